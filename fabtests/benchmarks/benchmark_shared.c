@@ -31,14 +31,54 @@
  * SOFTWARE.
  */
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
 
 #include <rdma/fi_errno.h>
+#include <rdma/fi_tagged.h>
 
 #include "shared.h"
 #include "benchmark_shared.h"
 
+/* Post the sends of a bandwidth window with FI_MORE */
+static int bw_tx_more;
+/* Report the CPU time spent per transfer */
+static int report_cpu;
+static struct rusage ru_start, ru_end;
+/* Record the time of each transfer and report its distribution */
+static int report_lat;
+static uint64_t *lat_ns;
+static int lat_cnt, lat_size;
+static struct timespec lat_last;
+
+#if HAVE_SCHED_SETAFFINITY == 1
+#include <sched.h>
+
+/* Pin the process to a comma separated list of CPUs */
+static void ft_set_affinity(char *cpus)
+{
+	cpu_set_t set;
+	char *cpu, *saveptr;
+
+	CPU_ZERO(&set);
+	for (cpu = strtok_r(cpus, ",", &saveptr); cpu;
+	     cpu = strtok_r(NULL, ",", &saveptr))
+		CPU_SET(atoi(cpu), &set);
+
+	if (sched_setaffinity(0, sizeof(set), &set))
+		FT_PRINTERR("sched_setaffinity", -errno);
+}
+#else
+static void ft_set_affinity(char *cpus)
+{
+	FT_ERR("CPU affinity is not supported on this platform");
+}
+#endif
+
 void ft_parse_benchmark_opts(int op, char *optarg)
 {
 	switch (op) {
@@ -54,6 +94,18 @@ void ft_parse_benchmark_opts(int op, char *optarg)
 	case 'W':
 		opts.window_size = atoi(optarg);
 		break;
+	case 'A':
+		ft_set_affinity(optarg);
+		break;
+	case 'G':
+		bw_tx_more = 1;
+		break;
+	case 'U':
+		report_cpu = 1;
+		break;
+	case 'L':
+		report_lat = 1;
+		break;
 	default:
 		break;
 	}
@@ -64,12 +116,186 @@ void ft_benchmark_usage(void)
 	FT_PRINT_OPTS_USAGE("-v", "enables data_integrity checks");
 	FT_PRINT_OPTS_USAGE("-k", "force prefix mode");
 	FT_PRINT_OPTS_USAGE("-j", "maximum inject message size");
+	FT_PRINT_OPTS_USAGE("-A <cpu,...>", "pin the process to the given CPUs");
+	FT_PRINT_OPTS_USAGE("-G", "post each bandwidth window with FI_MORE set "
+			    "on all but its last send");
+	FT_PRINT_OPTS_USAGE("-U", "report user and system CPU time per transfer");
+	FT_PRINT_OPTS_USAGE("-L", "report latency percentiles and histogram");
 	FT_PRINT_OPTS_USAGE("-W", "window size* (for bandwidth tests)\n\n"
 			"* The following condition is required to have at least "
 			"one window\nsize # of messsages to be sent: "
 			"# of iterations > window size");
 }
 
+/* Tags of unmatched receives, above any tag used by the tests */
+#define FT_UNMATCHED_TAG_BASE (1ULL << 48)
+
+/*
+ * Posts depth receives whose tags are never sent, so that every message of
+ * a tagged test is matched against a posted receive queue of that depth.
+ */
+int ft_post_unmatched_trecv(size_t depth, struct fi_context *ctx)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < depth; i++) {
+		ret = fi_trecv(ep, rx_buf, rx_size, mr_desc, 0,
+			       FT_UNMATCHED_TAG_BASE + i, 0, &ctx[i]);
+		if (ret) {
+			FT_PRINTERR("fi_trecv", ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Sizes the sample array for a run before it starts, so that no allocation
+ * happens while transfers are timed.  A run records at most one sample per
+ * iteration.
+ */
+static int bench_lat_alloc(void)
+{
+	uint64_t *samples;
+
+	lat_cnt = 0;
+	if (!report_lat || opts.iterations <= lat_size)
+		return 0;
+
+	samples = realloc(lat_ns, opts.iterations * sizeof(*lat_ns));
+	if (!samples)
+		return -FI_ENOMEM;
+
+	lat_ns = samples;
+	lat_size = opts.iterations;
+	return 0;
+}
+
+/* Records the time per transfer since the previous sample */
+static void bench_lat_sample(int xfers)
+{
+	struct timespec now;
+
+	if (!report_lat || !(opts.options & FT_OPT_ACTIVE) || !xfers ||
+	    lat_cnt == lat_size)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	lat_ns[lat_cnt++] = get_elapsed(&lat_last, &now, NANO) / xfers;
+	lat_last = now;
+}
+
+static int bench_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted samples, in usec */
+static double bench_lat_pct(double pct)
+{
+	double pos = pct / 100.0 * lat_cnt;
+	int rank = (int) pos;
+
+	if (rank < pos)
+		rank++;
+	return lat_ns[rank ? rank - 1 : 0] / 1000.0;
+}
+
+/* Counts the samples in power of two usec buckets */
+static void bench_show_lat_hist(void)
+{
+	uint64_t limit = 1000;
+	char label[48];
+	int i = 0, cnt;
+
+	printf("%-20s%s\n", "usec/xfer", "count");
+	while (i < lat_cnt) {
+		for (cnt = 0; i < lat_cnt && lat_ns[i] < limit; i++)
+			cnt++;
+
+		if (cnt) {
+			if (limit == 1000)
+				snprintf(label, sizeof(label), "< 1");
+			else
+				snprintf(label, sizeof(label), "%" PRIu64 " - %"
+					 PRIu64, limit / 2000, limit / 1000);
+			printf("%-20s%d\n", label, cnt);
+		}
+		limit *= 2;
+	}
+}
+
+static void bench_show_lat(void)
+{
+	printf("latency usec/xfer: min %.2f, p50 %.2f, p90 %.2f, p99 %.2f, "
+	       "p99.9 %.2f, max %.2f\n", lat_ns[0] / 1000.0,
+	       bench_lat_pct(50), bench_lat_pct(90), bench_lat_pct(99),
+	       bench_lat_pct(99.9), lat_ns[lat_cnt - 1] / 1000.0);
+	bench_show_lat_hist();
+}
+
+static void bench_start(void)
+{
+	ft_start();
+	if (report_cpu)
+		getrusage(RUSAGE_SELF, &ru_start);
+	if (report_lat)
+		lat_last = start;
+}
+
+static void bench_stop(void)
+{
+	if (report_cpu)
+		getrusage(RUSAGE_SELF, &ru_end);
+	ft_stop();
+}
+
+static int64_t bench_tv_usec(struct timeval *start, struct timeval *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000000 +
+	       (end->tv_usec - start->tv_usec);
+}
+
+static void bench_show_perf(int xfers_per_iter)
+{
+	double user, sys, xfers;
+	char fields[256];
+
+	if (lat_cnt)
+		qsort(lat_ns, lat_cnt, sizeof(*lat_ns), bench_cmp_u64);
+
+	if (opts.machr) {
+		if (lat_cnt)
+			snprintf(fields, sizeof(fields), "lat_min: %f, "
+				 "lat_p50: %f, lat_p90: %f, lat_p99: %f, "
+				 "lat_p99.9: %f, lat_max: %f",
+				 lat_ns[0] / 1000.0, bench_lat_pct(50),
+				 bench_lat_pct(90), bench_lat_pct(99),
+				 bench_lat_pct(99.9),
+				 lat_ns[lat_cnt - 1] / 1000.0);
+		show_perf_mr_fields(opts.transfer_size, opts.iterations, &start,
+				    &end, xfers_per_iter, opts.argc, opts.argv,
+				    lat_cnt ? fields : NULL);
+		return;
+	}
+
+	show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end,
+		  xfers_per_iter);
+	if (lat_cnt)
+		bench_show_lat();
+	if (!report_cpu)
+		return;
+
+	xfers = (double) opts.iterations * xfers_per_iter;
+	user = bench_tv_usec(&ru_start.ru_utime, &ru_end.ru_utime) / xfers;
+	sys = bench_tv_usec(&ru_start.ru_stime, &ru_end.ru_stime) / xfers;
+	printf("cpu usec/xfer: %.2f (user %.2f, sys %.2f)\n",
+	       user + sys, user, sys);
+}
+
 int ft_bw_init(void)
 {
 	if (opts.window_size > 0) {
@@ -84,6 +310,10 @@ int pingpong(void)
 {
 	int ret, i;
 
+	ret = bench_lat_alloc();
+	if (ret)
+		return ret;
+
 	ret = ft_sync();
 	if (ret)
 		return ret;
@@ -91,7 +321,7 @@ int pingpong(void)
 	if (opts.dst_addr) {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
-				ft_start();
+				bench_start();
 
 			if (opts.transfer_size < fi->tx_attr->inject_size)
 				ret = ft_inject(ep, remote_fi_addr, opts.transfer_size);
@@ -103,11 +333,12 @@ int pingpong(void)
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
 				return ret;
+			bench_lat_sample(2);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
-				ft_start();
+				bench_start();
 
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
@@ -119,19 +350,35 @@ int pingpong(void)
 				ret = ft_tx(ep, remote_fi_addr, opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+			bench_lat_sample(2);
 		}
 	}
-	ft_stop();
+	bench_stop();
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end, 2,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 2);
+	bench_show_perf(2);
 
 	return 0;
 }
 
+/*
+ * FI_MORE tells the provider that another send follows, so it may hold the
+ * send back and transmit the whole window together when the last send,
+ * which clears the flag, is posted.
+ */
+static int bw_post_tx_more(int last, struct fi_context *ctx)
+{
+	int ret;
+
+	ret = ft_sendmsg(ep, remote_fi_addr,
+			 opts.transfer_size + ft_tx_prefix_size(), ctx,
+			 last ? 0 : FI_MORE);
+	if (ret)
+		return ret;
+
+	tx_seq++;
+	return 0;
+}
+
 static int bw_tx_comp()
 {
 	int ret;
@@ -157,6 +404,10 @@ int bandwidth(void)
 {
 	int ret, i, j;
 
+	ret = bench_lat_alloc();
+	if (ret)
+		return ret;
+
 	ret = ft_sync();
 	if (ret)
 		return ret;
@@ -171,9 +422,13 @@ int bandwidth(void)
 	if (opts.dst_addr) {
 		for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
-				ft_start();
+				bench_start();
 
-			if (opts.transfer_size < fi->tx_attr->inject_size)
+			if (bw_tx_more)
+				ret = bw_post_tx_more(j + 1 == opts.window_size ||
+					i + 1 == opts.iterations + opts.warmup_iterations,
+					&tx_ctx_arr[j]);
+			else if (opts.transfer_size < fi->tx_attr->inject_size)
 				ret = ft_inject(ep, remote_fi_addr, opts.transfer_size);
 			else
 				ret = ft_post_tx(ep, remote_fi_addr, opts.transfer_size,
@@ -185,16 +440,18 @@ int bandwidth(void)
 				ret = bw_tx_comp();
 				if (ret)
 					return ret;
+				bench_lat_sample(j);
 				j = 0;
 			}
 		}
 		ret = bw_tx_comp();
 		if (ret)
 			return ret;
+		bench_lat_sample(j);
 	} else {
 		for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
-				ft_start();
+				bench_start();
 
 			ret = ft_post_rx(ep, opts.transfer_size, &tx_ctx_arr[j]);
 			if (ret)
@@ -204,20 +461,18 @@ int bandwidth(void)
 				ret = bw_rx_comp();
 				if (ret)
 					return ret;
+				bench_lat_sample(j);
 				j = 0;
 			}
 		}
 		ret = bw_rx_comp();
 		if (ret)
 			return ret;
+		bench_lat_sample(j);
 	}
-	ft_stop();
+	bench_stop();
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end, 1,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 1);
+	bench_show_perf(1);
 
 	return 0;
 }
@@ -245,13 +500,17 @@ int bandwidth_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 {
 	int ret, i, j;
 
+	ret = bench_lat_alloc();
+	if (ret)
+		return ret;
+
 	ret = ft_sync();
 	if (ret)
 		return ret;
 
 	for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 		if (i == opts.warmup_iterations)
-			ft_start();
+			bench_start();
 
 		switch (rma_op) {
 		case FT_RMA_WRITE:
@@ -303,18 +562,16 @@ int bandwidth_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 			ret = bw_rma_comp(rma_op);
 			if (ret)
 				return ret;
+			bench_lat_sample(j);
 			j = 0;
 		}
 	}
 	ret = bw_rma_comp(rma_op);
 	if (ret)
 		return ret;
-	ft_stop();
+	bench_lat_sample(j);
+	bench_stop();
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end,	1,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 1);
+	bench_show_perf(1);
 	return 0;
 }
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Multi-threaded memory registration rate test.  Every thread repeatedly
+ * registers and closes each buffer of its working set.  With a registration
+ * cache in the provider, repeated registrations of the same buffer turn into
+ * cache hits, so this measures how well lookups scale with thread count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_domain.h>
+
+#include <shared.h>
+
+static int max_threads = 4;
+static int num_bufs = 16;
+static int shared_bufs;
+static char *bufs;
+
+static pthread_barrier_t barrier;
+
+struct reg_thread {
+	pthread_t thread;
+	char *bufs;
+	uint64_t key;
+	int ret;
+};
+
+static void *reg_thread_run(void *arg)
+{
+	struct reg_thread *ctx = arg;
+	struct fid_mr *mr;
+	int i, j;
+
+	pthread_barrier_wait(&barrier);
+
+	for (i = 0; i < opts.iterations; i++) {
+		for (j = 0; j < num_bufs; j++) {
+			ctx->ret = fi_mr_reg(domain, ctx->bufs +
+					     j * opts.transfer_size,
+					     opts.transfer_size,
+					     ft_info_to_mr_access(fi), 0,
+					     ctx->key + j, 0, &mr, NULL);
+			if (ctx->ret) {
+				FT_PRINTERR("fi_mr_reg", ctx->ret);
+				goto out;
+			}
+
+			ctx->ret = fi_close(&mr->fid);
+			if (ctx->ret) {
+				FT_PRINTERR("fi_close", ctx->ret);
+				goto out;
+			}
+		}
+	}
+out:
+	pthread_barrier_wait(&barrier);
+	return NULL;
+}
+
+static int run_threads(int nthreads)
+{
+	struct reg_thread *ctx;
+	struct timespec start, end;
+	int64_t usec;
+	long long regs;
+	int i, ret;
+
+	ctx = calloc(nthreads, sizeof(*ctx));
+	if (!ctx)
+		return -FI_ENOMEM;
+
+	ret = pthread_barrier_init(&barrier, NULL, nthreads + 1);
+	if (ret) {
+		free(ctx);
+		return -ret;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		ctx[i].bufs = shared_bufs ? bufs :
+			      bufs + (size_t) i * num_bufs * opts.transfer_size;
+		/* requested keys must be unique while registrations overlap */
+		ctx[i].key = FT_MR_KEY + (uint64_t) i * num_bufs;
+		ret = pthread_create(&ctx[i].thread, NULL, reg_thread_run,
+				     &ctx[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", -ret);
+			/* threads already started wait on the barrier forever */
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(ctx[i].thread, NULL);
+		if (ctx[i].ret && !ret)
+			ret = ctx[i].ret;
+	}
+
+	if (!ret) {
+		usec = get_elapsed(&start, &end, MICRO);
+		regs = (long long) nthreads * opts.iterations * num_bufs;
+		printf("%-8d %-10zu %-12lld %-10.2f %-14.2f %.3f\n",
+		       nthreads, opts.transfer_size, regs, usec / 1000000.0,
+		       usec ? regs * 1000000.0 / usec : 0.0,
+		       regs ? (double) usec / regs * nthreads : 0.0);
+	}
+
+	pthread_barrier_destroy(&barrier);
+	free(ctx);
+	return ret;
+}
+
+static int run(void)
+{
+	size_t size;
+	int i, ret;
+
+	size = (size_t) num_bufs * opts.transfer_size;
+	if (!shared_bufs)
+		size *= max_threads;
+
+	bufs = malloc(size);
+	if (!bufs)
+		return -FI_ENOMEM;
+	memset(bufs, 0, size);
+
+	printf("%-8s %-10s %-12s %-10s %-14s %s\n", "threads", "bytes",
+	       "regs", "sec", "regs/sec", "usec/reg/thread");
+
+	for (i = 1; ; i <<= 1) {
+		if (i > max_threads)
+			i = max_threads;
+		ret = run_threads(i);
+		if (ret || i == max_threads)
+			break;
+	}
+
+	free(bufs);
+	bufs = NULL;
+	return ret;
+}
+
+static void usage(char *name)
+{
+	ft_usage(name, "Multi-threaded memory registration rate test");
+	FT_PRINT_OPTS_USAGE("-T <threads>", "maximum number of threads, "
+			    "run doubles from 1 (default 4)");
+	FT_PRINT_OPTS_USAGE("-n <bufs>", "buffers registered per thread "
+			    "(default 16)");
+	FT_PRINT_OPTS_USAGE("-x", "all threads register the same buffers");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.iterations = 10000;
+	opts.transfer_size = 4096;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "T:n:xI:S:h" INFO_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints);
+			break;
+		case 'I':
+		case 'S':
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			max_threads = atoi(optarg);
+			break;
+		case 'n':
+			num_bufs = atoi(optarg);
+			break;
+		case 'x':
+			shared_bufs = 1;
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (max_threads < 1 || num_bufs < 1 || opts.iterations < 1 ||
+	    !opts.transfer_size) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+	hints->domain_attr->threading = FI_THREAD_SAFE;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		goto out;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = run();
+out:
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Connection setup rate test.  The client starts connecting all of its
+ * endpoints at once, or keeps at most -w connects outstanding, and the
+ * server accepts each request as it arrives.  Both sides report how long
+ * it took to establish every connection.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+
+#include <shared.h>
+
+static int num_conns = 256;
+static int window;
+static struct fid_ep **eps;
+static struct fid_cq *conn_cq;
+static int num_eps;
+
+static int open_ep(struct fi_info *info, struct fid_ep **ep_fid)
+{
+	int ret;
+
+	ret = fi_endpoint(domain, info, ep_fid, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(*ep_fid, &eq->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(*ep_fid, &conn_cq->fid, FI_TRANSMIT | FI_RECV);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_enable(*ep_fid);
+	if (ret)
+		FT_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+static int open_cq(void)
+{
+	struct fi_cq_attr attr = {
+		.format = FI_CQ_FORMAT_CONTEXT,
+		.wait_obj = FI_WAIT_NONE,
+	};
+	int ret;
+
+	ret = fi_cq_open(domain, &attr, &conn_cq, NULL);
+	if (ret)
+		FT_PRINTERR("fi_cq_open", ret);
+	return ret;
+}
+
+static void show_rate(void)
+{
+	int64_t usec;
+
+	usec = get_elapsed(&start, &end, MICRO);
+	printf("%-12s %-10s %s\n", "connections", "sec", "conn/sec");
+	printf("%-12d %-10.3f %.0f\n", num_conns, usec / 1000000.0,
+	       usec ? num_conns * 1000000.0 / usec : 0.0);
+}
+
+/* Waits for the next CM event, returning -FI_EAGAIN if there is none */
+static int read_cm_event(uint32_t *event, struct fi_eq_cm_entry *entry)
+{
+	ssize_t ret;
+
+	ret = fi_eq_sread(eq, event, entry, sizeof(*entry), 1000, 0);
+	if (ret == sizeof(*entry))
+		return 0;
+	if (ret == -FI_EAGAIN)
+		return (int) ret;
+
+	FT_PROCESS_EQ_ERR(ret, eq, "fi_eq_sread", "cm");
+	return ret < 0 ? (int) ret : -FI_EOTHER;
+}
+
+static int run_server(void)
+{
+	struct fi_eq_cm_entry entry;
+	uint32_t event;
+	int ret, connected = 0;
+
+	ret = ft_start_server();
+	if (ret)
+		return ret;
+
+	while (connected < num_conns) {
+		ret = read_cm_event(&event, &entry);
+		if (ret == -FI_EAGAIN)
+			continue;
+		if (ret)
+			return ret;
+
+		switch (event) {
+		case FI_CONNREQ:
+			if (!domain) {
+				ft_start();
+				ret = fi_domain(fabric, entry.info, &domain,
+						NULL);
+				if (ret) {
+					FT_PRINTERR("fi_domain", ret);
+					goto reject;
+				}
+
+				ret = open_cq();
+				if (ret)
+					goto reject;
+			}
+
+			if (num_eps == num_conns) {
+				ret = -FI_EOTHER;
+				goto reject;
+			}
+
+			ret = open_ep(entry.info, &eps[num_eps]);
+			if (ret)
+				goto reject;
+
+			ret = fi_accept(eps[num_eps++], NULL, 0);
+			fi_freeinfo(entry.info);
+			if (ret) {
+				FT_PRINTERR("fi_accept", ret);
+				return ret;
+			}
+			break;
+		case FI_CONNECTED:
+			connected++;
+			break;
+		default:
+			fprintf(stderr, "Unexpected CM event %d\n", event);
+			return -FI_EOTHER;
+		}
+	}
+	ft_stop();
+
+	show_rate();
+	return 0;
+
+reject:
+	fi_reject(pep, entry.info->handle, NULL, 0);
+	fi_freeinfo(entry.info);
+	return ret;
+}
+
+/* Progresses the connections until the server closes them */
+static int wait_shutdown(void)
+{
+	struct fi_cq_entry comp;
+	struct fi_eq_cm_entry entry;
+	uint32_t event;
+	ssize_t ret;
+
+	for (;;) {
+		ret = fi_cq_read(conn_cq, &comp, 1);
+		if (ret < 0 && ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return (int) ret;
+		}
+
+		ret = fi_eq_read(eq, &event, &entry, sizeof(entry), 0);
+		if (ret == sizeof(entry) && event == FI_SHUTDOWN)
+			return 0;
+		if (ret < 0 && ret != -FI_EAGAIN) {
+			FT_PROCESS_EQ_ERR(ret, eq, "fi_eq_read", "shutdown");
+			return (int) ret;
+		}
+
+		usleep(1000);
+	}
+}
+
+static int run_client(void)
+{
+	struct fi_eq_cm_entry entry;
+	uint32_t event;
+	int ret, connected = 0;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = open_cq();
+	if (ret)
+		return ret;
+
+	ft_start();
+	while (connected < num_conns) {
+		while (num_eps < num_conns &&
+		       (!window || num_eps - connected < window)) {
+			ret = open_ep(fi, &eps[num_eps]);
+			if (ret)
+				return ret;
+
+			ret = fi_connect(eps[num_eps++], fi->dest_addr,
+					 NULL, 0);
+			if (ret) {
+				FT_PRINTERR("fi_connect", ret);
+				return ret;
+			}
+		}
+
+		ret = read_cm_event(&event, &entry);
+		if (ret == -FI_EAGAIN)
+			continue;
+		if (ret)
+			return ret;
+
+		if (event != FI_CONNECTED) {
+			fprintf(stderr, "Unexpected CM event %d\n", event);
+			return -FI_EOTHER;
+		}
+		connected++;
+	}
+	ft_stop();
+
+	show_rate();
+	return wait_shutdown();
+}
+
+static void close_eps(void)
+{
+	int i;
+
+	for (i = 0; i < num_eps; i++)
+		FT_CLOSE_FID(eps[i]);
+	FT_CLOSE_FID(conn_cq);
+	free(eps);
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "n:w:h" CS_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'n':
+			num_conns = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Connection setup rate.");
+			FT_PRINT_OPTS_USAGE("-n <conns>", "number of connections "
+					    "(default 256)");
+			FT_PRINT_OPTS_USAGE("-w <window>", "client connects "
+					    "outstanding (default all)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (num_conns < 1 || window < 0) {
+		ft_csusage(argv[0], "Connection setup rate.");
+		return EXIT_FAILURE;
+	}
+
+	hints->ep_attr->type = FI_EP_MSG;
+	hints->caps = FI_MSG;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+
+	eps = calloc(num_conns, sizeof(*eps));
+	if (!eps)
+		return EXIT_FAILURE;
+
+	ret = opts.dst_addr ? run_client() : run_server();
+
+	close_eps();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * CQ poll cost test.  The client opens connections to the server one at a
+ * time, and all server endpoints share a single CQ.  Each time the number
+ * of connections doubles, the server times reads of its empty CQ, showing
+ * how the cost of polling grows with the number of idle endpoints.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+
+#include <shared.h>
+
+static int max_eps = 256;
+static struct fid_ep **eps;
+static struct fid_cq *poll_cq;
+static int num_eps;
+
+static int open_ep(struct fi_info *info, struct fid_ep **ep_fid)
+{
+	int ret;
+
+	ret = fi_endpoint(domain, info, ep_fid, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(*ep_fid, &eq->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(*ep_fid, &poll_cq->fid, FI_TRANSMIT | FI_RECV);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_enable(*ep_fid);
+	if (ret)
+		FT_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+static int open_cq(void)
+{
+	struct fi_cq_attr attr = {
+		.format = FI_CQ_FORMAT_CONTEXT,
+		.wait_obj = FI_WAIT_NONE,
+	};
+	int ret;
+
+	ret = fi_cq_open(domain, &attr, &poll_cq, NULL);
+	if (ret)
+		FT_PRINTERR("fi_cq_open", ret);
+	return ret;
+}
+
+static int poll_empty_cq(void)
+{
+	struct fi_cq_entry comp;
+	struct timespec start, end;
+	int64_t usec;
+	ssize_t ret;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < opts.iterations; i++) {
+		ret = fi_cq_read(poll_cq, &comp, 1);
+		if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return ret < 0 ? (int) ret : -FI_EOTHER;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	usec = get_elapsed(&start, &end, MICRO);
+	printf("%-10d %-10d %-10.2f %.3f\n", num_eps, opts.iterations,
+	       usec / 1000000.0, (double) usec / opts.iterations);
+	return 0;
+}
+
+static int run_server(void)
+{
+	struct fi_info *info;
+	int ret;
+
+	ret = ft_start_server();
+	if (ret)
+		return ret;
+
+	printf("%-10s %-10s %-10s %s\n", "endpoints", "polls", "sec",
+	       "usec/poll");
+
+	for (num_eps = 0; num_eps < max_eps; ) {
+		ret = ft_retrieve_conn_req(eq, &info);
+		if (ret)
+			return ret;
+
+		if (!domain) {
+			ret = fi_domain(fabric, info, &domain, NULL);
+			if (ret) {
+				FT_PRINTERR("fi_domain", ret);
+				goto reject;
+			}
+
+			ret = open_cq();
+			if (ret)
+				goto reject;
+		}
+
+		ret = open_ep(info, &eps[num_eps]);
+		if (ret)
+			goto reject;
+
+		ret = ft_accept_connection(eps[num_eps], eq);
+		fi_freeinfo(info);
+		if (ret)
+			return ret;
+
+		num_eps++;
+		if (!(num_eps & (num_eps - 1)) || num_eps == max_eps) {
+			ret = poll_empty_cq();
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+
+reject:
+	fi_reject(pep, info->handle, NULL, 0);
+	fi_freeinfo(info);
+	return ret;
+}
+
+/* Progresses the connections until the server closes them */
+static int wait_shutdown(void)
+{
+	struct fi_cq_entry comp;
+	struct fi_eq_cm_entry entry;
+	uint32_t event;
+	ssize_t ret;
+
+	for (;;) {
+		ret = fi_cq_read(poll_cq, &comp, 1);
+		if (ret < 0 && ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return (int) ret;
+		}
+
+		ret = fi_eq_read(eq, &event, &entry, sizeof(entry), 0);
+		if (ret == sizeof(entry) && event == FI_SHUTDOWN)
+			return 0;
+		if (ret < 0 && ret != -FI_EAGAIN) {
+			FT_PROCESS_EQ_ERR(ret, eq, "fi_eq_read", "shutdown");
+			return (int) ret;
+		}
+
+		/* leave the CPU to the server while it measures */
+		usleep(1000);
+	}
+}
+
+static int run_client(void)
+{
+	int ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = open_cq();
+	if (ret)
+		return ret;
+
+	for (num_eps = 0; num_eps < max_eps; num_eps++) {
+		ret = open_ep(fi, &eps[num_eps]);
+		if (ret)
+			return ret;
+
+		ret = ft_connect_ep(eps[num_eps], eq, fi->dest_addr);
+		if (ret)
+			return ret;
+	}
+
+	return wait_shutdown();
+}
+
+static void close_eps(void)
+{
+	int i;
+
+	for (i = 0; i < num_eps; i++)
+		FT_CLOSE_FID(eps[i]);
+	FT_CLOSE_FID(poll_cq);
+	free(eps);
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.iterations = 10000;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "n:h" CS_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'n':
+			max_eps = atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "CQ poll cost with many idle "
+				   "connected endpoints.");
+			FT_PRINT_OPTS_USAGE("-n <eps>", "number of connections "
+					    "(default 256)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (max_eps < 1 || opts.iterations < 1) {
+		ft_csusage(argv[0], "CQ poll cost with many idle "
+			   "connected endpoints.");
+		return EXIT_FAILURE;
+	}
+
+	hints->ep_attr->type = FI_EP_MSG;
+	hints->caps = FI_MSG;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+
+	eps = calloc(max_eps, sizeof(*eps));
+	if (!eps)
+		return EXIT_FAILURE;
+
+	ret = opts.dst_addr ? run_client() : run_server();
+
+	close_eps();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
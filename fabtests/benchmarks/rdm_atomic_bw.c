@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Atomic bandwidth test.  Both sides issue windows of write and fetch
+ * atomics to each other for every supported operation and datatype, with
+ * element counts doubling from 1 up to the requested or provider maximum.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_atomic.h>
+
+#include <shared.h>
+#include "benchmark_shared.h"
+
+/* Largest datatype, FI_LONG_DOUBLE_COMPLEX */
+#define MAX_DATATYPE_SIZE 32
+
+static size_t max_count = 65536;
+static void *result;
+static struct fid_mr *mr_result;
+static struct fi_context *ctx_arr;
+
+static int run_count(enum fi_op op, enum fi_datatype datatype, int fetch,
+		     size_t count)
+{
+	int i, len, ret;
+
+	opts.transfer_size = count * datatype_to_size(datatype);
+	len = snprintf(test_name, sizeof test_name, "%s_%s_",
+		       fetch ? "fetch" : "write",
+		       fi_tostr(&op, FI_TYPE_ATOMIC_OP));
+	snprintf(test_name + len, sizeof test_name - len, "%s_%zu",
+		 fi_tostr(&datatype, FI_TYPE_ATOMIC_TYPE), count);
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	ft_start();
+	for (i = 0; i < opts.iterations; i++) {
+		ret = ft_post_atomic(fetch ? FT_ATOMIC_FETCH : FT_ATOMIC_BASE,
+				     ep, NULL, NULL, result,
+				     fi_mr_desc(mr_result), &remote, datatype,
+				     op, &ctx_arr[i % opts.window_size]);
+		if (ret)
+			return ret;
+
+		if (!((i + 1) % opts.window_size)) {
+			ret = ft_get_tx_comp(tx_seq);
+			if (ret)
+				return ret;
+		}
+	}
+	ret = ft_get_tx_comp(tx_seq);
+	if (ret)
+		return ret;
+	ft_stop();
+
+	if (opts.machr)
+		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end,
+			     1, opts.argc, opts.argv);
+	else
+		show_perf(test_name, opts.transfer_size, opts.iterations,
+			  &start, &end, 1);
+	return 0;
+}
+
+static int run_op(enum fi_op op, enum fi_datatype datatype, int fetch)
+{
+	size_t count, valid_count;
+	int ret;
+
+	ret = fetch ? check_fetch_atomic_op(ep, op, datatype, &valid_count) :
+		      check_base_atomic_op(ep, op, datatype, &valid_count);
+	if (ret == -FI_ENOSYS || ret == -FI_EOPNOTSUPP)
+		return 0;
+	else if (ret)
+		return ret;
+
+	for (count = 1; count <= MIN(max_count, valid_count); count <<= 1) {
+		ret = run_count(op, datatype, fetch, count);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int run_ops(void)
+{
+	enum fi_datatype datatype;
+	enum fi_op op;
+	int ret;
+
+	for (op = FI_MIN; op <= FI_ATOMIC_WRITE; op++) {
+		for (datatype = 0; datatype < FI_DATATYPE_LAST; datatype++) {
+			if (op != FI_ATOMIC_READ) {
+				ret = run_op(op, datatype, 0);
+				if (ret)
+					return ret;
+			}
+
+			ret = run_op(op, datatype, 1);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static int alloc_res(void)
+{
+	int ret;
+
+	ctx_arr = calloc(opts.window_size, sizeof(*ctx_arr));
+	result = malloc(max_count * MAX_DATATYPE_SIZE);
+	if (!ctx_arr || !result)
+		return -FI_ENOMEM;
+
+	ret = fi_mr_reg(domain, result, max_count * MAX_DATATYPE_SIZE,
+			FI_READ | FI_WRITE, 0, FT_MR_KEY + 1, 0,
+			&mr_result, NULL);
+	if (ret)
+		FT_PRINTERR("fi_mr_reg", ret);
+	return ret;
+}
+
+static void free_res(void)
+{
+	FT_CLOSE_FID(mr_result);
+	free(result);
+	free(ctx_arr);
+}
+
+static int run(void)
+{
+	int ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ret = alloc_res();
+	if (ret)
+		return ret;
+
+	ret = ft_exchange_keys(&remote);
+	if (ret)
+		return ret;
+
+	ret = run_ops();
+	if (ret)
+		return ret;
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_BW | FT_OPT_SIZE;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG | FI_ATOMIC;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+
+	while ((op = getopt(argc, argv, "hC:T" CS_OPTS INFO_OPTS BENCHMARK_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'C':
+			max_count = strtoul(optarg, NULL, 0);
+			break;
+		case 'T':
+			hints->domain_attr->threading = FI_THREAD_SAFE;
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Bandwidth test using atomic operations.");
+			ft_benchmark_usage();
+			FT_PRINT_OPTS_USAGE("-C <count>", "maximum number of "
+					    "elements per atomic (default 65536)");
+			FT_PRINT_OPTS_USAGE("-T", "request FI_THREAD_SAFE instead "
+					    "of FI_THREAD_DOMAIN");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (!max_count) {
+		ft_csusage(argv[0], "Bandwidth test using atomic operations.");
+		return EXIT_FAILURE;
+	}
+	/* sizes the data buffers for the largest atomic */
+	opts.transfer_size = max_count * MAX_DATATYPE_SIZE;
+
+	ret = run();
+
+	free_res();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
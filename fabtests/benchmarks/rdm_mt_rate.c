@@ -0,0 +1,827 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Multi-threaded message rate test.  Client thread i streams windows of
+ * tagged messages to server thread i, which acknowledges each window.
+ * Threads either use their own endpoint, share a single FI_THREAD_SAFE
+ * endpoint, or use their own context of a scalable endpoint.  In incast
+ * mode every client thread has its own endpoint and all of them send to a
+ * single FI_THREAD_SAFE endpoint on the server, measuring how the receive
+ * side scales with the number of senders.  The main endpoint is only used
+ * for address exchange and synchronization.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_tagged.h>
+
+#include <shared.h>
+#include "benchmark_shared.h"
+
+#define MT_CQ_BATCH	16
+#define MT_ACK_SIZE	4
+#define MT_TAG		0x4d540000ULL
+
+enum mt_mode {
+	MT_MODE_EP,
+	MT_MODE_SHARED,
+	MT_MODE_SEP,
+	MT_MODE_INCAST,
+};
+
+static const char *mt_mode_str[] = {
+	[MT_MODE_EP] = "ep",
+	[MT_MODE_SHARED] = "shared",
+	[MT_MODE_SEP] = "sep",
+	[MT_MODE_INCAST] = "incast",
+};
+
+/* Completions are counted by the thread that posted the operation, which
+ * may differ from the thread reading the CQ when the endpoint is shared. */
+struct mt_ctx {
+	struct fi_context	ctx;
+	uint64_t		*cnt;
+};
+
+struct mt_thread {
+	pthread_t		thread;
+	int			id;
+	struct fid_ep		*tx_ep;
+	struct fid_ep		*rx_ep;
+	struct fid_cq		*txcq;
+	struct fid_cq		*rxcq;
+	struct fid_mr		*mr;
+	void			*desc;
+	char			*buf;
+	fi_addr_t		addr;
+	uint64_t		tag;
+	struct mt_ctx		*ctx;
+	uint64_t		tx_comp;
+	uint64_t		rx_comp;
+	uint64_t		tx_posted;
+	uint64_t		rx_posted;
+	int64_t			usec;
+	int			ret;
+};
+
+static enum mt_mode mode = MT_MODE_EP;
+static int num_threads = 4;
+static size_t max_size;
+static struct mt_thread *threads;
+
+static struct fi_info *data_fi;
+static struct fid_ep *shared_ep;
+static struct fid_cq *shared_txcq, *shared_rxcq;
+static struct fid_ep *sep;
+static struct fid_av *sep_av;
+static int rx_ctx_bits;
+
+static pthread_barrier_t barrier;
+
+/* All threads of this side share one endpoint */
+static int mt_shared(void)
+{
+	return mode == MT_MODE_SHARED ||
+	       (mode == MT_MODE_INCAST && !opts.dst_addr);
+}
+
+static int mt_read_cq(struct fid_cq *cq)
+{
+	struct fi_cq_entry comp[MT_CQ_BATCH];
+	struct mt_ctx *ctx;
+	int i, ret;
+
+	ret = fi_cq_read(cq, comp, MT_CQ_BATCH);
+	if (ret > 0) {
+		for (i = 0; i < ret; i++) {
+			ctx = comp[i].op_context;
+			__sync_fetch_and_add(ctx->cnt, 1);
+		}
+		return 0;
+	}
+
+	if (ret == -FI_EAGAIN)
+		return 0;
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(cq);
+
+	FT_PRINTERR("fi_cq_read", ret);
+	return ret;
+}
+
+static int mt_progress(struct mt_thread *t)
+{
+	int ret;
+
+	ret = mt_read_cq(t->txcq);
+	if (ret)
+		return ret;
+
+	return mt_read_cq(t->rxcq);
+}
+
+static int mt_wait(struct mt_thread *t, uint64_t *cnt, uint64_t total)
+{
+	int ret;
+
+	while (*(volatile uint64_t *) cnt < total) {
+		ret = mt_progress(t);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int mt_send(struct mt_thread *t, size_t size, struct mt_ctx *ctx,
+		   int inject)
+{
+	ssize_t ret;
+
+	ctx->cnt = &t->tx_comp;
+	for (;;) {
+		ret = inject ? fi_tinject(t->tx_ep, t->buf, size, t->addr, t->tag) :
+		      fi_tsend(t->tx_ep, t->buf, size, t->desc, t->addr, t->tag,
+			       ctx);
+		if (!ret)
+			break;
+
+		if (ret != -FI_EAGAIN) {
+			if (inject)
+				FT_PRINTERR("fi_tinject", ret);
+			else
+				FT_PRINTERR("fi_tsend", ret);
+			return (int) ret;
+		}
+
+		ret = mt_progress(t);
+		if (ret)
+			return (int) ret;
+	}
+
+	if (!inject)
+		t->tx_posted++;
+	return 0;
+}
+
+static int mt_recv(struct mt_thread *t, size_t size, struct mt_ctx *ctx)
+{
+	ssize_t ret;
+
+	ctx->cnt = &t->rx_comp;
+	for (;;) {
+		ret = fi_trecv(t->rx_ep, t->buf + max_size, size, t->desc,
+			       FI_ADDR_UNSPEC, t->tag, 0, ctx);
+		if (!ret)
+			break;
+
+		if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_trecv", ret);
+			return (int) ret;
+		}
+
+		ret = mt_progress(t);
+		if (ret)
+			return (int) ret;
+	}
+
+	t->rx_posted++;
+	return 0;
+}
+
+static int mt_xfer(struct mt_thread *t, int iterations)
+{
+	int i, j, cnt, ret;
+
+	for (i = 0; i < iterations; i += opts.window_size) {
+		cnt = MIN(opts.window_size, iterations - i);
+
+		if (opts.dst_addr) {
+			ret = mt_recv(t, MT_ACK_SIZE, &t->ctx[opts.window_size]);
+			if (ret)
+				return ret;
+
+			for (j = 0; j < cnt; j++) {
+				ret = mt_send(t, opts.transfer_size, &t->ctx[j],
+					      opts.transfer_size <=
+					      fi->tx_attr->inject_size);
+				if (ret)
+					return ret;
+			}
+
+			ret = mt_wait(t, &t->tx_comp, t->tx_posted);
+			if (ret)
+				return ret;
+
+			ret = mt_wait(t, &t->rx_comp, t->rx_posted);
+		} else {
+			for (j = 0; j < cnt; j++) {
+				ret = mt_recv(t, opts.transfer_size, &t->ctx[j]);
+				if (ret)
+					return ret;
+			}
+
+			ret = mt_wait(t, &t->rx_comp, t->rx_posted);
+			if (ret)
+				return ret;
+
+			/* Nothing progresses the endpoint once every thread
+			 * is done, so the ack is not injected: waiting for its
+			 * completion makes sure it has left the provider. */
+			ret = mt_send(t, MT_ACK_SIZE, &t->ctx[opts.window_size],
+				      0);
+			if (ret)
+				return ret;
+
+			ret = mt_wait(t, &t->tx_comp, t->tx_posted);
+		}
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static void *mt_thread_run(void *arg)
+{
+	struct mt_thread *t = arg;
+	struct timespec a, b;
+
+	pthread_barrier_wait(&barrier);
+	t->ret = mt_xfer(t, opts.warmup_iterations);
+
+	pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	if (!t->ret)
+		t->ret = mt_xfer(t, opts.iterations);
+	clock_gettime(CLOCK_MONOTONIC, &b);
+	t->usec = get_elapsed(&a, &b, MICRO);
+
+	pthread_barrier_wait(&barrier);
+	return NULL;
+}
+
+static void mt_show_perf(int64_t usec)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	double rate, min_rate, max_rate, sum = 0, sum_sq = 0;
+	long long msgs;
+	int i;
+
+	if (header) {
+		printf("%-8s%-8s%-8s%8s %10s%13s%13s%13s%10s\n", "bytes",
+		       "threads", "msgs", "time", "MB/sec", "msgs/sec",
+		       "min/thread", "max/thread", "fairness");
+		header = 0;
+	}
+
+	min_rate = max_rate = 0;
+	for (i = 0; i < num_threads; i++) {
+		rate = threads[i].usec ? opts.iterations * 1000000.0 /
+		       threads[i].usec : 0;
+		if (!i || rate < min_rate)
+			min_rate = rate;
+		if (!i || rate > max_rate)
+			max_rate = rate;
+		sum += rate;
+		sum_sq += rate * rate;
+	}
+
+	msgs = (long long) opts.iterations * num_threads;
+	printf("%-8s", size_str(str, opts.transfer_size));
+	printf("%-8d", num_threads);
+	printf("%-8s", cnt_str(str, msgs));
+	/* Jain's fairness index, 1.0 when all threads ran at the same rate */
+	printf("%8.2fs%10.2f%13.0f%13.0f%13.0f%10.3f\n",
+	       usec / 1000000.0,
+	       usec ? (double) msgs * opts.transfer_size / usec : 0.0,
+	       usec ? msgs * 1000000.0 / usec : 0.0, min_rate, max_rate,
+	       sum_sq ? sum * sum / (num_threads * sum_sq) : 0.0);
+}
+
+static int mt_run_size(void)
+{
+	struct timespec a, b;
+	int i, ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	ret = pthread_barrier_init(&barrier, NULL, num_threads + 1);
+	if (ret)
+		return -ret;
+
+	for (i = 0; i < num_threads; i++) {
+		ret = pthread_create(&threads[i].thread, NULL, mt_thread_run,
+				     &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", -ret);
+			/* threads already started wait on the barrier forever */
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	pthread_barrier_wait(&barrier);
+	pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	pthread_barrier_wait(&barrier);
+	clock_gettime(CLOCK_MONOTONIC, &b);
+
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (threads[i].ret && !ret)
+			ret = threads[i].ret;
+	}
+	pthread_barrier_destroy(&barrier);
+
+	if (!ret)
+		mt_show_perf(get_elapsed(&a, &b, MICRO));
+	return ret;
+}
+
+static int mt_open_cqs(size_t size, struct fid_cq **txcq,
+		       struct fid_cq **rxcq)
+{
+	struct fi_cq_attr attr = {
+		.format = FI_CQ_FORMAT_CONTEXT,
+		.wait_obj = FI_WAIT_NONE,
+		.size = size,
+	};
+	int ret;
+
+	ret = fi_cq_open(domain, &attr, txcq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	ret = fi_cq_open(domain, &attr, rxcq, NULL);
+	if (ret)
+		FT_PRINTERR("fi_cq_open", ret);
+	return ret;
+}
+
+static int mt_open_ep(struct fid_ep **data_ep, struct fid_cq **txcq,
+		      struct fid_cq **rxcq)
+{
+	int ret;
+
+	ret = mt_open_cqs(fi->tx_attr->size * (mt_shared() ? num_threads : 1),
+			  txcq, rxcq);
+	if (ret)
+		return ret;
+
+	ret = fi_endpoint(domain, data_fi, data_ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	return ft_enable_ep(*data_ep, eq, av, *txcq, *rxcq, NULL, NULL);
+}
+
+static int mt_open_sep(void)
+{
+	struct fi_av_attr attr = av_attr;
+	struct fi_info *info;
+	int i, ret;
+
+	if (num_threads > fi->domain_attr->tx_ctx_cnt ||
+	    num_threads > fi->domain_attr->rx_ctx_cnt) {
+		fprintf(stderr, "Provider supports %zu tx and %zu rx contexts\n",
+			fi->domain_attr->tx_ctx_cnt,
+			fi->domain_attr->rx_ctx_cnt);
+		return -FI_EINVAL;
+	}
+
+	info = fi_dupinfo(data_fi);
+	if (!info)
+		return -FI_ENOMEM;
+
+	info->ep_attr->tx_ctx_cnt = num_threads;
+	info->ep_attr->rx_ctx_cnt = num_threads;
+	ret = fi_scalable_ep(domain, info, &sep, NULL);
+	fi_freeinfo(info);
+	if (ret) {
+		FT_PRINTERR("fi_scalable_ep", ret);
+		return ret;
+	}
+
+	while (num_threads >> ++rx_ctx_bits);
+	attr.rx_ctx_bits = rx_ctx_bits;
+	attr.count = 1;
+	ret = fi_av_open(domain, &attr, &sep_av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = fi_scalable_ep_bind(sep, &sep_av->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_scalable_ep_bind", ret);
+		return ret;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		ret = mt_open_cqs(fi->tx_attr->size, &threads[i].txcq,
+				  &threads[i].rxcq);
+		if (ret)
+			return ret;
+
+		ret = fi_tx_context(sep, i, NULL, &threads[i].tx_ep, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_tx_context", ret);
+			return ret;
+		}
+		FT_EP_BIND(threads[i].tx_ep, threads[i].txcq, FI_SEND);
+
+		ret = fi_enable(threads[i].tx_ep);
+		if (ret) {
+			FT_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+
+		ret = fi_rx_context(sep, i, NULL, &threads[i].rx_ep, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_rx_context", ret);
+			return ret;
+		}
+		FT_EP_BIND(threads[i].rx_ep, threads[i].rxcq, FI_RECV);
+
+		ret = fi_enable(threads[i].rx_ep);
+		if (ret) {
+			FT_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+	}
+
+	ret = fi_enable(sep);
+	if (ret) {
+		FT_PRINTERR("fi_enable", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Lock step with the peer, so rx_buf isn't overwritten before it's read */
+static int mt_exchange_name(struct fid *data_fid, struct fid_av *data_av,
+			    fi_addr_t *addr)
+{
+	size_t addrlen = FT_MAX_CTRL_MSG;
+	int ret;
+
+	ret = fi_getname(data_fid, (char *) tx_buf + ft_tx_prefix_size(),
+			 &addrlen);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	if (opts.dst_addr) {
+		ret = (int) ft_tx(ep, remote_fi_addr, addrlen, &tx_ctx);
+		if (ret)
+			return ret;
+
+		ret = (int) ft_rx(ep, FT_MAX_CTRL_MSG);
+		if (ret)
+			return ret;
+
+		return ft_av_insert(data_av, (char *) rx_buf +
+				    ft_rx_prefix_size(), 1, addr, 0, NULL);
+	}
+
+	ret = (int) ft_rx(ep, FT_MAX_CTRL_MSG);
+	if (ret)
+		return ret;
+
+	ret = ft_av_insert(data_av, (char *) rx_buf + ft_rx_prefix_size(),
+			   1, addr, 0, NULL);
+	if (ret)
+		return ret;
+
+	return (int) ft_tx(ep, remote_fi_addr, addrlen, &tx_ctx);
+}
+
+/*
+ * The main endpoint owns the requested source address, so the data
+ * endpoints are opened from an fi_info that lets the provider pick one.
+ */
+static int mt_getinfo(void)
+{
+	struct fi_info *info;
+	int ret;
+
+	info = fi_dupinfo(fi);
+	if (!info)
+		return -FI_ENOMEM;
+
+	free(info->src_addr);
+	free(info->dest_addr);
+	info->src_addr = info->dest_addr = NULL;
+	info->src_addrlen = info->dest_addrlen = 0;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, info, &data_fi);
+	fi_freeinfo(info);
+	if (ret)
+		FT_PRINTERR("fi_getinfo", ret);
+	return ret;
+}
+
+static int mt_init_threads(void)
+{
+	struct mt_thread *t;
+	fi_addr_t addr;
+	size_t size;
+	int i, ret;
+
+	ret = mt_getinfo();
+	if (ret)
+		return ret;
+
+	threads = calloc(num_threads, sizeof(*threads));
+	if (!threads)
+		return -FI_ENOMEM;
+
+	/* data buffers hold the send region followed by the receive region */
+	max_size = MAX(max_size, MT_ACK_SIZE);
+	size = max_size;
+	for (i = 0; i < num_threads; i++) {
+		t = &threads[i];
+		t->id = i;
+		t->tag = MT_TAG + i;
+		t->buf = calloc(2, size);
+		t->ctx = calloc(opts.window_size + 1, sizeof(*t->ctx));
+		if (!t->buf || !t->ctx)
+			return -FI_ENOMEM;
+
+		if (fi->domain_attr->mr_mode & FI_MR_LOCAL) {
+			ret = fi_mr_reg(domain, t->buf, 2 * size,
+					FI_SEND | FI_RECV, 0, FT_MR_KEY + 1 + i,
+					0, &t->mr, NULL);
+			if (ret) {
+				FT_PRINTERR("fi_mr_reg", ret);
+				return ret;
+			}
+			t->desc = fi_mr_desc(t->mr);
+		}
+	}
+
+	switch (mode) {
+	case MT_MODE_INCAST:
+		if (!opts.dst_addr) {
+			ret = mt_open_ep(&shared_ep, &shared_txcq,
+					 &shared_rxcq);
+			if (ret)
+				return ret;
+
+			/* one exchange per client endpoint */
+			for (i = 0; i < num_threads; i++) {
+				t = &threads[i];
+				t->tx_ep = t->rx_ep = shared_ep;
+				t->txcq = shared_txcq;
+				t->rxcq = shared_rxcq;
+				ret = mt_exchange_name(&shared_ep->fid, av,
+						       &t->addr);
+				if (ret)
+					return ret;
+			}
+			break;
+		}
+		/* fall through */
+	case MT_MODE_EP:
+		for (i = 0; i < num_threads; i++) {
+			t = &threads[i];
+			ret = mt_open_ep(&t->tx_ep, &t->txcq, &t->rxcq);
+			if (ret)
+				return ret;
+			t->rx_ep = t->tx_ep;
+
+			ret = mt_exchange_name(&t->tx_ep->fid, av, &t->addr);
+			if (ret)
+				return ret;
+		}
+		break;
+	case MT_MODE_SHARED:
+		ret = mt_open_ep(&shared_ep, &shared_txcq, &shared_rxcq);
+		if (ret)
+			return ret;
+
+		ret = mt_exchange_name(&shared_ep->fid, av, &addr);
+		if (ret)
+			return ret;
+
+		for (i = 0; i < num_threads; i++) {
+			t = &threads[i];
+			t->tx_ep = t->rx_ep = shared_ep;
+			t->txcq = shared_txcq;
+			t->rxcq = shared_rxcq;
+			t->addr = addr;
+		}
+		break;
+	case MT_MODE_SEP:
+		ret = mt_open_sep();
+		if (ret)
+			return ret;
+
+		ret = mt_exchange_name(&sep->fid, sep_av, &addr);
+		if (ret)
+			return ret;
+
+		for (i = 0; i < num_threads; i++)
+			threads[i].addr = fi_rx_addr(addr, i, rx_ctx_bits);
+		break;
+	}
+	return 0;
+}
+
+static void mt_free_threads(void)
+{
+	struct mt_thread *t;
+	int i;
+
+	fi_freeinfo(data_fi);
+	if (!threads)
+		return;
+
+	for (i = 0; i < num_threads; i++) {
+		t = &threads[i];
+		if (mode == MT_MODE_SEP)
+			FT_CLOSE_FID(t->rx_ep);
+		if (!mt_shared()) {
+			FT_CLOSE_FID(t->tx_ep);
+			FT_CLOSE_FID(t->txcq);
+			FT_CLOSE_FID(t->rxcq);
+		}
+	}
+	FT_CLOSE_FID(shared_ep);
+	FT_CLOSE_FID(shared_txcq);
+	FT_CLOSE_FID(shared_rxcq);
+	FT_CLOSE_FID(sep);
+	FT_CLOSE_FID(sep_av);
+
+	for (i = 0; i < num_threads; i++) {
+		t = &threads[i];
+		FT_CLOSE_FID(t->mr);
+		free(t->buf);
+		free(t->ctx);
+	}
+	free(threads);
+	threads = NULL;
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	if (opts.options & FT_OPT_SIZE) {
+		max_size = opts.transfer_size;
+	} else {
+		for (i = 0; i < TEST_CNT; i++) {
+			if (ft_use_size(i, opts.sizes_enabled) &&
+			    test_size[i].size <= fi->ep_attr->max_msg_size)
+				max_size = MAX(max_size, test_size[i].size);
+		}
+	}
+
+	ret = mt_init_threads();
+	if (ret)
+		return ret;
+
+	if (!(opts.options & FT_OPT_SIZE)) {
+		for (i = 0; i < TEST_CNT; i++) {
+			if (!ft_use_size(i, opts.sizes_enabled) ||
+			    test_size[i].size > max_size)
+				continue;
+			opts.transfer_size = test_size[i].size;
+			init_test(&opts, test_name, sizeof(test_name));
+			ret = mt_run_size();
+			if (ret)
+				return ret;
+		}
+	} else {
+		init_test(&opts, test_name, sizeof(test_name));
+		ret = mt_run_size();
+		if (ret)
+			return ret;
+	}
+
+	return ft_finalize();
+}
+
+static void usage(char *name)
+{
+	ft_csusage(name, "Multi-threaded message rate test for RDM endpoints.");
+	ft_benchmark_usage();
+	FT_PRINT_OPTS_USAGE("-T <threads>", "number of threads (default 4)");
+	FT_PRINT_OPTS_USAGE("-M <mode>", "ep: an endpoint per thread (default)");
+	FT_PRINT_OPTS_USAGE("", "shared: one FI_THREAD_SAFE endpoint");
+	FT_PRINT_OPTS_USAGE("", "sep: a scalable endpoint context per thread");
+	FT_PRINT_OPTS_USAGE("", "incast: an endpoint per client thread, all "
+			    "sending to one server endpoint");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_BW;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hT:M:" CS_OPTS INFO_OPTS BENCHMARK_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			num_threads = atoi(optarg);
+			break;
+		case 'M':
+			for (mode = 0; mode <= MT_MODE_INCAST; mode++) {
+				if (!strcasecmp(optarg, mt_mode_str[mode]))
+					break;
+			}
+			if (mode > MT_MODE_INCAST) {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (num_threads < 1 || opts.window_size < 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	/* the main endpoint's peer plus one address per remote endpoint */
+	opts.av_size = num_threads + 1;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->caps = FI_TAGGED;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+	if (mode == MT_MODE_SHARED || mode == MT_MODE_INCAST) {
+		hints->domain_attr->threading = FI_THREAD_SAFE;
+	} else {
+		hints->domain_attr->threading = FI_THREAD_ENDPOINT;
+		if (mode == MT_MODE_SEP)
+			hints->caps |= FI_NAMED_RX_CTX;
+	}
+
+	ret = run();
+
+	mt_free_threads();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
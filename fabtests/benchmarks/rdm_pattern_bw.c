@@ -0,0 +1,777 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Traffic pattern bandwidth test for RDM endpoints among more than two
+ * processes.  The test forks -n processes on the local node, each opening
+ * its own endpoint, and exchanges their addresses out-of-band through the
+ * parent process, which only launches the others and collects results.
+ * The processes then stream tagged messages in one of these patterns:
+ *
+ *   incast:   every process sends to process 0
+ *   alltoall: every process sends to every other process in turn
+ *   ring:     process i sends to process i + 1
+ *
+ * Messages are tagged with the sender's rank, so receivers account for the
+ * bytes of each sender and when its last message arrived.  The processes
+ * share the node's monotonic clock, so each flow is timed from its
+ * sender's start to that arrival.  Each size reports the aggregate
+ * throughput, the throughput of the slowest and fastest sender to receiver
+ * flow, and how evenly the flows were served.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_tagged.h>
+
+#include <shared.h>
+#include "benchmark_shared.h"
+
+#define PAT_CQ_BATCH	16
+#define PAT_NAME_LEN	256
+
+enum pat_type {
+	PAT_INCAST,
+	PAT_ALLTOALL,
+	PAT_RING,
+};
+
+static const char *pat_str[] = {
+	[PAT_INCAST] = "incast",
+	[PAT_ALLTOALL] = "alltoall",
+	[PAT_RING] = "ring",
+};
+
+/* What a process received from one rank */
+struct pat_peer {
+	uint64_t	bytes;
+	int64_t		last_usec;	/* monotonic time of the last message */
+};
+
+/* Sent by each process to the parent after every size.  A size below zero
+ * marks the end of the test. */
+struct pat_result {
+	int		ret;
+	int		size;
+	int64_t		start_usec;	/* monotonic time transfers started */
+	int64_t		usec;
+	struct pat_peer	peer[];
+};
+
+/* Contexts of the operations a process may have outstanding.  Completions
+ * return them in any order, so free ones are kept on a stack. */
+struct pat_ctx_pool {
+	struct fi_context	*ctxs;
+	struct fi_context	**free;
+	int			free_cnt;
+};
+
+static enum pat_type pattern = PAT_INCAST;
+static int num_procs = 4;
+static int rank;
+static fi_addr_t *peers;
+static struct pat_ctx_pool tx_pool, rx_pool;
+static uint64_t tx_posted, tx_done, rx_posted, rx_done;
+static struct pat_result *result;
+
+static size_t pat_result_size(void)
+{
+	return sizeof(*result) + num_procs * sizeof(result->peer[0]);
+}
+
+static int64_t pat_now_usec(void)
+{
+	struct timespec zero = { 0 }, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return get_elapsed(&zero, &now, MICRO);
+}
+
+static int pat_ctx_pool_init(struct pat_ctx_pool *pool)
+{
+	pool->ctxs = calloc(opts.window_size, sizeof(*pool->ctxs));
+	pool->free = calloc(opts.window_size, sizeof(*pool->free));
+	if (!pool->ctxs || !pool->free)
+		return -FI_ENOMEM;
+
+	for (pool->free_cnt = 0; pool->free_cnt < opts.window_size;
+	     pool->free_cnt++)
+		pool->free[pool->free_cnt] = &pool->ctxs[pool->free_cnt];
+	return 0;
+}
+
+/* The window bounds the operations outstanding, so one is always free */
+static struct fi_context *pat_ctx_get(struct pat_ctx_pool *pool)
+{
+	assert(pool->free_cnt > 0);
+	return pool->free[--pool->free_cnt];
+}
+
+static void pat_ctx_put(struct pat_ctx_pool *pool, void *ctx)
+{
+	assert(pool->free_cnt < opts.window_size);
+	pool->free[pool->free_cnt++] = ctx;
+}
+
+/* Whether src sends to dst in the selected pattern */
+static int pat_flow(int src, int dst)
+{
+	if (src == dst)
+		return 0;
+
+	switch (pattern) {
+	case PAT_INCAST:
+		return dst == 0;
+	case PAT_RING:
+		return dst == (src + 1) % num_procs;
+	default:
+		return 1;
+	}
+}
+
+static uint64_t pat_tx_total(void)
+{
+	switch (pattern) {
+	case PAT_INCAST:
+		return rank ? opts.iterations : 0;
+	case PAT_RING:
+		return opts.iterations;
+	default:
+		return (uint64_t) opts.iterations * (num_procs - 1);
+	}
+}
+
+static uint64_t pat_rx_total(void)
+{
+	switch (pattern) {
+	case PAT_INCAST:
+		return rank ? 0 : (uint64_t) opts.iterations * (num_procs - 1);
+	case PAT_RING:
+		return opts.iterations;
+	default:
+		return (uint64_t) opts.iterations * (num_procs - 1);
+	}
+}
+
+/* All-to-all senders go round the other ranks, starting with the next one */
+static fi_addr_t pat_dest(uint64_t seq)
+{
+	switch (pattern) {
+	case PAT_INCAST:
+		return peers[0];
+	case PAT_RING:
+		return peers[(rank + 1) % num_procs];
+	default:
+		return peers[(rank + 1 + seq % (num_procs - 1)) % num_procs];
+	}
+}
+
+static int pat_read_cq(struct fid_cq *cq, int rx)
+{
+	struct fi_cq_tagged_entry comp[PAT_CQ_BATCH];
+	int64_t now;
+	int i, ret;
+
+	ret = fi_cq_read(cq, comp, PAT_CQ_BATCH);
+	if (ret > 0) {
+		if (!rx) {
+			for (i = 0; i < ret; i++)
+				pat_ctx_put(&tx_pool, comp[i].op_context);
+			tx_done += ret;
+			return 0;
+		}
+
+		now = pat_now_usec();
+		for (i = 0; i < ret; i++) {
+			pat_ctx_put(&rx_pool, comp[i].op_context);
+			if (comp[i].tag < (uint64_t) num_procs) {
+				result->peer[comp[i].tag].bytes += comp[i].len;
+				result->peer[comp[i].tag].last_usec = now;
+			}
+		}
+		rx_done += ret;
+		return 0;
+	}
+
+	if (ret == -FI_EAGAIN)
+		return 0;
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(cq);
+
+	FT_PRINTERR("fi_cq_read", ret);
+	return ret;
+}
+
+static ssize_t pat_post_tx(void)
+{
+	struct fi_context *ctx;
+	ssize_t ret;
+
+	if (opts.transfer_size < fi->tx_attr->inject_size) {
+		ret = fi_tinject(ep, tx_buf, opts.transfer_size,
+				 pat_dest(tx_posted), rank);
+		if (!ret)
+			tx_done++;
+	} else {
+		ctx = pat_ctx_get(&tx_pool);
+		ret = fi_tsend(ep, tx_buf, opts.transfer_size, mr_desc,
+			       pat_dest(tx_posted), rank, ctx);
+		if (ret)
+			pat_ctx_put(&tx_pool, ctx);
+	}
+	if (!ret)
+		tx_posted++;
+	return ret;
+}
+
+static ssize_t pat_post_rx(void)
+{
+	struct fi_context *ctx;
+	ssize_t ret;
+
+	ctx = pat_ctx_get(&rx_pool);
+	ret = fi_trecv(ep, rx_buf, opts.transfer_size, mr_desc,
+		       FI_ADDR_UNSPEC, 0, ~0ULL, ctx);
+	if (ret)
+		pat_ctx_put(&rx_pool, ctx);
+	else
+		rx_posted++;
+	return ret;
+}
+
+/* Keeps up to a window of sends and receives outstanding until all the
+ * messages of this process have been sent and received. */
+static int pat_xfer(void)
+{
+	uint64_t tx_total = pat_tx_total(), rx_total = pat_rx_total();
+	ssize_t ret;
+
+	tx_posted = tx_done = rx_posted = rx_done = 0;
+	while (tx_done < tx_total || rx_done < rx_total) {
+		while (rx_posted < rx_total &&
+		       rx_posted - rx_done < (uint64_t) opts.window_size) {
+			ret = pat_post_rx();
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("fi_trecv", ret);
+				return (int) ret;
+			}
+		}
+
+		while (tx_posted < tx_total &&
+		       tx_posted - tx_done < (uint64_t) opts.window_size) {
+			ret = pat_post_tx();
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("fi_tsend", ret);
+				return (int) ret;
+			}
+		}
+
+		ret = pat_read_cq(txcq, 0);
+		if (ret)
+			return (int) ret;
+
+		ret = pat_read_cq(rxcq, 1);
+		if (ret)
+			return (int) ret;
+	}
+	return 0;
+}
+
+/* Waits for the parent to start the next size.  The CQs are read meanwhile,
+ * as providers such as rxd only acknowledge and retransmit from there, and
+ * peers may still be receiving the messages this process has injected. */
+static int pat_wait_go(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	char go;
+	int ret;
+
+	while (!(ret = poll(&pfd, 1, 0))) {
+		ret = pat_read_cq(txcq, 0);
+		if (ret)
+			return ret;
+
+		ret = pat_read_cq(rxcq, 1);
+		if (ret)
+			return ret;
+	}
+	if (ret < 0) {
+		ret = -errno;
+		perror("poll");
+		return ret;
+	}
+
+	return ft_sock_recv(fd, &go, sizeof(go));
+}
+
+static int pat_run_size(int fd)
+{
+	int ret;
+
+	ret = pat_wait_go(fd);
+	if (ret)
+		return ret;
+
+	memset(result, 0, pat_result_size());
+	result->size = (int) opts.transfer_size;
+
+	result->start_usec = pat_now_usec();
+	result->ret = pat_xfer();
+	result->usec = pat_now_usec() - result->start_usec;
+
+	ret = ft_sock_send(fd, result, pat_result_size());
+	return result->ret ? result->ret : ret;
+}
+
+/* Sends this process's address to the parent, which returns everyone's */
+static int pat_exchange_names(int fd)
+{
+	char name[PAT_NAME_LEN];
+	size_t len = sizeof(name);
+	int i, ret;
+
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	ret = ft_sock_send(fd, &len, sizeof(len));
+	if (ret)
+		return ret;
+
+	ret = ft_sock_send(fd, name, len);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num_procs; i++) {
+		ret = ft_sock_recv(fd, &len, sizeof(len));
+		if (ret)
+			return ret;
+
+		if (len > sizeof(name))
+			return -FI_ETOOSMALL;
+
+		ret = ft_sock_recv(fd, name, len);
+		if (ret)
+			return ret;
+
+		ret = ft_av_insert(av, name, 1, &peers[i], 0, NULL);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int pat_init(int fd)
+{
+	int ret;
+
+	peers = calloc(num_procs, sizeof(*peers));
+	result = calloc(1, pat_result_size());
+	if (!peers || !result)
+		return -FI_ENOMEM;
+
+	ret = pat_ctx_pool_init(&tx_pool);
+	if (ret)
+		return ret;
+
+	ret = pat_ctx_pool_init(&rx_pool);
+	if (ret)
+		return ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep(ep, eq, av, txcq, rxcq, txcntr, rxcntr);
+	if (ret)
+		return ret;
+
+	return pat_exchange_names(fd);
+}
+
+/* Runs in each forked process.  Any failure closes the socket to the
+ * parent, which then stops the test. */
+static int pat_child(int fd)
+{
+	int i, ret;
+
+	ret = pat_init(fd);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (!(opts.options & FT_OPT_SIZE)) {
+			if (!ft_use_size(i, opts.sizes_enabled) ||
+			    test_size[i].size > tx_size)
+				continue;
+			opts.transfer_size = test_size[i].size;
+		}
+
+		ret = pat_run_size(fd);
+		if (ret || (opts.options & FT_OPT_SIZE))
+			break;
+	}
+	if (ret)
+		return ret;
+
+	ret = pat_wait_go(fd);
+	if (ret)
+		return ret;
+
+	memset(result, 0, pat_result_size());
+	result->size = -1;
+	return ft_sock_send(fd, result, pat_result_size());
+}
+
+static void pat_show_perf(struct pat_result **results)
+{
+	static int header = 1;
+	char str[FT_STR_LEN], fields[128];
+	struct timespec start = { 0 }, end;
+	double rate, min_rate = 0, max_rate = 0, sum = 0, sum_sq = 0, fairness;
+	int64_t usec = 0, flow_usec;
+	long long msgs = 0;
+	int src, dst, flows = 0;
+
+	for (dst = 0; dst < num_procs; dst++) {
+		usec = MAX(usec, results[dst]->usec);
+		for (src = 0; src < num_procs; src++) {
+			if (!pat_flow(src, dst))
+				continue;
+
+			msgs += results[dst]->peer[src].bytes /
+				MAX(results[dst]->size, 1);
+			flow_usec = results[dst]->peer[src].last_usec -
+				    results[src]->start_usec;
+			rate = flow_usec > 0 ?
+			       (double) results[dst]->peer[src].bytes /
+			       flow_usec : 0;
+			if (!flows || rate < min_rate)
+				min_rate = rate;
+			if (!flows || rate > max_rate)
+				max_rate = rate;
+			sum += rate;
+			sum_sq += rate * rate;
+			flows++;
+		}
+	}
+
+	/* Jain's fairness index, 1.0 when all flows ran at the same rate */
+	fairness = sum_sq ? sum * sum / (flows * sum_sq) : 0.0;
+
+	end.tv_sec = usec / 1000000;
+	end.tv_nsec = (usec % 1000000) * 1000;
+
+	if (opts.machr) {
+		snprintf(fields, sizeof(fields), "procs: %d, "
+			 "peer_min_MB/sec: %f, peer_max_MB/sec: %f, "
+			 "fairness: %f", num_procs, min_rate, max_rate,
+			 fairness);
+		show_perf_mr_fields(results[0]->size, (int) msgs, &start, &end,
+				    1, opts.argc, opts.argv, fields);
+		return;
+	}
+
+	if (header) {
+		printf("%-8s%-8s%-8s%8s %10s%13s%13s%10s\n", "bytes", "procs",
+		       "msgs", "time", "MB/sec", "min/peer", "max/peer",
+		       "fairness");
+		header = 0;
+	}
+
+	printf("%-8s", size_str(str, results[0]->size));
+	printf("%-8d", num_procs);
+	printf("%-8s", cnt_str(str, msgs));
+	printf("%8.2fs%10.2f%13.2f%13.2f%10.3f\n", usec / 1000000.0,
+	       usec ? (double) msgs * results[0]->size / usec : 0.0,
+	       min_rate, max_rate, fairness);
+}
+
+/* Relays every process's address to all of them, in rank order */
+static int pat_relay_names(int *fds)
+{
+	char (*names)[PAT_NAME_LEN];
+	size_t *lens;
+	int i, j, ret;
+
+	names = calloc(num_procs, sizeof(*names));
+	lens = calloc(num_procs, sizeof(*lens));
+	if (!names || !lens) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < num_procs; i++) {
+		ret = ft_sock_recv(fds[i], &lens[i], sizeof(lens[i]));
+		if (ret)
+			goto out;
+
+		if (lens[i] > PAT_NAME_LEN) {
+			ret = -FI_ETOOSMALL;
+			goto out;
+		}
+
+		ret = ft_sock_recv(fds[i], names[i], lens[i]);
+		if (ret)
+			goto out;
+	}
+
+	for (i = 0; i < num_procs; i++) {
+		for (j = 0; j < num_procs; j++) {
+			ret = ft_sock_send(fds[i], &lens[j], sizeof(lens[j]));
+			if (ret)
+				goto out;
+
+			ret = ft_sock_send(fds[i], names[j], lens[j]);
+			if (ret)
+				goto out;
+		}
+	}
+out:
+	free(names);
+	free(lens);
+	return ret;
+}
+
+static int pat_collect(int *fds)
+{
+	struct pat_result **results;
+	char go = 1;
+	int i, ret = 0;
+
+	results = calloc(num_procs, sizeof(*results));
+	if (!results)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < num_procs; i++) {
+		results[i] = malloc(pat_result_size());
+		if (!results[i]) {
+			ret = -FI_ENOMEM;
+			goto out;
+		}
+	}
+
+	ret = pat_relay_names(fds);
+	while (!ret) {
+		for (i = 0; i < num_procs && !ret; i++)
+			ret = ft_sock_send(fds[i], &go, sizeof(go));
+
+		for (i = 0; i < num_procs && !ret; i++) {
+			ret = ft_sock_recv(fds[i], results[i],
+					   pat_result_size());
+			if (!ret && results[i]->ret)
+				ret = results[i]->ret;
+		}
+
+		if (ret || results[0]->size < 0)
+			break;
+
+		pat_show_perf(results);
+	}
+out:
+	for (i = 0; i < num_procs; i++)
+		free(results[i]);
+	free(results);
+	return ret;
+}
+
+/* Each process binds its own port, counting up from -B or the default
+ * port.  Providers such as shm also name their endpoints after it. */
+static void pat_set_port(void)
+{
+	static char port[8];
+
+	snprintf(port, sizeof(port), "%d",
+		 atoi(opts.src_port ? opts.src_port : default_port) + rank);
+	opts.src_port = port;
+}
+
+/* Forks the processes before libfabric is initialized in this one, which
+ * only relays addresses and collects results */
+static int pat_launch(void)
+{
+	int i, n, ret = 0, status, sv[2], *fds;
+	pid_t *pids;
+
+	fds = calloc(num_procs, sizeof(*fds));
+	pids = calloc(num_procs, sizeof(*pids));
+	if (!fds || !pids) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < num_procs; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+			ret = -errno;
+			perror("socketpair");
+			break;
+		}
+
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			ret = -errno;
+			perror("fork");
+			close(sv[0]);
+			close(sv[1]);
+			break;
+		}
+
+		if (!pids[i]) {
+			rank = i;
+			while (i--)
+				close(fds[i]);
+			close(sv[0]);
+			free(fds);
+			free(pids);
+
+			pat_set_port();
+			ret = pat_child(sv[1]);
+			close(sv[1]);
+			ft_free_res();
+			exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+
+		close(sv[1]);
+		fds[i] = sv[0];
+	}
+
+	if (!ret)
+		ret = pat_collect(fds);
+
+	/* i is the number of processes that were started */
+	for (n = 0; n < i; n++) {
+		if (ret)
+			kill(pids[n], SIGTERM);
+		close(fds[n]);
+	}
+
+	for (n = 0; n < i; n++) {
+		waitpid(pids[n], &status, 0);
+		if (!ret && (!WIFEXITED(status) || WEXITSTATUS(status)))
+			ret = -FI_EOTHER;
+	}
+out:
+	free(fds);
+	free(pids);
+	return ret;
+}
+
+static void usage(char *name)
+{
+	ft_csusage(name, "Traffic pattern bandwidth test for RDM endpoints.");
+	ft_benchmark_usage();
+	FT_PRINT_OPTS_USAGE("-n <procs>", "number of processes (default 4)");
+	FT_PRINT_OPTS_USAGE("-M <pattern>", "incast: all processes send to "
+			    "process 0 (default)");
+	FT_PRINT_OPTS_USAGE("", "alltoall: all processes send to all others");
+	FT_PRINT_OPTS_USAGE("", "ring: each process sends to the next one");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_BW;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hn:M:" CS_OPTS INFO_OPTS BENCHMARK_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'n':
+			num_procs = atoi(optarg);
+			break;
+		case 'M':
+			for (pattern = 0; pattern <= PAT_RING; pattern++) {
+				if (!strcasecmp(optarg, pat_str[pattern]))
+					break;
+			}
+			if (pattern > PAT_RING) {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_procs < 2 || opts.window_size < 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	/* every process is a peer, including itself */
+	opts.av_size = num_procs;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->caps = FI_TAGGED;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
+
+	ret = pat_launch();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
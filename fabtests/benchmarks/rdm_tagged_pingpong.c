@@ -36,6 +36,9 @@
 #include <shared.h>
 #include "benchmark_shared.h"
 
+static size_t depth;
+static struct fi_context *depth_ctx;
+
 static int run(void)
 {
 	int i, ret = 0;
@@ -44,6 +47,15 @@ static int run(void)
 	if (ret)
 		return ret;
 
+	if (depth) {
+		depth_ctx = calloc(depth, sizeof(*depth_ctx));
+		if (!depth_ctx)
+			return -FI_ENOMEM;
+		ret = ft_post_unmatched_trecv(depth, depth_ctx);
+		if (ret)
+			return ret;
+	}
+
 	if (!(opts.options & FT_OPT_SIZE)) {
 		for (i = 0; i < TEST_CNT; i++) {
 			if (!ft_use_size(i, opts.sizes_enabled))
@@ -76,17 +88,22 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((op = getopt(argc, argv, "h" CS_OPTS INFO_OPTS BENCHMARK_OPTS)) != -1) {
+	while ((op = getopt(argc, argv, "hD:" CS_OPTS INFO_OPTS BENCHMARK_OPTS)) != -1) {
 		switch (op) {
 		default:
 			ft_parse_benchmark_opts(op, optarg);
 			ft_parseinfo(op, optarg, hints);
 			ft_parsecsopts(op, optarg, &opts);
 			break;
+		case 'D':
+			depth = strtoul(optarg, NULL, 0);
+			break;
 		case '?':
 		case 'h':
 			ft_csusage(argv[0], "Ping pong client and server using tagged messages.");
 			ft_benchmark_usage();
+			FT_PRINT_OPTS_USAGE("-D <depth>", "number of unmatched "
+					    "receives posted ahead of the test");
 			return EXIT_FAILURE;
 		}
 	}
@@ -103,5 +120,6 @@ int main(int argc, char **argv)
 	ret = run();
 
 	ft_free_res();
+	free(depth_ctx);
 	return ft_exit_code(ret);
 }
@@ -112,7 +112,7 @@ struct fi_rma_iov remote;
 
 struct ft_opts opts;
 
-struct test_size_param test_size[] = {
+static struct test_size_param def_test_sizes[] = {
 	{ 1 <<  0, 0 },
 	{ 1 <<  1, 0 }, { (1 <<  1) + (1 <<  0), 0 },
 	{ 1 <<  2, 0 }, { (1 <<  2) + (1 <<  1), 0 },
@@ -139,7 +139,8 @@ struct test_size_param test_size[] = {
 	{ 1 << 23, 0 },
 };
 
-const unsigned int test_cnt = (sizeof test_size / sizeof test_size[0]);
+struct test_size_param *test_size = def_test_sizes;
+unsigned int test_cnt = (sizeof def_test_sizes / sizeof def_test_sizes[0]);
 
 #define INTEG_SEED 7
 static const char integ_alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
@@ -155,6 +156,9 @@ static int ft_poll_fd(int fd, int timeout)
 	fds.events = POLLIN;
 	ret = poll(&fds, 1, timeout);
 	if (ret == -1) {
+		/* interrupted waits are retried by the caller */
+		if (errno == EINTR)
+			return -FI_EAGAIN;
 		FT_PRINTERR("poll", -errno);
 		ret = -errno;
 	} else if (!ret) {
@@ -2004,7 +2008,7 @@ static int ft_wait_for_comp(struct fid_cq *cq, uint64_t *cur,
 			if (!ft_tag_is_valid(cq, &comp, ft_tag ? ft_tag : rx_cq_cntr))
 				return -FI_EOTHER;
 			(*cur)++;
-		} else if (ret < 0 && ret != -FI_EAGAIN) {
+		} else if (ret < 0 && ret != -FI_EAGAIN && ret != -FI_EINTR) {
 			return ret;
 		}
 	}
@@ -2552,6 +2556,15 @@ void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 
 void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 		  struct timespec *end, int xfers_per_iter, int argc, char *argv[])
+{
+	show_perf_mr_fields(tsize, iters, start, end, xfers_per_iter, argc,
+			    argv, NULL);
+}
+
+/* As show_perf_mr, with extra "key: value" fields appended to the entry */
+void show_perf_mr_fields(size_t tsize, int iters, struct timespec *start,
+			 struct timespec *end, int xfers_per_iter, int argc,
+			 char *argv[], const char *fields)
 {
 	static int header = 1;
 	int64_t elapsed = get_elapsed(start, end, MICRO);
@@ -2579,6 +2592,8 @@ void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 	printf("MB/sec: %f, ", (total) / (1.0 * elapsed));
 	printf("usec/xfer: %f, ", usec_per_xfer);
 	printf("Mxfers/sec: %f", 1.0/usec_per_xfer);
+	if (fields)
+		printf(", %s", fields);
 	printf(" }\n");
 }
 
@@ -2647,7 +2662,8 @@ void ft_csusage(char *name, char *desc)
 	ft_usage(name, desc);
 	FT_PRINT_OPTS_USAGE("-I <number>", "number of iterations");
 	FT_PRINT_OPTS_USAGE("-w <number>", "number of warmup iterations");
-	FT_PRINT_OPTS_USAGE("-S <size>", "specific transfer size or 'all'");
+	FT_PRINT_OPTS_USAGE("-S <size>", "specific transfer size, a comma "
+			    "separated list of sizes, or 'all'");
 	FT_PRINT_OPTS_USAGE("-l", "align transmit and receive buffers to page size");
 	FT_PRINT_OPTS_USAGE("-m", "machine readable output");
 	FT_PRINT_OPTS_USAGE("-t <type>", "completion type [queue, counter]");
@@ -2730,6 +2746,46 @@ void ft_parse_addr_opts(int op, char *optarg, struct ft_opts *opts)
 	}
 }
 
+static int ft_size_cmp(const void *a, const void *b)
+{
+	const struct test_size_param *x = a, *y = b;
+
+	return (x->size > y->size) - (x->size < y->size);
+}
+
+/* Replaces the size table with a comma separated list, e.g. to sweep
+ * across a provider's protocol boundaries. */
+static int ft_parse_size_list(char *list)
+{
+	struct test_size_param *sizes;
+	unsigned int cnt = 1, i;
+	char *tok, *saveptr;
+
+	for (i = 0; list[i]; i++) {
+		if (list[i] == ',')
+			cnt++;
+	}
+
+	sizes = calloc(cnt, sizeof(*sizes));
+	if (!sizes)
+		return -FI_ENOMEM;
+
+	for (i = 0, tok = strtok_r(list, ",", &saveptr); tok;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		sizes[i++].size = strtoul(tok, NULL, 0);
+	}
+	if (!i) {
+		free(sizes);
+		FT_ERR("invalid size list");
+		return -FI_EINVAL;
+	}
+
+	qsort(sizes, i, sizeof(*sizes), ft_size_cmp);
+	test_size = sizes;
+	test_cnt = i;
+	return 0;
+}
+
 void ft_parsecsopts(int op, char *optarg, struct ft_opts *opts)
 {
 	ft_parse_addr_opts(op, optarg, opts);
@@ -2742,6 +2798,10 @@ void ft_parsecsopts(int op, char *optarg, struct ft_opts *opts)
 	case 'S':
 		if (!strncasecmp("all", optarg, 3)) {
 			opts->sizes_enabled = FT_ENABLE_ALL;
+		} else if (strchr(optarg, ',')) {
+			if (ft_parse_size_list(optarg))
+				exit(EXIT_FAILURE);
+			opts->sizes_enabled = FT_ENABLE_ALL;
 		} else {
 			opts->options |= FT_OPT_SIZE;
 			opts->transfer_size = atoi(optarg);
@@ -244,6 +244,27 @@ static int alloc_ep_res(struct fi_info *fi)
 	return 0;
 }
 
+static int init_ep(void)
+{
+	int ret;
+
+	ret = alloc_ep_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep_recv();
+	if (ret)
+		return ret;
+
+	ret = fi_setopt(&ep->fid, FI_OPT_ENDPOINT, FI_OPT_MIN_MULTI_RECV,
+			&tx_size, sizeof(tx_size));
+	if (ret)
+		return ret;
+
+	ret = post_multi_recv_buffer();
+	return ret;
+}
+
 static int init_fabric(void)
 {
 	int ret;
@@ -259,23 +280,52 @@ static int init_fabric(void)
 	if (ret)
 		return ret;
 
-	ret = alloc_ep_res(fi);
+	return init_ep();
+}
+
+/* Buffers are posted before the connection is accepted */
+static int server_connect(void)
+{
+	int ret;
+
+	ret = ft_start_server();
 	if (ret)
 		return ret;
 
-	ret = ft_enable_ep_recv();
+	ret = ft_retrieve_conn_req(eq, &fi);
 	if (ret)
 		return ret;
 
-	ret = fi_setopt(&ep->fid, FI_OPT_ENDPOINT, FI_OPT_MIN_MULTI_RECV,
-			&tx_size, sizeof(tx_size));
+	fi->rx_attr->op_flags = FI_MULTI_RECV;
+
+	ret = fi_domain(fabric, fi, &domain, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_domain", ret);
+		goto err;
+	}
+
+	ret = init_ep();
 	if (ret)
-		return ret;
+		goto err;
 
-	ret = post_multi_recv_buffer();
+	return ft_accept_connection(ep, eq);
+
+err:
+	fi_reject(pep, fi->handle, NULL, 0);
 	return ret;
 }
 
+static int client_connect(void)
+{
+	int ret;
+
+	ret = init_fabric();
+	if (ret)
+		return ret;
+
+	return ft_connect_ep(ep, eq, fi->dest_addr);
+}
+
 static int init_av(void)
 {
 	size_t addrlen;
@@ -313,13 +363,19 @@ static int run(void)
 {
 	int ret = 0;
 
-	ret = init_fabric();
-	if (ret)
-		goto out;
+	if (hints->ep_attr->type == FI_EP_MSG) {
+		ret = opts.dst_addr ? client_connect() : server_connect();
+		if (ret)
+			goto out;
+	} else {
+		ret = init_fabric();
+		if (ret)
+			goto out;
 
-	ret = init_av();
-	if (ret)
-		goto out;
+		ret = init_av();
+		if (ret)
+			goto out;
+	}
 
 	ret = run_test();
 
@@ -355,7 +411,7 @@ int main(int argc, char **argv)
 			break;
 		case '?':
 		case 'h':
-			ft_csusage(argv[0], "Streaming RDM client-server using multi recv buffer.");
+			ft_csusage(argv[0], "Streaming client-server using multi recv buffer.");
 			FT_PRINT_OPTS_USAGE("-M", "enable testing with fi_recvmsg");
 			return EXIT_FAILURE;
 		}
@@ -364,7 +420,8 @@ int main(int argc, char **argv)
 	if (optind < argc)
 		opts.dst_addr = argv[optind];
 
-	hints->ep_attr->type = FI_EP_RDM;
+	if (!hints->ep_attr->type)
+		hints->ep_attr->type = FI_EP_RDM;
 	hints->caps = FI_MSG | FI_MULTI_RECV;
 	hints->mode = FI_CONTEXT;
 	hints->domain_attr->mr_mode = FI_MR_LOCAL | OFI_MR_BASIC_MAP;
@@ -2,6 +2,7 @@
 
 import sys
 import csv
+import json
 from optparse import OptionParser
 
 try:
@@ -10,12 +11,33 @@ except ImportError:
 	print ("PyYAML library missing, try: yum install pyyaml")
 	sys.exit(1)
 
+def rows(docs):
+	"""Flatten each document into rows keyed by test name.  runfabtests.sh
+	   maps a test to its status, benchmarks run with -m map their command
+	   line to a list of results, one per transfer size.
+	"""
+	for doc in docs:
+		if not doc:
+			continue
+
+		for k, v in doc.items():
+			if isinstance(v, list):
+				for result in v:
+					row = {"Test name": k.strip()}
+					row.update(result)
+					yield row
+			else:
+				yield {"Test name": k, "Status": v}
+
 def main(argv=None):
-	"""Convert runfabtests.sh yaml output to CSV. If no argument is given
-	   stdin is read, otherwise read from file.
+	"""Convert runfabtests.sh yaml output, or the machine readable (-m)
+	   output of benchmarks, to CSV. If no argument is given stdin is read,
+	   otherwise read from file.
 	"""
 
-	parser = OptionParser(description=main.__doc__, usage="usage: %prog [file]")
+	parser = OptionParser(description=main.__doc__, usage="usage: %prog [options] [file]")
+	parser.add_option("-j", "--json", action="store_true", default=False,
+			  help="write one JSON object per row instead of CSV")
 	(options, args) = parser.parse_args()
 
 	if len(args) == 0:
@@ -23,13 +45,24 @@ def main(argv=None):
 	else:
 		fd = open(args[0], 'r')
 
-	yi = yaml.load(fd.read())
+	table = list(rows(yaml.safe_load_all(fd.read())))
+
+	if options.json:
+		for row in table:
+			print (json.dumps(row))
+		return 0
+
+	# Columns are ordered as first seen, e.g. latency percentiles follow
+	# the throughput of benchmarks run with -L
+	fields = []
+	for row in table:
+		fields += [k for k in row if k not in fields]
 
-	csv_fd = csv.writer(sys.stdout, delimiter=",", quotechar='"', quoting=csv.QUOTE_NONNUMERIC)
-	csv_fd.writerow(["Test name", "Status"])
-	
-	for k,v in yi.iteritems():
-		csv_fd.writerow([k, v])
+	csv_fd = csv.DictWriter(sys.stdout, fields, restval="", delimiter=",",
+				quotechar='"', quoting=csv.QUOTE_NONNUMERIC)
+	csv_fd.writerow(dict(zip(fields, fields)))
+	for row in table:
+		csv_fd.writerow(row)
 
 	return 0
 
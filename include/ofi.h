@@ -110,6 +110,14 @@ enum {
 	OFI_CLFLUSHOPT_BIT	= (1 << 24),
 	OFI_CLFLUSH_REG		= 3,
 	OFI_CLFLUSH_BIT		= (1 << 23),
+	OFI_OSXSAVE_REG		= 2,
+	OFI_OSXSAVE_BIT		= (1 << 27),
+	OFI_AVX2_REG		= 1,
+	OFI_AVX2_BIT		= (1 << 5),
+	OFI_AVX512F_REG		= 1,
+	OFI_AVX512F_BIT		= (1 << 16),
+	OFI_AVX512BW_REG	= 1,
+	OFI_AVX512BW_BIT	= (1 << 30),
 };
 
 int ofi_cpu_supports(unsigned func, unsigned reg, unsigned bit);
@@ -144,6 +152,7 @@ struct fid_nic *ofi_nic_dup(const struct fid_nic *nic);
 int ofi_nic_tostr(const struct fid *fid_nic, char *buf, size_t len);
 
 struct fi_provider *ofi_get_hook(const char *name);
+void ofi_load_provs(void);
 
 void fi_log_init(void);
 void fi_log_fini(void);
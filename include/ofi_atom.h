@@ -105,6 +105,13 @@ typedef atomic_long	ofi_atomic_int64_t;
 		return (int##radix##_t)atomic_load(&atomic->val);					\
 	}												\
 	static inline											\
+	int##radix##_t ofi_atomic_get_acquire##radix(ofi_atomic##radix##_t *atomic)			\
+	{												\
+		ATOMIC_IS_INITIALIZED(atomic);								\
+		return (int##radix##_t)atomic_load_explicit(&atomic->val,				\
+							    memory_order_acquire);		\
+	}												\
+	static inline											\
 	void ofi_atomic_initialize##radix(ofi_atomic##radix##_t *atomic, int##radix##_t value)		\
 	{												\
 		atomic_init(&atomic->val, value);							\
@@ -180,6 +187,12 @@ typedef atomic_long	ofi_atomic_int64_t;
 		return *ofi_atomic_ptr(atomic);								\
 	}												\
 	static inline											\
+	int##radix##_t ofi_atomic_get_acquire##radix(ofi_atomic##radix##_t *atomic)			\
+	{												\
+		ATOMIC_IS_INITIALIZED(atomic);								\
+		return (int##radix##_t)ofi_atomic_load_acquire(radix, ofi_atomic_ptr(atomic));		\
+	}												\
+	static inline											\
 	void ofi_atomic_initialize##radix(ofi_atomic##radix##_t *atomic, int##radix##_t value)		\
 	{												\
 		*(ofi_atomic_ptr(atomic)) = value;							\
@@ -231,6 +244,16 @@ typedef atomic_long	ofi_atomic_int64_t;
 		return atomic->val;								\
 	}											\
 	static inline										\
+	int##radix##_t ofi_atomic_get_acquire##radix(ofi_atomic##radix##_t *atomic)		\
+	{											\
+		int##radix##_t v;								\
+		ATOMIC_IS_INITIALIZED(atomic);							\
+		fastlock_acquire(&atomic->lock);						\
+		v = atomic->val;								\
+		fastlock_release(&atomic->lock);						\
+		return v;									\
+	}											\
+	static inline										\
 	void ofi_atomic_initialize##radix(ofi_atomic##radix##_t *atomic,			\
 					  int##radix##_t value)					\
 	{											\
@@ -56,6 +56,28 @@ extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_LAST][FI_DATATYPE_LAST])
 			(void *dst, const void *src, const void *cmp,
 			 void *res, size_t cnt);
 
+/*
+ * Non-atomic handlers for target buffers that only one thread updates at a
+ * time, e.g. from the progress of a domain the application serializes.  They
+ * are vectorized where possible and are set up by ofi_atomic_init(), which
+ * ofi_domain_init() calls.  They are only used if the application opts in
+ * with FI_ATOMIC_LOCAL, as the target memory may also be updated through
+ * other domains or by the application itself.
+ */
+extern void (*ofi_atomic_write_local_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+			(void *dst, const void *src, size_t cnt);
+extern void (*ofi_atomic_readwrite_local_handlers[OFI_READWRITE_OP_LAST][FI_DATATYPE_LAST])
+			(void *dst, const void *src, void *res, size_t cnt);
+
+extern int ofi_atomic_local_enabled;
+
+void ofi_atomic_init(void);
+
+static inline int ofi_atomic_local(enum fi_threading threading)
+{
+	return ofi_atomic_local_enabled && threading == FI_THREAD_DOMAIN;
+}
+
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags);
 
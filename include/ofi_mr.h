@@ -111,6 +111,8 @@ struct ofi_notification_queue {
 	struct ofi_mem_monitor		*monitor;
 	fastlock_t			lock;
 	struct dlist_entry		list;
+	/* Number of events on list, readable without the lock */
+	ofi_atomic32_t			pending;
 	int				refcnt;
 };
 
@@ -139,12 +141,28 @@ ofi_monitor_add_event_to_nq(struct ofi_subscription *subscription)
 	       subscription, subscription->iov.iov_base,
 	       subscription->iov.iov_len, subscription->nq);
 	fastlock_acquire(&subscription->nq->lock);
-	if (dlist_empty(&subscription->entry))
+	if (dlist_empty(&subscription->entry)) {
 		dlist_insert_tail(&subscription->entry,
 				  &subscription->nq->list);
+		ofi_atomic_inc32(&subscription->nq->pending);
+	}
 	fastlock_release(&subscription->nq->lock);
 }
 
+/*
+ * Generic monitors usable by any provider.  They track subscribed ranges
+ * internally and queue every subscription overlapping an invalidated
+ * range on its notification queue.  default_monitor is selected through
+ * FI_MR_CACHE_MONITOR and is NULL if no monitor is available.
+ */
+extern struct ofi_mem_monitor *uffd_monitor;
+extern struct ofi_mem_monitor *default_monitor;
+
+void ofi_monitors_init(void);
+void ofi_monitors_cleanup(void);
+void ofi_monitor_notify(struct ofi_mem_monitor *monitor,
+			const void *addr, size_t len);
+
 /*
  * MR map
  */
@@ -198,7 +216,10 @@ struct ofi_mr_entry {
 	struct iovec			iov;
 	unsigned int			cached:1;
 	unsigned int			subscribed:1;
-	int				use_cnt;
+	/* Set by lookups, cleared by the LRU scan (second chance).  Atomic
+	 * since hits set it holding the cache lock shared. */
+	ofi_atomic32_t			referenced;
+	ofi_atomic32_t			use_cnt;
 	struct dlist_entry		lru_entry;
 	struct ofi_subscription		subscription;
 	uint8_t				data[];
@@ -230,9 +251,18 @@ struct ofi_mr_storage {
 	ofi_mr_erase_t erase;
 };
 
+/*
+ * The cache is read-mostly: lookups that hit a cached region only take
+ * the lock shared, so concurrent hits don't serialize.  Processing monitor
+ * events, misses, merges and eviction take it exclusively.  Cached entries
+ * stay on lru_list while in use; eviction skips busy or recently
+ * referenced entries instead of lookups having to reorder the list.
+ * Eviction runs when a miss has to add a region, not in the background.
+ */
 struct ofi_mr_cache {
 	struct util_domain		*domain;
 	struct ofi_notification_queue	nq;
+	pthread_rwlock_t		lock;
 	size_t				max_cached_cnt;
 	size_t				max_cached_size;
 	int				merge_regions;
@@ -243,9 +273,11 @@ struct ofi_mr_cache {
 
 	size_t				cached_cnt;
 	size_t				cached_size;
-	size_t				search_cnt;
-	size_t				delete_cnt;
-	size_t				hit_cnt;
+	ofi_atomic64_t			search_cnt;
+	ofi_atomic64_t			delete_cnt;
+	ofi_atomic64_t			hit_cnt;
+	size_t				notify_cnt;
+	size_t				flush_cnt;
 	struct util_buf_pool		*entry_pool;
 
 	int				(*add_region)(struct ofi_mr_cache *cache,
@@ -254,15 +286,24 @@ struct ofi_mr_cache {
 							 struct ofi_mr_entry *entry);
 };
 
+/* A NULL monitor selects default_monitor */
 int ofi_mr_cache_init(struct util_domain *domain, struct ofi_mem_monitor *monitor,
 		      struct ofi_mr_cache *cache);
 void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache);
 
-/* Caller must provide locking around calls */
+/* The cache serializes calls internally */
 bool ofi_mr_cache_flush(struct ofi_mr_cache *cache);
 int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
 			struct ofi_mr_entry **entry);
 void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry);
 
+/* Size of the fields of struct fi_mr_cache_stats defined initially */
+#define OFI_MR_CACHE_STATS_V1_SIZE \
+	(offsetof(struct fi_mr_cache_stats, cached_size) + sizeof(uint64_t))
+
+/* Adds the counters of the cache to stats */
+void ofi_mr_cache_add_stats(struct ofi_mr_cache *cache,
+			    struct fi_mr_cache_stats *stats);
+
 
 #endif /* _OFI_MR_H_ */
@@ -50,7 +50,7 @@ extern "C" {
 #endif
 
 
-#define SMR_VERSION	1
+#define SMR_VERSION	4
 
 #ifdef HAVE_ATOMICS
 #define SMR_FLAG_ATOMIC	(1 << 0)
@@ -72,6 +72,7 @@ enum {
 	smr_src_inline,	/* command data */
 	smr_src_inject,	/* inject buffers */
 	smr_src_iov,	/* reference iovec via CMA */
+	smr_src_posted,	/* written into the published receive via CMA */
 };
 
 #define SMR_REMOTE_CQ_DATA	(1 << 0)
@@ -79,6 +80,7 @@ enum {
 #define SMR_TX_COMPLETION	(1 << 2)
 #define SMR_RX_COMPLETION	(1 << 3)
 #define SMR_MULTI_RECV		(1 << 4)
+#define SMR_TX_BOUNCE		(1 << 5) /* local pending copy only */
 
 /* 
  * Unique smr_op_hdr for smr message protocol:
@@ -146,8 +148,15 @@ struct smr_cmd {
 	};
 };
 
+/* Inject buffers are sized at region creation, between SMR_INJECT_SIZE
+ * and SMR_MAX_INJECT_SIZE.  Atomics only use the first SMR_INJECT_SIZE
+ * bytes. */
 #define SMR_INJECT_SIZE		4096
+#define SMR_MAX_INJECT_SIZE	(1 << 16)
 #define SMR_COMP_INJECT_SIZE	(SMR_INJECT_SIZE / 2)
+#define SMR_INJECT_ALIGN	64
+#define smr_inject_align(size)	\
+	(ofi_div_ceil((size), SMR_INJECT_ALIGN) * SMR_INJECT_ALIGN)
 
 #define SMR_NAME_SIZE	32
 struct smr_addr {
@@ -157,9 +166,37 @@ struct smr_addr {
 
 struct smr_region;
 
+/*
+ * A receive buffer the owner of a region publishes so that a sender can
+ * write a message straight into it.  The owner publishes (IDLE -> READY)
+ * only when it has no commands pending, and takes it back (READY -> IDLE)
+ * with the region lock held.  A sender claims it (READY -> CLAIMED) with
+ * the region lock held and only while the command queue is empty, so the
+ * published receive is the one its message would have matched anyway.
+ */
+#define SMR_POSTED_IOV_LIMIT	4
+
+enum {
+	SMR_POSTED_IDLE,
+	SMR_POSTED_READY,
+	SMR_POSTED_CLAIMED,
+};
+
+struct smr_posted_recv {
+	ofi_atomic32_t	state;
+	uint32_t	op;
+	fi_addr_t	addr;
+	uint64_t	tag;
+	uint64_t	ignore;
+	size_t		iov_count;
+	struct iovec	iov[SMR_POSTED_IOV_LIMIT];
+};
+
 struct smr_peer {
 	struct smr_addr		peer;
 	struct smr_region	*region;
+	int			signal_fd; /* local copy of peer's signal fd */
+	int			signal_err; /* signal_fd couldn't be copied */
 };
 
 #define SMR_MAX_PEERS	256
@@ -187,6 +224,17 @@ struct smr_region {
 				    cmd alloc/free depending on protocol
 				    (Ex. unexpected messages, RMA requests) */
 
+	size_t		inject_size; /* size of each inject buffer */
+
+	/* Doorbell for blocking waits.  The owner sets signal before
+	 * sleeping on signal_fd, an eventfd in its own process.  Peers
+	 * that post work while it is set clear it and write to their
+	 * duplicate of signal_fd.  signal_fd is -1 if no one ever waits. */
+	ofi_atomic32_t	signal;
+	int		signal_fd;
+
+	struct smr_posted_recv	posted;
+
 	/* offsets from start of smr_region */
 	size_t		cmd_queue_offset;
 	size_t		resp_queue_offset;
@@ -212,7 +260,65 @@ struct smr_inject_buf {
 
 OFI_DECLARE_CIRQUE(struct smr_cmd, smr_cmd_queue);
 OFI_DECLARE_CIRQUE(struct smr_resp, smr_resp_queue);
-DECLARE_SMR_FREESTACK(struct smr_inject_buf, smr_inject_pool);
+
+/*
+ * Pool of inject buffers, inject_size bytes each.  The stack of free
+ * buffers holds indices, so it is valid in every process mapping the
+ * region.  Protected by the region lock.
+ */
+struct smr_inject_pool {
+	size_t		size;
+	size_t		stride;
+	size_t		buf_offset;
+	size_t		top;
+	size_t		free[];
+};
+
+static inline size_t smr_inject_pool_hdr_size(size_t size)
+{
+	return smr_inject_align(sizeof(struct smr_inject_pool) +
+				sizeof(size_t) * size);
+}
+
+static inline size_t smr_inject_pool_total_size(size_t size, size_t buf_size)
+{
+	return smr_inject_pool_hdr_size(size) +
+	       smr_inject_align(buf_size) * size;
+}
+
+static inline void smr_inject_pool_init(struct smr_inject_pool *pool,
+					size_t size, size_t buf_size)
+{
+	size_t i;
+
+	pool->size = size;
+	pool->stride = smr_inject_align(buf_size);
+	pool->buf_offset = smr_inject_pool_hdr_size(size);
+	pool->top = size;
+	for (i = 0; i < size; i++)
+		pool->free[i] = size - 1 - i;
+}
+
+static inline int smr_inject_pool_isempty(struct smr_inject_pool *pool)
+{
+	return !pool->top;
+}
+
+static inline struct smr_inject_buf *
+smr_inject_pool_pop(struct smr_inject_pool *pool)
+{
+	assert(pool->top);
+	return (struct smr_inject_buf *) ((char *) pool + pool->buf_offset +
+					  pool->free[--pool->top] * pool->stride);
+}
+
+static inline void smr_inject_pool_push(struct smr_inject_pool *pool,
+					struct smr_inject_buf *buf)
+{
+	assert(pool->top < pool->size);
+	pool->free[pool->top++] = ((char *) buf - (char *) pool -
+				   pool->buf_offset) / pool->stride;
+}
 
 static inline struct smr_region *smr_peer_region(struct smr_region *smr, int i)
 {
@@ -248,6 +354,9 @@ struct smr_attr {
 	const char	*name;
 	size_t		rx_count;
 	size_t		tx_count;
+	size_t		inject_size;
+	int		numa_bind;
+	int		inject_first_touch;
 };
 
 int	smr_map_create(const struct fi_provider *prov, int peer_count,
@@ -268,6 +377,19 @@ int	smr_create(const struct fi_provider *prov, struct smr_map *map,
 		   const struct smr_attr *attr, struct smr_region **smr);
 void	smr_free(struct smr_region *smr);
 
+int	smr_signal_open(const struct fi_provider *prov, struct smr_region *smr);
+int	smr_signal_reset(struct smr_region *smr);
+void	smr_signal_peer(const struct fi_provider *prov, struct smr_map *map,
+			int id);
+
+/* Wakes peer id if it is blocked waiting for work */
+static inline void smr_signal(const struct fi_provider *prov,
+			      struct smr_map *map, int id)
+{
+	if (ofi_atomic_get32(&map->peers[id].region->signal))
+		smr_signal_peer(prov, map, id);
+}
+
 #ifdef __cplusplus
 }
 #endif
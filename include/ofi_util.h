@@ -227,6 +227,19 @@ struct util_ep;
 typedef void (*ofi_ep_progress_func)(struct util_ep *util_ep);
 typedef void (*ofi_cntr_inc_func)(struct util_cntr *util_cntr);
 
+/* Counters behind FI_OPT_EP_STATS, collected only when FI_EP_STATS is set.
+ * Senders on FI_THREAD_SAFE domains update them without holding any
+ * endpoint lock, so they are atomic. */
+struct util_ep_stats {
+	ofi_atomic64_t		tx_msgs;
+	ofi_atomic64_t		tx_bytes;
+	ofi_atomic64_t		rx_msgs;
+	ofi_atomic64_t		rx_bytes;
+	ofi_atomic64_t		unexp_msgs;
+	ofi_atomic64_t		retries;
+	ofi_atomic64_t		eagain;
+};
+
 struct util_ep {
 	struct fid_ep		ep_fid;
 	struct util_domain	*domain;
@@ -268,8 +281,56 @@ struct util_ep {
 	fastlock_t		lock;
 	ofi_fastlock_acquire_t	lock_acquire;
 	ofi_fastlock_release_t	lock_release;
+
+	struct util_ep_stats	stats;
 };
 
+extern int ofi_ep_stats_enabled;
+
+static inline void ofi_ep_stats_tx(struct util_ep *ep, size_t len)
+{
+	if (!ofi_ep_stats_enabled)
+		return;
+
+	ofi_atomic_inc64(&ep->stats.tx_msgs);
+	ofi_atomic_add64(&ep->stats.tx_bytes, len);
+}
+
+static inline void ofi_ep_stats_rx(struct util_ep *ep, size_t len)
+{
+	if (!ofi_ep_stats_enabled)
+		return;
+
+	ofi_atomic_inc64(&ep->stats.rx_msgs);
+	ofi_atomic_add64(&ep->stats.rx_bytes, len);
+}
+
+static inline void ofi_ep_stats_unexp(struct util_ep *ep)
+{
+	if (!ofi_ep_stats_enabled)
+		return;
+
+	ofi_atomic_inc64(&ep->stats.unexp_msgs);
+}
+
+static inline void ofi_ep_stats_retry(struct util_ep *ep)
+{
+	if (!ofi_ep_stats_enabled)
+		return;
+
+	ofi_atomic_inc64(&ep->stats.retries);
+}
+
+static inline void ofi_ep_stats_eagain(struct util_ep *ep)
+{
+	if (!ofi_ep_stats_enabled)
+		return;
+
+	ofi_atomic_inc64(&ep->stats.eagain);
+}
+
+int ofi_ep_getopt_stats(struct util_ep *ep, void *optval, size_t *optlen);
+
 int ofi_ep_bind_av(struct util_ep *util_ep, struct util_av *av);
 int ofi_ep_bind_eq(struct util_ep *ep, struct util_eq *eq);
 int ofi_ep_bind_cq(struct util_ep *ep, struct util_cq *cq, uint64_t flags);
@@ -436,6 +497,8 @@ struct util_cq {
 	int			internal_wait;
 	ofi_atomic32_t		signaled;
 	ofi_cq_progress_func	progress;
+	/* endpoints with ready fds, used by ofi_cq_progress_ready */
+	fi_epoll_t		ready_set;
 };
 
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
@@ -444,6 +507,21 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 int ofi_check_bind_cq_flags(struct util_ep *ep, struct util_cq *cq,
 			    uint64_t flags);
 void ofi_cq_progress(struct util_cq *cq);
+
+/*
+ * Readiness driven progress: only endpoints whose fds were added to the
+ * CQ ready set and are reported ready by it are progressed when the CQ is
+ * read.  Providers register FI_EPOLL_OUT as well while an endpoint has
+ * work pending that does not depend on incoming data.  The add, mod and
+ * del calls do nothing unless ofi_cq_ready_init was called on the CQ.
+ */
+int ofi_cq_ready_init(struct util_cq *cq);
+int ofi_cq_ready_add(struct util_cq *cq, int fd, uint32_t events,
+		     struct util_ep *ep);
+int ofi_cq_ready_mod(struct util_cq *cq, int fd, uint32_t events,
+		     struct util_ep *ep);
+void ofi_cq_ready_del(struct util_cq *cq, int fd);
+void ofi_cq_progress_ready(struct util_cq *cq);
 int ofi_cq_cleanup(struct util_cq *cq);
 int ofi_cq_control(struct fid *fid, int command, void *arg);
 ssize_t ofi_cq_read(struct fid_cq *cq_fid, void *buf, size_t count);
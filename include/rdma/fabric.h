@@ -585,6 +585,7 @@ enum {
 	FI_FLUSH_WORK,		/* NULL */
 	FI_REFRESH,		/* mr: fi_mr_modify */
 	FI_DUP,			/* struct fid ** */
+	FI_GET_MR_CACHE_STATS,	/* struct fi_mr_cache_stats */
 };
 
 static inline int fi_control(struct fid *fid, int command, void *arg)
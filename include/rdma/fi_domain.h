@@ -112,6 +112,17 @@ struct fi_mr_modify {
 	struct fi_mr_attr	attr;
 };
 
+struct fi_mr_cache_stats {
+	size_t			size;	/* set by the caller and provider */
+	uint64_t		searches;
+	uint64_t		hits;
+	uint64_t		misses;
+	uint64_t		evictions;
+	uint64_t		invalidations;
+	uint64_t		cached_cnt;
+	uint64_t		cached_size;
+};
+
 
 #ifdef FABRIC_DIRECT
 #include <rdma/fi_direct_atomic_def.h>
@@ -66,6 +66,18 @@ enum {
 	FI_OPT_RECV_BUF_SIZE,
 	FI_OPT_TX_SIZE,
 	FI_OPT_RX_SIZE,
+	FI_OPT_EP_STATS,		/* struct fi_ep_stats */
+};
+
+struct fi_ep_stats {
+	size_t			size;	/* set by the provider */
+	uint64_t		tx_msgs;
+	uint64_t		tx_bytes;
+	uint64_t		rx_msgs;
+	uint64_t		rx_bytes;
+	uint64_t		unexp_msgs;
+	uint64_t		retries;
+	uint64_t		eagain;
 };
 
 struct fi_ops_ep {
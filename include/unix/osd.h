@@ -280,8 +280,12 @@ OFI_DEF_COMPLEX_OPS(long_double)
 #ifdef HAVE_BUILTIN_ATOMICS
 #define ofi_atomic_add_and_fetch(radix, ptr, val) __sync_add_and_fetch((ptr), (val))
 #define ofi_atomic_sub_and_fetch(radix, ptr, val) __sync_sub_and_fetch((ptr), (val))
+#define ofi_atomic_load_acquire(radix, ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
 #endif /* HAVE_BUILTIN_ATOMICS */
 
+/* full memory barrier */
+#define ofi_mb() __sync_synchronize()
+
 int ofi_set_thread_affinity(const char *s);
 
 
@@ -304,12 +308,21 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 	asm volatile("clflush %0" : "+m" (*(volatile char *) addr))
 #define ofi_sfence() asm volatile("sfence" ::: "memory")
 
+static inline uint64_t ofi_xgetbv(unsigned xcr)
+{
+	uint32_t eax, edx;
+
+	asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (xcr));
+	return ((uint64_t) edx << 32) | eax;
+}
+
 #else /* defined(__x86_64__) || defined(__amd64__) */
 
 #define ofi_cpuid(func, subfunc, cpuinfo)
 #define ofi_clwb(addr)
 #define ofi_clflushopt(addr)
 #define ofi_clflush(addr)
+#define ofi_xgetbv(xcr) 0
 #define ofi_sfence()
 
 #endif /* defined(__x86_64__) || defined(__amd64__) */
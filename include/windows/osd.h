@@ -938,13 +938,18 @@ OFI_DEF_COMPLEX(long_double)
 /* atomics primitives */
 #ifdef HAVE_BUILTIN_ATOMICS
 #define InterlockedAdd32 InterlockedAdd
+#define ReadAcquire32 ReadAcquire
 typedef LONG ofi_atomic_int_32_t;
 typedef LONGLONG ofi_atomic_int_64_t;
 
 #define ofi_atomic_add_and_fetch(radix, ptr, val) InterlockedAdd##radix((ofi_atomic_int_##radix##_t *)(ptr), (ofi_atomic_int_##radix##_t)(val))
 #define ofi_atomic_sub_and_fetch(radix, ptr, val) InterlockedAdd##radix((ofi_atomic_int_##radix##_t *)(ptr), -(ofi_atomic_int_##radix##_t)(val))
+#define ofi_atomic_load_acquire(radix, ptr) ReadAcquire##radix((ofi_atomic_int_##radix##_t *)(ptr))
 #endif /* HAVE_BUILTIN_ATOMICS */
 
+/* full memory barrier */
+#define ofi_mb() MemoryBarrier()
+
 static inline int ofi_set_thread_affinity(const char *s)
 {
 	OFI_UNUSED(s);
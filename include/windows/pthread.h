@@ -69,6 +69,70 @@ static inline int pthread_mutex_unlock(pthread_mutex_t* mutex)
 	return 0;
 }
 
+/* SRW locks are released according to the mode they were taken in.  Only
+ * one thread may hold the lock exclusively, so the writer flag tells
+ * pthread_rwlock_unlock() which release to use. */
+typedef struct {
+	SRWLOCK	lock;
+	int	write_locked;
+} pthread_rwlock_t;
+
+static inline int pthread_rwlock_init(pthread_rwlock_t* rwlock, void* attr)
+{
+	(void) attr;
+	InitializeSRWLock(&rwlock->lock);
+	rwlock->write_locked = 0;
+	return 0;
+}
+
+static inline int pthread_rwlock_destroy(pthread_rwlock_t* rwlock)
+{
+	(void) rwlock;
+	return 0;
+}
+
+static inline int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock)
+{
+	AcquireSRWLockShared(&rwlock->lock);
+	return 0;
+}
+
+static inline int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
+{
+	AcquireSRWLockExclusive(&rwlock->lock);
+	rwlock->write_locked = 1;
+	return 0;
+}
+
+static inline int pthread_rwlock_unlock(pthread_rwlock_t* rwlock)
+{
+	if (rwlock->write_locked) {
+		rwlock->write_locked = 0;
+		ReleaseSRWLockExclusive(&rwlock->lock);
+	} else {
+		ReleaseSRWLockShared(&rwlock->lock);
+	}
+	return 0;
+}
+
+typedef INIT_ONCE pthread_once_t;
+#define PTHREAD_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+static BOOL CALLBACK ofi_pthread_once_fn(PINIT_ONCE once, PVOID param,
+					 PVOID *ctx)
+{
+	(void) once;
+	(void) ctx;
+	((void (*)(void)) param)();
+	return TRUE;
+}
+
+static inline int pthread_once(pthread_once_t* once, void (*init)(void))
+{
+	return InitOnceExecuteOnce(once, ofi_pthread_once_fn,
+				   (PVOID) init, NULL) ? 0 : -1;
+}
+
 static inline int pthread_join(pthread_t thread, void** exit_code)
 {
 	if (WaitForSingleObject(thread, INFINITE) == WAIT_OBJECT_0) {
@@ -74,6 +74,14 @@ extern size_t mrail_num_info;
 
 extern struct fi_ops_rma mrail_ops_rma;
 
+struct mrail_env {
+	size_t	stripe_size;
+	size_t	*stripe_weights;
+	size_t	num_stripe_weights;
+};
+
+extern struct mrail_env mrail_env;
+
 struct mrail_match_attr {
 	fi_addr_t addr;
 	uint64_t tag;
@@ -106,16 +114,31 @@ mrail_match_recv_handle_unexp(struct mrail_recv_queue *recv_queue, uint64_t tag,
 			      uint64_t addr, char *data, size_t len, void *context);
 
 /* mrail protocol */
-#define MRAIL_HDR_VERSION 1
+#define MRAIL_HDR_VERSION 2
+
+/* Messages of at least mrail_env.stripe_size bytes are split into one chunk
+ * per rail.  Each chunk takes its own sequence number.  The first chunk
+ * carries the original op and tag and is used for matching, the others are
+ * sent as MRAIL_OP_STRIPE with the chunk's offset in place of the tag.
+ * stripe_cnt is the number of chunks, or 0 for a message sent whole. */
+#define MRAIL_OP_STRIPE	0x80
+
+/* Sent in place of a message that failed on a rail and can't be sent again
+ * because its data may be gone.  It only carries the sequence number, so the
+ * receiver does not wait for the lost message. */
+#define MRAIL_OP_SKIP	0x81
 
 struct mrail_hdr {
 	uint8_t		version;
 	uint8_t		op;
-	uint8_t		padding[2];
+	uint8_t		stripe_cnt;
+	uint8_t		padding;
 	uint32_t	seq;
 	uint64_t 	tag;
 };
 
+#define MRAIL_IOV_LIMIT	5
+
 struct mrail_tx_buf {
 	/* context should stay at top and would get overwritten on
 	 * util buf release */
@@ -124,6 +147,17 @@ struct mrail_tx_buf {
 	/* flags would be used for both operation flags (FI_COMPLETION)
 	 * and completion flags (FI_MSG, FI_TAGGED, etc) */
 	uint64_t		flags;
+	/* Set for the chunks of a striped send */
+	struct mrail_subreq	*subreq;
+	/* Rail the send was posted on and what is needed to post it again
+	 * on another rail if that one fails */
+	uint32_t		rail;
+	uint64_t		post_time;
+	struct slist_entry	retry_entry;
+	struct iovec		iov[MRAIL_IOV_LIMIT];
+	size_t			iov_count;
+	fi_addr_t		addr;
+	uint64_t		data;
 	struct mrail_hdr	hdr;
 };
 
@@ -134,8 +168,6 @@ struct mrail_pkt {
 
 /* TX & RX processing */
 
-#define MRAIL_IOV_LIMIT	5
-
 struct mrail_rx_buf {
 	struct fid_ep		*rail_ep;
 	struct mrail_pkt	pkt;
@@ -150,6 +182,7 @@ struct mrail_recv {
 	uint64_t 		comp_flags;
 	struct mrail_hdr	hdr;
 	struct mrail_ep		*ep;
+	struct mrail_stripe	*stripe;
 	struct dlist_entry 	entry;
 	fi_addr_t 		addr;
 	uint64_t 		tag;
@@ -157,8 +190,23 @@ struct mrail_recv {
 };
 DECLARE_FREESTACK(struct mrail_recv, mrail_recv_fs);
 
+/* Reassembly state of a striped message on the receive side */
+struct mrail_stripe {
+	struct mrail_recv	*recv;		/* NULL until matched */
+	struct slist		pending;	/* chunks received before match */
+	size_t			chunks_left;	/* chunks yet to be received */
+	ofi_atomic32_t		comps_left;	/* chunks yet to be copied */
+	size_t			len;
+	uint64_t		flags;
+	uint64_t		data;
+	uint64_t		tag;
+};
+
 int mrail_cq_process_buf_recv(struct fi_cq_tagged_entry *comp,
 			      struct mrail_recv *recv);
+int mrail_cq_process_stripe_recv(struct fi_cq_tagged_entry *comp,
+				 struct mrail_stripe *stripe,
+				 struct mrail_recv *recv);
 
 struct mrail_fabric {
 	struct util_fabric util_fabric;
@@ -183,10 +231,14 @@ struct mrail_av {
 };
 
 struct mrail_peer_info {
-	struct slist	ooo_recv_queue;
-	fi_addr_t	addr;
-	uint32_t	seq_no;
-	uint32_t	expected_seq_no;
+	struct slist		ooo_recv_queue;
+	/* Striped message whose chunks are still arriving */
+	struct mrail_stripe	*stripe;
+	fi_addr_t		addr;
+	uint32_t		seq_no;
+	uint32_t		expected_seq_no;
+	/* Set for the rails a send to this peer failed on, indexed by rail */
+	uint8_t			rail_failed[];
 };
 
 struct mrail_ooo_recv {
@@ -200,18 +252,46 @@ typedef int (*mrail_cq_process_comp_func_t)(struct fi_cq_tagged_entry *comp,
 struct mrail_cq {
 	struct util_cq 			util_cq;
 	struct fid_cq 			**cqs;
+	/* Set for rails that reported an error the bound EPs have not
+	 * picked up yet, see mrail_ep_progress() */
+	int				*rail_errs;
 	size_t 				num_cqs;
 	mrail_cq_process_comp_func_t	process_comp;
 };
 
+/* Per-rail health and load.  inflight and the counters are updated from
+ * both the posting and the completion paths, so they are atomics.  The
+ * latency average is only a selection hint and tolerates racing updates. */
+struct mrail_rail_stats {
+	ofi_atomic32_t		inflight;
+	ofi_atomic64_t		posted;
+	ofi_atomic64_t		completed;
+	ofi_atomic64_t		errors;
+	ofi_atomic64_t		retried;
+	/* Moving average of the completion latency in usec, scaled by
+	 * 1 << MRAIL_LAT_SHIFT */
+	uint64_t		lat_avg;
+};
+
+#define MRAIL_LAT_SHIFT	3
+
 struct mrail_ep {
 	struct util_ep		util_ep;
 	struct fi_info		*info;
 	struct {
 		struct fid_ep 		*ep;
 		struct fi_info		*info;
+		/* Relative share of striped messages sent on this rail */
+		size_t			weight;
+		/* Set once the rail reported an error, it is no longer
+		 * used for new operations */
+		int			failed;
+		struct mrail_rail_stats	stats;
 	}			*rails;
 	size_t			num_eps;
+	size_t			active_rails;
+	size_t			weight_sum;
+	size_t			stripe_rails;
 	ofi_atomic32_t		tx_rail;
 	ofi_atomic32_t		rx_rail;
 
@@ -222,7 +302,12 @@ struct mrail_ep {
 	struct util_buf_pool	*req_pool;
 	struct util_buf_pool 	*ooo_recv_pool;
 	struct util_buf_pool 	*tx_buf_pool;
+	struct util_buf_pool	*stripe_pool;
 	struct slist		deferred_reqs;
+	/* Sends and subreqs that failed on a rail and wait to be posted
+	 * again on one of the remaining rails */
+	struct slist		retry_tx_bufs;
+	struct slist		retry_subreqs;
 };
 
 struct mrail_addr_key {
@@ -303,9 +388,47 @@ static inline int mrail_close_fids(struct fid **fids, size_t count)
 	return retv;
 }
 
-static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep)
+static inline int mrail_rail_usable(struct mrail_ep *mrail_ep,
+				    struct mrail_peer_info *peer_info,
+				    size_t rail)
+{
+	return !mrail_ep->rails[rail].failed && !peer_info->rail_failed[rail];
+}
+
+size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep,
+			 struct mrail_peer_info *peer_info);
+size_t mrail_peer_active_rails(struct mrail_ep *mrail_ep,
+			       struct mrail_peer_info *peer_info);
+void mrail_rail_fail(struct mrail_ep *mrail_ep, size_t rail, int err);
+void mrail_peer_rail_fail(struct mrail_ep *mrail_ep,
+			  struct mrail_peer_info *peer_info, size_t rail,
+			  int err);
+
+/* Account for an operation posted on a rail and return its post time */
+static inline uint64_t mrail_rail_posted(struct mrail_ep *mrail_ep,
+					 uint32_t rail)
+{
+	ofi_atomic_inc32(&mrail_ep->rails[rail].stats.inflight);
+	ofi_atomic_inc64(&mrail_ep->rails[rail].stats.posted);
+	return fi_gettime_us();
+}
+
+static inline void mrail_rail_unposted(struct mrail_ep *mrail_ep,
+				       uint32_t rail)
+{
+	ofi_atomic_dec32(&mrail_ep->rails[rail].stats.inflight);
+	ofi_atomic_dec64(&mrail_ep->rails[rail].stats.posted);
+}
+
+static inline void mrail_rail_completed(struct mrail_ep *mrail_ep,
+					uint32_t rail, uint64_t post_time)
 {
-	return (ofi_atomic_inc32(&mrail_ep->tx_rail) - 1) % mrail_ep->num_eps;
+	struct mrail_rail_stats *stats = &mrail_ep->rails[rail].stats;
+
+	ofi_atomic_dec32(&stats->inflight);
+	ofi_atomic_inc64(&stats->completed);
+	stats->lat_avg += (fi_gettime_us() - post_time) -
+			  (stats->lat_avg >> MRAIL_LAT_SHIFT);
 }
 
 struct mrail_subreq {
@@ -316,6 +439,13 @@ struct mrail_subreq {
 	struct fi_rma_iov rma_iov[MRAIL_IOV_LIMIT];
 	size_t iov_count;
 	size_t rma_iov_count;
+	/* Rail the subreq was last posted on.  Chunks of striped sends are
+	 * also sized for it. */
+	uint32_t rail;
+	uint64_t post_time;
+	struct slist_entry retry_entry;
+	/* Striped sends only */
+	struct mrail_tx_buf *tx_buf;
 };
 
 struct mrail_req {
@@ -328,6 +458,8 @@ struct mrail_req {
 	ofi_atomic32_t expected_subcomps;
 	int op_type;
 	int pending_subreq;
+	/* First error of a subreq that could not be posted on any rail */
+	int err;
 	struct mrail_subreq subreqs[];
 };
 
@@ -352,6 +484,15 @@ void mrail_free_req(struct mrail_ep *mrail_ep, struct mrail_req *req)
 }
 
 void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep);
+void mrail_post_deferred_req(struct mrail_ep *mrail_ep, struct mrail_req *req);
+ssize_t mrail_post_send_subreq(struct mrail_subreq *subreq);
+ssize_t mrail_post_subreq(uint32_t rail, struct mrail_subreq *subreq);
+
+void mrail_queue_retry_tx_buf(struct mrail_tx_buf *tx_buf);
+void mrail_queue_retry_subreq(struct mrail_subreq *subreq);
+void mrail_progress_retries(struct mrail_ep *mrail_ep);
+void mrail_tx_buf_fail(struct mrail_tx_buf *tx_buf, int err);
+void mrail_subreq_fail(struct mrail_subreq *subreq, int err);
 
 void mrail_poll_cq(struct util_cq *cq);
 
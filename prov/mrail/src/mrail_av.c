@@ -65,7 +65,7 @@ static int mrail_av_insert(struct fid_av *av_fid, const void *addr, size_t count
 	struct mrail_av *mrail_av;
 	struct mrail_peer_info *peer_info;
 	size_t i, j, offset, num_inserted = 0;
-	fi_addr_t index;
+	fi_addr_t index, rail_addr;
 	int ret;
 
 	mrail_av = container_of(av_fid, struct mrail_av, util_av.av_fid);
@@ -92,13 +92,17 @@ static int mrail_av_insert(struct fid_av *av_fid, const void *addr, size_t count
 					"addr", addr);
 			ret = fi_av_insert(mrail_av->avs[j],
 					   (char *)addr + offset, 1,
-					   NULL, flags, NULL);
+					   j ? NULL : &rail_addr, flags, NULL);
 			if (ret != 1) {
 				free(peer_info);
 				return ret;
 			}
 			offset += mrail_av->rail_addrlen[j];
 		}
+		/* Rail AVs are FI_AV_TABLE and filled in lockstep, so the
+		 * rail address is also the peer's mrail address.  Storing it
+		 * before the insert keeps peer_info unique per peer. */
+		peer_info->addr = rail_addr;
 		ret = ofi_av_insert_addr(&mrail_av->util_av, peer_info,
 					 &index);
 		if (fi_addr) {
@@ -155,7 +159,8 @@ int mrail_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 
 	mrail_av->num_avs = mrail_domain->num_domains;
 
-	util_attr.addrlen = sizeof(struct mrail_peer_info);
+	util_attr.addrlen = sizeof(struct mrail_peer_info) +
+			    sizeof(uint8_t) * mrail_av->num_avs;
 	/* We just need a table to store the mapping */
 	util_attr.flags = 0;
 
@@ -117,19 +117,228 @@ out:
 	return retv;
 }
 
+static int mrail_stripe_complete(struct mrail_stripe *stripe)
+{
+	struct mrail_recv *recv = stripe->recv;
+	struct mrail_ep *mrail_ep = recv->ep;
+	size_t size;
+	int ret = 0;
+
+	size = ofi_total_iov_len(&recv->iov[1], recv->count - 1);
+	if (stripe->len > size) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Message truncated recv buf "
+			"size: %zu message length: %zu\n", size, stripe->len);
+		ret = ofi_cq_write_error_trunc(
+			mrail_ep->util_ep.rx_cq, recv->context,
+			recv->comp_flags | stripe->flags, 0, NULL, stripe->data,
+			stripe->tag, stripe->len - size);
+		mrail_cntr_incerr(mrail_ep->util_ep.rx_cntr);
+	} else {
+		FI_DBG(&mrail_prov, FI_LOG_CQ, "finish striped recv: length: "
+		       "%zu tag: 0x%" PRIx64 "\n", stripe->len, stripe->tag);
+		ofi_ep_rx_cntr_inc(&mrail_ep->util_ep);
+		if (recv->flags & FI_COMPLETION)
+			ret = ofi_cq_write(mrail_ep->util_ep.rx_cq,
+					   recv->context,
+					   recv->comp_flags | stripe->flags,
+					   stripe->len, NULL, stripe->data,
+					   stripe->tag);
+	}
+	if (ret)
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Unable to write to util cq\n");
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	util_buf_release(mrail_ep->stripe_pool, stripe);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+
+	recv->stripe = NULL;
+	mrail_push_recv(recv);
+	return ret;
+}
+
+static int mrail_stripe_chunk_done(struct mrail_stripe *stripe)
+{
+	if (ofi_atomic_dec32(&stripe->comps_left))
+		return 0;
+	return mrail_stripe_complete(stripe);
+}
+
+/* Copy a chunk of a matched striped message to its offset in the receive
+ * buffer.  Chunks too large to have been buffered by the rail are claimed
+ * straight into place and complete through FI_CLAIM.  A chunk that doesn't
+ * fit is dropped and the message completes as truncated. */
+static int mrail_stripe_copy_chunk(struct mrail_stripe *stripe,
+				   struct fi_cq_tagged_entry *comp)
+{
+	struct fi_recv_context *recv_ctx = comp->op_context;
+	struct mrail_pkt *mrail_pkt = comp->buf;
+	struct mrail_recv *recv = stripe->recv;
+	struct iovec iov[MRAIL_IOV_LIMIT];
+	struct fi_msg msg = {
+		.context = recv_ctx,
+	};
+	size_t count, offset, len;
+	int ret;
+
+	offset = (mrail_pkt->hdr.op == MRAIL_OP_STRIPE) ? mrail_pkt->hdr.tag : 0;
+	len = comp->len - sizeof(*mrail_pkt);
+	count = recv->count - 1;
+
+	if (!(comp->flags & FI_MORE)) {
+		ofi_copy_to_iov(&recv->iov[1], count, offset, mrail_pkt->data,
+				len);
+	} else if (offset + len <= ofi_total_iov_len(&recv->iov[1], count)) {
+		iov[0] = recv->iov[0];
+		memcpy(&iov[1], &recv->iov[1], sizeof(*iov) * count);
+		ofi_consume_iov(&iov[1], &count, offset);
+		ofi_truncate_iov(&iov[1], &count, len);
+
+		msg.msg_iov	= iov;
+		msg.iov_count	= count + 1;
+		msg.addr	= recv->addr;
+
+		recv_ctx->context = recv;
+
+		ret = fi_recvmsg(recv_ctx->ep, &msg, FI_CLAIM);
+		if (ret) {
+			FI_WARN(&mrail_prov, FI_LOG_CQ,
+				"Unable to claim buffered recv\n");
+			assert(0);
+		}
+		return ret;
+	}
+
+	ret = fi_recvmsg(recv_ctx->ep, &msg, FI_DISCARD);
+	if (ret) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ,
+			"Unable to discard buffered recv\n");
+		mrail_stripe_chunk_done(stripe);
+		return ret;
+	}
+	return mrail_stripe_chunk_done(stripe);
+}
+
+int mrail_cq_process_stripe_recv(struct fi_cq_tagged_entry *comp,
+				 struct mrail_stripe *stripe,
+				 struct mrail_recv *recv)
+{
+	struct mrail_ep *mrail_ep = recv->ep;
+	struct mrail_ooo_recv *chunk;
+	struct slist pending;
+	int ret, retv;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	recv->stripe = stripe;
+	stripe->recv = recv;
+	pending = stripe->pending;
+	slist_init(&stripe->pending);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+
+	/* Chunks that arrived before the match can go in now.  The stripe
+	 * may be released as soon as the last one is copied. */
+	retv = mrail_stripe_copy_chunk(stripe, comp);
+	while (!slist_empty(&pending)) {
+		slist_remove_head_container(&pending, struct mrail_ooo_recv,
+					    chunk, entry);
+		ret = mrail_stripe_copy_chunk(stripe, &chunk->comp);
+		if (ret)
+			retv = ret;
+
+		ofi_ep_lock_acquire(&mrail_ep->util_ep);
+		util_buf_release(mrail_ep->ooo_recv_pool, chunk);
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+	}
+	return retv;
+}
+
+/* Should only be called while holding the EP's lock */
+static struct mrail_stripe *
+mrail_stripe_alloc(struct mrail_ep *mrail_ep, struct fi_cq_tagged_entry *comp)
+{
+	struct mrail_hdr *hdr = comp->buf;
+	struct mrail_stripe *stripe;
+
+	stripe = util_buf_alloc(mrail_ep->stripe_pool);
+	if (!stripe) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Cannot allocate stripe\n");
+		assert(0);
+		return NULL;
+	}
+
+	stripe->recv		= NULL;
+	stripe->chunks_left	= hdr->stripe_cnt - 1;
+	stripe->len		= comp->len - sizeof(struct mrail_pkt);
+	stripe->flags		= comp->flags & FI_REMOTE_CQ_DATA;
+	stripe->data		= comp->data;
+	stripe->tag		= hdr->tag;
+	slist_init(&stripe->pending);
+	ofi_atomic_initialize32(&stripe->comps_left, hdr->stripe_cnt);
+	return stripe;
+}
+
 /* Should only be called while holding the EP's lock */
+static void mrail_stripe_save_chunk(struct mrail_ep *mrail_ep,
+				    struct mrail_stripe *stripe,
+				    struct fi_cq_tagged_entry *comp)
+{
+	struct mrail_ooo_recv *chunk;
+
+	chunk = util_buf_alloc(mrail_ep->ooo_recv_pool);
+	if (!chunk) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Cannot allocate stripe chunk\n");
+		assert(0);
+		return;
+	}
+	memcpy(&chunk->comp, comp, sizeof(*comp));
+	slist_insert_tail(&chunk->entry, &stripe->pending);
+}
+
+/* Should only be called while holding the EP's lock.
+ *
+ * Striped messages are matched on their first chunk.  The remaining chunks
+ * follow it in sequence and are tied to it through peer_info->stripe; they
+ * are set aside until the message is matched.  *stripe is set if the
+ * message is striped. */
 static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
+					   struct mrail_peer_info *peer_info,
 					   struct fi_cq_tagged_entry *comp,
-					   int src_addr)
+					   int src_addr,
+					   struct mrail_stripe **stripe)
 {
 	struct mrail_hdr *hdr = comp->buf;
 	struct mrail_recv *recv;
 
+	if (hdr->op == MRAIL_OP_SKIP) {
+		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got SKIP op\n");
+		*stripe = NULL;
+		return NULL;
+	}
+
+	if (hdr->op == MRAIL_OP_STRIPE) {
+		*stripe = peer_info->stripe;
+		assert(*stripe);
+		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got stripe chunk at offset: %"
+		       PRIu64 "\n", hdr->tag);
+		if (!--(*stripe)->chunks_left)
+			peer_info->stripe = NULL;
+		(*stripe)->len += comp->len - sizeof(struct mrail_pkt);
+		if (!(*stripe)->recv)
+			mrail_stripe_save_chunk(mrail_ep, *stripe, comp);
+		return (*stripe)->recv;
+	}
+
+	*stripe = NULL;
+	if (hdr->stripe_cnt) {
+		*stripe = mrail_stripe_alloc(mrail_ep, comp);
+		if (hdr->stripe_cnt > 1)
+			peer_info->stripe = *stripe;
+	}
+
 	if (hdr->op == ofi_op_msg) {
 		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got MSG op\n");
 		recv = mrail_match_recv_handle_unexp(&mrail_ep->recv_queue, 0,
 						     src_addr, (char *)comp,
-						     sizeof(*comp), NULL);
+						     sizeof(*comp), *stripe);
 	} else {
 		assert(hdr->op == ofi_op_tagged);
 		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got TAGGED op with tag: 0x%"
@@ -137,12 +346,48 @@ static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
 		recv = mrail_match_recv_handle_unexp(&mrail_ep->trecv_queue,
 						     hdr->tag, src_addr,
 						     (char *)comp,
-						     sizeof(*comp), NULL);
+						     sizeof(*comp), *stripe);
 	}
 
 	return recv;
 }
 
+static int mrail_process_recv(struct fi_cq_tagged_entry *comp,
+			      struct mrail_recv *recv,
+			      struct mrail_stripe *stripe)
+{
+	struct mrail_hdr *hdr = comp->buf;
+
+	if (!stripe)
+		return mrail_cq_process_buf_recv(comp, recv);
+	if (hdr->op == MRAIL_OP_STRIPE)
+		return mrail_stripe_copy_chunk(stripe, comp);
+	return mrail_cq_process_stripe_recv(comp, stripe, recv);
+}
+
+static inline int mrail_recv_is_skip(struct fi_cq_tagged_entry *comp)
+{
+	return ((struct mrail_hdr *) comp->buf)->op == MRAIL_OP_SKIP;
+}
+
+/* Return the buffer of a duplicate or a skip to the rail */
+static int mrail_discard_recv(struct fi_cq_tagged_entry *comp,
+			      uint32_t seq_no)
+{
+	struct fi_recv_context *recv_ctx = comp->op_context;
+	struct fi_msg msg = {
+		.context = recv_ctx,
+	};
+	int ret;
+
+	FI_DBG(&mrail_prov, FI_LOG_CQ, "dropping seq=%d\n", seq_no);
+	ret = fi_recvmsg(recv_ctx->ep, &msg, FI_DISCARD);
+	if (ret)
+		FI_WARN(&mrail_prov, FI_LOG_CQ,
+			"Unable to discard buffered recv\n");
+	return ret;
+}
+
 static
 struct mrail_ooo_recv *mrail_get_next_recv(struct mrail_peer_info *peer_info)
 {
@@ -165,6 +410,7 @@ static int mrail_process_ooo_recvs(struct mrail_ep *mrail_ep,
 				   struct mrail_peer_info *peer_info)
 {
 	struct mrail_ooo_recv *ooo_recv;
+	struct mrail_stripe *stripe;
 	struct mrail_recv *recv;
 	int ret;
 
@@ -175,12 +421,17 @@ static int mrail_process_ooo_recvs(struct mrail_ep *mrail_ep,
 				ooo_recv->seq_no);
 		/* Requesting FI_AV_TABLE from the underlying provider allows
 		 * us to use peer_info->addr as an int here. */
-		recv = mrail_match_recv(mrail_ep, &ooo_recv->comp,
-				(int) peer_info->addr);
+		recv = mrail_match_recv(mrail_ep, peer_info, &ooo_recv->comp,
+				(int) peer_info->addr, &stripe);
 		ofi_ep_lock_release(&mrail_ep->util_ep);
 
 		if (recv) {
-			ret = mrail_cq_process_buf_recv(&ooo_recv->comp, recv);
+			ret = mrail_process_recv(&ooo_recv->comp, recv, stripe);
+			if (ret)
+				return ret;
+		} else if (mrail_recv_is_skip(&ooo_recv->comp)) {
+			ret = mrail_discard_recv(&ooo_recv->comp,
+						 ooo_recv->seq_no);
 			if (ret)
 				return ret;
 		}
@@ -227,11 +478,35 @@ static void mrail_save_ooo_recv(struct mrail_ep *mrail_ep,
 	FI_DBG(&mrail_prov, FI_LOG_CQ, "saved ooo_recv seq=%d\n", seq_no);
 }
 
+static int mrail_ooo_recv_match_seq(struct slist_entry *item, const void *arg)
+{
+	struct mrail_ooo_recv *ooo_recv;
+
+	ooo_recv = container_of(item, struct mrail_ooo_recv, entry);
+	return ooo_recv->seq_no == *(const uint32_t *) arg;
+}
+
+/* Should only be called while holding the EP's lock.
+ *
+ * A message that failed over from a broken rail keeps its sequence number,
+ * but the broken rail may have delivered it before reporting the error.
+ * The second copy is either behind expected_seq_no or already queued. */
+static int mrail_recv_is_dup(struct mrail_peer_info *peer_info,
+			     uint32_t seq_no)
+{
+	if ((int32_t) (seq_no - peer_info->expected_seq_no) < 0)
+		return 1;
+	return slist_find_first_match(&peer_info->ooo_recv_queue,
+				      mrail_ooo_recv_match_seq,
+				      &seq_no) != NULL;
+}
+
 static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 					fi_addr_t src_addr)
 {
 	struct fi_recv_context *recv_ctx;
 	struct mrail_peer_info *peer_info;
+	struct mrail_stripe *stripe;
 	struct mrail_ep *mrail_ep;
 	struct mrail_recv *recv;
 	struct mrail_hdr *hdr;
@@ -244,6 +519,10 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 		 */
 		recv = comp->op_context;
 		assert(recv->hdr.version == MRAIL_HDR_VERSION);
+		if (recv->stripe) {
+			ret = mrail_stripe_chunk_done(recv->stripe);
+			goto exit;
+		}
 		ret =  mrail_cq_write_recv_comp(recv->ep, &recv->hdr, comp,
 						recv);
 		mrail_push_recv(recv);
@@ -264,16 +543,24 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 			mrail_ep, (int)peer_info->addr, seq_no,
 			peer_info->expected_seq_no);
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
-	if (seq_no == peer_info->expected_seq_no) {
+	if (mrail_recv_is_dup(peer_info, seq_no)) {
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+		ret = mrail_discard_recv(comp, seq_no);
+	} else if (seq_no == peer_info->expected_seq_no) {
 		/* This message was received in order */
 		peer_info->expected_seq_no++;
 		/* Requesting FI_AV_TABLE from the underlying provider allows
 		 * us to use src_addr as an int here. */
-		recv = mrail_match_recv(mrail_ep, comp, (int) src_addr);
+		recv = mrail_match_recv(mrail_ep, peer_info, comp,
+					(int) src_addr, &stripe);
 		ofi_ep_lock_release(&mrail_ep->util_ep);
 
 		if (recv) {
-			ret = mrail_cq_process_buf_recv(comp, recv);
+			ret = mrail_process_recv(comp, recv, stripe);
+			if (ret)
+				goto exit;
+		} else if (mrail_recv_is_skip(comp)) {
+			ret = mrail_discard_recv(comp, seq_no);
 			if (ret)
 				goto exit;
 		}
@@ -302,6 +589,7 @@ static int mrail_cq_close(fid_t fid)
 	if (ret)
 		retv = ret;
 	free(mrail_cq->cqs);
+	free(mrail_cq->rail_errs);
 
 	ret = ofi_cq_cleanup(&mrail_cq->util_cq);
 	if (ret)
@@ -332,6 +620,98 @@ static struct fi_ops_cq mrail_cq_ops = {
 	.strerror = fi_no_cq_strerror,
 };
 
+static void mrail_req_write_err(struct mrail_req *req)
+{
+	struct util_ep *util_ep = &req->mrail_ep->util_ep;
+	struct fi_cq_err_entry err_entry = {
+		.op_context	= req->comp.op_context,
+		.flags		= req->comp.flags,
+		.err		= req->err,
+		.prov_errno	= req->err,
+	};
+
+	if (req->op_type == FI_SEND)
+		mrail_cntr_incerr(util_ep->tx_cntr);
+	else if (req->op_type == FI_WRITE)
+		mrail_cntr_incerr(util_ep->wr_cntr);
+	else
+		mrail_cntr_incerr(util_ep->rd_cntr);
+
+	if (ofi_cq_write_error(util_ep->tx_cq, &err_entry)) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ,
+			"Unable to write error to util cq\n");
+		assert(0);
+	}
+	mrail_free_req(req->mrail_ep, req);
+}
+
+/* The subreq could not be completed on any rail */
+void mrail_subreq_fail(struct mrail_subreq *subreq, int err)
+{
+	struct mrail_req *req = subreq->parent;
+	struct mrail_ep *mrail_ep = req->mrail_ep;
+
+	if (req->op_type == FI_SEND) {
+		ofi_ep_lock_acquire(&mrail_ep->util_ep);
+		util_buf_release(mrail_ep->tx_buf_pool, subreq->tx_buf);
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+	}
+
+	if (!req->err)
+		req->err = err;
+	if (!ofi_atomic_dec32(&req->expected_subcomps))
+		mrail_req_write_err(req);
+}
+
+static void mrail_tx_buf_write_err(struct mrail_tx_buf *tx_buf, int err)
+{
+	struct mrail_ep *mrail_ep = tx_buf->ep;
+	struct fi_cq_err_entry err_entry = {
+		.op_context	= tx_buf->context,
+		.flags		= (tx_buf->flags & (FI_TAGGED | FI_MSG)) |
+				  FI_SEND,
+		.err		= err,
+		.prov_errno	= err,
+	};
+
+	mrail_cntr_incerr(mrail_ep->util_ep.tx_cntr);
+	if (ofi_cq_write_error(mrail_ep->util_ep.tx_cq, &err_entry)) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ,
+			"Unable to write error to util cq\n");
+		assert(0);
+	}
+}
+
+/* The send could not be completed on any rail.  A skip was sent for a
+ * send that was already reported. */
+void mrail_tx_buf_fail(struct mrail_tx_buf *tx_buf, int err)
+{
+	struct mrail_ep *mrail_ep = tx_buf->ep;
+
+	if (tx_buf->hdr.op != MRAIL_OP_SKIP)
+		mrail_tx_buf_write_err(tx_buf, err);
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	util_buf_release(mrail_ep->tx_buf_pool, tx_buf);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+/* The send consumed a sequence number but can't be posted again, because
+ * its data may be gone.  It is reported as failed, and its sequence number
+ * is sent alone on another rail so the peer does not wait for it. */
+static void mrail_tx_buf_skip(struct mrail_tx_buf *tx_buf, int err)
+{
+	mrail_tx_buf_write_err(tx_buf, err);
+
+	tx_buf->hdr.op		= MRAIL_OP_SKIP;
+	tx_buf->hdr.tag		= 0;
+	tx_buf->context		= NULL;
+	tx_buf->flags		= 0;
+	tx_buf->iov_count	= 0;
+	tx_buf->data		= 0;
+	mrail_queue_retry_tx_buf(tx_buf);
+}
+
 static void mrail_handle_rma_completion(struct util_cq *cq,
 		struct fi_cq_tagged_entry *comp)
 {
@@ -341,8 +721,13 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 
 	subreq = comp->op_context;
 	req = subreq->parent;
+	mrail_rail_completed(req->mrail_ep, subreq->rail, subreq->post_time);
 
 	if (ofi_atomic_dec32(&req->expected_subcomps) == 0) {
+		if (req->err) {
+			mrail_req_write_err(req);
+			return;
+		}
 		ret = ofi_cq_write(cq, req->comp.op_context, req->comp.flags,
 				req->comp.len, req->comp.buf, req->comp.data,
 				req->comp.tag);
@@ -363,6 +748,133 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 	}
 }
 
+static void mrail_handle_stripe_completion(struct util_cq *cq,
+					   struct mrail_tx_buf *tx_buf)
+{
+	struct mrail_subreq *subreq = tx_buf->subreq;
+	struct mrail_req *req = subreq->parent;
+	struct mrail_ep *mrail_ep = req->mrail_ep;
+	int ret;
+
+	mrail_rail_completed(mrail_ep, subreq->rail, subreq->post_time);
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	util_buf_release(mrail_ep->tx_buf_pool, tx_buf);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+
+	if (ofi_atomic_dec32(&req->expected_subcomps))
+		return;
+
+	if (req->err) {
+		mrail_req_write_err(req);
+		return;
+	}
+
+	ofi_ep_tx_cntr_inc(&mrail_ep->util_ep);
+	if (req->flags & FI_COMPLETION) {
+		ret = ofi_cq_write(cq, req->comp.op_context, req->comp.flags,
+				   0, NULL, 0, 0);
+		if (ret) {
+			FI_WARN(&mrail_prov, FI_LOG_CQ,
+				"Cannot write to util cq\n");
+			assert(0);
+		}
+	}
+	mrail_free_req(mrail_ep, req);
+}
+
+static void mrail_rail_errored(struct mrail_ep *mrail_ep,
+			       struct mrail_peer_info *peer_info,
+			       uint32_t rail, uint64_t post_time, int err)
+{
+	if (post_time)
+		ofi_atomic_dec32(&mrail_ep->rails[rail].stats.inflight);
+	ofi_atomic_inc64(&mrail_ep->rails[rail].stats.errors);
+	mrail_peer_rail_fail(mrail_ep, peer_info, rail, err);
+}
+
+/* An operation that failed on a rail takes the rail out of use for its
+ * peer.  Operations that can be told apart by the completion flags are
+ * posted again on the peer's remaining rails, unless none are left.  Sends
+ * whose data may be gone are replaced by a skip.  Other errors can't be
+ * matched to an EP or an operation: they are reported as is, and the EPs
+ * bound to the CQ stop using the rail for every peer on their next
+ * progress. */
+static void mrail_cq_handle_rail_err(struct mrail_cq *mrail_cq, size_t rail)
+{
+	struct fi_cq_err_entry err_entry = {0};
+	struct mrail_peer_info *peer_info;
+	struct mrail_tx_buf *tx_buf;
+	struct mrail_subreq *subreq;
+	struct mrail_ep *mrail_ep;
+	int err;
+	ssize_t ret;
+
+	ret = fi_cq_readerr(mrail_cq->cqs[rail], &err_entry, 0);
+	if (ret < 0) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ,
+			"Unable to read rail error completion: %s\n",
+			fi_strerror(-ret));
+		return;
+	}
+
+	err = err_entry.err ? err_entry.err : FI_EIO;
+	FI_WARN(&mrail_prov, FI_LOG_CQ, "Error on rail %zu: %s\n", rail,
+		fi_cq_strerror(mrail_cq->cqs[rail], err_entry.prov_errno,
+			       err_entry.err_data, NULL, 0));
+
+	if (err_entry.flags & FI_SEND) {
+		tx_buf = err_entry.op_context;
+		mrail_ep = tx_buf->ep;
+		subreq = tx_buf->subreq;
+
+		if (subreq) {
+			peer_info = subreq->parent->peer_info;
+			mrail_rail_errored(mrail_ep, peer_info, rail,
+					   subreq->post_time, err);
+			if (mrail_peer_active_rails(mrail_ep, peer_info))
+				mrail_queue_retry_subreq(subreq);
+			else
+				mrail_subreq_fail(subreq, err);
+			return;
+		}
+
+		peer_info = ofi_av_get_addr(mrail_ep->util_ep.av,
+					    (int) tx_buf->addr);
+		mrail_rail_errored(mrail_ep, peer_info, rail,
+				   tx_buf->post_time, err);
+		/* Only sends that report a completion saved their iov, and
+		 * the data of an inject may be gone */
+		if (!mrail_peer_active_rails(mrail_ep, peer_info))
+			mrail_tx_buf_fail(tx_buf, err);
+		else if (tx_buf->post_time && !(tx_buf->flags & FI_INJECT))
+			mrail_queue_retry_tx_buf(tx_buf);
+		else
+			mrail_tx_buf_skip(tx_buf, err);
+	} else if ((err_entry.flags & (FI_READ | FI_WRITE)) &&
+		   err_entry.op_context) {
+		subreq = err_entry.op_context;
+		mrail_ep = subreq->parent->mrail_ep;
+		peer_info = subreq->parent->peer_info;
+
+		mrail_rail_errored(mrail_ep, peer_info, rail,
+				   subreq->post_time, err);
+		if (mrail_peer_active_rails(mrail_ep, peer_info))
+			mrail_queue_retry_subreq(subreq);
+		else
+			mrail_subreq_fail(subreq, err);
+	} else {
+		mrail_cq->rail_errs[rail] = err;
+
+		err_entry.op_context = NULL;
+		err_entry.err_data = NULL;
+		err_entry.err_data_size = 0;
+		if (ofi_cq_write_error(&mrail_cq->util_cq, &err_entry))
+			FI_WARN(&mrail_prov, FI_LOG_CQ,
+				"Unable to write error to util cq\n");
+	}
+}
+
 void mrail_poll_cq(struct util_cq *cq)
 {
 	struct mrail_cq *mrail_cq;
@@ -378,6 +890,10 @@ void mrail_poll_cq(struct util_cq *cq)
 		ret = fi_cq_readfrom(mrail_cq->cqs[i], &comp, 1, &src_addr);
 		if (ret == -FI_EAGAIN || !ret)
 			continue;
+		if (ret == -FI_EAVAIL) {
+			mrail_cq_handle_rail_err(mrail_cq, i);
+			continue;
+		}
 		if (ret < 0) {
 			FI_WARN(&mrail_prov, FI_LOG_CQ,
 				"Unable to read rail completion: %s\n",
@@ -393,8 +909,17 @@ void mrail_poll_cq(struct util_cq *cq)
 			mrail_handle_rma_completion(cq, &comp);
 		} else if (comp.flags & FI_SEND) {
 			tx_buf = comp.op_context;
+			if (tx_buf->subreq) {
+				mrail_handle_stripe_completion(cq, tx_buf);
+				continue;
+			}
 
-			ofi_ep_tx_cntr_inc(&tx_buf->ep->util_ep);
+			if (tx_buf->post_time)
+				mrail_rail_completed(tx_buf->ep, tx_buf->rail,
+						     tx_buf->post_time);
+			/* A skip stands for a send that was reported failed */
+			if (tx_buf->hdr.op != MRAIL_OP_SKIP)
+				ofi_ep_tx_cntr_inc(&tx_buf->ep->util_ep);
 
 			if (tx_buf->flags & FI_COMPLETION) {
 				ret = ofi_cq_write(cq, tx_buf->context,
@@ -470,7 +995,9 @@ int mrail_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 
 	mrail_cq->cqs = calloc(mrail_domain->num_domains,
 			       sizeof(*mrail_cq->cqs));
-	if (!mrail_cq->cqs)
+	mrail_cq->rail_errs = calloc(mrail_domain->num_domains,
+				     sizeof(*mrail_cq->rail_errs));
+	if (!mrail_cq->cqs || !mrail_cq->rail_errs)
 		goto err;
 
 	mrail_cq->num_cqs = mrail_domain->num_domains;
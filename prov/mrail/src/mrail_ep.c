@@ -176,6 +176,7 @@ mrail_match_recv_handle_unexp(struct mrail_recv_queue *recv_queue, uint64_t tag,
 static void mrail_init_recv(struct mrail_recv *recv, void *arg)
 {
 	recv->ep		= arg;
+	recv->stripe		= NULL;
 	recv->iov[0].iov_base 	= &recv->hdr;
 	recv->iov[0].iov_len 	= sizeof(recv->hdr);
 	recv->comp_flags	= FI_RECV;
@@ -213,6 +214,7 @@ mrail_recv_common(struct mrail_ep *mrail_ep, struct mrail_recv_queue *recv_queue
 {
 	struct mrail_recv *recv;
 	struct mrail_unexp_msg_entry *unexp_msg_entry;
+	ssize_t ret;
 
 	recv = mrail_pop_recv(mrail_ep);
 	if (!recv)
@@ -252,8 +254,18 @@ mrail_recv_common(struct mrail_ep *mrail_ep, struct mrail_recv_queue *recv_queue
 	       "0x%" PRIx64 " found in unexpected msg queue\n",
 	       recv->addr, recv->tag, recv->ignore);
 
-	return mrail_cq_process_buf_recv((struct fi_cq_tagged_entry *)
-					 unexp_msg_entry->data, recv);
+	/* The context of an unexpected striped message is its reassembly
+	 * state, see mrail_match_recv() */
+	if (unexp_msg_entry->context)
+		ret = mrail_cq_process_stripe_recv((struct fi_cq_tagged_entry *)
+						   unexp_msg_entry->data,
+						   unexp_msg_entry->context,
+						   recv);
+	else
+		ret = mrail_cq_process_buf_recv((struct fi_cq_tagged_entry *)
+						unexp_msg_entry->data, recv);
+	free(unexp_msg_entry);
+	return ret;
 }
 
 static ssize_t mrail_recv(struct fid_ep *ep_fid, void *buf, size_t len,
@@ -332,11 +344,223 @@ static struct mrail_tx_buf *mrail_get_tx_buf(struct mrail_ep *mrail_ep,
 
 	tx_buf->context		= context;
 	tx_buf->flags		= flags;
+	tx_buf->subreq		= NULL;
+	tx_buf->post_time	= 0;
 	tx_buf->hdr.op		= op;
+	tx_buf->hdr.stripe_cnt	= 0;
 	tx_buf->hdr.seq		= htonl(seq);
 	return tx_buf;
 }
 
+/* Sends that report a completion keep what is needed to post them again
+ * if their rail fails, and are accounted as in flight on the rail.  The
+ * others only keep their peer, to send their sequence number again. */
+static inline void
+mrail_save_tx_buf(struct mrail_ep *mrail_ep, struct mrail_tx_buf *tx_buf,
+		  uint32_t rail, const struct iovec *iov, size_t count,
+		  fi_addr_t addr, uint64_t data)
+{
+	tx_buf->rail		= rail;
+	tx_buf->addr		= addr;
+	tx_buf->data		= data;
+	tx_buf->iov_count	= 0;
+	if (!(tx_buf->flags & FI_COMPLETION))
+		return;
+
+	tx_buf->iov_count	= count;
+	memcpy(tx_buf->iov, iov, sizeof(*iov) * count);
+	tx_buf->post_time	= mrail_rail_posted(mrail_ep, rail);
+}
+
+/* Share of the rail weights that can be used to reach the peer */
+static size_t mrail_stripe_weight(struct mrail_ep *mrail_ep,
+				  struct mrail_peer_info *peer_info,
+				  size_t rail)
+{
+	return mrail_rail_usable(mrail_ep, peer_info, rail) ?
+	       mrail_ep->rails[rail].weight : 0;
+}
+
+/* Length of the chunk of a striped message sent on the given rail */
+static size_t mrail_stripe_chunk_len(struct mrail_ep *mrail_ep,
+				     struct mrail_peer_info *peer_info,
+				     size_t weight_sum, size_t len, size_t rail)
+{
+	size_t weight = mrail_stripe_weight(mrail_ep, peer_info, rail);
+
+	if (!weight_sum)
+		return 0;
+	return (len / weight_sum) * weight +
+	       (len % weight_sum) * weight / weight_sum;
+}
+
+ssize_t mrail_post_send_subreq(struct mrail_subreq *subreq)
+{
+	struct mrail_req *req = subreq->parent;
+	struct mrail_ep *mrail_ep = req->mrail_ep;
+	struct iovec iov[MRAIL_IOV_LIMIT + 1];
+	void *desc[MRAIL_IOV_LIMIT + 1];
+	const struct mrail_mr *mrail_mr;
+	uint64_t flags = req->flags | FI_COMPLETION;
+	struct fi_msg msg;
+	size_t i;
+	ssize_t ret;
+
+	mrail_copy_iov_hdr(&subreq->tx_buf->hdr, iov, subreq->iov,
+			   subreq->iov_count);
+
+	/* The header is not registered, the chunk uses the rail's MR */
+	desc[0] = NULL;
+	for (i = 0; i < subreq->iov_count; i++) {
+		mrail_mr = subreq->descs[i];
+		desc[i + 1] = (mrail_mr ?
+			       fi_mr_desc(mrail_mr->rails[subreq->rail].mr) :
+			       NULL);
+	}
+
+	msg.msg_iov	= iov;
+	msg.desc	= desc;
+	msg.iov_count	= subreq->iov_count + 1;
+	msg.addr	= req->peer_info->addr;
+	msg.context	= subreq->tx_buf;
+	msg.data	= 0;
+
+	/* Immediate data is sent with the chunk used for matching */
+	if (flags & FI_REMOTE_CQ_DATA) {
+		if (subreq->tx_buf->hdr.op == MRAIL_OP_STRIPE)
+			flags &= ~FI_REMOTE_CQ_DATA;
+		else
+			msg.data = req->data;
+	}
+
+	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting stripe chunk of length: "
+	       "%zu seq: %d on rail: %d\n", ofi_total_iov_len(subreq->iov,
+	       subreq->iov_count), ntohl(subreq->tx_buf->hdr.seq),
+	       subreq->rail);
+
+	subreq->post_time = mrail_rail_posted(mrail_ep, subreq->rail);
+	ret = fi_sendmsg(mrail_ep->rails[subreq->rail].ep, &msg, flags);
+	if (ret)
+		mrail_rail_unposted(mrail_ep, subreq->rail);
+	return ret;
+}
+
+/* Split a large message into one chunk per rail, sized by the rail weights.
+ * The chunks take consecutive sequence numbers so the receiver sees them
+ * back to back, and are posted through the deferred request queue.  The
+ * send completes once every chunk has completed. */
+static ssize_t
+mrail_send_stripe(struct mrail_ep *mrail_ep, const struct iovec *iov,
+		  void **desc, size_t count, size_t len, fi_addr_t dest_addr, uint8_t op,
+		  uint64_t tag, uint64_t data, void *context, uint64_t flags)
+{
+	struct mrail_peer_info *peer_info;
+	struct mrail_subreq *subreq;
+	struct mrail_tx_buf *tx_buf;
+	struct mrail_req *req;
+	size_t *chunk_len = alloca(sizeof(*chunk_len) * mrail_ep->num_eps);
+	size_t i, chunk, first = 0, left = len, weight_sum = 0;
+	size_t iov_index = 0, iov_offset = 0;
+	uint8_t stripe_cnt = 0;
+	int ret;
+
+	req = mrail_alloc_req(mrail_ep);
+	if (!req)
+		return -FI_ENOMEM;
+
+	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) dest_addr);
+
+	req->op_type		= FI_SEND;
+	req->err		= 0;
+	req->flags		= flags;
+	req->data		= data;
+	req->mrail_ep		= mrail_ep;
+	req->peer_info		= peer_info;
+	req->comp.op_context	= context;
+	req->comp.flags		= (op == ofi_op_msg ? FI_MSG : FI_TAGGED) |
+				  FI_SEND;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	/* Weights change when a rail fails, which happens under the lock */
+	for (i = 0; i < mrail_ep->num_eps; i++)
+		weight_sum += mrail_stripe_weight(mrail_ep, peer_info, i);
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		chunk_len[i] = mrail_stripe_chunk_len(mrail_ep, peer_info,
+						      weight_sum, len, i);
+		left -= chunk_len[i];
+		if (chunk_len[i] && !stripe_cnt++)
+			first = i;
+	}
+	if (!stripe_cnt) {
+		/* No rail left to stripe across, send it whole */
+		first = mrail_get_tx_rail(mrail_ep, peer_info);
+		stripe_cnt = 1;
+	}
+	/* The first chunk takes the rounding remainder */
+	chunk_len[first] += left;
+
+	for (i = first, chunk = 0, left = len; chunk < stripe_cnt; i++) {
+		if (!chunk_len[i])
+			continue;
+
+		/* The array is filled in reverse order, as for RMA: the
+		 * first chunk is posted first, from the last position */
+		subreq = &req->subreqs[stripe_cnt - 1 - chunk];
+		subreq->parent = req;
+		subreq->rail = i;
+
+		tx_buf = mrail_get_tx_buf(mrail_ep, NULL,
+					  peer_info->seq_no + chunk,
+					  chunk ? MRAIL_OP_STRIPE : op, 0);
+		if (OFI_UNLIKELY(!tx_buf)) {
+			ret = -FI_ENOMEM;
+			goto err;
+		}
+		tx_buf->subreq		= subreq;
+		tx_buf->hdr.stripe_cnt	= stripe_cnt;
+		tx_buf->hdr.tag		= chunk ? len - left : tag;
+		subreq->tx_buf		= tx_buf;
+
+		if (!desc)
+			memset(subreq->descs, 0, sizeof(subreq->descs));
+		ret = ofi_copy_iov_desc(subreq->iov, subreq->descs,
+					&subreq->iov_count, (struct iovec *)iov,
+					desc, count, &iov_index, &iov_offset,
+					chunk_len[i]);
+		chunk++;
+		if (ret)
+			goto err;
+		left -= chunk_len[i];
+	}
+	assert(!left);
+	peer_info->seq_no += stripe_cnt;
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+
+	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Striping send of length: %zu "
+	       "dest_addr: 0x%" PRIx64 " across %d rails\n", len, dest_addr,
+	       stripe_cnt);
+
+	ofi_atomic_initialize32(&req->expected_subcomps, stripe_cnt);
+	req->pending_subreq = stripe_cnt - 1;
+
+	mrail_post_deferred_req(mrail_ep, req);
+	return 0;
+err:
+	while (chunk--)
+		util_buf_release(mrail_ep->tx_buf_pool,
+				 req->subreqs[stripe_cnt - 1 - chunk].tx_buf);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+	mrail_free_req(mrail_ep, req);
+	return ret;
+}
+
+static inline int mrail_use_stripe(struct mrail_ep *mrail_ep, size_t len,
+				   uint64_t flags)
+{
+	return mrail_env.stripe_size && len >= mrail_env.stripe_size &&
+	       mrail_ep->stripe_rails > 1 && !(flags & FI_INJECT);
+}
+
 static ssize_t
 mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 		  size_t count, size_t len, fi_addr_t dest_addr, uint64_t data,
@@ -347,11 +571,17 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	struct mrail_peer_info *peer_info;
 	struct iovec *iov_dest = alloca(sizeof(*iov_dest) * (count + 1));
 	struct mrail_tx_buf *tx_buf;
-	uint32_t i = mrail_get_tx_rail(mrail_ep);
 	struct fi_msg msg;
+	uint32_t i;
 	ssize_t ret;
 
+	if (mrail_use_stripe(mrail_ep, len, flags))
+		return mrail_send_stripe(mrail_ep, iov, desc, count, len,
+					 dest_addr, ofi_op_msg, 0, data,
+					 context, flags);
+
 	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) dest_addr);
+	i = mrail_get_tx_rail(mrail_ep, peer_info);
 
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
 
@@ -373,6 +603,8 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	if (len < mrail_ep->rails[i].info->tx_attr->inject_size)
 		flags |= FI_INJECT;
 
+	mrail_save_tx_buf(mrail_ep, tx_buf, i, iov, count, dest_addr, data);
+
 	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting send of length: %" PRIu64
 	       " dest_addr: 0x%" PRIx64 "  seq: %d on rail: %d\n",
 	       len, dest_addr, peer_info->seq_no - 1, i);
@@ -381,6 +613,8 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	if (ret) {
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", i);
+		if (tx_buf->post_time)
+			mrail_rail_unposted(mrail_ep, i);
 		goto err2;
 	} else if (!(flags & FI_COMPLETION)) {
 		ofi_ep_tx_cntr_inc(&mrail_ep->util_ep);
@@ -405,11 +639,17 @@ mrail_tsend_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	struct mrail_peer_info *peer_info;
 	struct iovec *iov_dest = alloca(sizeof(*iov_dest) * (count + 1));
 	struct mrail_tx_buf *tx_buf;
-	uint32_t i = mrail_get_tx_rail(mrail_ep);
 	struct fi_msg msg;
+	uint32_t i;
 	ssize_t ret;
 
+	if (mrail_use_stripe(mrail_ep, len, flags))
+		return mrail_send_stripe(mrail_ep, iov, desc, count, len,
+					 dest_addr, ofi_op_tagged, tag, data,
+					 context, flags);
+
 	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) dest_addr);
+	i = mrail_get_tx_rail(mrail_ep, peer_info);
 
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
 
@@ -432,6 +672,8 @@ mrail_tsend_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	if (len < mrail_ep->rails[i].info->tx_attr->inject_size)
 		flags |= FI_INJECT;
 
+	mrail_save_tx_buf(mrail_ep, tx_buf, i, iov, count, dest_addr, data);
+
 	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting tsend of length: %" PRIu64
 	       " dest_addr: 0x%" PRIx64 " tag: 0x%" PRIx64 " seq: %d"
 	       " on rail: %d\n", len, dest_addr, tag, peer_info->seq_no - 1, i);
@@ -440,6 +682,8 @@ mrail_tsend_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	if (ret) {
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", i);
+		if (tx_buf->post_time)
+			mrail_rail_unposted(mrail_ep, i);
 		goto err2;
 	} else if (!(flags & FI_COMPLETION)) {
 		ofi_ep_tx_cntr_inc(&mrail_ep->util_ep);
@@ -614,6 +858,9 @@ static void mrail_ep_free_bufs(struct mrail_ep *mrail_ep)
 	if (mrail_ep->tx_buf_pool)
 		util_buf_pool_destroy(mrail_ep->tx_buf_pool);
 
+	if (mrail_ep->stripe_pool)
+		util_buf_pool_destroy(mrail_ep->stripe_pool);
+
 	if (mrail_ep->recv_fs)
 		mrail_recv_fs_free(mrail_ep->recv_fs);
 }
@@ -652,6 +899,12 @@ static int mrail_ep_alloc_bufs(struct mrail_ep *mrail_ep)
 	if (!mrail_ep->tx_buf_pool)
 		goto err;
 
+	ret = util_buf_pool_create(&mrail_ep->stripe_pool,
+				   sizeof(struct mrail_stripe),
+				   sizeof(void *), 0, 16);
+	if (ret)
+		goto err;
+
 	buf_size = (sizeof(struct mrail_req) +
 		    (mrail_ep->num_eps * sizeof(struct mrail_subreq)));
 
@@ -665,6 +918,25 @@ err:
 	return ret;
 }
 
+static void mrail_ep_log_rail_stats(struct mrail_ep *mrail_ep)
+{
+	struct mrail_rail_stats *stats;
+	size_t i;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		stats = &mrail_ep->rails[i].stats;
+		FI_INFO(&mrail_prov, FI_LOG_EP_CTRL, "rail %zu%s: posted %"
+			PRId64 " completed %" PRId64 " errors %" PRId64
+			" retried %" PRId64 " avg latency %" PRIu64 " usec\n",
+			i, mrail_ep->rails[i].failed ? " (failed)" : "",
+			ofi_atomic_get64(&stats->posted),
+			ofi_atomic_get64(&stats->completed),
+			ofi_atomic_get64(&stats->errors),
+			ofi_atomic_get64(&stats->retried),
+			stats->lat_avg >> MRAIL_LAT_SHIFT);
+	}
+}
+
 static int mrail_ep_close(fid_t fid)
 {
 	struct mrail_ep *mrail_ep =
@@ -674,6 +946,9 @@ static int mrail_ep_close(fid_t fid)
 
 	mrail_ep_free_bufs(mrail_ep);
 
+	if (mrail_ep->rails)
+		mrail_ep_log_rail_stats(mrail_ep);
+
 	for (i = 0; i < mrail_ep->num_eps; i++) {
 		ret = fi_close(&mrail_ep->rails[i].ep->fid);
 		if (ret)
@@ -854,10 +1129,311 @@ struct fi_ops_tagged mrail_ops_tagged = {
 	.injectdata = mrail_tinjectdata,
 };
 
+/* Recompute the striping shares over the rails that are still usable */
+static void mrail_ep_update_weights(struct mrail_ep *mrail_ep)
+{
+	size_t i;
+
+	mrail_ep->weight_sum = 0;
+	mrail_ep->stripe_rails = 0;
+	mrail_ep->active_rails = 0;
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (mrail_ep->rails[i].failed)
+			continue;
+		mrail_ep->active_rails++;
+		mrail_ep->weight_sum += mrail_ep->rails[i].weight;
+		if (mrail_ep->rails[i].weight)
+			mrail_ep->stripe_rails++;
+	}
+
+	/* hdr.stripe_cnt is a single byte */
+	if (mrail_ep->stripe_rails > UINT8_MAX) {
+		FI_WARN(&mrail_prov, FI_LOG_EP_CTRL, "Too many rails to stripe "
+			"messages across, striping disabled\n");
+		mrail_ep->stripe_rails = 0;
+	}
+}
+
+/* Weights are scaled down to at most MRAIL_MAX_WEIGHT, keeping their ratio,
+ * so that splitting a message by them can't overflow.  Link speeds are in
+ * bits per second. */
+#define MRAIL_MAX_WEIGHT 1024
+
+static void mrail_ep_scale_weights(struct mrail_ep *mrail_ep)
+{
+	size_t i, max_weight = 0, div;
+
+	for (i = 0; i < mrail_ep->num_eps; i++)
+		max_weight = MAX(max_weight, mrail_ep->rails[i].weight);
+	if (max_weight <= MRAIL_MAX_WEIGHT)
+		return;
+
+	div = (max_weight + MRAIL_MAX_WEIGHT - 1) / MRAIL_MAX_WEIGHT;
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (mrail_ep->rails[i].weight)
+			mrail_ep->rails[i].weight =
+				MAX(mrail_ep->rails[i].weight / div, 1);
+	}
+}
+
+/* Rail weights come from FI_OFI_MRAIL_STRIPE_WEIGHTS if set, otherwise from
+ * the link speed the rails report.  Without either, all rails are equal. */
+static void mrail_ep_init_weights(struct mrail_ep *mrail_ep)
+{
+	struct fi_info *info;
+	size_t i, speed_cnt = 0;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		info = mrail_ep->rails[i].info;
+		if (info->nic && info->nic->link_attr &&
+		    info->nic->link_attr->speed)
+			speed_cnt++;
+	}
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (mrail_env.num_stripe_weights)
+			mrail_ep->rails[i].weight =
+				i < mrail_env.num_stripe_weights ?
+				mrail_env.stripe_weights[i] : 0;
+		else if (speed_cnt == mrail_ep->num_eps)
+			mrail_ep->rails[i].weight =
+				mrail_ep->rails[i].info->nic->link_attr->speed;
+		else
+			mrail_ep->rails[i].weight = 1;
+	}
+
+	mrail_ep_scale_weights(mrail_ep);
+	mrail_ep_update_weights(mrail_ep);
+}
+
+/* Pick a rail for the next operation.  Rails are visited round-robin, but
+ * a rail with fewer operations in flight or a lower completion latency is
+ * preferred, so a busy or degraded link gets less traffic.  Rails that
+ * failed, for all peers or for this one, are skipped.  Equally loaded rails
+ * keep the round-robin order. */
+size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep,
+			 struct mrail_peer_info *peer_info)
+{
+	struct mrail_rail_stats *stats;
+	size_t i, rail, start, best;
+	uint64_t load, best_load = UINT64_MAX;
+
+	start = (ofi_atomic_inc32(&mrail_ep->tx_rail) - 1) % mrail_ep->num_eps;
+	best = start;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		rail = (start + i) % mrail_ep->num_eps;
+		if (!mrail_rail_usable(mrail_ep, peer_info, rail))
+			continue;
+
+		stats = &mrail_ep->rails[rail].stats;
+		load = ((uint64_t) ofi_atomic_get32(&stats->inflight) + 1) *
+		       ((stats->lat_avg >> MRAIL_LAT_SHIFT) + 1);
+		if (load < best_load) {
+			best_load = load;
+			best = rail;
+		}
+	}
+	return best;
+}
+
+/* Stop using a rail for new operations after it reported an error */
+void mrail_rail_fail(struct mrail_ep *mrail_ep, size_t rail, int err)
+{
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	if (!mrail_ep->rails[rail].failed) {
+		mrail_ep->rails[rail].failed = 1;
+		mrail_ep_update_weights(mrail_ep);
+		FI_WARN(&mrail_prov, FI_LOG_EP_DATA, "Removing rail %zu after "
+			"error: %s, %zu rail(s) left\n", rail, fi_strerror(err),
+			mrail_ep->active_rails);
+	}
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+size_t mrail_peer_active_rails(struct mrail_ep *mrail_ep,
+			       struct mrail_peer_info *peer_info)
+{
+	size_t i, cnt = 0;
+
+	for (i = 0; i < mrail_ep->num_eps; i++)
+		cnt += mrail_rail_usable(mrail_ep, peer_info, i);
+	return cnt;
+}
+
+/* Stop using a rail to reach a peer after a send to it failed there.  The
+ * rail may still work for the other peers. */
+void mrail_peer_rail_fail(struct mrail_ep *mrail_ep,
+			  struct mrail_peer_info *peer_info, size_t rail,
+			  int err)
+{
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	if (!peer_info->rail_failed[rail]) {
+		peer_info->rail_failed[rail] = 1;
+		FI_WARN(&mrail_prov, FI_LOG_EP_DATA, "Removing rail %zu for "
+			"peer %" PRIu64 " after error: %s, %zu rail(s) left\n",
+			rail, peer_info->addr, fi_strerror(err),
+			mrail_peer_active_rails(mrail_ep, peer_info));
+	}
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+void mrail_queue_retry_tx_buf(struct mrail_tx_buf *tx_buf)
+{
+	struct mrail_ep *mrail_ep = tx_buf->ep;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	slist_insert_tail(&tx_buf->retry_entry, &mrail_ep->retry_tx_bufs);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+void mrail_queue_retry_subreq(struct mrail_subreq *subreq)
+{
+	struct mrail_ep *mrail_ep = subreq->parent->mrail_ep;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	slist_insert_tail(&subreq->retry_entry, &mrail_ep->retry_subreqs);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+static ssize_t mrail_retry_tx_buf(struct mrail_ep *mrail_ep,
+				  struct mrail_tx_buf *tx_buf)
+{
+	struct mrail_peer_info *peer_info;
+	struct iovec iov[MRAIL_IOV_LIMIT + 1];
+	struct fi_msg msg;
+	uint32_t rail;
+	ssize_t ret;
+
+	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) tx_buf->addr);
+	if (!mrail_peer_active_rails(mrail_ep, peer_info))
+		return -FI_EIO;
+
+	rail = mrail_get_tx_rail(mrail_ep, peer_info);
+	mrail_copy_iov_hdr(&tx_buf->hdr, iov, tx_buf->iov, tx_buf->iov_count);
+
+	msg.msg_iov	= iov;
+	msg.desc	= NULL;
+	msg.iov_count	= tx_buf->iov_count + 1;
+	msg.addr	= tx_buf->addr;
+	msg.context	= tx_buf;
+	msg.data	= tx_buf->data;
+
+	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Retrying send seq: %d on rail: "
+	       "%d\n", ntohl(tx_buf->hdr.seq), rail);
+
+	tx_buf->rail = rail;
+	tx_buf->post_time = mrail_rail_posted(mrail_ep, rail);
+	ret = fi_sendmsg(mrail_ep->rails[rail].ep, &msg,
+			 (tx_buf->flags & ~(FI_MSG | FI_TAGGED)) |
+			 FI_COMPLETION);
+	if (ret)
+		mrail_rail_unposted(mrail_ep, rail);
+	else
+		ofi_atomic_inc64(&mrail_ep->rails[rail].stats.retried);
+	return ret;
+}
+
+static ssize_t mrail_retry_subreq(struct mrail_ep *mrail_ep,
+				  struct mrail_subreq *subreq)
+{
+	struct mrail_peer_info *peer_info = subreq->parent->peer_info;
+	uint32_t rail;
+	ssize_t ret;
+
+	if (!mrail_peer_active_rails(mrail_ep, peer_info))
+		return -FI_EIO;
+
+	rail = mrail_get_tx_rail(mrail_ep, peer_info);
+	if (subreq->parent->op_type == FI_SEND) {
+		subreq->rail = rail;
+		ret = mrail_post_send_subreq(subreq);
+	} else {
+		ret = mrail_post_subreq(rail, subreq);
+	}
+	if (!ret)
+		ofi_atomic_inc64(&mrail_ep->rails[rail].stats.retried);
+	return ret;
+}
+
+static struct slist_entry *
+mrail_pop_retry(struct mrail_ep *mrail_ep, struct slist *list)
+{
+	struct slist_entry *entry;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	entry = slist_empty(list) ? NULL : slist_remove_head(list);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+	return entry;
+}
+
+static void mrail_push_retry(struct mrail_ep *mrail_ep, struct slist *list,
+			     struct slist_entry *entry)
+{
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	slist_insert_head(entry, list);
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+}
+
+/* Post the operations of failed rails again on the remaining ones.  They
+ * keep their sequence numbers, the receiver puts them back in order. */
+void mrail_progress_retries(struct mrail_ep *mrail_ep)
+{
+	struct mrail_tx_buf *tx_buf;
+	struct mrail_subreq *subreq;
+	struct slist_entry *entry;
+	ssize_t ret;
+
+	while ((entry = mrail_pop_retry(mrail_ep, &mrail_ep->retry_tx_bufs))) {
+		tx_buf = container_of(entry, struct mrail_tx_buf, retry_entry);
+		ret = mrail_retry_tx_buf(mrail_ep, tx_buf);
+		if (ret == -FI_EAGAIN) {
+			mrail_push_retry(mrail_ep, &mrail_ep->retry_tx_bufs,
+					 entry);
+			break;
+		}
+		if (ret)
+			mrail_tx_buf_fail(tx_buf, (int) -ret);
+	}
+
+	while ((entry = mrail_pop_retry(mrail_ep, &mrail_ep->retry_subreqs))) {
+		subreq = container_of(entry, struct mrail_subreq, retry_entry);
+		ret = mrail_retry_subreq(mrail_ep, subreq);
+		if (ret == -FI_EAGAIN) {
+			mrail_push_retry(mrail_ep, &mrail_ep->retry_subreqs,
+					 entry);
+			break;
+		}
+		if (ret)
+			mrail_subreq_fail(subreq, (int) -ret);
+	}
+}
+
+/* Pick up rail errors a CQ could not attribute to an operation */
+static void mrail_ep_check_rail_errs(struct mrail_ep *mrail_ep,
+				     struct util_cq *util_cq)
+{
+	struct mrail_cq *mrail_cq;
+	size_t i;
+
+	if (!util_cq)
+		return;
+
+	mrail_cq = container_of(util_cq, struct mrail_cq, util_cq);
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (mrail_cq->rail_errs[i] && !mrail_ep->rails[i].failed)
+			mrail_rail_fail(mrail_ep, i, mrail_cq->rail_errs[i]);
+	}
+}
+
 void mrail_ep_progress(struct util_ep *ep)
 {
 	struct mrail_ep *mrail_ep;
 	mrail_ep = container_of(ep, struct mrail_ep, util_ep);
+	mrail_ep_check_rail_errs(mrail_ep, ep->tx_cq);
+	if (ep->rx_cq != ep->tx_cq)
+		mrail_ep_check_rail_errs(mrail_ep, ep->rx_cq);
+	mrail_progress_retries(mrail_ep);
 	mrail_progress_deferred_reqs(mrail_ep);
 }
 
@@ -903,6 +1479,12 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 	}
 
 	for (i = 0, fi = mrail_ep->info->next; fi; fi = fi->next, i++) {
+		ofi_atomic_initialize32(&mrail_ep->rails[i].stats.inflight, 0);
+		ofi_atomic_initialize64(&mrail_ep->rails[i].stats.posted, 0);
+		ofi_atomic_initialize64(&mrail_ep->rails[i].stats.completed, 0);
+		ofi_atomic_initialize64(&mrail_ep->rails[i].stats.errors, 0);
+		ofi_atomic_initialize64(&mrail_ep->rails[i].stats.retried, 0);
+
 		fi->tx_attr->op_flags &= ~FI_COMPLETION;
 		ret = fi_endpoint(mrail_domain->domains[i], fi,
 				  &mrail_ep->rails[i].ep, mrail_ep);
@@ -918,7 +1500,11 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 	if (ret)
 		goto err;
 
+	mrail_ep_init_weights(mrail_ep);
+
 	slist_init(&mrail_ep->deferred_reqs);
+	slist_init(&mrail_ep->retry_tx_bufs);
+	slist_init(&mrail_ep->retry_subreqs);
 
 	if (mrail_ep->info->caps & FI_DIRECTED_RECV) {
 		mrail_recv_queue_init(&mrail_prov, &mrail_ep->recv_queue,
@@ -35,6 +35,10 @@
 #include "mrail.h"
 
 static char **mrail_addr_strv = NULL;
+
+struct mrail_env mrail_env = {
+	.stripe_size = 128 * 1024,
+};
 /* Not thread safe */
 struct fi_info *mrail_info_vec[MRAIL_MAX_INFO] = {0};
 size_t mrail_num_info = 0;
@@ -50,11 +54,47 @@ static inline char **mrail_split_addr_strc(const char *addr_strc)
 	return addr_strv;
 }
 
+static void mrail_parse_stripe_weights(const char *weights_strc)
+{
+	char **weights_strv;
+	size_t i, cnt;
+
+	weights_strv = ofi_split_and_alloc(weights_strc, ",", &cnt);
+	if (!weights_strv) {
+		FI_WARN(&mrail_prov, FI_LOG_CORE,
+			"Unable to split stripe_weights string\n");
+		return;
+	}
+
+	mrail_env.stripe_weights = calloc(cnt, sizeof(*mrail_env.stripe_weights));
+	if (mrail_env.stripe_weights) {
+		for (i = 0; i < cnt; i++)
+			mrail_env.stripe_weights[i] =
+				strtoul(weights_strv[i], NULL, 0);
+		mrail_env.num_stripe_weights = cnt;
+	}
+	ofi_free_string_array(weights_strv);
+}
+
 static int mrail_parse_env_vars(void)
 {
-	char *addr_strc;
+	char *addr_strc, *weights_strc = NULL;
 	int ret;
 
+	fi_param_define(&mrail_prov, "stripe_size", FI_PARAM_SIZE_T, "Messages "
+			"of at least this size are split across all rails "
+			"(0 disables striping, default: 131072)");
+	fi_param_get_size_t(&mrail_prov, "stripe_size", &mrail_env.stripe_size);
+
+	fi_param_define(&mrail_prov, "stripe_weights", FI_PARAM_STRING, "Comma "
+			"delimited relative bandwidth of each rail, in the "
+			"order of addr_strc.  Striped messages are split in "
+			"proportion to these (default: link speed reported by "
+			"the rails, or an equal split)");
+	fi_param_get_str(&mrail_prov, "stripe_weights", &weights_strc);
+	if (weights_strc)
+		mrail_parse_stripe_weights(weights_strc);
+
 	fi_param_define(&mrail_prov, "addr_strc", FI_PARAM_STRING, "List of rail"
 			" addresses of format FI_ADDR_STR delimited by comma");
 	ret = fi_param_get_str(&mrail_prov, "addr_strc", &addr_strc);
@@ -338,6 +378,7 @@ static void mrail_fini(void)
 	size_t i;
 	for (i = 0; i < mrail_num_info; i++)
 		fi_freeinfo(mrail_info_vec[i]);
+	free(mrail_env.stripe_weights);
 }
 
 struct fi_provider mrail_prov = {
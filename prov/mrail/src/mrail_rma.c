@@ -60,8 +60,7 @@ static void mrail_subreq_to_rail(struct mrail_subreq *subreq, uint32_t rail,
 	}
 }
 
-static ssize_t mrail_post_subreq(uint32_t rail,
-		struct mrail_subreq *subreq)
+ssize_t mrail_post_subreq(uint32_t rail, struct mrail_subreq *subreq)
 {
 	ssize_t ret;
 	struct iovec rail_iov[MRAIL_IOV_LIMIT];
@@ -75,6 +74,7 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 	uint64_t flags = req->flags;
 
 	mrail_subreq_to_rail(subreq, rail, rail_iov, rail_descs, rail_rma_iov);
+	subreq->rail = rail;
 
 	msg.msg_iov		= rail_iov;
 	msg.desc		= rail_descs;
@@ -84,6 +84,7 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 	msg.rma_iov_count	= subreq->rma_iov_count;
 	msg.context		= &subreq->context;
 
+	subreq->post_time = mrail_rail_posted(mrail_ep, rail);
 	if (req->op_type == FI_READ) {
 		ret = fi_readmsg(mrail_ep->rails[rail].ep, &msg, flags);
 	} else {
@@ -98,27 +99,45 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 		ret = fi_writemsg(mrail_ep->rails[rail].ep, &msg, flags);
 	}
 
+	if (ret)
+		mrail_rail_unposted(mrail_ep, rail);
 	return ret;
 }
 
 static ssize_t mrail_post_req(struct mrail_req *req)
 {
+	struct mrail_subreq *subreq;
 	size_t i;
 	uint32_t rail;
 	ssize_t ret = 0;
 
 	while (req->pending_subreq >= 0) {
-		/* Try all rails before giving up */
-		for (i = 0; i < req->mrail_ep->num_eps; ++i) {
-			rail = mrail_get_tx_rail(req->mrail_ep);
+		if (req->op_type == FI_SEND) {
+			/* Stripe chunks are sized for the rail they go out on,
+			 * unless that rail failed since */
+			subreq = &req->subreqs[req->pending_subreq];
+			if (!mrail_rail_usable(req->mrail_ep, req->peer_info,
+					       subreq->rail))
+				subreq->rail = mrail_get_tx_rail(req->mrail_ep,
+								 req->peer_info);
+			ret = mrail_post_send_subreq(subreq);
+			if (ret == -FI_EAGAIN)
+				mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+		} else {
+			/* Try all rails before giving up */
+			for (i = 0; i < req->mrail_ep->num_eps; ++i) {
+				rail = mrail_get_tx_rail(req->mrail_ep,
+							 req->peer_info);
 
-			ret = mrail_post_subreq(rail,
+				ret = mrail_post_subreq(rail,
 					&req->subreqs[req->pending_subreq]);
-			if (ret != -FI_EAGAIN) {
-				break;
-			} else {
-				/* One of the rails is busy. Try progressing. */
-				mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+				if (ret != -FI_EAGAIN) {
+					break;
+				} else {
+					/* One of the rails is busy. Try
+					 * progressing. */
+					mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+				}
 			}
 		}
 
@@ -180,6 +199,16 @@ void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep)
 	}
 }
 
+void mrail_post_deferred_req(struct mrail_ep *mrail_ep, struct mrail_req *req)
+{
+	mrail_queue_deferred_req(mrail_ep, req);
+
+	/* Initiate progress here. See mrail_ep_progress() for any remaining
+	 * reqs.
+	 */
+	mrail_progress_deferred_reqs(mrail_ep);
+}
+
 static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		const struct fi_msg_rma *msg, struct mrail_req *req)
 {
@@ -262,6 +291,7 @@ static ssize_t mrail_init_rma_req(struct mrail_ep *mrail_ep,
 	ssize_t ret;
 
 	req->op_type		= op_type;
+	req->err		= 0;
 	req->flags		= flags;
 	req->data		= msg->data;
 	req->mrail_ep		= mrail_ep;
@@ -299,12 +329,7 @@ static ssize_t mrail_ep_post_rma(struct fid_ep *ep_fid,
 		return ret;
 	}
 
-	mrail_queue_deferred_req(mrail_ep, req);
-
-	/* Initiate progress here. See mrail_ep_progress() for any remaining
-	 * reqs.
-	 */
-	mrail_progress_deferred_reqs(mrail_ep);
+	mrail_post_deferred_req(mrail_ep, req);
 
 	return 0;
 }
@@ -393,7 +418,9 @@ static ssize_t mrail_ep_inject_write(struct fid_ep *ep_fid, const void *buf,
 	mrail_ep = container_of(ep_fid, struct mrail_ep, util_ep.ep_fid.fid);
 	mr_map = (struct mrail_addr_key *) key;
 
-	rail = mrail_get_tx_rail(mrail_ep);
+	rail = mrail_get_tx_rail(mrail_ep,
+				 ofi_av_get_addr(mrail_ep->util_ep.av,
+						 (int) dest_addr));
 	ret = fi_inject_write(mrail_ep->rails[rail].ep, buf, len,
 			      dest_addr, addr, mr_map[rail].key);
 	if (ret) {
@@ -216,6 +216,7 @@ static void rxd_complete_rx(struct rxd_ep *ep, struct rxd_x_entry *rx_entry)
 
 	if (rx_entry->bytes_done == rx_entry->cq_entry.len) {
 		rxd_cntr_report_rx_comp(ep, rx_entry);
+		ofi_ep_stats_rx(&ep->util_ep, rx_entry->bytes_done);
 		if (write_cq)
 			rx_cq->write_fn(rx_cq, &rx_entry->cq_entry);
 	} else if (write_cq) {
@@ -243,6 +244,7 @@ static void rxd_complete_tx(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 
 out:
 	rxd_cntr_report_tx_comp(ep, tx_entry);
+	ofi_ep_stats_tx(&ep->util_ep, tx_entry->cq_entry.len);
 	rxd_tx_entry_free(ep, tx_entry);
 }
 
@@ -493,6 +495,7 @@ static void rxd_check_post_unexp(struct rxd_ep *ep, struct dlist_entry *list,
 
 insert:
 	dlist_insert_tail(&pkt_entry->d_entry, list);
+	ofi_ep_stats_unexp(&ep->util_ep);
 }
 
 static void rxd_handle_rts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
@@ -918,6 +921,10 @@ void rxd_progress_op(struct rxd_ep *ep, struct rxd_x_entry *rx_entry,
 		rx_entry->cq_entry.data = data_hdr->cq_data;
 	}
 
+	/* report the sender's tag, not the posted one, as ignore bits may differ */
+	if (tag_hdr)
+		rx_entry->cq_entry.tag = tag_hdr->tag;
+
 	rx_entry->peer = base_hdr->peer;
 
 	if (!sar_hdr || sar_hdr->num_segs == 1) {
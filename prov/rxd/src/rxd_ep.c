@@ -180,6 +180,14 @@ static int rxd_ep_getopt(fid_t fid, int level, int optname,
 {
 	struct rxd_ep *rxd_ep =
 		container_of(fid, struct rxd_ep, util_ep.ep_fid);
+	int ret;
+
+	if ((level == FI_OPT_ENDPOINT) && (optname == FI_OPT_EP_STATS)) {
+		fastlock_acquire(&rxd_ep->util_ep.lock);
+		ret = ofi_ep_getopt_stats(&rxd_ep->util_ep, optval, optlen);
+		fastlock_release(&rxd_ep->util_ep.lock);
+		return ret;
+	}
 
 	if ((level != FI_OPT_ENDPOINT) || (optname != FI_OPT_MIN_MULTI_RECV))
 		return -FI_ENOPROTOOPT;
@@ -1072,6 +1080,7 @@ static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 		    current < rxd_get_retry_time(pkt_entry->timestamp, peer->retry_cnt))
 			continue;
 		retry = 1;
+		ofi_ep_stats_retry(&ep->util_ep);
 		ret = rxd_ep_send_pkt(ep, pkt_entry);
 		if (ret)
 			break;
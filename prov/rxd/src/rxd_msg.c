@@ -151,6 +151,8 @@ ssize_t rxd_ep_generic_recvmsg(struct rxd_ep *rxd_ep, const struct iovec *iov,
 
 	dlist_insert_tail(&rx_entry->entry, rx_list);
 out:
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxd_ep->util_ep);
 	fastlock_release(&rxd_ep->util_ep.rx_cq->cq_lock);
 	fastlock_release(&rxd_ep->util_ep.lock);
 	return ret;
@@ -227,6 +229,8 @@ ssize_t rxd_ep_generic_inject(struct rxd_ep *rxd_ep, const struct iovec *iov,
 		rxd_tx_entry_free(rxd_ep, tx_entry);
 
 out:
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxd_ep->util_ep);
 	fastlock_release(&rxd_ep->util_ep.tx_cq->cq_lock);
 	fastlock_release(&rxd_ep->util_ep.lock);
 	return ret;
@@ -268,6 +272,8 @@ ssize_t rxd_ep_generic_sendmsg(struct rxd_ep *rxd_ep, const struct iovec *iov,
 		rxd_tx_entry_free(rxd_ep, tx_entry);
 
 out:
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxd_ep->util_ep);
 	fastlock_release(&rxd_ep->util_ep.tx_cq->cq_lock);
 	fastlock_release(&rxd_ep->util_ep.lock);
 	return ret;
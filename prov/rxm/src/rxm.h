@@ -152,6 +152,9 @@ extern struct fi_ops_atomic rxm_ops_atomic;
 extern size_t rxm_msg_tx_size;
 extern size_t rxm_msg_rx_size;
 extern size_t rxm_def_univ_size;
+extern int rxm_mr_cache_enable;
+extern size_t rxm_mr_max_cached_cnt;
+extern size_t rxm_mr_max_cached_size;
 
 /*
  * Connection Map
@@ -264,11 +267,28 @@ struct rxm_fabric {
 	struct fid_fabric *msg_fabric;
 };
 
+/* Internal registrations are cached separately for each access an internal
+ * transfer requests, so that buffers are only registered with that access. */
+enum rxm_mr_cache_type {
+	RXM_MR_CACHE_REMOTE_READ,	/* rendezvous send buffers */
+	RXM_MR_CACHE_READ,		/* rendezvous receive and RMA read buffers */
+	RXM_MR_CACHE_WRITE,		/* RMA write buffers */
+	RXM_MR_CACHE_MAX,
+};
+
+struct rxm_mr_cache {
+	struct ofi_mr_cache cache;
+	struct rxm_domain *domain;
+	uint64_t access;
+};
+
 struct rxm_domain {
 	struct util_domain util_domain;
 	struct fid_domain *msg_domain;
 	size_t max_atomic_size;
+	struct rxm_mr_cache mr_cache[RXM_MR_CACHE_MAX];
 	uint8_t mr_local;
+	uint8_t mr_cache_enabled;
 };
 
 int rxm_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
@@ -280,6 +300,20 @@ struct rxm_mr {
 	struct rxm_domain *domain;
 };
 
+/* MSG provider registration of an internal buffer stored in the MR cache.
+ * mr_fid carries the desc and key of msg_mr, and closing it releases the
+ * cache entry. */
+struct rxm_mr_cache_desc {
+	struct fid_mr mr_fid;
+	struct fid_mr *msg_mr;
+	struct ofi_mr_entry *entry;
+	struct ofi_mr_cache *cache;
+};
+
+int rxm_msg_mr_reg_internal(struct rxm_domain *rxm_domain, const void *buf,
+			    size_t len, uint64_t acs, uint64_t flags,
+			    struct fid_mr **mr);
+
 struct rxm_ep_wire_proto {
 	uint8_t	ctrl_version;
 	uint8_t	op_version;
@@ -774,6 +808,7 @@ rxm_ep_alloc_deferred_tx_entry(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 static inline void
 rxm_ep_enqueue_deferred_tx_queue(struct rxm_deferred_tx_entry *tx_entry)
 {
+	ofi_ep_stats_retry(&tx_entry->rxm_ep->util_ep);
 	if (dlist_empty(&tx_entry->rxm_conn->deferred_tx_queue))
 		dlist_insert_tail(&tx_entry->rxm_conn->deferred_conn_entry,
 				  &tx_entry->rxm_ep->deferred_tx_conn_queue);
@@ -816,8 +851,8 @@ rxm_ep_msg_mr_regv(struct rxm_ep *rxm_ep, const struct iovec *iov, size_t count,
 		container_of(rxm_ep->util_ep.domain, struct rxm_domain, util_domain);
  
 	for (i = 0; i < count; i++) {
-		ret = fi_mr_reg(rxm_domain->msg_domain, iov[i].iov_base,
-				iov[i].iov_len, access, 0, 0, 0, &mr[i], NULL);
+		ret = rxm_msg_mr_reg_internal(rxm_domain, iov[i].iov_base,
+					      iov[i].iov_len, access, 0, &mr[i]);
 		if (ret)
 			goto err;
 	}
@@ -838,8 +873,8 @@ rxm_ep_msg_mr_regv_lim(struct rxm_ep *rxm_ep, const struct iovec *iov, size_t co
  
 	for (i = 0; i < count && total_reg_len; i++) {
 		size_t len = MIN(iov[i].iov_len, total_reg_len);
-		ret = fi_mr_reg(rxm_domain->msg_domain, iov[i].iov_base,
-				len, access, 0, 0, 0, &mr[i], NULL);
+		ret = rxm_msg_mr_reg_internal(rxm_domain, iov[i].iov_base,
+					      len, access, 0, &mr[i]);
 		if (ret)
 			goto err;
 		total_reg_len -= len;
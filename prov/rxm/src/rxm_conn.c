@@ -200,6 +200,31 @@ rxm_conn_inject_pkt_alloc(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 
 	return inject_pkt;
 }
+
+/* Releases received buffers still waiting to be reposted to a MSG EP that
+ * is about to be closed */
+static void rxm_conn_drop_repost(struct rxm_cmap_handle *handle,
+				 struct fid_ep *msg_ep)
+{
+	struct rxm_ep *rxm_ep =
+		container_of(handle->cmap->ep, struct rxm_ep, util_ep);
+	struct rxm_rx_buf *rx_buf;
+	struct dlist_entry *tmp;
+
+	if (rxm_ep->srx_ctx)
+		return;
+
+	dlist_foreach_container_safe(&rxm_ep->repost_ready_list,
+				     struct rxm_rx_buf, rx_buf,
+				     repost_entry, tmp) {
+		if (rx_buf->msg_ep != msg_ep)
+			continue;
+		dlist_remove(&rx_buf->repost_entry);
+		rxm_buf_release(&rxm_ep->buf_pools[RXM_BUF_POOL_RX],
+				&rx_buf->hdr);
+	}
+}
+
 static void rxm_conn_res_free(struct rxm_conn *rxm_conn)
 {
 	ofi_freealign(rxm_conn->inject_pkt);
@@ -248,6 +273,7 @@ static void rxm_conn_free(struct rxm_cmap_handle *handle)
 
 	/* This handles case when saved_msg_ep wasn't closed */
 	if (rxm_conn->saved_msg_ep) {
+		rxm_conn_drop_repost(handle, rxm_conn->saved_msg_ep);
 		if (fi_close(&rxm_conn->saved_msg_ep->fid)) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
 				"Unable to close saved msg_ep\n");
@@ -262,6 +288,7 @@ static void rxm_conn_free(struct rxm_cmap_handle *handle)
 		return;
 	/* Assuming fi_close also shuts down the connection gracefully if the
 	 * endpoint is in connected state */
+	rxm_conn_drop_repost(handle, rxm_conn->msg_ep);
 	if (fi_close(&rxm_conn->msg_ep->fid)) {
 		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
 			"Unable to close msg_ep\n");
@@ -870,6 +897,7 @@ static void rxm_conn_close(struct rxm_cmap_handle *handle)
 		return;
 
 	if (handle->cmap->attr.serial_access) {
+		rxm_conn_drop_repost(handle, rxm_conn->msg_ep);
 		if (fi_close(&rxm_conn->msg_ep->fid)) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
 				"Unable to close msg_ep\n");
@@ -913,6 +941,7 @@ static void rxm_conn_close_saved(struct rxm_cmap_handle *handle)
 	 * objects, postpone the closing of the saved MSG EP for
 	 * further deletion in main thread  */
 	if (handle->cmap->attr.serial_access) {
+		rxm_conn_drop_repost(handle, rxm_conn->saved_msg_ep);
 		if (fi_close(&rxm_conn->saved_msg_ep->fid)) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
 				"Unable to close saved msg_ep\n");
@@ -932,6 +961,7 @@ static void rxm_conn_connected_handler(struct rxm_cmap_handle *handle)
 		return;
 	/* Assuming fi_close also shuts down the connection gracefully if the
 	 * endpoint is in connected state */
+	rxm_conn_drop_repost(handle, rxm_conn->saved_msg_ep);
 	if (fi_close(&rxm_conn->saved_msg_ep->fid))
 		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "Unable to close saved msg_ep\n");
 	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "Closed saved msg_ep\n");
@@ -172,6 +172,7 @@ static int rxm_finish_recv(struct rxm_rx_buf *rx_buf, size_t done_len)
 				return ret;
 		}
 		ofi_ep_rx_cntr_inc(&rx_buf->ep->util_ep);
+		ofi_ep_stats_rx(&rx_buf->ep->util_ep, rx_buf->pkt.hdr.size);
 	}
 
 	if (rx_buf->recv_entry->flags & FI_MULTI_RECV) {
@@ -417,6 +418,35 @@ rxm_cq_rndv_read_prepare_deferred(struct rxm_deferred_tx_entry **def_tx_entry, s
 	return 0;
 }
 
+/*
+ * Posts a new buffer to the MSG EP in place of one that is held until
+ * the message it holds is matched or its rendezvous read completes.
+ * Otherwise enough held buffers stall the connection: the MSG provider
+ * has nowhere to place the next message, and the read responses that
+ * would release the buffers are queued behind it.
+ */
+static ssize_t rxm_rx_buf_replace(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep)
+{
+	struct rxm_rx_buf *rx_buf;
+
+	rx_buf = rxm_rx_buf_alloc(rxm_ep);
+	if (OFI_UNLIKELY(!rx_buf)) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"Ran out of buffers from RX buffer pool\n");
+		return -FI_ENOMEM;
+	}
+
+	rx_buf->hdr.state = RXM_RX;
+	rx_buf->msg_ep = msg_ep;
+	rx_buf->repost = 1;
+	if (!rxm_ep->srx_ctx)
+		rx_buf->conn = container_of(msg_ep->fid.context,
+					    struct rxm_conn, handle);
+
+	rxm_rx_buf_release(rxm_ep, rx_buf);
+	return 0;
+}
+
 static inline
 ssize_t rxm_cq_handle_large_data(struct rxm_rx_buf *rx_buf)
 {
@@ -438,6 +468,14 @@ ssize_t rxm_cq_handle_large_data(struct rxm_rx_buf *rx_buf)
 	       "Got incoming recv with msg_id: 0x%" PRIx64 "\n",
 	       rx_buf->pkt.ctrl_hdr.msg_id);
 
+	/* held until the read completes and the ack is sent */
+	if (rx_buf->repost) {
+		ret = rxm_rx_buf_replace(rx_buf->ep, rx_buf->msg_ep);
+		if (OFI_UNLIKELY(ret))
+			return ret;
+		rx_buf->repost = 0;
+	}
+
 	rx_buf->rndv_hdr = (struct rxm_rndv_hdr *)rx_buf->pkt.data;
 	rx_buf->rndv_rma_index = 0;
 
@@ -563,24 +601,9 @@ rxm_cq_match_rx_buf(struct rxm_rx_buf *rx_buf,
 
 		dlist_insert_tail(&rx_buf->unexp_msg.entry,
 				  &recv_queue->unexp_msg_list);
+		ofi_ep_stats_unexp(&rxm_ep->util_ep);
 
-		rx_buf = rxm_rx_buf_alloc(rxm_ep);
-		if (OFI_UNLIKELY(!rx_buf)) {
-			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
-				"Ran out of buffers from RX buffer pool\n");
-			return -FI_ENOMEM;
-		}
-
-		rx_buf->hdr.state = RXM_RX;
-		rx_buf->msg_ep = msg_ep;
-		rx_buf->repost = 1;
-		if (!rxm_ep->srx_ctx)
-			rx_buf->conn = container_of(msg_ep->fid.context,
-						    struct rxm_conn,
-						    handle);
-
-		rxm_rx_buf_release(rxm_ep, rx_buf);
-		return 0;
+		return rxm_rx_buf_replace(rxm_ep, msg_ep);
 	}
 
 	rx_buf->recv_entry = container_of(entry, struct rxm_recv_entry, entry);
@@ -832,15 +855,25 @@ static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 
 static inline void rxm_do_atomic(struct rxm_pkt *pkt, void *dst, void *src,
 				 void *cmp, void *res, size_t count,
-				 enum fi_datatype datatype, enum fi_op op)
+				 enum fi_datatype datatype, enum fi_op op,
+				 int local)
 {
 	switch (pkt->hdr.op) {
 	case ofi_op_atomic:
-		ofi_atomic_write_handlers[op][datatype](dst, src, count);
+		if (local)
+			ofi_atomic_write_local_handlers[op][datatype](dst, src,
+								      count);
+		else
+			ofi_atomic_write_handlers[op][datatype](dst, src,
+								count);
 		break;
 	case ofi_op_atomic_fetch:
-		ofi_atomic_readwrite_handlers[op][datatype](dst, src, res,
-							    count);
+		if (local)
+			ofi_atomic_readwrite_local_handlers[op][datatype](dst,
+							src, res, count);
+		else
+			ofi_atomic_readwrite_handlers[op][datatype](dst, src,
+							res, count);
 		break;
 	case ofi_op_atomic_compare:
 		ofi_atomic_swap_handlers[op - OFI_SWAP_OP_START][datatype](dst,
@@ -863,7 +896,7 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 	size_t len;
 	ssize_t result_len;
 	uint64_t offset;
-	int i;
+	int i, local;
 	int ret = 0;
 	struct rxm_tx_atomic_buf *resp_buf;
 	struct rxm_atomic_resp_hdr *resp_hdr;
@@ -910,6 +943,7 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 	len = ofi_total_rma_ioc_cnt(req_hdr->rma_ioc,
 			rx_buf->pkt.hdr.atomic.ioc_count) * datatype_sz;
 	resp_hdr = (struct rxm_atomic_resp_hdr *) resp_buf->pkt.data;
+	local = ofi_atomic_local(domain->util_domain.threading);
 
 	for (i = 0, offset = 0; i < rx_buf->pkt.hdr.atomic.ioc_count; i++) {
 		rxm_do_atomic(&rx_buf->pkt,
@@ -917,7 +951,8 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 			      req_hdr->data + offset,
 			      req_hdr->data + len + offset,
 			      resp_hdr->data + offset,
-			      req_hdr->rma_ioc[i].count, datatype, atomic_op);
+			      req_hdr->rma_ioc[i].count, datatype, atomic_op,
+			      local);
 		offset += req_hdr->rma_ioc[i].count * datatype_sz;
 	}
 	result_len = rx_buf->pkt.hdr.op == ofi_op_atomic ? 0 : offset;
@@ -1275,9 +1310,6 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 	ssize_t ret;
 	size_t comp_read = 0;
 
-	if (!slistfd_empty(&rxm_ep->msg_eq_entry_list))
-		rxm_conn_process_eq_events(rxm_ep);
-
 	while (!dlist_empty(&rxm_ep->repost_ready_list)) {
 		dlist_pop_front(&rxm_ep->repost_ready_list, struct rxm_rx_buf,
 				buf, repost_entry);
@@ -1303,6 +1335,11 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 		}
 	} while ((ret > 0) && (++comp_read < rxm_ep->comp_per_progress));
 
+	/* Completions read above for a connection that has been shut down
+	 * are dropped when its MSG EP is closed, instead of being reposted */
+	if (!slistfd_empty(&rxm_ep->msg_eq_entry_list))
+		rxm_conn_process_eq_events(rxm_ep);
+
 	if (OFI_UNLIKELY(!dlist_empty(&rxm_ep->deferred_tx_conn_queue))) {
 		dlist_foreach_container_safe(&rxm_ep->deferred_tx_conn_queue,
 					     struct rxm_conn, rxm_conn,
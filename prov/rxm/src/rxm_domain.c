@@ -107,10 +107,16 @@ static int rxm_mr_add_map_entry(struct util_domain *domain,
 static int rxm_domain_close(fid_t fid)
 {
 	struct rxm_domain *rxm_domain;
-	int ret;
+	int i, ret;
 
 	rxm_domain = container_of(fid, struct rxm_domain, util_domain.domain_fid.fid);
 
+	if (rxm_domain->mr_cache_enabled) {
+		for (i = 0; i < RXM_MR_CACHE_MAX; i++)
+			ofi_mr_cache_cleanup(&rxm_domain->mr_cache[i].cache);
+		rxm_domain->mr_cache_enabled = 0;
+	}
+
 	ret = fi_close(&rxm_domain->msg_domain->fid);
 	if (ret)
 		return ret;
@@ -123,11 +129,47 @@ static int rxm_domain_close(fid_t fid)
 	return 0;
 }
 
+static int rxm_domain_get_mr_cache_stats(struct rxm_domain *rxm_domain,
+					 struct fi_mr_cache_stats *user_stats)
+{
+	struct fi_mr_cache_stats stats;
+	int i;
+
+	if (!rxm_domain->mr_cache_enabled)
+		return -FI_ENOSYS;
+
+	if (user_stats->size < OFI_MR_CACHE_STATS_V1_SIZE)
+		return -FI_ETOOSMALL;
+
+	memset(&stats, 0, sizeof(stats));
+	for (i = 0; i < RXM_MR_CACHE_MAX; i++)
+		ofi_mr_cache_add_stats(&rxm_domain->mr_cache[i].cache, &stats);
+
+	stats.size = MIN(user_stats->size, sizeof(stats));
+	memcpy(user_stats, &stats, stats.size);
+	return 0;
+}
+
+static int rxm_domain_control(fid_t fid, int command, void *arg)
+{
+	struct rxm_domain *rxm_domain;
+
+	rxm_domain = container_of(fid, struct rxm_domain,
+				  util_domain.domain_fid.fid);
+
+	switch (command) {
+	case FI_GET_MR_CACHE_STATS:
+		return rxm_domain_get_mr_cache_stats(rxm_domain, arg);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
 static struct fi_ops rxm_domain_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = rxm_domain_close,
 	.bind = fi_no_bind,
-	.control = fi_no_control,
+	.control = rxm_domain_control,
 	.ops_open = fi_no_ops_open,
 };
 
@@ -158,6 +200,148 @@ static struct fi_ops rxm_mr_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
+static int rxm_mr_cache_desc_close(fid_t fid)
+{
+	struct rxm_mr_cache_desc *desc =
+		container_of(fid, struct rxm_mr_cache_desc, mr_fid.fid);
+
+	ofi_mr_cache_delete(desc->cache, desc->entry);
+	return 0;
+}
+
+static struct fi_ops rxm_mr_cache_desc_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = rxm_mr_cache_desc_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int rxm_mr_cache_entry_reg(struct ofi_mr_cache *cache,
+				  struct ofi_mr_entry *entry)
+{
+	struct rxm_mr_cache_desc *desc = (struct rxm_mr_cache_desc *) entry->data;
+	struct rxm_mr_cache *rxm_cache =
+		container_of(cache, struct rxm_mr_cache, cache);
+	int ret;
+
+	ret = fi_mr_reg(rxm_cache->domain->msg_domain, entry->iov.iov_base,
+			entry->iov.iov_len, rxm_cache->access, 0, 0, 0,
+			&desc->msg_mr, NULL);
+	if (ret)
+		return ret;
+
+	desc->mr_fid.fid.fclass = FI_CLASS_MR;
+	desc->mr_fid.fid.context = NULL;
+	desc->mr_fid.fid.ops = &rxm_mr_cache_desc_ops;
+	desc->mr_fid.mem_desc = fi_mr_desc(desc->msg_mr);
+	desc->mr_fid.key = fi_mr_key(desc->msg_mr);
+	desc->entry = entry;
+	desc->cache = cache;
+	return 0;
+}
+
+static void rxm_mr_cache_entry_dereg(struct ofi_mr_cache *cache,
+				     struct ofi_mr_entry *entry)
+{
+	struct rxm_mr_cache_desc *desc = (struct rxm_mr_cache_desc *) entry->data;
+
+	if (fi_close(&desc->msg_mr->fid))
+		FI_WARN(&rxm_prov, FI_LOG_DOMAIN,
+			"Unable to close cached MSG MR\n");
+}
+
+static struct ofi_mr_cache *
+rxm_mr_cache_get(struct rxm_domain *rxm_domain, uint64_t access)
+{
+	switch (access) {
+	case FI_REMOTE_READ:
+		return &rxm_domain->mr_cache[RXM_MR_CACHE_REMOTE_READ].cache;
+	case FI_READ:
+		return &rxm_domain->mr_cache[RXM_MR_CACHE_READ].cache;
+	case FI_WRITE:
+		return &rxm_domain->mr_cache[RXM_MR_CACHE_WRITE].cache;
+	default:
+		return NULL;
+	}
+}
+
+int rxm_msg_mr_reg_internal(struct rxm_domain *rxm_domain, const void *buf,
+			    size_t len, uint64_t acs, uint64_t flags,
+			    struct fid_mr **mr)
+{
+	struct rxm_mr_cache_desc *desc;
+	struct ofi_mr_cache *cache;
+	struct ofi_mr_entry *entry;
+	struct fi_mr_attr attr;
+	struct iovec iov;
+	int ret;
+
+	if (!rxm_domain->mr_cache_enabled || flags)
+		goto uncached;
+
+	cache = rxm_mr_cache_get(rxm_domain, acs);
+	if (!cache)
+		goto uncached;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	attr.mr_iov = &iov;
+	attr.iov_count = 1;
+	attr.access = acs;
+
+	ret = ofi_mr_cache_search(cache, &attr, &entry);
+	if (OFI_UNLIKELY(ret))
+		goto uncached;
+
+	desc = (struct rxm_mr_cache_desc *) entry->data;
+	*mr = &desc->mr_fid;
+	return 0;
+
+uncached:
+	return fi_mr_reg(rxm_domain->msg_domain, buf, len, acs, 0, 0,
+			 flags, mr, NULL);
+}
+
+static const uint64_t rxm_mr_cache_access[RXM_MR_CACHE_MAX] = {
+	[RXM_MR_CACHE_REMOTE_READ] = FI_REMOTE_READ,
+	[RXM_MR_CACHE_READ] = FI_READ,
+	[RXM_MR_CACHE_WRITE] = FI_WRITE,
+};
+
+static int rxm_domain_mr_cache_init(struct rxm_domain *rxm_domain)
+{
+	struct rxm_mr_cache *rxm_cache;
+	int i, ret;
+
+	for (i = 0; i < RXM_MR_CACHE_MAX; i++) {
+		rxm_cache = &rxm_domain->mr_cache[i];
+		rxm_cache->domain = rxm_domain;
+		rxm_cache->access = rxm_mr_cache_access[i];
+		rxm_cache->cache.max_cached_cnt = rxm_mr_max_cached_cnt;
+		rxm_cache->cache.max_cached_size = rxm_mr_max_cached_size;
+		rxm_cache->cache.entry_data_size =
+			sizeof(struct rxm_mr_cache_desc);
+		rxm_cache->cache.add_region = rxm_mr_cache_entry_reg;
+		rxm_cache->cache.delete_region = rxm_mr_cache_entry_dereg;
+
+		ret = ofi_mr_cache_init(&rxm_domain->util_domain, NULL,
+					&rxm_cache->cache);
+		if (ret) {
+			FI_INFO(&rxm_prov, FI_LOG_DOMAIN,
+				"MR cache unavailable (%s), internal "
+				"registrations will not be cached\n",
+				fi_strerror(-ret));
+			while (i--)
+				ofi_mr_cache_cleanup(&rxm_domain->mr_cache[i].cache);
+			return ret;
+		}
+	}
+
+	rxm_domain->mr_cache_enabled = 1;
+	return 0;
+}
+
 static uint64_t
 rxm_mr_get_msg_access(struct rxm_domain *rxm_domain, uint64_t access)
 {
@@ -347,6 +531,11 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 
 	rxm_domain->mr_local = ofi_mr_local(msg_info) && !ofi_mr_local(info);
 
+	/* rxm registers application buffers itself for rendezvous and RMA
+	 * transfers when the application doesn't provide descriptors */
+	if (rxm_mr_cache_enable && rxm_domain->mr_local)
+		(void) rxm_domain_mr_cache_init(rxm_domain);
+
 	fi_freeinfo(msg_info);
 	return 0;
 err3:
@@ -570,6 +570,8 @@ static int rxm_ep_getopt(fid_t fid, int level, int optname, void *optval,
 		*(size_t *)optval = rxm_ep->buffered_limit;
 		*optlen = sizeof(size_t);
 		break;
+	case FI_OPT_EP_STATS:
+		return ofi_ep_getopt_stats(&rxm_ep->util_ep, optval, optlen);
 	default:
 		return -FI_ENOPROTOOPT;
 	}
@@ -773,6 +775,8 @@ rxm_ep_recv_common(struct rxm_ep *rxm_ep, const struct iovec *iov,
 	ofi_ep_lock_acquire(&rxm_ep->util_ep);
 	ret = rxm_ep_post_recv(rxm_ep, iov, desc, count, src_addr,
 			       tag, ignore, context, op_flags, recv_queue);
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxm_ep->util_ep);
 	ofi_ep_lock_release(&rxm_ep->util_ep);
 	return ret;
 }
@@ -1242,6 +1246,10 @@ rxm_ep_inject_send_fast(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 					    inject_pkt->hdr.data, inject_pkt->hdr.flags,
 					    inject_pkt->hdr.tag, inject_pkt->hdr.op);
 	}
+	if (!ret)
+		ofi_ep_stats_tx(&rxm_ep->util_ep, len);
+	else if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxm_ep->util_ep);
 	return ret;
 }
 
@@ -1277,6 +1285,10 @@ rxm_ep_inject_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 					    pkt_size, data, flags, tag, op);
 	}
 unlock:
+	if (!ret)
+		ofi_ep_stats_tx(&rxm_ep->util_ep, len);
+	else if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxm_ep->util_ep);
 	ofi_ep_lock_release(&rxm_ep->util_ep);
 	return ret;
 
@@ -1397,6 +1409,10 @@ rxm_ep_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 			ret = rxm_ep_rndv_tx_send(rxm_ep, rxm_conn, tx_buf, ret);
 	}
 unlock:
+	if (!ret)
+		ofi_ep_stats_tx(&rxm_ep->util_ep, data_len);
+	else if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&rxm_ep->util_ep);
 	ofi_ep_lock_release(&rxm_ep->util_ep);
 	return ret;
 }
@@ -49,6 +49,9 @@
 size_t rxm_msg_tx_size		= 128;
 size_t rxm_msg_rx_size		= 128;
 size_t rxm_def_univ_size	= 256;
+int rxm_mr_cache_enable		= 1;
+size_t rxm_mr_max_cached_cnt	= 4096;
+size_t rxm_mr_max_cached_size	= SIZE_MAX;
 
 char *rxm_proto_state_str[] = {
 	RXM_PROTO_STATES(OFI_STR)
@@ -379,11 +382,31 @@ RXM_INI
 			"(default: 128). Setting this to 0 would get default "
 			"value defined by the MSG provider.");
 
+	fi_param_define(&rxm_prov, "mr_cache_enable", FI_PARAM_BOOL,
+			"Enable caching of the MSG provider registrations "
+			"made internally for rendezvous and RMA transfers when "
+			"the application doesn't register its buffers "
+			"(default: yes). Requires a memory monitor, see "
+			"FI_MR_CACHE_MONITOR.");
+
+	fi_param_define(&rxm_prov, "mr_max_cached_cnt", FI_PARAM_SIZE_T,
+			"Maximum number of cached registrations "
+			"(default: 4096).");
+
+	fi_param_define(&rxm_prov, "mr_max_cached_size", FI_PARAM_SIZE_T,
+			"Maximum total size of cached registrations "
+			"(default: unlimited).");
+
 	fi_param_get_size_t(&rxm_prov, "tx_size", &rxm_info.tx_attr->size);
 	fi_param_get_size_t(&rxm_prov, "rx_size", &rxm_info.rx_attr->size);
 	fi_param_get_size_t(&rxm_prov, "msg_tx_size", &rxm_msg_tx_size);
 	fi_param_get_size_t(&rxm_prov, "msg_rx_size", &rxm_msg_rx_size);
 	fi_param_get_size_t(NULL, "universe_size", &rxm_def_univ_size);
+	fi_param_get_bool(&rxm_prov, "mr_cache_enable", &rxm_mr_cache_enable);
+	fi_param_get_size_t(&rxm_prov, "mr_max_cached_cnt",
+			    &rxm_mr_max_cached_cnt);
+	fi_param_get_size_t(&rxm_prov, "mr_max_cached_size",
+			    &rxm_mr_max_cached_size);
 
 	if (rxm_init_info()) {
 		FI_WARN(&rxm_prov, FI_LOG_CORE, "Unable to initialize rxm_info\n");
@@ -67,6 +67,13 @@
 #define SMR_MAJOR_VERSION 1
 #define SMR_MINOR_VERSION 0
 
+struct smr_env {
+	int numa_bind;
+	int inject_first_touch;
+	size_t posted_write_size;
+};
+
+extern struct smr_env smr_env;
 extern struct fi_provider smr_prov;
 extern struct fi_info smr_info;
 extern struct util_prov smr_util_prov;
@@ -172,6 +179,9 @@ static inline const char *smr_no_prefix(const char *addr)
 #define smr_fast_rma_enabled(mode, order) ((mode & FI_MR_VIRT_ADDR) && \
 			!(order & SMR_RMA_ORDER))
 
+/* Commands taken off the region's command queue per progress call */
+#define SMR_CMD_BATCH	16
+
 struct smr_ep {
 	struct util_ep		util_ep;
 	smr_rx_comp_func	rx_comp;
@@ -187,6 +197,24 @@ struct smr_ep {
 	struct smr_unexp_fs	*unexp_fs;
 	struct smr_pend_fs	*pend_fs;
 	struct smr_queue	unexp_queue;
+
+	/*
+	 * Commands are copied out of the region in batches and processed
+	 * without holding the region lock.  Command slots and inject buffers
+	 * they release are handed back to senders in bulk.  All of these are
+	 * protected by the rx_cq lock, cmd_batch_cnt is only written with
+	 * the region lock held as well.
+	 */
+	struct smr_cmd		cmd_batch[SMR_CMD_BATCH];
+	int			cmd_batch_head;
+	int			cmd_batch_cnt;
+	int			cmd_ret_cnt;
+	int			inject_ret_cnt;
+	struct smr_inject_buf	**inject_ret;
+
+	/* receive published in the region, protected by the rx_cq lock */
+	struct smr_ep_entry	*posted_entry;
+	struct smr_queue	*posted_queue;
 };
 
 #define smr_ep_rx_flags(smr_ep) ((smr_ep)->util_ep.rx_op_flags)
@@ -219,6 +247,13 @@ void smr_format_iov(struct smr_cmd *cmd, fi_addr_t peer_id,
 		uint32_t op, uint64_t tag, uint64_t data, uint64_t op_flags,
 		void *context, struct smr_region *smr, struct smr_resp *resp,
 		struct smr_cmd *pend);
+int smr_format_posted(struct smr_cmd *cmd, fi_addr_t peer_id,
+		const struct iovec *iov, size_t count, size_t total_len,
+		uint32_t op, uint64_t tag, uint64_t data, uint64_t op_flags,
+		struct smr_region *smr);
+ssize_t smr_inject_bounce(struct smr_ep *ep, struct smr_cmd *cmd, int peer_id,
+		const struct iovec *iov, uint32_t op, uint64_t tag,
+		uint64_t data, uint64_t op_flags);
 
 int smr_complete_tx(struct smr_ep *ep, void *context, uint32_t op,
 		uint16_t flags, uint64_t err);
@@ -246,7 +281,24 @@ void smr_cntr_report_rx_comp(struct smr_ep *ep, uint32_t op);
 
 uint64_t smr_rx_cq_flags(uint32_t op, uint16_t op_flags);
 
+/* Commands are posted under the peer's region lock, which orders them
+ * against the peer arming its doorbell.  Resp status updates aren't, so
+ * they need a full barrier before checking the doorbell. */
+static inline void smr_cmd_signal(struct smr_ep *ep, int64_t peer_id)
+{
+	smr_signal(&smr_prov, ep->region->map, (int) peer_id);
+}
+
+static inline void smr_resp_signal(struct smr_ep *ep, int64_t peer_id)
+{
+	__sync_synchronize();
+	smr_signal(&smr_prov, ep->region->map, (int) peer_id);
+}
+
 void smr_ep_progress(struct util_ep *util_ep);
+void smr_progress_return(struct smr_ep *ep);
+void smr_publish_recv(struct smr_ep *ep);
+void smr_unpublish_recv(struct smr_ep *ep);
 int smr_progress_unexp(struct smr_ep *ep, struct smr_ep_entry *entry);
 
 #endif
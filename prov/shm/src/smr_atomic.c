@@ -252,7 +252,7 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 					 iov, count, compare_iov, compare_count,
 					 op, datatype, atomic_op, op_flags);
 	} else if (total_len <= SMR_INJECT_SIZE) {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject_atomic(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 					 iov, count, result_iov, result_count,
 					 compare_iov, compare_count, op, datatype,
@@ -293,6 +293,7 @@ format_rma:
 	smr_format_rma_ioc(cmd, rma_ioc, rma_count);
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
 	peer_smr->cmd_cnt--;
+	smr_cmd_signal(ep, peer_id);
 unlock_cq:
 	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
 unlock_region:
@@ -401,7 +402,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 					 &iov, 1, NULL, 0, ofi_op_atomic,
 					 datatype, op, 0);
 	} else if (total_len <= SMR_INJECT_SIZE) {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject_atomic(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 					 &iov, 1, NULL, 0, NULL, 0, ofi_op_atomic,
 					 datatype, op, peer_smr, tx_buf, 0);
@@ -413,6 +414,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 	smr_format_rma_ioc(cmd, &rma_ioc, 1);
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
 	peer_smr->cmd_cnt--;
+	smr_cmd_signal(ep, peer_id);
 
 	smr_cntr_report_tx_comp(ep, ofi_op_atomic);
 unlock_region:
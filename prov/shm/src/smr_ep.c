@@ -92,6 +92,9 @@ int smr_getopt(fid_t fid, int level, int optname,
 	struct smr_ep *smr_ep =
 		container_of(fid, struct smr_ep, util_ep.ep_fid);
 
+	if (level == FI_OPT_ENDPOINT && optname == FI_OPT_EP_STATS)
+		return ofi_ep_getopt_stats(&smr_ep->util_ep, optval, optlen);
+
 	if ((level != FI_OPT_ENDPOINT) || (optname != FI_OPT_MIN_MULTI_RECV))
 		return -FI_ENOPROTOOPT;
 
@@ -131,7 +134,10 @@ static int smr_ep_cancel_recv(struct smr_ep *ep, struct smr_queue *queue,
 	struct dlist_entry *entry;
 	int ret = 0;
 
+	/* the region lock keeps senders from claiming a published receive */
+	fastlock_acquire(&ep->region->lock);
 	fastlock_acquire(&ep->util_ep.rx_cq->cq_lock);
+	smr_unpublish_recv(ep);
 	entry = dlist_remove_first_match(&queue->list, smr_match_recv_ctx,
 					 context);
 	if (entry) {
@@ -144,7 +150,9 @@ static int smr_ep_cancel_recv(struct smr_ep *ep, struct smr_queue *queue,
 		ret = ret ? ret : 1;
 	}
 
+	smr_publish_recv(ep);
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
+	fastlock_release(&ep->region->lock);
 	return ret;
 }
 
@@ -276,7 +284,7 @@ void smr_format_inject(struct smr_cmd *cmd, fi_addr_t peer_id,
 	smr_generic_format(cmd, peer_id, op, tag, 0, 0, data, op_flags);
 	cmd->msg.hdr.op_src = smr_src_inject;
 	cmd->msg.hdr.src_data = (char **) tx_buf - (char **) smr;
-	cmd->msg.hdr.size = ofi_copy_from_iov(tx_buf->data, SMR_INJECT_SIZE,
+	cmd->msg.hdr.size = ofi_copy_from_iov(tx_buf->data, smr->inject_size,
 					      iov, count, 0);
 }
 
@@ -297,12 +305,189 @@ void smr_format_iov(struct smr_cmd *cmd, fi_addr_t peer_id,
 	smr_post_pend_resp(cmd, pend_cmd, resp);
 }
 
+/*
+ * The peer's inject buffers are smaller than ours, so the data is copied
+ * into a bounce buffer that the peer reads through CMA.  The buffer is
+ * freed once the peer responds.  Called with the peer's region lock held.
+ */
+ssize_t smr_inject_bounce(struct smr_ep *ep, struct smr_cmd *cmd, int peer_id,
+			  const struct iovec *iov, uint32_t op, uint64_t tag,
+			  uint64_t data, uint64_t op_flags)
+{
+	struct smr_resp *resp;
+	struct smr_cmd *pend;
+	struct iovec bounce;
+	ssize_t ret = 0;
+
+	bounce.iov_len = iov->iov_len;
+	bounce.iov_base = malloc(bounce.iov_len);
+	if (!bounce.iov_base)
+		return -FI_ENOMEM;
+	memcpy(bounce.iov_base, iov->iov_base, bounce.iov_len);
+
+	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
+	if (ofi_cirque_isfull(smr_resp_queue(ep->region))) {
+		ret = -FI_EAGAIN;
+		goto unlock;
+	}
+
+	resp = ofi_cirque_tail(smr_resp_queue(ep->region));
+	pend = freestack_pop(ep->pend_fs);
+	smr_format_iov(cmd, smr_peer_addr(ep->region)[peer_id].addr, &bounce, 1,
+		       bounce.iov_len, op, tag, data, op_flags, NULL,
+		       ep->region, resp, pend);
+	pend->msg.hdr.op_flags |= SMR_TX_BOUNCE;
+	ofi_cirque_commit(smr_resp_queue(ep->region));
+unlock:
+	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
+	if (ret)
+		free(bounce.iov_base);
+	return ret;
+}
+
+/*
+ * Writes the message straight into the receive the peer published instead
+ * of staging it in an inject buffer.  Called with the peer's region lock
+ * held, which keeps a READY receive from being taken back.  Returns
+ * -FI_EAGAIN if the message has to go through the inject buffers.
+ */
+int smr_format_posted(struct smr_cmd *cmd, fi_addr_t peer_id,
+		      const struct iovec *iov, size_t count, size_t total_len,
+		      uint32_t op, uint64_t tag, uint64_t data,
+		      uint64_t op_flags, struct smr_region *smr)
+{
+	struct smr_posted_recv *posted = &smr->posted;
+	ssize_t ret;
+
+	if (!smr_env.posted_write_size || total_len < smr_env.posted_write_size ||
+	    ofi_atomic_get32(&posted->state) != SMR_POSTED_READY ||
+	    !ofi_cirque_isempty(smr_cmd_queue(smr)))
+		return -FI_EAGAIN;
+
+	if (posted->op != op || !smr_match_addr(posted->addr, peer_id) ||
+	    (op == ofi_op_tagged &&
+	     !smr_match_tag(posted->tag, posted->ignore, tag)) ||
+	    total_len > ofi_total_iov_len(posted->iov, posted->iov_count))
+		return -FI_EAGAIN;
+
+	ret = process_vm_writev(smr->pid, iov, count, posted->iov,
+				posted->iov_count, 0);
+	if (ret != total_len) {
+		FI_DBG(&smr_prov, FI_LOG_EP_DATA,
+		       "CMA write to posted receive failed\n");
+		return -FI_EAGAIN;
+	}
+
+	smr_generic_format(cmd, peer_id, op, tag, 0, 0, data, op_flags);
+	cmd->msg.hdr.op_src = smr_src_posted;
+	cmd->msg.hdr.size = total_len;
+	ofi_atomic_set32(&posted->state, SMR_POSTED_CLAIMED);
+	return 0;
+}
+
+#define SMR_MAX_WAITS	8
+
+/* Returns the wait objects of all CQs and counters bound to the EP */
+static int smr_ep_waits(struct smr_ep *ep, struct util_wait **waits)
+{
+	struct util_cntr *cntrs[] = {
+		ep->util_ep.tx_cntr, ep->util_ep.rx_cntr,
+		ep->util_ep.rd_cntr, ep->util_ep.wr_cntr,
+		ep->util_ep.rem_rd_cntr, ep->util_ep.rem_wr_cntr,
+	};
+	int i, cnt = 0;
+
+	if (ep->util_ep.tx_cq->wait)
+		waits[cnt++] = ep->util_ep.tx_cq->wait;
+	if (ep->util_ep.rx_cq->wait)
+		waits[cnt++] = ep->util_ep.rx_cq->wait;
+	for (i = 0; i < sizeof(cntrs) / sizeof(cntrs[0]); i++) {
+		if (cntrs[i] && cntrs[i]->wait)
+			waits[cnt++] = cntrs[i]->wait;
+	}
+	return cnt;
+}
+
+/*
+ * Called before a wait object sleeps.  Arm the doorbell, then check for
+ * work posted before it was armed.  Peers check the doorbell after posting
+ * work and signal us if it is set.  Commands left in the batch and slots
+ * not yet returned to senders also need another progress call.
+ */
+static int smr_ep_trywait(void *arg)
+{
+	struct smr_ep *ep = arg;
+	struct smr_resp *resp;
+	int ret = FI_SUCCESS;
+
+	smr_signal_reset(ep->region);
+
+	fastlock_acquire(&ep->region->lock);
+	ofi_atomic_set32(&ep->region->signal, 1);
+	__sync_synchronize();
+
+	if (!ofi_cirque_isempty(smr_cmd_queue(ep->region)) ||
+	    ep->cmd_batch_head != ep->cmd_batch_cnt || ep->cmd_ret_cnt) {
+		ret = -FI_EAGAIN;
+	} else if (!ofi_cirque_isempty(smr_resp_queue(ep->region))) {
+		resp = ofi_cirque_head(smr_resp_queue(ep->region));
+		if (resp->status != FI_EBUSY)
+			ret = -FI_EAGAIN;
+	}
+
+	if (ret)
+		ofi_atomic_set32(&ep->region->signal, 0);
+	fastlock_release(&ep->region->lock);
+	return ret;
+}
+
+static int smr_ep_signal_init(struct smr_ep *ep)
+{
+	struct util_wait *waits[SMR_MAX_WAITS];
+	int i, cnt, ret;
+
+	cnt = smr_ep_waits(ep, waits);
+	if (!cnt)
+		return 0;
+
+	ret = smr_signal_open(&smr_prov, ep->region);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < cnt; i++) {
+		ret = ofi_wait_fd_add(waits[i], ep->region->signal_fd,
+				      FI_EPOLL_IN, smr_ep_trywait, ep,
+				      &ep->util_ep.ep_fid.fid);
+		if (ret)
+			goto err;
+	}
+	return 0;
+err:
+	while (i--)
+		ofi_wait_fd_del(waits[i], ep->region->signal_fd);
+	return ret;
+}
+
+static void smr_ep_signal_cleanup(struct smr_ep *ep)
+{
+	struct util_wait *waits[SMR_MAX_WAITS];
+	int i, cnt;
+
+	if (!ep->region || ep->region->signal_fd < 0)
+		return;
+
+	cnt = smr_ep_waits(ep, waits);
+	for (i = 0; i < cnt; i++)
+		ofi_wait_fd_del(waits[i], ep->region->signal_fd);
+}
+
 static int smr_ep_close(struct fid *fid)
 {
 	struct smr_ep *ep;
 
 	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
 
+	smr_ep_signal_cleanup(ep);
 	ofi_endpoint_close(&ep->util_ep);
 
 	if (ep->region)
@@ -311,6 +496,7 @@ static int smr_ep_close(struct fid *fid)
 	smr_recv_fs_free(ep->recv_fs);
 	smr_unexp_fs_free(ep->unexp_fs);
 	smr_pend_fs_free(ep->pend_fs);
+	free(ep->inject_ret);
 	free(ep);
 	return 0;
 }
@@ -401,9 +587,18 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 		attr.name = ep->name;
 		attr.rx_count = ep->rx_size;
 		attr.tx_count = ep->tx_size;
+		attr.inject_size = smr_info.tx_attr->inject_size;
+		attr.numa_bind = smr_env.numa_bind;
+		attr.inject_first_touch = smr_env.inject_first_touch;
 		ret = smr_create(&smr_prov, av->smr_map, &attr, &ep->region);
 		if (ret)
 			return ret;
+		ret = smr_ep_signal_init(ep);
+		if (ret) {
+			smr_free(ep->region);
+			ep->region = NULL;
+			return ret;
+		}
 		smr_exchange_all_peers(ep->region);
 		break;
 	default:
@@ -471,6 +666,13 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err1;
 
+	/* every inject buffer of the region may be waiting to be returned */
+	ep->inject_ret = calloc(info->rx_attr->size, sizeof(*ep->inject_ret));
+	if (!ep->inject_ret) {
+		ret = -FI_ENOMEM;
+		goto err0;
+	}
+
 	ep->recv_fs = smr_recv_fs_create(info->rx_attr->size, NULL, NULL);
 	ep->unexp_fs = smr_unexp_fs_create(info->rx_attr->size, NULL, NULL);
 	ep->pend_fs = smr_pend_fs_create(info->tx_attr->size, NULL, NULL);
@@ -478,7 +680,7 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 	smr_init_queue(&ep->trecv_queue, smr_match_tagged);
 	smr_init_queue(&ep->unexp_queue, smr_match_unexp);
 
-	ep->min_multi_recv_size = SMR_INJECT_SIZE;
+	ep->min_multi_recv_size = smr_info.tx_attr->inject_size;
 
 	ep->util_ep.ep_fid.fid.ops = &smr_ep_fi_ops;
 	ep->util_ep.ep_fid.ops = &smr_ep_ops;
@@ -491,6 +693,8 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 	*ep_fid = &ep->util_ep.ep_fid;
 	return 0;
 
+err0:
+	ofi_endpoint_close(&ep->util_ep);
 err1:
 	free((void *)ep->name);
 err2:
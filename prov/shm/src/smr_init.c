@@ -36,6 +36,12 @@
 #include "smr.h"
 
 
+struct smr_env smr_env = {
+	.numa_bind = 1,
+	.inject_first_touch = 0,
+	.posted_write_size = 0,
+};
+
 static void smr_resolve_addr(const char *node, const char *service,
 			     char **addr, size_t *addrlen)
 {
@@ -104,6 +110,23 @@ static int smr_getinfo(uint32_t version, const char *node, const char *service,
 	return 0;
 }
 
+static void smr_init_info(void)
+{
+	size_t param;
+
+	if (fi_param_get_size_t(&smr_prov, "inject_size", &param))
+		return;
+
+	if (param < SMR_INJECT_SIZE || param > SMR_MAX_INJECT_SIZE) {
+		FI_WARN(&smr_prov, FI_LOG_CORE,
+			"inject size must be between %d and %d, using %zu\n",
+			SMR_INJECT_SIZE, SMR_MAX_INJECT_SIZE,
+			smr_info.tx_attr->inject_size);
+		return;
+	}
+	smr_info.tx_attr->inject_size = param;
+}
+
 static void smr_fini(void)
 {
 	/* yawn */
@@ -126,5 +149,32 @@ struct util_prov smr_util_prov = {
 
 SHM_INI
 {
+	fi_param_define(&smr_prov, "inject_size", FI_PARAM_SIZE_T,
+			"Size of the inject buffers in each endpoint's shared "
+			"memory region, and the largest message copied through "
+			"them.  Larger messages are transferred with CMA. Peers "
+			"may use different sizes (default: 4096, max: 65536).");
+
+	fi_param_define(&smr_prov, "numa_bind", FI_PARAM_BOOL,
+			"Prefer the NUMA node of the thread enabling an "
+			"endpoint for the pages of its shared memory region "
+			"(default: yes).");
+	fi_param_define(&smr_prov, "inject_first_touch", FI_PARAM_BOOL,
+			"With numa_bind, leave the inject buffers to first "
+			"touch, which places them on the node of the first "
+			"sender that fills them (default: no).");
+	fi_param_define(&smr_prov, "posted_write_size", FI_PARAM_SIZE_T,
+			"Smallest message a sender writes with CMA directly "
+			"into a receive the peer already posted, instead of "
+			"copying it through an inject buffer.  Only messages "
+			"up to the inject size are eligible (default: 0, "
+			"disabled).");
+
+	fi_param_get_bool(&smr_prov, "numa_bind", &smr_env.numa_bind);
+	fi_param_get_bool(&smr_prov, "inject_first_touch",
+			  &smr_env.inject_first_touch);
+	fi_param_get_size_t(&smr_prov, "posted_write_size",
+			    &smr_env.posted_write_size);
+	smr_init_info();
 	return &smr_prov;
 }
@@ -54,8 +54,10 @@ static inline struct smr_ep_entry *smr_get_recv_entry(struct smr_ep *ep, uint64_
 {
 	struct smr_ep_entry *entry;
 
-	if (freestack_isempty(ep->recv_fs))
+	if (freestack_isempty(ep->recv_fs)) {
+		ofi_ep_stats_eagain(&ep->util_ep);
 		return NULL;
+	}
 
 	entry = freestack_pop(ep->recv_fs);
 
@@ -92,6 +94,7 @@ ssize_t smr_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	entry->addr = msg->addr;
 
 	dlist_insert_tail(&entry->entry, &ep->recv_queue.list);
+	smr_publish_recv(ep);
 out:
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
 	return ret;
@@ -122,6 +125,7 @@ ssize_t smr_recvv(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	entry->addr = src_addr;
 
 	dlist_insert_tail(&entry->entry, &ep->recv_queue.list);
+	smr_publish_recv(ep);
 out:
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
 	return ret;
@@ -150,6 +154,7 @@ ssize_t smr_recv(struct fid_ep *ep_fid, void *buf, size_t len, void *desc,
 	entry->addr = src_addr;
 
 	dlist_insert_tail(&entry->entry, &ep->recv_queue.list);
+	smr_publish_recv(ep);
 out:
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
 	return ret;
@@ -196,8 +201,13 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 	if (total_len <= SMR_MSG_DATA_LEN) {
 		smr_format_inline(cmd, smr_peer_addr(ep->region)[peer_id].addr, iov,
 				  iov_count, op, tag, data, op_flags);
-	} else if (total_len <= SMR_INJECT_SIZE) {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+	} else if (total_len <= peer_smr->inject_size &&
+		   !smr_format_posted(cmd, smr_peer_addr(ep->region)[peer_id].addr,
+				      iov, iov_count, total_len, op, tag, data,
+				      op_flags, peer_smr)) {
+		/* written into the peer's posted receive */
+	} else if (total_len <= peer_smr->inject_size) {
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  iov, iov_count, op, tag, data, op_flags,
 				  peer_smr, tx_buf);
@@ -224,10 +234,14 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 commit:
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
 	peer_smr->cmd_cnt--;
+	smr_cmd_signal(ep, peer_id);
+	ofi_ep_stats_tx(&ep->util_ep, total_len);
 unlock_cq:
 	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
 unlock_region:
 	fastlock_release(&peer_smr->lock);
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&ep->util_ep);
 	return ret;
 }
 
@@ -282,7 +296,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 	ssize_t ret = 0;
 	struct iovec msg_iov;
 
-	assert(len <= SMR_INJECT_SIZE);
+	assert(len <= SMR_MAX_INJECT_SIZE);
 
 	msg_iov.iov_base = (void *) buf;
 	msg_iov.iov_len = len;
@@ -306,17 +320,31 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 	if (len <= SMR_MSG_DATA_LEN) {
 		smr_format_inline(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  &msg_iov, 1, op, tag, data, op_flags);
-	} else {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+	} else if (len > peer_smr->inject_size) {
+		/* the counter is updated when the peer responds */
+		ret = smr_inject_bounce(ep, cmd, peer_id, &msg_iov, op, tag,
+					data, op_flags);
+		if (ret)
+			goto unlock;
+		goto commit;
+	} else if (smr_format_posted(cmd, smr_peer_addr(ep->region)[peer_id].addr,
+				     &msg_iov, 1, len, op, tag, data, op_flags,
+				     peer_smr)) {
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  &msg_iov, 1, op, tag, data, op_flags,
 				  peer_smr, tx_buf);
 	}
 	smr_cntr_report_tx_comp(ep, op);
+commit:
 	peer_smr->cmd_cnt--;
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
+	smr_cmd_signal(ep, peer_id);
+	ofi_ep_stats_tx(&ep->util_ep, len);
 unlock:
 	fastlock_release(&peer_smr->lock);
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&ep->util_ep);
 
 	return ret;
 }
@@ -369,8 +397,10 @@ static inline struct smr_ep_entry *smr_get_trecv_entry(struct smr_ep *ep, uint64
 {
 	struct smr_ep_entry *entry;
 
-	if (freestack_isempty(ep->recv_fs))
+	if (freestack_isempty(ep->recv_fs)) {
+		ofi_ep_stats_eagain(&ep->util_ep);
 		return NULL;
+	}
 
 	entry = freestack_pop(ep->recv_fs);
 	entry->err = 0;
@@ -389,6 +419,7 @@ smr_proccess_trecv_post(struct smr_ep *ep, struct smr_ep_entry *entry)
 		return ret;
 
 	dlist_insert_tail(&entry->entry, &ep->trecv_queue.list);
+	smr_publish_recv(ep);
 	return 0;
 }
 
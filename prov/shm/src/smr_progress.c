@@ -69,7 +69,7 @@ static int smr_progress_fetch(struct smr_ep *ep, struct smr_cmd *pending,
 	}
 
 out:
-	smr_freestack_push(smr_inject_pool(peer_smr), tx_buf);
+	smr_inject_pool_push(smr_inject_pool(peer_smr), tx_buf);
 	peer_smr->cmd_cnt++;
 	fastlock_release(&peer_smr->lock);
 	return 0;
@@ -102,6 +102,8 @@ static void smr_progress_resp(struct smr_ep *ep)
 				"unable to process tx completion\n");
 			break;
 		}
+		if (pending->msg.hdr.op_flags & SMR_TX_BOUNCE)
+			free(pending->msg.data.iov[0].iov_base);
 		freestack_push(ep->pend_fs, pending);
 		ofi_cirque_discard(smr_resp_queue(ep->region));
 	}
@@ -109,6 +111,148 @@ static void smr_progress_resp(struct smr_ep *ep)
 	fastlock_release(&ep->region->lock);
 }
 
+static inline struct smr_cmd *smr_batch_head(struct smr_ep *ep)
+{
+	return &ep->cmd_batch[ep->cmd_batch_head];
+}
+
+static inline void smr_batch_discard(struct smr_ep *ep)
+{
+	ep->cmd_batch_head++;
+}
+
+/* RMA and atomic commands are followed by a command holding the rma iovs */
+static inline int smr_cmd_slots(struct smr_cmd *cmd)
+{
+	switch (cmd->msg.hdr.op) {
+	case ofi_op_write:
+	case ofi_op_read_req:
+	case ofi_op_atomic:
+	case ofi_op_atomic_fetch:
+	case ofi_op_atomic_compare:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+static void smr_return_inject(struct smr_ep *ep, struct smr_inject_buf *tx_buf)
+{
+	ep->inject_ret[ep->inject_ret_cnt++] = tx_buf;
+}
+
+/* Called with the region and rx_cq locks held */
+static void smr_return_cmds(struct smr_ep *ep)
+{
+	struct smr_inject_pool *pool = smr_inject_pool(ep->region);
+	int i;
+
+	for (i = 0; i < ep->inject_ret_cnt; i++)
+		smr_inject_pool_push(pool, ep->inject_ret[i]);
+	ep->region->cmd_cnt += ep->cmd_ret_cnt;
+	ep->inject_ret_cnt = ep->cmd_ret_cnt = 0;
+}
+
+void smr_progress_return(struct smr_ep *ep)
+{
+	fastlock_acquire(&ep->region->lock);
+	fastlock_acquire(&ep->util_ep.rx_cq->cq_lock);
+	smr_return_cmds(ep);
+	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
+	fastlock_release(&ep->region->lock);
+}
+
+/*
+ * Publish the first posted receive for senders to write into.  Called with
+ * the rx_cq lock held.  Nothing may be waiting in the batch, or a sender
+ * could overtake a message that should match this receive.
+ */
+void smr_publish_recv(struct smr_ep *ep)
+{
+	struct smr_posted_recv *posted = &ep->region->posted;
+	struct smr_ep_entry *entry;
+	struct smr_queue *queue;
+
+	if (!smr_env.posted_write_size || ep->posted_entry ||
+	    ep->cmd_batch_head != ep->cmd_batch_cnt)
+		return;
+
+	queue = dlist_empty(&ep->recv_queue.list) ?
+		&ep->trecv_queue : &ep->recv_queue;
+	if (dlist_empty(&queue->list))
+		return;
+
+	entry = container_of(queue->list.next, struct smr_ep_entry, entry);
+	if (entry->flags & SMR_MULTI_RECV)
+		return;
+
+	dlist_remove(&entry->entry);
+	ep->posted_entry = entry;
+	ep->posted_queue = queue;
+
+	posted->op = (queue == &ep->trecv_queue) ? ofi_op_tagged : ofi_op_msg;
+	posted->addr = entry->addr;
+	posted->tag = entry->tag;
+	posted->ignore = entry->ignore;
+	posted->iov_count = entry->iov_count;
+	memcpy(posted->iov, entry->iov, sizeof(*entry->iov) * entry->iov_count);
+	__sync_synchronize();
+	ofi_atomic_set32(&posted->state, SMR_POSTED_READY);
+}
+
+/*
+ * Take back a published receive no sender has claimed.  Called with the
+ * region and rx_cq locks held.
+ */
+void smr_unpublish_recv(struct smr_ep *ep)
+{
+	struct smr_posted_recv *posted = &ep->region->posted;
+
+	if (!ep->posted_entry ||
+	    ofi_atomic_get32(&posted->state) != SMR_POSTED_READY)
+		return;
+
+	ofi_atomic_set32(&posted->state, SMR_POSTED_IDLE);
+	dlist_insert_head(&ep->posted_entry->entry, &ep->posted_queue->list);
+	ep->posted_entry = NULL;
+}
+
+/*
+ * Called with the region and rx_cq locks held.  Commands that could not be
+ * processed yet stay at the front of the batch, so ordering is kept.  A
+ * published receive is taken back before anything is fetched, unless a
+ * sender already claimed it.  Its command is then the first one queued.
+ */
+static void smr_fetch_cmds(struct smr_ep *ep)
+{
+	struct smr_cmd *cmd;
+	int slots;
+
+	if (!ofi_cirque_isempty(smr_cmd_queue(ep->region)))
+		smr_unpublish_recv(ep);
+
+	if (ep->cmd_batch_head) {
+		ep->cmd_batch_cnt -= ep->cmd_batch_head;
+		memmove(ep->cmd_batch, &ep->cmd_batch[ep->cmd_batch_head],
+			sizeof(*cmd) * ep->cmd_batch_cnt);
+		ep->cmd_batch_head = 0;
+	}
+
+	while (!ofi_cirque_isempty(smr_cmd_queue(ep->region))) {
+		cmd = ofi_cirque_head(smr_cmd_queue(ep->region));
+		slots = smr_cmd_slots(cmd);
+		if (ep->cmd_batch_cnt + slots > SMR_CMD_BATCH)
+			break;
+
+		while (slots--) {
+			memcpy(&ep->cmd_batch[ep->cmd_batch_cnt++],
+			       ofi_cirque_head(smr_cmd_queue(ep->region)),
+			       sizeof(*cmd));
+			ofi_cirque_discard(smr_cmd_queue(ep->region));
+		}
+	}
+}
+
 static int smr_progress_inline(struct smr_cmd *cmd, struct iovec *iov,
 			       size_t iov_count, size_t *total_len)
 {
@@ -144,7 +288,7 @@ static int smr_progress_inject(struct smr_cmd *cmd, struct iovec *iov,
 	}
 
 out:
-	smr_freestack_push(smr_inject_pool(ep->region), tx_buf);
+	smr_return_inject(ep, tx_buf);
 	return err;
 }
 
@@ -194,6 +338,7 @@ static int smr_progress_iov(struct smr_cmd *cmd, struct iovec *iov,
 out:
 	//Status must be set last (signals peer: op done, valid resp entry)
 	resp->status = ret;
+	smr_resp_signal(ep, peer_id);
 
 	return -ret;
 }
@@ -224,7 +369,7 @@ static int smr_progress_multi_recv(struct smr_ep *ep, struct smr_queue *queue,
 }
 
 static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype datatype,
-			  enum fi_op op, size_t cnt, uint16_t flags)
+			  enum fi_op op, size_t cnt, uint16_t flags, int local)
 {
 	char tmp_result[SMR_INJECT_SIZE];
 
@@ -232,10 +377,18 @@ static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype data
 		ofi_atomic_swap_handlers[op - OFI_SWAP_OP_START][datatype](dst,
 			src, cmp, tmp_result, cnt);
 	} else if (flags & SMR_RMA_REQ) {
-		ofi_atomic_readwrite_handlers[op][datatype](dst, src,
-			tmp_result, cnt);
+		if (local)
+			ofi_atomic_readwrite_local_handlers[op][datatype](dst,
+				src, tmp_result, cnt);
+		else
+			ofi_atomic_readwrite_handlers[op][datatype](dst, src,
+				tmp_result, cnt);
 	} else if (op != FI_ATOMIC_READ) {
-		ofi_atomic_write_handlers[op][datatype](dst, src, cnt);
+		if (local)
+			ofi_atomic_write_local_handlers[op][datatype](dst, src,
+								      cnt);
+		else
+			ofi_atomic_write_handlers[op][datatype](dst, src, cnt);
 	}
 
 	if (flags & SMR_RMA_REQ)
@@ -244,7 +397,7 @@ static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype data
 }
 
 static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
-			       size_t ioc_count, size_t *len)
+			       size_t ioc_count, size_t *len, int local)
 {
 	int i;
 	uint8_t *src, *comp;
@@ -263,7 +416,7 @@ static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 	for (i = *len = 0; i < ioc_count && *len < cmd->msg.hdr.size; i++) {
 		smr_do_atomic(&src[*len], ioc[i].addr, comp ? &comp[*len] : NULL,
 			      cmd->msg.hdr.datatype, cmd->msg.hdr.atomic_op,
-			      ioc[i].count, cmd->msg.hdr.op_flags);
+			      ioc[i].count, cmd->msg.hdr.op_flags, local);
 		*len += ioc[i].count * ofi_datatype_size(cmd->msg.hdr.datatype);
 	}
 
@@ -277,7 +430,7 @@ static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 
 static int smr_progress_inject_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 			       size_t ioc_count, size_t *len,
-			       struct smr_ep *ep, int err)
+			       struct smr_ep *ep, int err, int local)
 {
 	struct smr_inject_buf *tx_buf;
 	size_t inj_offset;
@@ -304,7 +457,7 @@ static int smr_progress_inject_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 	for (i = *len = 0; i < ioc_count && *len < cmd->msg.hdr.size; i++) {
 		smr_do_atomic(&src[*len], ioc[i].addr, comp ? &comp[*len] : NULL,
 			      cmd->msg.hdr.datatype, cmd->msg.hdr.atomic_op,
-			      ioc[i].count, cmd->msg.hdr.op_flags);
+			      ioc[i].count, cmd->msg.hdr.op_flags, local);
 		*len += ioc[i].count * ofi_datatype_size(cmd->msg.hdr.datatype);
 	}
 
@@ -316,11 +469,37 @@ static int smr_progress_inject_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 
 out:
 	if (!(cmd->msg.hdr.op_flags & SMR_RMA_REQ))
-		smr_freestack_push(smr_inject_pool(ep->region), tx_buf);
+		smr_return_inject(ep, tx_buf);
 
 	return err;
 }
 
+static int smr_progress_posted(struct smr_ep *ep, struct smr_cmd *cmd)
+{
+	struct smr_ep_entry *entry = ep->posted_entry;
+	int ret;
+
+	assert(entry);
+	ep->posted_entry = NULL;
+	ofi_atomic_set32(&ep->region->posted.state, SMR_POSTED_IDLE);
+
+	ofi_ep_stats_rx(&ep->util_ep, cmd->msg.hdr.size);
+	ret = smr_complete_rx(ep, entry->context, cmd->msg.hdr.op,
+			      cmd->msg.hdr.op_flags | entry->flags,
+			      cmd->msg.hdr.size, entry->iov[0].iov_base,
+			      &cmd->msg.hdr.addr, cmd->msg.hdr.tag,
+			      cmd->msg.hdr.data, 0);
+	if (ret) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unable to process rx completion\n");
+	}
+	smr_batch_discard(ep);
+	ep->cmd_ret_cnt++;
+	freestack_push(ep->recv_fs, entry);
+
+	return ret;
+}
+
 static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 {
 	struct smr_queue *recv_queue;
@@ -338,6 +517,9 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 		return -FI_ENOSPC;
 	}
 
+	if (cmd->msg.hdr.op_src == smr_src_posted)
+		return smr_progress_posted(ep, cmd);
+
 	recv_queue = (cmd->msg.hdr.op == ofi_op_tagged) ?
 		      &ep->trecv_queue : &ep->recv_queue;
 
@@ -358,8 +540,9 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 			return -FI_EAGAIN;
 		unexp = freestack_pop(ep->unexp_fs);
 		memcpy(&unexp->cmd, cmd, sizeof(*cmd));
-		ofi_cirque_discard(smr_cmd_queue(ep->region));
+		smr_batch_discard(ep);
 		dlist_insert_tail(&unexp->entry, &ep->unexp_queue.list);
+		ofi_ep_stats_unexp(&ep->util_ep);
 		return ret;
 	}
 	entry = container_of(dlist_entry, struct smr_ep_entry, entry);
@@ -382,6 +565,7 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 			"unidentified operation type\n");
 		err = -FI_EINVAL;
 	}
+	ofi_ep_stats_rx(&ep->util_ep, total_len);
 	ret = smr_complete_rx(ep, entry->context, cmd->msg.hdr.op,
 			  cmd->msg.hdr.op_flags | (entry->flags & ~SMR_MULTI_RECV),
 			  total_len, entry->iov[0].iov_base, &addr, cmd->msg.hdr.tag,
@@ -390,8 +574,8 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 			"unable to process rx completion\n");
 	}
-	ofi_cirque_discard(smr_cmd_queue(ep->region));
-	ep->region->cmd_cnt++;
+	smr_batch_discard(ep);
+	ep->cmd_ret_cnt++;
 
 	if (entry->flags & SMR_MULTI_RECV) {
 		ret = smr_progress_multi_recv(ep, recv_queue, entry, total_len);
@@ -422,9 +606,9 @@ static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd)
 		return -FI_ENOSPC;
 	}
 
-	ofi_cirque_discard(smr_cmd_queue(ep->region));
-	ep->region->cmd_cnt++;
-	rma_cmd = ofi_cirque_head(smr_cmd_queue(ep->region));
+	smr_batch_discard(ep);
+	ep->cmd_ret_cnt++;
+	rma_cmd = smr_batch_head(ep);
 
 	for (iov_count = 0; iov_count < rma_cmd->rma.rma_count; iov_count++) {
 		ret = ofi_mr_verify(&domain->util_domain.mr_map,
@@ -438,8 +622,8 @@ static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd)
 		iov[iov_count].iov_base = (void *) rma_cmd->rma.rma_iov[iov_count].addr;
 		iov[iov_count].iov_len = rma_cmd->rma.rma_iov[iov_count].len;
 	}
-	ofi_cirque_discard(smr_cmd_queue(ep->region));
-	ep->region->cmd_cnt++;
+	smr_batch_discard(ep);
+	ep->cmd_ret_cnt++;
 	if (ret)
 		return ret;
 
@@ -479,14 +663,15 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd)
 	struct fi_ioc ioc[SMR_IOV_LIMIT];
 	size_t ioc_count;
 	size_t total_len = 0;
-	int err, ret = 0;
+	int err, ret = 0, local;
 
 	domain = container_of(ep->util_ep.domain, struct smr_domain,
 			      util_domain);
+	local = ofi_atomic_local(domain->util_domain.threading);
 
-	ofi_cirque_discard(smr_cmd_queue(ep->region));
-	ep->region->cmd_cnt++;
-	rma_cmd = ofi_cirque_head(smr_cmd_queue(ep->region));
+	smr_batch_discard(ep);
+	ep->cmd_ret_cnt++;
+	rma_cmd = smr_batch_head(ep);
 
 	for (ioc_count = 0; ioc_count < rma_cmd->rma.rma_count; ioc_count++) {
 		ret = ofi_mr_verify(&domain->util_domain.mr_map,
@@ -502,18 +687,20 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd)
 		ioc[ioc_count].addr = (void *) rma_cmd->rma.rma_ioc[ioc_count].addr;
 		ioc[ioc_count].count = rma_cmd->rma.rma_ioc[ioc_count].count;
 	}
-	ofi_cirque_discard(smr_cmd_queue(ep->region));
+	smr_batch_discard(ep);
 	if (ret) {
-		ep->region->cmd_cnt++;
+		ep->cmd_ret_cnt++;
 		return ret;
 	}
 
 	switch (cmd->msg.hdr.op_src) {
 	case smr_src_inline:
-		err = smr_progress_inline_atomic(cmd, ioc, ioc_count, &total_len);
+		err = smr_progress_inline_atomic(cmd, ioc, ioc_count, &total_len,
+						 local);
 		break;
 	case smr_src_inject:
-		err = smr_progress_inject_atomic(cmd, ioc, ioc_count, &total_len, ep, ret);
+		err = smr_progress_inject_atomic(cmd, ioc, ioc_count, &total_len,
+						 ep, ret, local);
 		break;
 	default:
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
@@ -521,12 +708,13 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd)
 		err = -FI_EINVAL;
 	}
 	if (!(cmd->msg.hdr.op_flags & SMR_RMA_REQ)) {
-		ep->region->cmd_cnt++;
+		ep->cmd_ret_cnt++;
 	} else {
 		peer_smr = smr_peer_region(ep->region, cmd->msg.hdr.addr);
 		resp = (struct smr_resp *) ((char **) peer_smr +
 			    (size_t) cmd->msg.hdr.data);
 		resp->status = -err;
+		smr_resp_signal(ep, cmd->msg.hdr.addr);
 	}
 	if (err)
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
@@ -544,13 +732,16 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd)
 static void smr_progress_cmd(struct smr_ep *ep)
 {
 	struct smr_cmd *cmd;
-	int ret = 0;
+	int ret = 0, ret_cnt;
 
 	fastlock_acquire(&ep->region->lock);
 	fastlock_acquire(&ep->util_ep.rx_cq->cq_lock);
+	smr_return_cmds(ep);
+	smr_fetch_cmds(ep);
+	fastlock_release(&ep->region->lock);
 
-	while (!ofi_cirque_isempty(smr_cmd_queue(ep->region))) {
-		cmd = ofi_cirque_head(smr_cmd_queue(ep->region));
+	while (ep->cmd_batch_head < ep->cmd_batch_cnt) {
+		cmd = smr_batch_head(ep);
 
 		switch (cmd->msg.hdr.op) {
 		case ofi_op_msg:
@@ -564,8 +755,8 @@ static void smr_progress_cmd(struct smr_ep *ep)
 		case ofi_op_write_rsp:
 		case ofi_op_read_rsp:
 			smr_cntr_report_rx_comp(ep, cmd->msg.hdr.op);
-			ofi_cirque_discard(smr_cmd_queue(ep->region));
-			ep->region->cmd_cnt++;
+			smr_batch_discard(ep);
+			ep->cmd_ret_cnt++;
 			break;
 		case ofi_op_atomic:
 		case ofi_op_atomic_fetch:
@@ -582,12 +773,18 @@ static void smr_progress_cmd(struct smr_ep *ep)
 			if (ret != -FI_EAGAIN) {
 				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 					"error processing command\n");
+			} else {
+				ofi_ep_stats_retry(&ep->util_ep);
 			}
 			break;
 		}
 	}
+	smr_publish_recv(ep);
+	ret_cnt = ep->cmd_ret_cnt;
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
-	fastlock_release(&ep->region->lock);
+
+	if (ret_cnt)
+		smr_progress_return(ep);
 }
 
 void smr_ep_progress(struct util_ep *util_ep)
@@ -647,6 +844,7 @@ int smr_progress_unexp(struct smr_ep *ep, struct smr_ep_entry *entry)
 		entry->err = FI_EINVAL;
 	}
 
+	ofi_ep_stats_rx(&ep->util_ep, total_len);
 	ret = smr_complete_rx(ep, entry->context, unexp_msg->cmd.msg.hdr.op,
 			  unexp_msg->cmd.msg.hdr.op_flags | entry->flags,
 			  total_len, entry->iov[0].iov_base, &entry->addr, entry->tag,
@@ -656,7 +854,7 @@ int smr_progress_unexp(struct smr_ep *ep, struct smr_ep_entry *entry)
 			"unable to process rx completion\n");
 	}
 
-	ep->region->cmd_cnt++;
+	ep->cmd_ret_cnt++;
 	freestack_push(ep->unexp_fs, unexp_msg);
 
 	if (entry->flags & SMR_MULTI_RECV) {
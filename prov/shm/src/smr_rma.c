@@ -153,8 +153,8 @@ ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 	if (total_len <= SMR_MSG_DATA_LEN && op == ofi_op_write) {
 		smr_format_inline(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  iov, iov_count, op, 0, data, op_flags);
-	} else if (total_len <= SMR_INJECT_SIZE && op == ofi_op_write) {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+	} else if (total_len <= peer_smr->inject_size && op == ofi_op_write) {
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  iov, iov_count, op, 0, data, op_flags,
 				  peer_smr, tx_buf);
@@ -181,6 +181,7 @@ ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 commit_comp:
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
 	peer_smr->cmd_cnt--;
+	smr_cmd_signal(ep, peer_id);
 
 	if (!comp)
 		goto unlock_cq;
@@ -314,10 +315,10 @@ ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	struct smr_cmd *cmd;
 	struct iovec iov;
 	struct fi_rma_iov rma_iov;
-	int peer_id, cmds;
+	int peer_id, cmds, bounce = 0;
 	ssize_t ret = 0;
 
-	assert(len <= SMR_INJECT_SIZE);
+	assert(len <= SMR_MAX_INJECT_SIZE);
 	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
 	domain = container_of(ep->util_ep.domain, struct smr_domain, util_domain);
 
@@ -354,8 +355,15 @@ ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	if (len <= SMR_MSG_DATA_LEN) {
 		smr_format_inline(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  &iov, 1, ofi_op_write, 0, data, flags);
+	} else if (len > peer_smr->inject_size) {
+		/* the counter is updated when the peer responds */
+		ret = smr_inject_bounce(ep, cmd, peer_id, &iov, ofi_op_write,
+					0, data, flags);
+		if (ret)
+			goto unlock_region;
+		bounce = 1;
 	} else {
-		tx_buf = smr_freestack_pop(smr_inject_pool(peer_smr));
+		tx_buf = smr_inject_pool_pop(smr_inject_pool(peer_smr));
 		smr_format_inject(cmd, smr_peer_addr(ep->region)[peer_id].addr,
 				  &iov, 1, ofi_op_write, 0, data,
 				  flags, peer_smr, tx_buf);
@@ -369,7 +377,9 @@ ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 commit:
 	ofi_cirque_commit(smr_cmd_queue(peer_smr));
 	peer_smr->cmd_cnt--;
-	smr_cntr_report_tx_comp(ep, ofi_op_write);
+	smr_cmd_signal(ep, peer_id);
+	if (!bounce)
+		smr_cntr_report_tx_comp(ep, ofi_op_write);
 unlock_region:
 	fastlock_release(&peer_smr->lock);
 	return ret;
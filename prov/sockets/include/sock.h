@@ -87,8 +87,14 @@
 #define SOCK_DOMAIN_MR_CNT (65535)
 
 #define SOCK_PE_POLL_TIMEOUT (100000)
-#define SOCK_PE_MAX_ENTRIES (128)
+/* The PE table grows in chunks of SOCK_PE_MIN_ENTRIES up to the
+ * FI_SOCKETS_PE_MAX_ENTRIES limit.  Entries are addressed by the 16-bit
+ * pe_entry_id of the message header. */
+#define SOCK_PE_MIN_ENTRIES (128)
+#define SOCK_PE_DEF_MAX_ENTRIES (4096)
+#define SOCK_PE_MAX_ENTRIES (UINT16_MAX + 1)
 #define SOCK_PE_WAITTIME (10)
+#define SOCK_RX_HASH_SIZE (256)
 
 #define SOCK_EQ_DEF_SZ (1<<8)
 #define SOCK_CQ_DEF_SZ (1<<8)
@@ -630,10 +636,13 @@ struct sock_rx_entry {
 	uint64_t data;
 	uint64_t tag;
 	uint64_t ignore;
+	uint64_t seq;
 	struct sock_comp *comp;
 
 	union sock_iov iov[SOCK_EP_MAX_IOV_LIMIT];
 	struct dlist_entry entry;
+	/* links the entry on its tag hash bucket or match list */
+	struct dlist_entry match_entry;
 	struct slist_entry pool_entry;
 	struct sock_rx_ctx *rx_ctx;
 };
@@ -669,6 +678,20 @@ struct sock_rx_ctx {
 	struct dlist_entry ep_list;
 	fastlock_t lock;
 
+	/*
+	 * Posted receives are kept on rx_entry_list in posting order and on
+	 * one match list: untagged receives, tagged receives with ignore
+	 * bits, or a hash bucket for exact tags.  seq orders entries across
+	 * match lists.  Tagged buffered entries are hashed the same way.
+	 */
+	struct dlist_entry rx_msg_list;
+	struct dlist_entry rx_tag_list;
+	struct dlist_entry rx_tag_hash[SOCK_RX_HASH_SIZE];
+	struct dlist_entry rx_buffered_hash[SOCK_RX_HASH_SIZE];
+	uint64_t rx_seq;
+	/* set when a buffered entry may have become matchable */
+	int match_pending;
+
 	struct fi_rx_attr attr;
 	struct sock_rx_entry *rx_entry_pool;
 	struct slist pool_list;
@@ -681,6 +704,8 @@ struct sock_tx_ctx {
 	} fid;
 	size_t fclass;
 
+	/* Posted operations, consumed by the PE without taking rb_lock.
+	 * rb_lock only serializes the posting threads. */
 	struct ofi_ringbuf rb;
 	fastlock_t rb_lock;
 
@@ -837,7 +862,8 @@ struct sock_pe_entry {
 	uint8_t mr_checked;
 	uint8_t is_pool_entry;
 	uint8_t completion_reported;
-	uint8_t reserved[3];
+	uint8_t reserved[2];
+	uint16_t id;
 
 	uint64_t done_len;
 	uint64_t total_len;
@@ -857,7 +883,8 @@ struct sock_pe_entry {
 struct sock_pe {
 	struct sock_domain *domain;
 	int num_free_entries;
-	struct sock_pe_entry pe_table[SOCK_PE_MAX_ENTRIES];
+	size_t num_entries;
+	struct sock_pe_entry *pe_table[SOCK_PE_MAX_ENTRIES / SOCK_PE_MIN_ENTRIES];
 	fastlock_t lock;
 	fastlock_t signal_lock;
 	pthread_mutex_t list_lock;
@@ -876,6 +903,8 @@ struct sock_pe {
 
 	pthread_t progress_thread;
 	volatile int do_progress;
+	/* Set while the progress thread may block waiting for events */
+	volatile int waiting;
 	struct sock_pe_entry *pe_atomic;
 	fi_epoll_t epoll_set;
 };
@@ -1132,11 +1161,43 @@ void sock_tx_ctx_write_op_tsend(struct sock_tx_ctx *tx_ctx,
 		struct sock_op *op, uint64_t flags, uint64_t context,
 		uint64_t dest_addr, uint64_t buf, struct sock_ep_attr *ep_attr,
 		struct sock_conn *conn, uint64_t tag);
-void sock_tx_ctx_read_op_send(struct sock_tx_ctx *tx_ctx,
+void sock_tx_ctx_read_op_send(struct sock_tx_ctx *tx_ctx, size_t *rcnt,
 		struct sock_op *op, uint64_t *flags, uint64_t *context,
 		uint64_t *dest_addr, uint64_t *buf, struct sock_ep_attr **ep_attr,
 		struct sock_conn **conn);
 
+/* Pairs with the barrier in sock_tx_ctx_commit() */
+static inline size_t sock_tx_ctx_wcnt(struct sock_tx_ctx *tx_ctx)
+{
+#ifdef ofi_atomic_load_acquire
+	return (size_t) ofi_atomic_load_acquire(64, &tx_ctx->rb.wcnt);
+#else
+	size_t wcnt = *(volatile size_t *) &tx_ctx->rb.wcnt;
+
+	ofi_mb();
+	return wcnt;
+#endif
+}
+
+/* The PE reads the tx ring without rb_lock, from its own read position.
+ * Posting threads reuse the space behind rb.rcnt, so rb.rcnt is only
+ * advanced once the whole operation was read. */
+static inline void sock_tx_ctx_read(struct sock_tx_ctx *tx_ctx, size_t *rcnt,
+				    void *buf, size_t len)
+{
+	struct ofi_ringbuf *rb = &tx_ctx->rb;
+	size_t endlen;
+
+	endlen = rb->size - (*rcnt & rb->size_mask);
+	if (len <= endlen) {
+		memcpy(buf, (char *) rb->buf + (*rcnt & rb->size_mask), len);
+	} else {
+		memcpy(buf, (char *) rb->buf + (*rcnt & rb->size_mask), endlen);
+		memcpy((char *) buf + endlen, rb->buf, len - endlen);
+	}
+	*rcnt += len;
+}
+
 int sock_poll_open(struct fid_domain *domain, struct fi_poll_attr *attr,
 		   struct fid_poll **pollset);
 int sock_wait_open(struct fid_fabric *fabric, struct fi_wait_attr *attr,
@@ -1173,6 +1234,7 @@ struct sock_pe *sock_pe_init(struct sock_domain *domain);
 void sock_pe_add_tx_ctx(struct sock_pe *pe, struct sock_tx_ctx *ctx);
 void sock_pe_add_rx_ctx(struct sock_pe *pe, struct sock_rx_ctx *ctx);
 void sock_pe_signal(struct sock_pe *pe);
+void sock_pe_wakeup(struct sock_pe *pe);
 void sock_pe_poll_add(struct sock_pe *pe, int fd);
 void sock_pe_poll_del(struct sock_pe *pe, int fd);
 
@@ -1187,7 +1249,12 @@ void sock_pe_finalize(struct sock_pe *pe);
 
 struct sock_rx_entry *sock_rx_new_entry(struct sock_rx_ctx *rx_ctx);
 struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
-						 size_t len);
+						 size_t len, uint64_t tag,
+						 uint8_t is_tagged);
+void sock_rx_init_lists(struct sock_rx_ctx *rx_ctx);
+void sock_rx_add_entry(struct sock_rx_ctx *rx_ctx,
+		       struct sock_rx_entry *rx_entry);
+void sock_rx_remove_entry(struct sock_rx_entry *rx_entry);
 struct sock_rx_entry *sock_rx_get_entry(struct sock_rx_ctx *rx_ctx,
 					uint64_t addr, uint64_t tag,
 					uint8_t is_tagged);
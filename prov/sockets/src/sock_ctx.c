@@ -53,8 +53,7 @@ struct sock_rx_ctx *sock_rx_ctx_alloc(const struct fi_rx_attr *attr,
 	dlist_init(&rx_ctx->pe_entry);
 
 	dlist_init(&rx_ctx->pe_entry_list);
-	dlist_init(&rx_ctx->rx_entry_list);
-	dlist_init(&rx_ctx->rx_buffered_list);
+	sock_rx_init_lists(rx_ctx);
 	dlist_init(&rx_ctx->ep_list);
 
 	fastlock_init(&rx_ctx->lock);
@@ -167,9 +166,12 @@ void sock_tx_ctx_write(struct sock_tx_ctx *tx_ctx, const void *buf, size_t len)
 
 void sock_tx_ctx_commit(struct sock_tx_ctx *tx_ctx)
 {
+	/* The PE reads the ring without rb_lock: the operation must be
+	 * visible before the write count covering it. */
+	ofi_mb();
 	ofi_rbcommit(&tx_ctx->rb);
-	sock_pe_signal(tx_ctx->domain->pe);
 	fastlock_release(&tx_ctx->rb_lock);
+	sock_pe_wakeup(tx_ctx->domain->pe);
 }
 
 void sock_tx_ctx_abort(struct sock_tx_ctx *tx_ctx)
@@ -202,16 +204,16 @@ void sock_tx_ctx_write_op_tsend(struct sock_tx_ctx *tx_ctx,
 	sock_tx_ctx_write(tx_ctx, &tag, sizeof(tag));
 }
 
-void sock_tx_ctx_read_op_send(struct sock_tx_ctx *tx_ctx,
+void sock_tx_ctx_read_op_send(struct sock_tx_ctx *tx_ctx, size_t *rcnt,
 		struct sock_op *op, uint64_t *flags, uint64_t *context,
 		uint64_t *dest_addr, uint64_t *buf, struct sock_ep_attr **ep_attr,
 		struct sock_conn **conn)
 {
-	ofi_rbread(&tx_ctx->rb, op, sizeof(*op));
-	ofi_rbread(&tx_ctx->rb, flags, sizeof(*flags));
-	ofi_rbread(&tx_ctx->rb, context, sizeof(*context));
-	ofi_rbread(&tx_ctx->rb, dest_addr, sizeof(*dest_addr));
-	ofi_rbread(&tx_ctx->rb, buf, sizeof(*buf));
-	ofi_rbread(&tx_ctx->rb, ep_attr, sizeof(*ep_attr));
-	ofi_rbread(&tx_ctx->rb, conn, sizeof(*conn));
+	sock_tx_ctx_read(tx_ctx, rcnt, op, sizeof(*op));
+	sock_tx_ctx_read(tx_ctx, rcnt, flags, sizeof(*flags));
+	sock_tx_ctx_read(tx_ctx, rcnt, context, sizeof(*context));
+	sock_tx_ctx_read(tx_ctx, rcnt, dest_addr, sizeof(*dest_addr));
+	sock_tx_ctx_read(tx_ctx, rcnt, buf, sizeof(*buf));
+	sock_tx_ctx_read(tx_ctx, rcnt, ep_attr, sizeof(*ep_attr));
+	sock_tx_ctx_read(tx_ctx, rcnt, conn, sizeof(*conn));
 }
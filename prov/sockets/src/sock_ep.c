@@ -505,7 +505,7 @@ static ssize_t sock_rx_ctx_cancel(struct sock_rx_ctx *rx_ctx, void *context)
 			if (rx_ctx->comp.recv_cntr)
 				fi_cntr_adderr(&rx_ctx->comp.recv_cntr->cntr_fid, 1);
 
-			dlist_remove(&rx_entry->entry);
+			sock_rx_remove_entry(rx_entry);
 			sock_rx_release_entry(rx_entry);
 			ret = 0;
 			break;
@@ -63,7 +63,12 @@
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
 
-#define PE_INDEX(_pe, _e) (_e - &_pe->pe_table[0])
+static inline struct sock_pe_entry *
+sock_pe_get_entry(struct sock_pe *pe, uint16_t id)
+{
+	assert(id < pe->num_entries);
+	return &pe->pe_table[id / SOCK_PE_MIN_ENTRIES][id % SOCK_PE_MIN_ENTRIES];
+}
 #define SOCK_GET_RX_ID(_addr, _bits) (((_bits) == 0) ? 0 : \
 		(((uint64_t)_addr) >> (64 - _bits)))
 
@@ -199,6 +204,59 @@ static void sock_pe_release_entry(struct sock_pe *pe,
 	SOCK_LOG_DBG("progress entry %p released\n", pe_entry);
 }
 
+/* Adds a chunk of entries to the PE table.  Entries never move, since
+ * they are linked on lists and referenced by pointer. */
+static int sock_pe_grow_table(struct sock_pe *pe)
+{
+	struct sock_pe_entry *chunk;
+	size_t max_entries;
+	int i;
+
+	max_entries = MIN(MAX(sock_pe_max_entries, SOCK_PE_MIN_ENTRIES),
+			  SOCK_PE_MAX_ENTRIES);
+	if (pe->num_entries + SOCK_PE_MIN_ENTRIES > max_entries)
+		return -FI_ENOSPC;
+
+	chunk = calloc(SOCK_PE_MIN_ENTRIES, sizeof(*chunk));
+	if (!chunk)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < SOCK_PE_MIN_ENTRIES; i++) {
+		chunk[i].id = (uint16_t) (pe->num_entries + i);
+		chunk[i].cache_sz = SOCK_PE_COMM_BUFF_SZ;
+		if (ofi_rbinit(&chunk[i].comm_buf, SOCK_PE_COMM_BUFF_SZ))
+			goto err;
+	}
+
+	for (i = 0; i < SOCK_PE_MIN_ENTRIES; i++)
+		dlist_insert_tail(&chunk[i].entry, &pe->free_list);
+
+	pe->pe_table[pe->num_entries / SOCK_PE_MIN_ENTRIES] = chunk;
+	pe->num_entries += SOCK_PE_MIN_ENTRIES;
+	pe->num_free_entries += SOCK_PE_MIN_ENTRIES;
+	SOCK_LOG_DBG("PE table grown to %zu entries\n", pe->num_entries);
+	return 0;
+
+err:
+	SOCK_LOG_ERROR("failed to init comm-cache\n");
+	while (i--)
+		ofi_rbfree(&chunk[i].comm_buf);
+	free(chunk);
+	return -FI_ENOMEM;
+}
+
+static void sock_pe_free_table(struct sock_pe *pe)
+{
+	size_t i, j;
+
+	for (i = 0; i < pe->num_entries / SOCK_PE_MIN_ENTRIES; i++) {
+		for (j = 0; j < SOCK_PE_MIN_ENTRIES; j++)
+			ofi_rbfree(&pe->pe_table[i][j].comm_buf);
+		free(pe->pe_table[i]);
+	}
+	pe->num_entries = 0;
+}
+
 static struct sock_pe_entry *sock_pe_acquire_entry(struct sock_pe *pe)
 {
 	struct dlist_entry *entry;
@@ -223,8 +281,8 @@ static struct sock_pe_entry *sock_pe_acquire_entry(struct sock_pe *pe)
 		assert(ofi_rbempty(&pe_entry->comm_buf));
 		dlist_remove(&pe_entry->entry);
 		dlist_insert_tail(&pe_entry->entry, &pe->busy_list);
-		SOCK_LOG_DBG("progress entry %p acquired : %lu\n", pe_entry,
-			     PE_INDEX(pe, pe_entry));
+		SOCK_LOG_DBG("progress entry %p acquired : %d\n", pe_entry,
+			     pe_entry->id);
 	}
 	return pe_entry;
 }
@@ -577,8 +635,7 @@ static int sock_pe_handle_ack(struct sock_pe *pe,
 		return 0;
 
 	response = &pe_entry->response;
-	assert(response->pe_entry_id <= SOCK_PE_MAX_ENTRIES);
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
+	waiting_entry = sock_pe_get_entry(pe, response->pe_entry_id);
 	SOCK_LOG_DBG("Received ack for PE entry %p (index: %d)\n",
 		      waiting_entry, response->pe_entry_id);
 
@@ -599,8 +656,7 @@ static int sock_pe_handle_error(struct sock_pe *pe,
 		return 0;
 
 	response = &pe_entry->response;
-	assert(response->pe_entry_id <= SOCK_PE_MAX_ENTRIES);
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
+	waiting_entry = sock_pe_get_entry(pe, response->pe_entry_id);
 	SOCK_LOG_ERROR("Received error for PE entry %p (index: %d)\n",
 		      waiting_entry, response->pe_entry_id);
 
@@ -635,12 +691,10 @@ static int sock_pe_handle_read_complete(struct sock_pe *pe,
 		return 0;
 
 	response = &pe_entry->response;
-	assert(response->pe_entry_id <= SOCK_PE_MAX_ENTRIES);
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
+	waiting_entry = sock_pe_get_entry(pe, response->pe_entry_id);
 	SOCK_LOG_DBG("Received read complete for PE entry %p (index: %d)\n",
 		      waiting_entry, response->pe_entry_id);
 
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
 	assert(waiting_entry->type == SOCK_PE_TX);
 
 	len = sizeof(struct sock_msg_response);
@@ -669,8 +723,7 @@ static int sock_pe_handle_write_complete(struct sock_pe *pe,
 		return 0;
 
 	response = &pe_entry->response;
-	assert(response->pe_entry_id <= SOCK_PE_MAX_ENTRIES);
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
+	waiting_entry = sock_pe_get_entry(pe, response->pe_entry_id);
 	SOCK_LOG_DBG("Received ack for PE entry %p (index: %d)\n",
 		      waiting_entry, response->pe_entry_id);
 
@@ -693,12 +746,10 @@ static int sock_pe_handle_atomic_complete(struct sock_pe *pe,
 		return 0;
 
 	response = &pe_entry->response;
-	assert(response->pe_entry_id <= SOCK_PE_MAX_ENTRIES);
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
+	waiting_entry = sock_pe_get_entry(pe, response->pe_entry_id);
 	SOCK_LOG_DBG("Received atomic complete for PE entry %p (index: %d)\n",
 		      waiting_entry, response->pe_entry_id);
 
-	waiting_entry = &pe->pe_table[response->pe_entry_id];
 	assert(waiting_entry->type == SOCK_PE_TX);
 
 	len = sizeof(struct sock_msg_response);
@@ -1036,7 +1087,8 @@ sock_pe_process_rx_tatomic(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	pe_entry->data_len = entry_len;
 
 	fastlock_acquire(&rx_ctx->lock);
-	rx_entry = sock_rx_new_buffered_entry(rx_ctx, entry_len);
+	rx_entry = sock_rx_new_buffered_entry(rx_ctx, entry_len,
+					      pe_entry->tag, 1);
 	if (!rx_entry) {
 		fastlock_release(&rx_ctx->lock);
 		return -FI_ENOMEM;
@@ -1055,10 +1107,10 @@ sock_pe_process_rx_tatomic(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	if (pe_entry->msg_hdr.flags & FI_REMOTE_CQ_DATA)
 		rx_entry->flags |= FI_REMOTE_CQ_DATA;
 	rx_entry->flags |= FI_TAGGED | FI_ATOMIC;
-	rx_entry->is_tagged = 1;
 
 	pe_entry->pe.rx.rx_entry = rx_entry;
 
+	rx_ctx->match_pending = 1;
 	sock_pe_progress_buffered_rx(rx_ctx);
 	fastlock_release(&rx_ctx->lock);
 
@@ -1098,7 +1150,7 @@ ssize_t sock_rx_peek_recv(struct sock_rx_ctx *rx_ctx, fi_addr_t addr,
 			rx_buffered->is_claimed = 1;
 
 		if (flags & FI_DISCARD) {
-			dlist_remove(&rx_buffered->entry);
+			sock_rx_remove_entry(rx_buffered);
 			sock_rx_release_entry(rx_buffered);
 		}
 		sock_pe_report_recv_completion(&pe_entry);
@@ -1167,7 +1219,7 @@ ssize_t sock_rx_claim_recv(struct sock_rx_ctx *rx_ctx, void *context,
 			sock_pe_report_recv_completion(&pe_entry);
 		}
 
-		dlist_remove(&rx_buffered->entry);
+		sock_rx_remove_entry(rx_buffered);
 		sock_rx_release_entry(rx_buffered);
 	} else {
 		ret = -FI_ENOMSG;
@@ -1185,9 +1237,12 @@ static int sock_pe_progress_buffered_rx(struct sock_rx_ctx *rx_ctx)
 	size_t i, rem = 0, offset, len, used_len, dst_offset, datatype_sz;
 	char *src, *dst;
 
-	if (dlist_empty(&rx_ctx->rx_entry_list) ||
+	/* Matching is only retried after a receive is posted, a buffered
+	 * entry completes or a multi-recv buffer is released */
+	if (!rx_ctx->match_pending || dlist_empty(&rx_ctx->rx_entry_list) ||
 	    dlist_empty(&rx_ctx->rx_buffered_list))
 		return 0;
+	rx_ctx->match_pending = 0;
 
 	for (entry = rx_ctx->rx_buffered_list.next;
 	     entry != &rx_ctx->rx_buffered_list;) {
@@ -1267,10 +1322,10 @@ static int sock_pe_progress_buffered_rx(struct sock_rx_ctx *rx_ctx)
 		if (rx_posted->flags & FI_MULTI_RECV) {
 			if (sock_rx_avail_len(rx_posted) < rx_ctx->min_multi_recv) {
 				pe_entry.flags |= FI_MULTI_RECV;
-				dlist_remove(&rx_posted->entry);
+				sock_rx_remove_entry(rx_posted);
 			}
 		} else {
-			dlist_remove(&rx_posted->entry);
+			sock_rx_remove_entry(rx_posted);
 		}
 
 		if (rem) {
@@ -1285,7 +1340,7 @@ static int sock_pe_progress_buffered_rx(struct sock_rx_ctx *rx_ctx)
 		 * sock_rx_get_entry() */
 		rx_posted->is_busy = 0;
 
-		dlist_remove(&rx_buffered->entry);
+		sock_rx_remove_entry(rx_buffered);
 		sock_rx_release_entry(rx_buffered);
 
 		if ((!(rx_posted->flags & FI_MULTI_RECV) ||
@@ -1335,7 +1390,9 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 			SOCK_LOG_DBG("%p: No matching recv, buffering recv (len = %llu)\n",
 				      pe_entry, (long long unsigned int)data_len);
 
-			rx_entry = sock_rx_new_buffered_entry(rx_ctx, data_len);
+			rx_entry = sock_rx_new_buffered_entry(rx_ctx, data_len,
+					pe_entry->tag,
+					pe_entry->msg_hdr.op_type == SOCK_OP_TSEND);
 			if (!rx_entry) {
 				fastlock_release(&rx_ctx->lock);
 				return -FI_ENOMEM;
@@ -1349,9 +1406,6 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 
 			if (pe_entry->msg_hdr.flags & FI_REMOTE_CQ_DATA)
 				rx_entry->flags |= FI_REMOTE_CQ_DATA;
-
-			if (pe_entry->msg_hdr.op_type == SOCK_OP_TSEND)
-				rx_entry->is_tagged = 1;
 		}
 		fastlock_release(&rx_ctx->lock);
 		pe_entry->context = rx_entry->context;
@@ -1406,13 +1460,15 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 	if (rx_entry->flags & FI_MULTI_RECV) {
 		if (sock_rx_avail_len(rx_entry) < rx_ctx->min_multi_recv) {
 			pe_entry->flags |= FI_MULTI_RECV;
-			dlist_remove(&rx_entry->entry);
+			sock_rx_remove_entry(rx_entry);
 		}
 	} else {
 		if (!rx_entry->is_buffered)
-			dlist_remove(&rx_entry->entry);
+			sock_rx_remove_entry(rx_entry);
 	}
 	rx_entry->is_busy = 0;
+	if (rx_entry->is_buffered || (rx_entry->flags & FI_MULTI_RECV))
+		rx_ctx->match_pending = 1;
 	fastlock_release(&rx_ctx->lock);
 
 	/* report error, if any */
@@ -2076,8 +2132,8 @@ static void sock_pe_new_rx_entry(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	else
 		pe_entry->comp = &rx_ctx->comp;
 
-	SOCK_LOG_DBG("New RX on PE entry %p (%ld)\n",
-		      pe_entry, PE_INDEX(pe, pe_entry));
+	SOCK_LOG_DBG("New RX on PE entry %p (%d)\n",
+		      pe_entry, pe_entry->id);
 
 	SOCK_LOG_DBG("Inserting rx_entry to PE entry %p, conn: %p\n",
 		      pe_entry, pe_entry->conn);
@@ -2091,6 +2147,7 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 	struct sock_msg_hdr *msg_hdr;
 	struct sock_pe_entry *pe_entry;
 	struct sock_ep_attr *ep_attr;
+	size_t rcnt;
 
 	pe_entry = sock_pe_acquire_entry(pe);
 	memset(&pe_entry->pe.tx, 0, sizeof(pe_entry->pe.tx));
@@ -2110,16 +2167,19 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 	msg_hdr = &pe_entry->msg_hdr;
 	msg_hdr->msg_len = sizeof(*msg_hdr);
 
-	msg_hdr->pe_entry_id = PE_INDEX(pe, pe_entry);
+	msg_hdr->pe_entry_id = pe_entry->id;
 	SOCK_LOG_DBG("New TX on PE entry %p (%d)\n",
 		      pe_entry, msg_hdr->pe_entry_id);
 
-	sock_tx_ctx_read_op_send(tx_ctx, &pe_entry->pe.tx.tx_op,
+	/* rb.rcnt is only advanced once the operation was read */
+	rcnt = tx_ctx->rb.rcnt;
+	sock_tx_ctx_read_op_send(tx_ctx, &rcnt, &pe_entry->pe.tx.tx_op,
 			&pe_entry->flags, &pe_entry->context, &pe_entry->addr,
 			&pe_entry->buf, &ep_attr, &pe_entry->conn);
 
 	if (pe_entry->pe.tx.tx_op.op == SOCK_OP_TSEND) {
-		ofi_rbread(&tx_ctx->rb, &pe_entry->tag, sizeof(pe_entry->tag));
+		sock_tx_ctx_read(tx_ctx, &rcnt, &pe_entry->tag,
+				 sizeof(pe_entry->tag));
 		msg_hdr->msg_len += sizeof(pe_entry->tag);
 	}
 
@@ -2129,7 +2189,8 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 		pe_entry->comp = &tx_ctx->comp;
 
 	if (pe_entry->flags & FI_REMOTE_CQ_DATA) {
-		ofi_rbread(&tx_ctx->rb, &pe_entry->data, sizeof(pe_entry->data));
+		sock_tx_ctx_read(tx_ctx, &rcnt, &pe_entry->data,
+				 sizeof(pe_entry->data));
 		msg_hdr->msg_len += sizeof(pe_entry->data);
 	}
 
@@ -2138,13 +2199,15 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 	case SOCK_OP_SEND:
 	case SOCK_OP_TSEND:
 		if (pe_entry->flags & FI_INJECT) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.inject[0],
-				 pe_entry->pe.tx.tx_op.src_iov_len);
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.inject[0],
+					 pe_entry->pe.tx.tx_op.src_iov_len);
 			msg_hdr->msg_len += pe_entry->pe.tx.tx_op.src_iov_len;
 		} else {
 			for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-				ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].src,
-					 sizeof(pe_entry->pe.tx.tx_iov[i].src));
+				sock_tx_ctx_read(tx_ctx, &rcnt,
+						 &pe_entry->pe.tx.tx_iov[i].src,
+						 sizeof(pe_entry->pe.tx.tx_iov[i].src));
 				msg_hdr->msg_len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
 			}
 		}
@@ -2154,34 +2217,39 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 		break;
 	case SOCK_OP_WRITE:
 		if (pe_entry->flags & FI_INJECT) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.inject[0],
-				 pe_entry->pe.tx.tx_op.src_iov_len);
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.inject[0],
+					 pe_entry->pe.tx.tx_op.src_iov_len);
 			msg_hdr->msg_len += pe_entry->pe.tx.tx_op.src_iov_len;
 		} else {
 			for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-				ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].src,
-					 sizeof(pe_entry->pe.tx.tx_iov[i].src));
+				sock_tx_ctx_read(tx_ctx, &rcnt,
+						 &pe_entry->pe.tx.tx_iov[i].src,
+						 sizeof(pe_entry->pe.tx.tx_iov[i].src));
 				msg_hdr->msg_len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
 			}
 		}
 
 		for (i = 0; i < pe_entry->pe.tx.tx_op.dest_iov_len; i++) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].dst,
-				 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.tx_iov[i].dst,
+					 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
 		}
 		msg_hdr->msg_len += sizeof(union sock_iov) * i;
 		msg_hdr->dest_iov_len = pe_entry->pe.tx.tx_op.dest_iov_len;
 		break;
 	case SOCK_OP_READ:
 		for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].src,
-				 sizeof(pe_entry->pe.tx.tx_iov[i].src));
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.tx_iov[i].src,
+					 sizeof(pe_entry->pe.tx.tx_iov[i].src));
 		}
 		msg_hdr->msg_len += sizeof(union sock_iov) * i;
 
 		for (i = 0;  i < pe_entry->pe.tx.tx_op.dest_iov_len; i++) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].dst,
-				 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.tx_iov[i].dst,
+					 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
 		}
 		msg_hdr->dest_iov_len = pe_entry->pe.tx.tx_op.src_iov_len;
 		break;
@@ -2189,52 +2257,61 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 		msg_hdr->msg_len += sizeof(struct sock_op);
 		datatype_sz = ofi_datatype_size(pe_entry->pe.tx.tx_op.atomic.datatype);
 		if (pe_entry->flags & FI_INJECT) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.inject[0],
-				 pe_entry->pe.tx.tx_op.src_iov_len);
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.inject[0] +
-				pe_entry->pe.tx.tx_op.src_iov_len,
-				pe_entry->pe.tx.tx_op.atomic.cmp_iov_len);
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.inject[0],
+					 pe_entry->pe.tx.tx_op.src_iov_len);
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.inject[0] +
+					 pe_entry->pe.tx.tx_op.src_iov_len,
+					 pe_entry->pe.tx.tx_op.atomic.cmp_iov_len);
 			msg_hdr->msg_len += pe_entry->pe.tx.tx_op.src_iov_len +
 						pe_entry->pe.tx.tx_op.atomic.cmp_iov_len;
 		} else {
 			for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-				ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].src,
-					 sizeof(pe_entry->pe.tx.tx_iov[i].src));
+				sock_tx_ctx_read(tx_ctx, &rcnt,
+						 &pe_entry->pe.tx.tx_iov[i].src,
+						 sizeof(pe_entry->pe.tx.tx_iov[i].src));
 
 				if (pe_entry->pe.tx.tx_op.atomic.op != FI_ATOMIC_READ)
 					msg_hdr->msg_len += datatype_sz *
 						pe_entry->pe.tx.tx_iov[i].src.ioc.count;
 			}
 			for (i = 0; i < pe_entry->pe.tx.tx_op.atomic.cmp_iov_len; i++) {
-				ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].cmp,
-				 	sizeof(pe_entry->pe.tx.tx_iov[i].cmp));
+				sock_tx_ctx_read(tx_ctx, &rcnt,
+						 &pe_entry->pe.tx.tx_iov[i].cmp,
+						 sizeof(pe_entry->pe.tx.tx_iov[i].cmp));
 				msg_hdr->msg_len += datatype_sz *
 					pe_entry->pe.tx.tx_iov[i].cmp.ioc.count;
 			}
 		}
 
 		for (i = 0; i < pe_entry->pe.tx.tx_op.dest_iov_len; i++) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].dst,
-				 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.tx_iov[i].dst,
+					 sizeof(pe_entry->pe.tx.tx_iov[i].dst));
 		}
 		msg_hdr->msg_len += sizeof(union sock_iov) * i;
 
 		for (i = 0; i < pe_entry->pe.tx.tx_op.atomic.res_iov_len; i++) {
-			ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.tx_iov[i].res,
-				 sizeof(pe_entry->pe.tx.tx_iov[i].res));
+			sock_tx_ctx_read(tx_ctx, &rcnt,
+					 &pe_entry->pe.tx.tx_iov[i].res,
+					 sizeof(pe_entry->pe.tx.tx_iov[i].res));
 		}
 
 		msg_hdr->dest_iov_len = pe_entry->pe.tx.tx_op.dest_iov_len;
 		break;
 	case SOCK_OP_CONN_MSG:
-		ofi_rbread(&tx_ctx->rb, &pe_entry->pe.tx.inject[0],
-			pe_entry->pe.tx.tx_op.src_iov_len);
+		sock_tx_ctx_read(tx_ctx, &rcnt, &pe_entry->pe.tx.inject[0],
+				 pe_entry->pe.tx.tx_op.src_iov_len);
 		msg_hdr->msg_len += pe_entry->pe.tx.tx_op.src_iov_len;
 		break;
 	default:
 		SOCK_LOG_ERROR("Invalid operation type\n");
 		return -FI_EINVAL;
 	}
+	ofi_mb();
+	tx_ctx->rb.rcnt = rcnt;
+
 	SOCK_LOG_DBG("Inserting TX-entry to PE entry %p, conn: %p\n",
 		      pe_entry, pe_entry->conn);
 
@@ -2258,6 +2335,15 @@ static int sock_pe_new_tx_entry(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 	return sock_pe_progress_tx_entry(pe, tx_ctx, pe_entry);
 }
 
+/* Posting threads only signal the progress thread if it may be blocked.
+ * Paired with the check in sock_pe_progress_thread(). */
+void sock_pe_wakeup(struct sock_pe *pe)
+{
+	ofi_mb();
+	if (pe->waiting)
+		sock_pe_signal(pe);
+}
+
 void sock_pe_signal(struct sock_pe *pe)
 {
 	char c = 0;
@@ -2516,13 +2602,16 @@ int sock_pe_progress_tx_ctx(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 		}
 	}
 
-	fastlock_acquire(&tx_ctx->rb_lock);
-	if (!ofi_rbempty(&tx_ctx->rb) && !dlist_empty(&pe->free_list)) {
+	/* Start all posted operations, growing the PE table as needed.
+	 * The ring has a single reader, serialized by the PE lock. */
+	while (sock_tx_ctx_wcnt(tx_ctx) != tx_ctx->rb.rcnt) {
+		if (dlist_empty(&pe->free_list) && sock_pe_grow_table(pe))
+			break;
+
 		ret = sock_pe_new_tx_entry(pe, tx_ctx);
+		if (ret < 0)
+			goto out;
 	}
-	fastlock_release(&tx_ctx->rb_lock);
-	if (ret < 0)
-		goto out;
 
 	sock_pe_progress_rx_ctrl_ctx(pe, tx_ctx->rx_ctrl_ctx, tx_ctx);
 out:
@@ -2619,9 +2708,16 @@ static void *sock_pe_progress_thread(void *data)
 		pthread_mutex_lock(&pe->list_lock);
 		if (pe->domain->progress_mode == FI_PROGRESS_AUTO &&
 		    sock_pe_wait_ok(pe)) {
-			pthread_mutex_unlock(&pe->list_lock);
-			sock_pe_wait(pe);
-			pthread_mutex_lock(&pe->list_lock);
+			/* Recheck after announcing the wait, so an operation
+			 * posted concurrently either is seen here or signals */
+			pe->waiting = 1;
+			ofi_mb();
+			if (sock_pe_wait_ok(pe)) {
+				pthread_mutex_unlock(&pe->list_lock);
+				sock_pe_wait(pe);
+				pthread_mutex_lock(&pe->list_lock);
+			}
+			pe->waiting = 0;
 		}
 
 		if (!dlist_empty(&pe->tx_list)) {
@@ -2658,26 +2754,24 @@ static void *sock_pe_progress_thread(void *data)
 	return NULL;
 }
 
-static void sock_pe_init_table(struct sock_pe *pe)
+static int sock_pe_init_table(struct sock_pe *pe)
 {
-	int i;
-
-	memset(&pe->pe_table, 0,
-	       sizeof(struct sock_pe_entry) * SOCK_PE_MAX_ENTRIES);
+	int ret;
 
 	dlist_init(&pe->free_list);
 	dlist_init(&pe->busy_list);
 	dlist_init(&pe->pool_list);
 
-	for (i = 0; i < SOCK_PE_MAX_ENTRIES; i++) {
-		dlist_insert_head(&pe->pe_table[i].entry, &pe->free_list);
-		pe->pe_table[i].cache_sz = SOCK_PE_COMM_BUFF_SZ;
-		if (ofi_rbinit(&pe->pe_table[i].comm_buf, SOCK_PE_COMM_BUFF_SZ))
-			SOCK_LOG_ERROR("failed to init comm-cache\n");
+	pe->num_entries = 0;
+	pe->num_free_entries = 0;
+	ret = sock_pe_grow_table(pe);
+	if (ret) {
+		SOCK_LOG_ERROR("failed to allocate PE table\n");
+		return ret;
 	}
 
-	pe->num_free_entries = SOCK_PE_MAX_ENTRIES;
 	SOCK_LOG_DBG("PE table init: OK\n");
+	return 0;
 }
 
 struct sock_pe *sock_pe_init(struct sock_domain *domain)
@@ -2689,7 +2783,11 @@ struct sock_pe *sock_pe_init(struct sock_domain *domain)
 	if (!pe)
 		return NULL;
 
-	sock_pe_init_table(pe);
+	if (sock_pe_init_table(pe)) {
+		free(pe);
+		return NULL;
+	}
+
 	dlist_init(&pe->tx_list);
 	dlist_init(&pe->rx_list);
 	fastlock_init(&pe->lock);
@@ -2750,6 +2848,7 @@ err2:
 	util_buf_pool_destroy(pe->pe_rx_pool);
 err1:
 	fastlock_destroy(&pe->lock);
+	sock_pe_free_table(pe);
 	free(pe);
 	return NULL;
 }
@@ -2773,7 +2872,6 @@ static void sock_pe_free_util_pool(struct sock_pe *pe)
 
 void sock_pe_finalize(struct sock_pe *pe)
 {
-	int i;
 	if (pe->domain->progress_mode == FI_PROGRESS_AUTO) {
 		pe->do_progress = 0;
 		sock_pe_signal(pe);
@@ -2782,10 +2880,7 @@ void sock_pe_finalize(struct sock_pe *pe)
 		ofi_close_socket(pe->signal_fds[1]);
 	}
 
-	for (i = 0; i < SOCK_PE_MAX_ENTRIES; i++) {
-		ofi_rbfree(&pe->pe_table[i].comm_buf);
-	}
-
+	sock_pe_free_table(pe);
 	sock_pe_free_util_pool(pe);
 	fastlock_destroy(&pe->lock);
 	fastlock_destroy(&pe->signal_lock);
@@ -47,6 +47,37 @@
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
 
+static inline struct dlist_entry *
+sock_rx_tag_bucket(struct dlist_entry *hash, uint64_t tag)
+{
+	tag ^= tag >> 33;
+	tag *= 0xff51afd7ed558ccdULL;
+	tag ^= tag >> 33;
+	return &hash[tag & (SOCK_RX_HASH_SIZE - 1)];
+}
+
+static inline int sock_rx_match_addr(struct sock_rx_ctx *rx_ctx,
+				     uint64_t addr, uint64_t rx_addr)
+{
+	return rx_addr == FI_ADDR_UNSPEC || addr == FI_ADDR_UNSPEC ||
+	       rx_addr == addr ||
+	       (rx_ctx->av && !sock_av_compare_addr(rx_ctx->av, addr, rx_addr));
+}
+
+void sock_rx_init_lists(struct sock_rx_ctx *rx_ctx)
+{
+	int i;
+
+	dlist_init(&rx_ctx->rx_entry_list);
+	dlist_init(&rx_ctx->rx_buffered_list);
+	dlist_init(&rx_ctx->rx_msg_list);
+	dlist_init(&rx_ctx->rx_tag_list);
+	for (i = 0; i < SOCK_RX_HASH_SIZE; i++) {
+		dlist_init(&rx_ctx->rx_tag_hash[i]);
+		dlist_init(&rx_ctx->rx_buffered_hash[i]);
+	}
+}
+
 struct sock_rx_entry *sock_rx_new_entry(struct sock_rx_ctx *rx_ctx)
 {
 	struct sock_rx_entry *rx_entry;
@@ -81,6 +112,7 @@ struct sock_rx_entry *sock_rx_new_entry(struct sock_rx_ctx *rx_ctx)
 	rx_entry->is_tagged = 0;
 	SOCK_LOG_DBG("New rx_entry: %p, ctx: %p\n", rx_entry, rx_ctx);
 	dlist_init(&rx_entry->entry);
+	dlist_init(&rx_entry->match_entry);
 	rx_ctx->num_left--;
 	return rx_entry;
 }
@@ -100,8 +132,35 @@ void sock_rx_release_entry(struct sock_rx_entry *rx_entry)
 	}
 }
 
+/* Caller holds rx_ctx->lock */
+void sock_rx_add_entry(struct sock_rx_ctx *rx_ctx,
+		       struct sock_rx_entry *rx_entry)
+{
+	struct dlist_entry *list;
+
+	if (!rx_entry->is_tagged)
+		list = &rx_ctx->rx_msg_list;
+	else if (rx_entry->ignore)
+		list = &rx_ctx->rx_tag_list;
+	else
+		list = sock_rx_tag_bucket(rx_ctx->rx_tag_hash, rx_entry->tag);
+
+	rx_entry->seq = rx_ctx->rx_seq++;
+	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_entry_list);
+	dlist_insert_tail(&rx_entry->match_entry, list);
+	rx_ctx->match_pending = 1;
+}
+
+/* Removes a posted or buffered entry from all lists */
+void sock_rx_remove_entry(struct sock_rx_entry *rx_entry)
+{
+	dlist_remove(&rx_entry->entry);
+	dlist_remove(&rx_entry->match_entry);
+}
+
 struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
-						 size_t len)
+						 size_t len, uint64_t tag,
+						 uint8_t is_tagged)
 {
 	struct sock_rx_entry *rx_entry;
 
@@ -117,6 +176,8 @@ struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
 
 	rx_entry->is_busy = 1;
 	rx_entry->is_buffered = 1;
+	rx_entry->is_tagged = is_tagged;
+	rx_entry->tag = tag;
 	rx_entry->rx_op.dest_iov_len = 1;
 	rx_entry->iov[0].iov.len = len;
 	rx_entry->iov[0].iov.addr = (uintptr_t) (rx_entry + 1);
@@ -124,57 +185,93 @@ struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
 
 	rx_ctx->buffered_len += len;
 	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_buffered_list);
+	if (is_tagged)
+		dlist_insert_tail(&rx_entry->match_entry,
+				  sock_rx_tag_bucket(rx_ctx->rx_buffered_hash,
+						     tag));
+	else
+		dlist_init(&rx_entry->match_entry);
 
 	return rx_entry;
 }
 
-struct sock_rx_entry *sock_rx_get_entry(struct sock_rx_ctx *rx_ctx,
-					uint64_t addr, uint64_t tag,
-					uint8_t is_tagged)
+/* Returns the first available entry on a match list posted before max_seq */
+static struct sock_rx_entry *
+sock_rx_match_list(struct sock_rx_ctx *rx_ctx, struct dlist_entry *list,
+		   uint64_t addr, uint64_t tag, uint64_t max_seq)
 {
 	struct dlist_entry *entry;
 	struct sock_rx_entry *rx_entry;
 
-	for (entry = rx_ctx->rx_entry_list.next;
-	     entry != &rx_ctx->rx_entry_list; entry = entry->next) {
-
-		rx_entry = container_of(entry, struct sock_rx_entry, entry);
-		if (rx_entry->is_busy || (is_tagged != rx_entry->is_tagged))
+	for (entry = list->next; entry != list; entry = entry->next) {
+		rx_entry = container_of(entry, struct sock_rx_entry,
+					match_entry);
+		if (rx_entry->seq >= max_seq)
+			break;
+		if (rx_entry->is_busy)
 			continue;
 
-		if (((rx_entry->tag & ~rx_entry->ignore) == (tag & ~rx_entry->ignore)) &&
-		    (rx_entry->addr == FI_ADDR_UNSPEC || addr == FI_ADDR_UNSPEC ||
-		     rx_entry->addr == addr ||
-		     (rx_ctx->av &&
-		      !sock_av_compare_addr(rx_ctx->av, addr, rx_entry->addr)))) {
-			rx_entry->is_busy = 1;
+		if (((rx_entry->tag & ~rx_entry->ignore) ==
+		     (tag & ~rx_entry->ignore)) &&
+		    sock_rx_match_addr(rx_ctx, addr, rx_entry->addr))
 			return rx_entry;
-		}
 	}
 	return NULL;
 }
 
+struct sock_rx_entry *sock_rx_get_entry(struct sock_rx_ctx *rx_ctx,
+					uint64_t addr, uint64_t tag,
+					uint8_t is_tagged)
+{
+	struct sock_rx_entry *rx_entry, *rx_wild;
+
+	if (!is_tagged) {
+		rx_entry = sock_rx_match_list(rx_ctx, &rx_ctx->rx_msg_list,
+					      addr, tag, UINT64_MAX);
+	} else {
+		/* An exact tag match may only be taken over a wildcard
+		 * receive that was posted after it. */
+		rx_entry = sock_rx_match_list(rx_ctx,
+				sock_rx_tag_bucket(rx_ctx->rx_tag_hash, tag),
+				addr, tag, UINT64_MAX);
+		rx_wild = sock_rx_match_list(rx_ctx, &rx_ctx->rx_tag_list,
+				addr, tag, rx_entry ? rx_entry->seq : UINT64_MAX);
+		if (rx_wild)
+			rx_entry = rx_wild;
+	}
+
+	if (rx_entry)
+		rx_entry->is_busy = 1;
+	return rx_entry;
+}
+
 struct sock_rx_entry *sock_rx_get_buffered_entry(struct sock_rx_ctx *rx_ctx,
 						uint64_t addr, uint64_t tag,
 						uint64_t ignore,
 						uint8_t is_tagged)
 {
-	struct dlist_entry *entry;
+	struct dlist_entry *entry, *list;
 	struct sock_rx_entry *rx_entry;
 
-	for (entry = rx_ctx->rx_buffered_list.next;
-	     entry != &rx_ctx->rx_buffered_list; entry = entry->next) {
+	/* Only entries with the same tag share a bucket, and they are kept
+	 * in arrival order, so an exact tag only has to search its bucket. */
+	list = (is_tagged && !ignore) ?
+	       sock_rx_tag_bucket(rx_ctx->rx_buffered_hash, tag) :
+	       &rx_ctx->rx_buffered_list;
 
-		rx_entry = container_of(entry, struct sock_rx_entry, entry);
+	for (entry = list->next; entry != list; entry = entry->next) {
+		if (list == &rx_ctx->rx_buffered_list)
+			rx_entry = container_of(entry, struct sock_rx_entry,
+						entry);
+		else
+			rx_entry = container_of(entry, struct sock_rx_entry,
+						match_entry);
 		if (rx_entry->is_busy || (is_tagged != rx_entry->is_tagged) ||
 		    rx_entry->is_claimed)
 			continue;
 
 		if (((rx_entry->tag & ~ignore) == (tag & ~ignore)) &&
-		    (rx_entry->addr == FI_ADDR_UNSPEC || addr == FI_ADDR_UNSPEC ||
-		     rx_entry->addr == addr ||
-		     (rx_ctx->av &&
-		      !sock_av_compare_addr(rx_ctx->av, addr, rx_entry->addr)))) {
+		    sock_rx_match_addr(rx_ctx, addr, rx_entry->addr)) {
 			return rx_entry;
 		}
 	}
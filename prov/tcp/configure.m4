@@ -11,5 +11,20 @@ AC_DEFUN([FI_TCP_CONFIGURE],[
        # Determine if we can support the tcp provider
        tcp_h_happy=0
        AS_IF([test x"$enable_tcp" != x"no"], [tcp_h_happy=1])
+
+       # Check for the io_uring features used by the optional I/O engine:
+       # multishot receives and provided buffer rings (linux kernel >= 6.0)
+       tcp_io_uring_happy=0
+       AS_IF([test $tcp_h_happy -eq 1],
+             [AC_CHECK_HEADERS([linux/io_uring.h], [tcp_io_uring_happy=1])])
+       AS_IF([test $tcp_io_uring_happy -eq 1],
+             [AC_CHECK_DECLS([IORING_RECV_MULTISHOT,
+                              IORING_REGISTER_PBUF_RING,
+                              __NR_io_uring_setup],
+                  [], [tcp_io_uring_happy=0],
+                  [[#include <linux/io_uring.h>
+                    #include <sys/syscall.h>]])])
+       AC_DEFINE_UNQUOTED([HAVE_TCP_IO_URING], [$tcp_io_uring_happy],
+                          [Define to 1 if the tcp io_uring engine is built])
        AS_IF([test $tcp_h_happy -eq 1], [$1], [$2])
 ])
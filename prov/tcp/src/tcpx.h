@@ -71,13 +71,23 @@
 #define TCPX_MAX_CM_DATA_SIZE	(1<<8)
 #define TCPX_IOV_LIMIT		(4)
 #define TCPX_MAX_INJECT_SZ	(64)
+#define TCPX_MIN_MULTI_RECV	(64)
 
 #define MAX_EPOLL_EVENTS	100
 #define STAGE_BUF_SIZE		512
 
+/* Limits on the queued sends coalesced into one sendmsg */
+#define TCPX_TX_BATCH_IOV	64
+#define TCPX_TX_BATCH_SIZE	(64 * 1024)
+
 extern struct fi_provider	tcpx_prov;
 extern struct util_prov		tcpx_util_prov;
 extern struct fi_info		tcpx_info;
+extern int			tcpx_ready_progress;
+extern int			tcpx_io_uring;
+extern int			tcpx_progress_thread;
+extern int			tcpx_progress_idle;
+extern char			*tcpx_progress_affinity;
 struct tcpx_xfer_entry;
 struct tcpx_ep;
 
@@ -105,6 +115,9 @@ struct tcpx_cm_context {
 	fid_t			fid;
 	enum tcpx_cm_event_type	type;
 	size_t			cm_data_sz;
+	/* CM message being received, header first, then its data */
+	struct ofi_ctrl_hdr	msg_hdr;
+	size_t			done_len;
 	char			cm_data[TCPX_MAX_CM_DATA_SIZE];
 };
 
@@ -158,6 +171,8 @@ struct tcpx_rx_detect {
 	} hdr;
 	size_t			hdr_len;
 	size_t			done_len;
+	/* counted as unexpected while waiting for a receive */
+	bool			unexp;
 };
 
 struct tcpx_rx_ctx {
@@ -165,6 +180,11 @@ struct tcpx_rx_ctx {
 	struct slist		rx_queue;
 	struct util_buf_pool	*buf_pool;
 	fastlock_t		lock;
+	uint64_t		op_flags;
+	size_t			min_multi_recv;
+	/* endpoints sharing the context, re-armed when a receive is posted */
+	struct dlist_entry	ep_list;
+	fastlock_t		ep_lock;
 };
 
 typedef int (*tcpx_rx_process_fn_t)(struct tcpx_xfer_entry *rx_entry);
@@ -190,6 +210,9 @@ struct tcpx_ep {
 	struct slist		tx_rsp_pend_queue;
 	struct slist		rma_read_queue;
 	struct tcpx_rx_ctx	*srx_ctx;
+	struct dlist_entry	srx_entry;
+	/* received data waits for a receive to be posted */
+	bool			rx_blocked;
 	enum tcpx_cm_state	cm_state;
 	/* lock for protecting tx/rx queues,rma list,cm_state*/
 	fastlock_t		lock;
@@ -198,6 +221,11 @@ struct tcpx_ep {
 	void (*hdr_bswap)(struct tcpx_base_hdr *hdr);
 	struct stage_buf	stage_buf;
 	bool			send_ready_monitor;
+	/* events registered with the CQ ready sets */
+	uint32_t		ready_events;
+	/* io_uring engine state, NULL when using socket calls */
+	struct tcpx_uring_ep	*uring;
+	size_t			min_multi_recv;
 };
 
 struct tcpx_fabric {
@@ -217,10 +245,31 @@ struct tcpx_xfer_entry {
 	uint64_t		flags;
 	void			*context;
 	uint64_t		rem_len;
+	/* start of the message in a multi-recv buffer, reported as the
+	 * completion's buf */
+	void			*mrecv_msg_start;
+	/* claimed receive: the multi-recv buffer it is placed in */
+	struct tcpx_xfer_entry	*mrecv;
+	/* multi-recv buffer: claimed receives that have not completed yet,
+	 * whether any were claimed, and whether it has left its queue */
+	size_t			mrecv_claims;
+	bool			mrecv_carved;
+	bool			mrecv_retired;
 };
 
 struct tcpx_domain {
 	struct util_domain	util_domain;
+	/* auto progress thread state, unused unless tcpx_progress_thread */
+	fi_epoll_t		progress_set;
+	/* keeps endpoints from being closed while the thread progresses them */
+	fastlock_t		progress_lock;
+	struct fd_signal	progress_signal;
+	pthread_t		progress_thread;
+	volatile int		progress_run;
+	/* time of the last application driven progress, for progress_idle */
+	volatile uint64_t	app_progress_time;
+	/* io_uring engine shared by the connected endpoints, or NULL */
+	struct tcpx_uring	*uring;
 };
 
 struct tcpx_buf_pool {
@@ -243,6 +292,8 @@ int tcpx_passive_ep(struct fid_fabric *fabric, struct fi_info *info,
 
 int tcpx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		     struct fid_domain **domain, void *context);
+int tcpx_progress_thread_start(struct tcpx_domain *domain);
+void tcpx_progress_thread_stop(struct tcpx_domain *domain);
 
 
 int tcpx_endpoint(struct fid_domain *domain, struct fi_info *info,
@@ -256,10 +307,11 @@ void tcpx_cq_report_completion(struct util_cq *cq,
 			       int err);
 
 int tcpx_recv_msg_data(struct tcpx_xfer_entry *recv_entry);
+ssize_t tcpx_send_iov(SOCKET sock, struct iovec *iov, size_t iov_cnt);
 int tcpx_send_msg(struct tcpx_xfer_entry *tx_entry);
-int tcpx_recv_hdr(SOCKET sock, struct stage_buf *sbuf,
+int tcpx_recv_hdr(struct tcpx_ep *ep, struct stage_buf *sbuf,
 		  struct tcpx_rx_detect *rx_detect);
-int tcpx_read_to_buffer(SOCKET sock, struct stage_buf *stage_buf);
+int tcpx_read_to_buffer(struct tcpx_ep *ep, struct stage_buf *stage_buf);
 
 struct tcpx_xfer_entry *tcpx_xfer_entry_alloc(struct tcpx_cq *cq,
 					      enum tcpx_xfer_op_codes type);
@@ -269,7 +321,11 @@ void tcpx_srx_xfer_release(struct tcpx_rx_ctx *srx_ctx,
 			   struct tcpx_xfer_entry *xfer_entry);
 void tcpx_rx_msg_release(struct tcpx_xfer_entry *rx_entry);
 struct tcpx_xfer_entry *
-tcpx_srx_dequeue(struct tcpx_rx_ctx *srx_ctx);
+tcpx_srx_dequeue(struct tcpx_rx_ctx *srx_ctx, struct tcpx_ep *ep, size_t len);
+bool tcpx_mrecv_claim(struct tcpx_xfer_entry *mrecv,
+		      struct tcpx_xfer_entry *rx_entry,
+		      size_t len, size_t min_len);
+void tcpx_mrecv_put(struct tcpx_xfer_entry *rx_entry);
 
 
 void tcpx_progress(struct util_ep *util_ep);
@@ -281,8 +337,70 @@ void tcpx_hdr_bswap(struct tcpx_base_hdr *hdr);
 int tcpx_ep_shutdown_report(struct tcpx_ep *ep, fid_t fid);
 int tcpx_cq_wait_ep_add(struct tcpx_ep *ep);
 void tcpx_cq_wait_ep_del(struct tcpx_ep *ep);
+void tcpx_ep_ready_update(struct tcpx_ep *ep);
+void tcpx_ep_rx_posted(struct tcpx_ep *ep);
+void tcpx_srx_rx_posted(struct tcpx_rx_ctx *srx_ctx);
 void tcpx_tx_queue_insert(struct tcpx_ep *tcpx_ep,
 			  struct tcpx_xfer_entry *tx_entry);
+void tcpx_tx_queue_sent(struct tcpx_ep *ep, ssize_t sent);
+
+#if HAVE_TCP_IO_URING
+int tcpx_uring_probe(void);
+int tcpx_uring_open(struct tcpx_domain *domain);
+void tcpx_uring_close(struct tcpx_domain *domain);
+int tcpx_uring_init(struct tcpx_ep *ep);
+void tcpx_uring_fini(struct tcpx_ep *ep);
+int tcpx_uring_wait_fd(struct tcpx_ep *ep);
+int tcpx_uring_ring_fd(struct tcpx_ep *ep);
+void tcpx_uring_progress(struct tcpx_ep *ep);
+ssize_t tcpx_uring_recv(struct tcpx_ep *ep, void *buf, size_t len);
+ssize_t tcpx_uring_recvv(struct tcpx_ep *ep, struct iovec *iov,
+			 size_t iov_cnt);
+bool tcpx_uring_rx_pending(struct tcpx_ep *ep);
+bool tcpx_uring_tx_busy(struct tcpx_ep *ep);
+int tcpx_uring_send(struct tcpx_ep *ep, struct iovec *iov, size_t iov_cnt);
+#else
+static inline int tcpx_uring_probe(void) { return -FI_ENOSYS; }
+static inline int tcpx_uring_open(struct tcpx_domain *domain)
+{
+	return -FI_ENOSYS;
+}
+static inline void tcpx_uring_close(struct tcpx_domain *domain) { }
+static inline int tcpx_uring_init(struct tcpx_ep *ep) { return -FI_ENOSYS; }
+static inline void tcpx_uring_fini(struct tcpx_ep *ep) { }
+static inline int tcpx_uring_wait_fd(struct tcpx_ep *ep) { return -1; }
+static inline int tcpx_uring_ring_fd(struct tcpx_ep *ep) { return -1; }
+static inline void tcpx_uring_progress(struct tcpx_ep *ep) { }
+static inline ssize_t
+tcpx_uring_recv(struct tcpx_ep *ep, void *buf, size_t len)
+{
+	return -FI_ENOSYS;
+}
+static inline ssize_t
+tcpx_uring_recvv(struct tcpx_ep *ep, struct iovec *iov, size_t iov_cnt)
+{
+	return -FI_ENOSYS;
+}
+static inline bool tcpx_uring_rx_pending(struct tcpx_ep *ep) { return false; }
+static inline bool tcpx_uring_tx_busy(struct tcpx_ep *ep) { return false; }
+static inline int
+tcpx_uring_send(struct tcpx_ep *ep, struct iovec *iov, size_t iov_cnt)
+{
+	return -FI_ENOSYS;
+}
+#endif
+
+static inline struct tcpx_domain *tcpx_ep_domain(struct tcpx_ep *ep)
+{
+	return container_of(ep->util_ep.domain, struct tcpx_domain,
+			    util_domain);
+}
+
+/* The fd that signals progress for the endpoint */
+static inline int tcpx_ep_wait_fd(struct tcpx_ep *ep)
+{
+	return ep->uring ? tcpx_uring_wait_fd(ep) : ep->conn_fd;
+}
 
 void tcpx_conn_mgr_run(struct util_eq *eq);
 int tcpx_eq_wait_try_func(void *arg);
@@ -37,18 +37,28 @@
 #include <ofi_iov.h>
 #include "tcpx.h"
 
-int tcpx_send_msg(struct tcpx_xfer_entry *tx_entry)
+ssize_t tcpx_send_iov(SOCKET sock, struct iovec *iov, size_t iov_cnt)
 {
 	ssize_t bytes_sent;
 	struct msghdr msg = {0};
 
-	msg.msg_iov = tx_entry->iov;
-	msg.msg_iovlen = tx_entry->iov_cnt;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iov_cnt;
 
-	bytes_sent = ofi_sendmsg_tcp(tx_entry->ep->conn_fd,
-	                             &msg, MSG_NOSIGNAL);
+	bytes_sent = ofi_sendmsg_tcp(sock, &msg, MSG_NOSIGNAL);
 	if (bytes_sent < 0)
 		return ofi_sockerr() == EPIPE ? -FI_ENOTCONN : -ofi_sockerr();
+	return bytes_sent;
+}
+
+int tcpx_send_msg(struct tcpx_xfer_entry *tx_entry)
+{
+	ssize_t bytes_sent;
+
+	bytes_sent = tcpx_send_iov(tx_entry->ep->conn_fd, tx_entry->iov,
+				   tx_entry->iov_cnt);
+	if (bytes_sent < 0)
+		return (int) bytes_sent;
 
 	tx_entry->rem_len -= bytes_sent;
 	if (tx_entry->rem_len) {
@@ -58,6 +68,32 @@ int tcpx_send_msg(struct tcpx_xfer_entry *tx_entry)
 	return FI_SUCCESS;
 }
 
+static ssize_t tcpx_recv(struct tcpx_ep *ep, void *buf, size_t len)
+{
+	ssize_t ret;
+
+	if (ep->uring)
+		return tcpx_uring_recv(ep, buf, len);
+
+	ret = ofi_recv_socket(ep->conn_fd, buf, len, 0);
+	if (ret <= 0)
+		return ret ? -ofi_sockerr() : -FI_ENOTCONN;
+	return ret;
+}
+
+static ssize_t tcpx_recvv(struct tcpx_ep *ep, struct iovec *iov, int iov_cnt)
+{
+	ssize_t ret;
+
+	if (ep->uring)
+		return tcpx_uring_recvv(ep, iov, iov_cnt);
+
+	ret = ofi_readv_socket(ep->conn_fd, iov, iov_cnt);
+	if (ret <= 0)
+		return ret ? -ofi_sockerr() : -FI_ENOTCONN;
+	return ret;
+}
+
 static ssize_t tcpx_read_from_buffer(struct stage_buf *sbuf,
 				     uint8_t *buf, size_t len)
 {
@@ -73,7 +109,7 @@ static ssize_t tcpx_read_from_buffer(struct stage_buf *sbuf,
 	return ret;
 }
 
-int tcpx_recv_rem_hdr(SOCKET sock, struct stage_buf *sbuf,
+int tcpx_recv_rem_hdr(struct tcpx_ep *ep, struct stage_buf *sbuf,
 		  struct tcpx_rx_detect *rx_detect)
 {
 	void *rem_buf;
@@ -86,17 +122,17 @@ int tcpx_recv_rem_hdr(SOCKET sock, struct stage_buf *sbuf,
 	if (sbuf->len != sbuf->off) {
 		bytes_recvd = tcpx_read_from_buffer(sbuf, rem_buf, rem_len);
 	} else {
-		bytes_recvd = ofi_recv_socket(sock, rem_buf, rem_len, 0);
+		bytes_recvd = tcpx_recv(ep, rem_buf, rem_len);
 	}
-	if (bytes_recvd <= 0)
-		return (bytes_recvd)? -ofi_sockerr(): -FI_ENOTCONN;
+	if (bytes_recvd < 0)
+		return (int) bytes_recvd;
 
 	rx_detect->done_len += bytes_recvd;
 	return (rx_detect->done_len == rx_detect->hdr_len)?
 		FI_SUCCESS : -FI_EAGAIN;
 }
 
-int tcpx_recv_hdr(SOCKET sock, struct stage_buf *sbuf,
+int tcpx_recv_hdr(struct tcpx_ep *ep, struct stage_buf *sbuf,
 		  struct tcpx_rx_detect *rx_detect)
 {
 	void *rem_buf;
@@ -109,10 +145,10 @@ int tcpx_recv_hdr(SOCKET sock, struct stage_buf *sbuf,
 	if (sbuf->len != sbuf->off) {
 		bytes_recvd = tcpx_read_from_buffer(sbuf, rem_buf, rem_len);
 	} else {
-		bytes_recvd = ofi_recv_socket(sock, rem_buf, rem_len, 0);
+		bytes_recvd = tcpx_recv(ep, rem_buf, rem_len);
 	}
-	if (bytes_recvd <= 0)
-		return (bytes_recvd)? -ofi_sockerr(): -FI_ENOTCONN;
+	if (bytes_recvd < 0)
+		return (int) bytes_recvd;
 
 	rx_detect->done_len += bytes_recvd;
 
@@ -120,7 +156,7 @@ int tcpx_recv_hdr(SOCKET sock, struct stage_buf *sbuf,
 		rx_detect->hdr_len = (size_t) rx_detect->hdr.base_hdr.payload_off;
 
 		if (rx_detect->hdr_len > rx_detect->done_len)
-			return tcpx_recv_rem_hdr(sock, sbuf, rx_detect);
+			return tcpx_recv_rem_hdr(ep, sbuf, rx_detect);
 	}
 
 	return (rx_detect->done_len == rx_detect->hdr_len)?
@@ -159,12 +195,11 @@ int tcpx_recv_msg_data(struct tcpx_xfer_entry *rx_entry)
 						     rx_entry->iov,
 						     rx_entry->iov_cnt);
 	 }else {
-		bytes_recvd = ofi_readv_socket(rx_entry->ep->conn_fd,
-					       rx_entry->iov,
-					       rx_entry->iov_cnt);
+		bytes_recvd = tcpx_recvv(rx_entry->ep, rx_entry->iov,
+					 rx_entry->iov_cnt);
 	}
-	if (bytes_recvd <= 0)
-		return (bytes_recvd)? -ofi_sockerr(): -FI_ENOTCONN;
+	if (bytes_recvd < 0)
+		return (int) bytes_recvd;
 
 	rx_entry->rem_len -= bytes_recvd;
 	if (rx_entry->rem_len) {
@@ -174,14 +209,13 @@ int tcpx_recv_msg_data(struct tcpx_xfer_entry *rx_entry)
 	return FI_SUCCESS;
 }
 
-int tcpx_read_to_buffer(SOCKET sock, struct stage_buf *stage_buf)
+int tcpx_read_to_buffer(struct tcpx_ep *ep, struct stage_buf *stage_buf)
 {
-	int bytes_recvd;
+	ssize_t bytes_recvd;
 
-	bytes_recvd = ofi_recv_socket(sock, stage_buf->buf,
-				      stage_buf->size, 0);
-	if (bytes_recvd <= 0)
-		return (bytes_recvd)? -ofi_sockerr(): -FI_ENOTCONN;
+	bytes_recvd = tcpx_recv(ep, stage_buf->buf, stage_buf->size);
+	if (bytes_recvd < 0)
+		return (int) bytes_recvd;
 
 	stage_buf->len = bytes_recvd;
 	stage_buf->off = 0;
@@ -39,51 +39,65 @@
 #include <ofi_util.h>
 
 
-static int read_cm_data(SOCKET fd, struct tcpx_cm_context *cm_ctx,
-			struct ofi_ctrl_hdr *hdr)
+/* Data beyond what fits in cm_data is read here and dropped */
+#define TCPX_CM_DISCARD_SIZE	64
+
+static int rx_cm_err(ssize_t ret)
 {
-	cm_ctx->cm_data_sz = ntohs(hdr->seg_size);
-	if (cm_ctx->cm_data_sz) {
-		size_t data_sz = MIN(cm_ctx->cm_data_sz,
-				     TCPX_MAX_CM_DATA_SIZE);
-		ssize_t ret = ofi_recv_socket(fd, cm_ctx->cm_data,
-					      data_sz, MSG_WAITALL);
-		if ((size_t) ret != data_sz)
-			return -FI_EIO;
-		cm_ctx->cm_data_sz = data_sz;
-
-		if (OFI_UNLIKELY(cm_ctx->cm_data_sz >
-					TCPX_MAX_CM_DATA_SIZE)) {
-			ofi_discard_socket(fd, cm_ctx->cm_data_sz -
-					   TCPX_MAX_CM_DATA_SIZE);
-		}
-	}
-	return FI_SUCCESS;
+	if (!ret)
+		return -FI_EIO;
+	return OFI_SOCK_TRY_SND_RCV_AGAIN(ofi_sockerr()) ?
+	       -FI_EAGAIN : -ofi_sockerr();
 }
 
-static int rx_cm_data(SOCKET fd, struct ofi_ctrl_hdr *hdr,
-		      int type, struct tcpx_cm_context *cm_ctx)
+/*
+ * Reads as much of a CM message as is available without blocking, so that
+ * a slow peer does not stall the handshakes of other connections.  Returns
+ * -FI_EAGAIN until the whole message has arrived.
+ */
+static int rx_cm_data(SOCKET fd, int type, struct tcpx_cm_context *cm_ctx)
 {
+	char discard[TCPX_CM_DISCARD_SIZE];
+	size_t msg_len, data_sz, off;
 	ssize_t ret;
 
-	ret = ofi_recv_socket(fd, hdr,
-			      sizeof(*hdr), MSG_WAITALL);
-	if (ret != sizeof(*hdr))
-		return -FI_EIO;
+	while (cm_ctx->done_len < sizeof(cm_ctx->msg_hdr)) {
+		ret = ofi_recv_socket(fd, (char *) &cm_ctx->msg_hdr +
+				      cm_ctx->done_len,
+				      sizeof(cm_ctx->msg_hdr) - cm_ctx->done_len,
+				      MSG_DONTWAIT);
+		if (ret <= 0)
+			return rx_cm_err(ret);
+		cm_ctx->done_len += ret;
+	}
 
-	if (hdr->version != TCPX_CTRL_HDR_VERSION)
+	if (cm_ctx->msg_hdr.version != TCPX_CTRL_HDR_VERSION)
 		return -FI_ENOPROTOOPT;
 
-	ret = read_cm_data(fd, cm_ctx, hdr);
-	if (hdr->type != type) {
-		ret = -FI_ECONNREFUSED;
+	msg_len = ntohs(cm_ctx->msg_hdr.seg_size);
+	data_sz = MIN(msg_len, TCPX_MAX_CM_DATA_SIZE);
+	while (cm_ctx->done_len < sizeof(cm_ctx->msg_hdr) + msg_len) {
+		off = cm_ctx->done_len - sizeof(cm_ctx->msg_hdr);
+		if (off < data_sz)
+			ret = ofi_recv_socket(fd, &cm_ctx->cm_data[off],
+					      data_sz - off, MSG_DONTWAIT);
+		else
+			ret = ofi_recv_socket(fd, discard,
+					      MIN(sizeof(discard), msg_len - off),
+					      MSG_DONTWAIT);
+		if (ret <= 0)
+			return rx_cm_err(ret);
+		cm_ctx->done_len += ret;
 	}
-	return ret;
+	cm_ctx->cm_data_sz = data_sz;
+
+	return cm_ctx->msg_hdr.type == type ? FI_SUCCESS : -FI_ECONNREFUSED;
 }
 
 static int tx_cm_data(SOCKET fd, uint8_t type, struct tcpx_cm_context *cm_ctx)
 {
 	struct ofi_ctrl_hdr hdr;
+	struct iovec iov[2];
 	ssize_t ret;
 
 	memset(&hdr, 0, sizeof(hdr));
@@ -92,16 +106,16 @@ static int tx_cm_data(SOCKET fd, uint8_t type, struct tcpx_cm_context *cm_ctx)
 	hdr.seg_size = htons((uint16_t) cm_ctx->cm_data_sz);
 	hdr.conn_data = 1; /* For testing endianess mismatch at peer */
 
-	ret = ofi_send_socket(fd, &hdr, sizeof(hdr), MSG_NOSIGNAL);
-	if (ret != sizeof(hdr))
-		return -FI_EIO;
+	/* The message is sent with a single call, and fits in the send
+	 * buffer of a new connection. */
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = cm_ctx->cm_data;
+	iov[1].iov_len = cm_ctx->cm_data_sz;
 
-	if (cm_ctx->cm_data_sz) {
-		ret = ofi_send_socket(fd, cm_ctx->cm_data,
-				      cm_ctx->cm_data_sz, MSG_NOSIGNAL);
-		if ((size_t) ret != cm_ctx->cm_data_sz)
-			return -FI_EIO;
-	}
+	ret = tcpx_send_iov(fd, iov, cm_ctx->cm_data_sz ? 2 : 1);
+	if ((size_t) ret != sizeof(hdr) + cm_ctx->cm_data_sz)
+		return -FI_EIO;
 	return FI_SUCCESS;
 }
 
@@ -119,6 +133,14 @@ static int tcpx_ep_msg_xfer_enable(struct tcpx_ep *ep)
 	if (ret)
 		goto err;
 
+	if (tcpx_ep_domain(ep)->uring) {
+		ret = tcpx_uring_init(ep);
+		if (ret)
+			FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
+				"io_uring setup failed, using sockets: %s\n",
+				fi_strerror(-ret));
+	}
+
 	ret = tcpx_cq_wait_ep_add(ep);
 	if (ret)
 		goto err;
@@ -132,15 +154,10 @@ err:
 static int proc_conn_resp(struct tcpx_cm_context *cm_ctx,
 			  struct tcpx_ep *ep)
 {
-	struct ofi_ctrl_hdr conn_resp;
 	struct fi_eq_cm_entry *cm_entry;
 	ssize_t len;
 	int ret = FI_SUCCESS;
 
-	ret = rx_cm_data(ep->conn_fd, &conn_resp, ofi_ctrl_connresp, cm_ctx);
-	if (ret)
-		return ret;
-
 	cm_entry = calloc(1, sizeof(*cm_entry) + cm_ctx->cm_data_sz);
 	if (!cm_entry)
 		return -FI_ENOMEM;
@@ -148,7 +165,7 @@ static int proc_conn_resp(struct tcpx_cm_context *cm_ctx,
 	cm_entry->fid = cm_ctx->fid;
 	memcpy(cm_entry->data, cm_ctx->cm_data, cm_ctx->cm_data_sz);
 
-	ep->hdr_bswap = (conn_resp.conn_data == 1)?
+	ep->hdr_bswap = (cm_ctx->msg_hdr.conn_data == 1)?
 		tcpx_hdr_none:tcpx_hdr_bswap;
 
 	ret = tcpx_ep_msg_xfer_enable(ep);
@@ -181,12 +198,18 @@ static void client_recv_connresp(struct util_wait *wait,
 	assert(cm_ctx->fid->fclass == FI_CLASS_EP);
 	ep = container_of(cm_ctx->fid, struct tcpx_ep, util_ep.ep_fid.fid);
 
-	ret = ofi_wait_fd_del(wait, ep->conn_fd);
-	if (ret) {
+	ret = rx_cm_data(ep->conn_fd, ofi_ctrl_connresp, cm_ctx);
+	if (ret == -FI_EAGAIN)
+		return;
+
+	if (ofi_wait_fd_del(wait, ep->conn_fd)) {
 		FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
 			"Could not remove fd from wait\n");
-		goto err;
+		if (!ret)
+			ret = -FI_EIO;
 	}
+	if (ret)
+		goto err;
 
 	ret = proc_conn_resp(cm_ctx, ep);
 	if (ret)
@@ -270,7 +293,6 @@ static void server_recv_connreq(struct util_wait *wait,
 {
 	struct tcpx_conn_handle *handle;
 	struct fi_eq_cm_entry *cm_entry;
-	struct ofi_ctrl_hdr conn_req;
 	int ret;
 
 	assert(cm_ctx->fid->fclass == FI_CLASS_CONNREQ);
@@ -279,7 +301,9 @@ static void server_recv_connreq(struct util_wait *wait,
 			       struct tcpx_conn_handle,
 			       handle);
 
-	ret = rx_cm_data(handle->conn_fd, &conn_req, ofi_ctrl_connreq, cm_ctx);
+	ret = rx_cm_data(handle->conn_fd, ofi_ctrl_connreq, cm_ctx);
+	if (ret == -FI_EAGAIN)
+		return;
 	if (ret)
 		goto err1;
 
@@ -292,7 +316,7 @@ static void server_recv_connreq(struct util_wait *wait,
 	if (!cm_entry->info)
 		goto err2;
 
-	handle->endian_match = (conn_req.conn_data == 1);
+	handle->endian_match = (cm_ctx->msg_hdr.conn_data == 1);
 	cm_entry->info->handle = &handle->handle;
 	memcpy(cm_entry->data, cm_ctx->cm_data, cm_ctx->cm_data_sz);
 
@@ -368,37 +392,25 @@ err:
 		    &err_entry, sizeof(err_entry), UTIL_FLAG_ERROR);
 }
 
-static void server_sock_accept(struct util_wait *wait,
-			       struct tcpx_cm_context *cm_ctx)
+static int server_conn_handle_add(struct util_wait *wait,
+				  struct tcpx_pep *pep, SOCKET sock)
 {
 	struct tcpx_conn_handle *handle;
 	struct tcpx_cm_context *rx_req_cm_ctx;
-	struct tcpx_pep *pep;
-	SOCKET sock;
 	int ret;
 
-	FI_DBG(&tcpx_prov, FI_LOG_EP_CTRL, "Received Connreq\n");
-	assert(cm_ctx->fid->fclass == FI_CLASS_PEP);
-	pep = container_of(cm_ctx->fid, struct tcpx_pep,
-			   util_pep.pep_fid.fid);
-
-	sock = accept(pep->sock, NULL, 0);
-	if (sock < 0) {
-		FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
-			"accept error: %d\n", ofi_sockerr());
-		return;
-	}
-
 	handle = calloc(1, sizeof(*handle));
 	if (!handle) {
 		FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
 			"cannot allocate memory \n");
-		goto err1;
+		return -FI_ENOMEM;
 	}
 
 	rx_req_cm_ctx = calloc(1, sizeof(*rx_req_cm_ctx));
-	if (!rx_req_cm_ctx)
-		goto err2;
+	if (!rx_req_cm_ctx) {
+		ret = -FI_ENOMEM;
+		goto err1;
+	}
 
 	handle->conn_fd = sock;
 	handle->handle.fclass = FI_CLASS_CONNREQ;
@@ -410,15 +422,49 @@ static void server_sock_accept(struct util_wait *wait,
 			      tcpx_eq_wait_try_func,
 			      NULL, (void *) rx_req_cm_ctx);
 	if (ret)
-		goto err3;
-	wait->signal(wait);
-	return;
-err3:
-	free(rx_req_cm_ctx);
+		goto err2;
+	return FI_SUCCESS;
 err2:
-	free(handle);
+	free(rx_req_cm_ctx);
 err1:
-	ofi_close_socket(sock);
+	free(handle);
+	return ret;
+}
+
+/*
+ * The listening socket is non-blocking: every pending connection is
+ * accepted before returning, rather than one per wakeup.
+ */
+static void server_sock_accept(struct util_wait *wait,
+			       struct tcpx_cm_context *cm_ctx)
+{
+	struct tcpx_pep *pep;
+	SOCKET sock;
+	int cnt = 0;
+
+	FI_DBG(&tcpx_prov, FI_LOG_EP_CTRL, "Received Connreq\n");
+	assert(cm_ctx->fid->fclass == FI_CLASS_PEP);
+	pep = container_of(cm_ctx->fid, struct tcpx_pep,
+			   util_pep.pep_fid.fid);
+
+	for (;;) {
+		sock = accept(pep->sock, NULL, 0);
+		if (sock == INVALID_SOCKET) {
+			if (!OFI_SOCK_TRY_SND_RCV_AGAIN(ofi_sockerr()))
+				FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
+					"accept error: %d\n", ofi_sockerr());
+			break;
+		}
+
+		if (server_conn_handle_add(wait, pep, sock)) {
+			ofi_close_socket(sock);
+			continue;
+		}
+		cnt++;
+	}
+
+	if (cnt)
+		wait->signal(wait);
 }
 
 static void process_cm_ctx(struct util_wait *wait,
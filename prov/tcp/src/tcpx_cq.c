@@ -80,6 +80,11 @@ struct tcpx_xfer_entry *tcpx_xfer_entry_alloc(struct tcpx_cq *tcpx_cq,
 		return NULL;
 	}
 	tcpx_cq->util_cq.cq_fastlock_release(&tcpx_cq->util_cq.cq_lock);
+	xfer_entry->mrecv_msg_start = NULL;
+	xfer_entry->mrecv = NULL;
+	xfer_entry->mrecv_claims = 0;
+	xfer_entry->mrecv_carved = false;
+	xfer_entry->mrecv_retired = false;
 	return xfer_entry;
 }
 
@@ -107,6 +112,10 @@ void tcpx_cq_report_completion(struct util_cq *cq,
 {
 	struct fi_cq_err_entry err_entry;
 	uint64_t data = 0;
+	size_t len = 0;
+
+	if (xfer_entry->mrecv)
+		tcpx_mrecv_put(xfer_entry);
 
 	if (!(xfer_entry->flags & FI_COMPLETION))
 		return;
@@ -134,9 +143,14 @@ void tcpx_cq_report_completion(struct util_cq *cq,
 
 		ofi_cq_write_error(cq, &err_entry);
 	} else {
+		/* messages received into a multi-recv buffer report where
+		 * they were placed */
+		if (xfer_entry->mrecv_msg_start)
+			len = xfer_entry->hdr.base_hdr.size -
+			      xfer_entry->hdr.base_hdr.payload_off;
 		ofi_cq_write(cq, xfer_entry->context,
-			     xfer_entry->flags, 0, NULL,
-			     data, 0);
+			     xfer_entry->flags, len,
+			     xfer_entry->mrecv_msg_start, data, 0);
 		if (cq->wait)
 			ofi_cq_signal(&cq->cq_fid);
 	}
@@ -165,6 +179,57 @@ static int tcpx_cq_control(struct fid *fid, int command, void *arg)
 	}
 }
 
+/*
+ * Completions of io_uring requests run as task work, which interrupts the
+ * submitting thread's blocking waits.  Interrupted waits are retried for
+ * the remaining time while the engine is in use.
+ */
+static ssize_t tcpx_cq_sreadfrom(struct fid_cq *cq_fid, void *buf,
+				 size_t count, fi_addr_t *src_addr,
+				 const void *cond, int timeout)
+{
+	uint64_t start = (timeout >= 0) ? fi_gettime_ms() : 0;
+	int wait_time = timeout;
+	ssize_t ret;
+
+	while (1) {
+		ret = ofi_cq_sreadfrom(cq_fid, buf, count, src_addr, cond,
+				       wait_time);
+		if (ret != -FI_EINTR || !tcpx_io_uring)
+			return ret;
+
+		if (timeout >= 0) {
+			wait_time = timeout - (int) (fi_gettime_ms() - start);
+			if (wait_time <= 0)
+				return -FI_EAGAIN;
+		}
+	}
+}
+
+static ssize_t tcpx_cq_sread(struct fid_cq *cq_fid, void *buf, size_t count,
+			     const void *cond, int timeout)
+{
+	return tcpx_cq_sreadfrom(cq_fid, buf, count, NULL, cond, timeout);
+}
+
+static const char *tcpx_cq_strerror(struct fid_cq *cq_fid, int prov_errno,
+				    const void *err_data, char *buf,
+				    size_t len)
+{
+	return fi_strerror(prov_errno);
+}
+
+static struct fi_ops_cq tcpx_cq_ops = {
+	.size = sizeof(struct fi_ops_cq),
+	.read = ofi_cq_read,
+	.readfrom = ofi_cq_readfrom,
+	.readerr = ofi_cq_readerr,
+	.sread = tcpx_cq_sread,
+	.sreadfrom = tcpx_cq_sreadfrom,
+	.signal = ofi_cq_signal,
+	.strerror = tcpx_cq_strerror,
+};
+
 static struct fi_ops tcpx_cq_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = tcpx_cq_close,
@@ -263,10 +328,27 @@ int tcpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		goto destroy_pool;
 
+	if (tcpx_ready_progress) {
+		ret = ofi_cq_ready_init(&tcpx_cq->util_cq);
+		if (ret)
+			goto cleanup;
+	}
+
+	/* the progress thread writes completions and allocates transfer
+	 * entries concurrently with the application, whatever the domain
+	 * threading model */
+	if (tcpx_progress_thread) {
+		tcpx_cq->util_cq.cq_fastlock_acquire = ofi_fastlock_acquire;
+		tcpx_cq->util_cq.cq_fastlock_release = ofi_fastlock_release;
+	}
+
 	*cq_fid = &tcpx_cq->util_cq.cq_fid;
 	(*cq_fid)->fid.ops = &tcpx_cq_fi_ops;
+	(*cq_fid)->ops = &tcpx_cq_ops;
 	return 0;
 
+cleanup:
+	ofi_cq_cleanup(&tcpx_cq->util_cq);
 destroy_pool:
 	tcpx_buf_pools_destroy(tcpx_cq->buf_pools);
 free_cq:
@@ -35,6 +35,7 @@
 
 #include "tcpx.h"
 extern struct fi_ops_msg tcpx_srx_msg_ops;
+extern struct fi_ops_ep tcpx_srx_ops;
 
 static int tcpx_srx_ctx_close(struct fid *fid)
 {
@@ -44,6 +45,8 @@ static int tcpx_srx_ctx_close(struct fid *fid)
 
 	srx_ctx = container_of(fid, struct tcpx_rx_ctx,
 			       rx_fid.fid);
+	if (!dlist_empty(&srx_ctx->ep_list))
+		return -FI_EBUSY;
 
 	while (!slist_empty(&srx_ctx->rx_queue)) {
 		entry = slist_remove_head(&srx_ctx->rx_queue);
@@ -52,6 +55,7 @@ static int tcpx_srx_ctx_close(struct fid *fid)
 	}
 
 	util_buf_pool_destroy(srx_ctx->buf_pool);
+	fastlock_destroy(&srx_ctx->ep_lock);
 	fastlock_destroy(&srx_ctx->lock);
 	free(srx_ctx);
 	return FI_SUCCESS;
@@ -79,21 +83,31 @@ static int tcpx_srx_ctx(struct fid_domain *domain, struct fi_rx_attr *attr,
 	srx_ctx->rx_fid.fid.context = context;
 	srx_ctx->rx_fid.fid.ops = &fi_ops_srx_ctx;
 
+	srx_ctx->rx_fid.ops = &tcpx_srx_ops;
 	srx_ctx->rx_fid.msg = &tcpx_srx_msg_ops;
 	slist_init(&srx_ctx->rx_queue);
+	srx_ctx->op_flags = attr ? attr->op_flags : 0;
+	srx_ctx->min_multi_recv = TCPX_MIN_MULTI_RECV;
+	dlist_init(&srx_ctx->ep_list);
 
 	ret = fastlock_init(&srx_ctx->lock);
 	if (ret)
 		goto err1;
 
+	ret = fastlock_init(&srx_ctx->ep_lock);
+	if (ret)
+		goto err2;
+
 	ret = util_buf_pool_create(&srx_ctx->buf_pool,
 				   sizeof(struct tcpx_xfer_entry),
 				   16, 0, 1024);
 	if (ret)
-		goto err2;
+		goto err3;
 
 	*rx_ep = &srx_ctx->rx_fid;
 	return FI_SUCCESS;
+err3:
+	fastlock_destroy(&srx_ctx->ep_lock);
 err2:
 	fastlock_destroy(&srx_ctx->lock);
 err1:
@@ -126,6 +140,8 @@ static int tcpx_domain_close(fid_t fid)
 	if (ret)
 		return ret;
 
+	tcpx_progress_thread_stop(tcpx_domain);
+	tcpx_uring_close(tcpx_domain);
 	free(tcpx_domain);
 	return 0;
 }
@@ -163,6 +179,23 @@ int tcpx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	if (ret)
 		goto err;
 
+	if (tcpx_io_uring) {
+		ret = tcpx_uring_open(tcpx_domain);
+		if (ret)
+			FI_WARN(&tcpx_prov, FI_LOG_DOMAIN,
+				"io_uring setup failed, using sockets: %s\n",
+				fi_strerror(-ret));
+	}
+
+	if (tcpx_progress_thread) {
+		ret = tcpx_progress_thread_start(tcpx_domain);
+		if (ret) {
+			tcpx_uring_close(tcpx_domain);
+			ofi_domain_close(&tcpx_domain->util_domain);
+			goto err;
+		}
+	}
+
 	*domain = &tcpx_domain->util_domain.domain_fid;
 	(*domain)->fid.ops = &tcpx_domain_fi_ops;
 	(*domain)->ops = &tcpx_domain_ops;
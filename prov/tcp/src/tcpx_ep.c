@@ -336,8 +336,15 @@ static int tcpx_ep_close(struct fid *fid)
 	struct tcpx_ep *ep = container_of(fid, struct tcpx_ep,
 					  util_ep.ep_fid.fid);
 
-	tcpx_ep_tx_rx_queues_release(ep);
 	tcpx_cq_wait_ep_del(ep);
+	if (ep->srx_ctx) {
+		fastlock_acquire(&ep->srx_ctx->ep_lock);
+		dlist_remove(&ep->srx_entry);
+		fastlock_release(&ep->srx_ctx->ep_lock);
+	}
+	/* stops the ring's sends before their entries are released */
+	tcpx_uring_fini(ep);
+	tcpx_ep_tx_rx_queues_release(ep);
 	if (ep->util_ep.eq->wait)
 		ofi_wait_fd_del(ep->util_ep.eq->wait, ep->conn_fd);
 
@@ -374,6 +381,9 @@ static int tcpx_ep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 	if (bfid->fclass == FI_CLASS_SRX_CTX) {
 		rx_ctx = container_of(bfid, struct tcpx_rx_ctx, rx_fid.fid);
 		tcpx_ep->srx_ctx = rx_ctx;
+		fastlock_acquire(&rx_ctx->ep_lock);
+		dlist_insert_tail(&tcpx_ep->srx_entry, &rx_ctx->ep_list);
+		fastlock_release(&rx_ctx->ep_lock);
 		return FI_SUCCESS;
 	}
 
@@ -390,6 +400,10 @@ static struct fi_ops tcpx_ep_fi_ops = {
 static int tcpx_ep_getopt(fid_t fid, int level, int optname,
 			  void *optval, size_t *optlen)
 {
+	struct tcpx_ep *ep;
+	int ret;
+
+	ep = container_of(fid, struct tcpx_ep, util_ep.ep_fid.fid);
 	if (level != FI_OPT_ENDPOINT)
 		return -ENOPROTOOPT;
 
@@ -402,6 +416,42 @@ static int tcpx_ep_getopt(fid_t fid, int level, int optname,
 		*((size_t *) optval) = TCPX_MAX_CM_DATA_SIZE;
 		*optlen = sizeof(size_t);
 		break;
+	case FI_OPT_MIN_MULTI_RECV:
+		if (*optlen < sizeof(size_t)) {
+			*optlen = sizeof(size_t);
+			return -FI_ETOOSMALL;
+		}
+		*((size_t *) optval) = ep->min_multi_recv;
+		*optlen = sizeof(size_t);
+		break;
+	case FI_OPT_EP_STATS:
+		fastlock_acquire(&ep->lock);
+		ret = ofi_ep_getopt_stats(&ep->util_ep, optval, optlen);
+		fastlock_release(&ep->lock);
+		return ret;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
+	return FI_SUCCESS;
+}
+
+static int tcpx_ep_setopt(fid_t fid, int level, int optname,
+			  const void *optval, size_t optlen)
+{
+	struct tcpx_ep *ep;
+
+	ep = container_of(fid, struct tcpx_ep, util_ep.ep_fid.fid);
+	if (level != FI_OPT_ENDPOINT)
+		return -ENOPROTOOPT;
+
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+		fastlock_acquire(&ep->lock);
+		ep->min_multi_recv = *((size_t *) optval);
+		fastlock_release(&ep->lock);
+		break;
 	default:
 		return -FI_ENOPROTOOPT;
 	}
@@ -412,7 +462,7 @@ static struct fi_ops_ep tcpx_ep_ops = {
 	.size = sizeof(struct fi_ops_ep),
 	.cancel = fi_no_cancel,
 	.getopt = tcpx_ep_getopt,
-	.setopt = fi_no_setopt,
+	.setopt = tcpx_ep_setopt,
 	.tx_ctx = fi_no_tx_ctx,
 	.rx_ctx = fi_no_rx_ctx,
 	.rx_size_left = fi_no_rx_size_left,
@@ -477,6 +527,7 @@ int tcpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err3;
 
+	ep->min_multi_recv = TCPX_MIN_MULTI_RECV;
 	ep->stage_buf.size = STAGE_BUF_SIZE;
 	ep->stage_buf.len = 0;
 	ep->stage_buf.off = 0;
@@ -608,6 +659,10 @@ static int tcpx_pep_listen(struct fid_pep *pep)
 		return -ofi_sockerr();
 	}
 
+	ret = fi_fd_nonblock(tcpx_pep->sock);
+	if (ret)
+		return ret;
+
 	ret = ofi_wait_fd_add(tcpx_pep->util_pep.eq->wait, tcpx_pep->sock,
 			      FI_EPOLL_IN, tcpx_eq_wait_try_func,
 			      NULL, &tcpx_pep->cm_ctx);
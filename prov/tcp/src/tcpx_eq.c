@@ -52,11 +52,39 @@ static ssize_t tcpx_eq_read(struct fid_eq *eq_fid, uint32_t *event,
 	return ofi_eq_read(eq_fid, event, buf, len, flags);
 }
 
+/*
+ * Connected endpoints arm their io_uring receives from the thread that
+ * reads the EQ, and the completions of those receives interrupt its
+ * blocking waits.  Interrupted waits are retried for the remaining time.
+ */
+static ssize_t tcpx_eq_sread(struct fid_eq *eq_fid, uint32_t *event,
+			     void *buf, size_t len, int timeout,
+			     uint64_t flags)
+{
+	struct util_eq *eq;
+	uint64_t start;
+	int wait_time = timeout;
+
+	eq = container_of(eq_fid, struct util_eq, eq_fid);
+	if (!tcpx_io_uring || !eq->internal_wait)
+		return ofi_eq_sread(eq_fid, event, buf, len, timeout, flags);
+
+	start = (timeout >= 0) ? fi_gettime_ms() : 0;
+	while (fi_wait(&eq->wait->wait_fid, wait_time) == -FI_EINTR) {
+		if (timeout >= 0) {
+			wait_time = timeout - (int) (fi_gettime_ms() - start);
+			if (wait_time <= 0)
+				break;
+		}
+	}
+	return fi_eq_read(eq_fid, event, buf, len, flags);
+}
+
 static struct fi_ops_eq tcpx_eq_ops = {
 	.size = sizeof(struct fi_ops_eq),
 	.read = tcpx_eq_read,
 	.readerr = ofi_eq_readerr,
-	.sread = ofi_eq_sread,
+	.sread = tcpx_eq_sread,
 	.write = ofi_eq_write,
 	.strerror = ofi_eq_strerror,
 };
@@ -99,6 +99,12 @@ static void tcpx_getinfo_ifs(struct fi_info **info)
 #define tcpx_getinfo_ifs(info) do{ } while(0)
 #endif
 
+int tcpx_ready_progress = 1;
+int tcpx_io_uring = 0;
+int tcpx_progress_thread = 0;
+int tcpx_progress_idle = 0;
+char *tcpx_progress_affinity = NULL;
+
 static int tcpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
@@ -132,11 +138,47 @@ struct fi_provider tcpx_prov = {
 
 TCP_INI
 {
+	int ret;
+
 #if HAVE_TCP_DL
 	ofi_pmem_init();
 #endif
 	fi_param_define(&tcpx_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
+	fi_param_define(&tcpx_prov, "ready_progress", FI_PARAM_BOOL,
+			"Only progress endpoints with ready sockets when "
+			"reading a CQ (default: yes)");
+	fi_param_get_bool(&tcpx_prov, "ready_progress", &tcpx_ready_progress);
+	fi_param_define(&tcpx_prov, "io_uring", FI_PARAM_BOOL,
+			"Use io_uring instead of socket calls for data "
+			"transfers on connected endpoints (default: no)");
+	fi_param_get_bool(&tcpx_prov, "io_uring", &tcpx_io_uring);
+	fi_param_define(&tcpx_prov, "progress_thread", FI_PARAM_BOOL,
+			"Progress transfers from a thread per domain while "
+			"the application is not reading its CQs (default: no)");
+	fi_param_get_bool(&tcpx_prov, "progress_thread",
+			  &tcpx_progress_thread);
+	fi_param_define(&tcpx_prov, "progress_affinity", FI_PARAM_STRING,
+			"CPU affinity of the progress thread, as a list of "
+			"CPU ids and ranges, e.g. 0,2-4");
+	fi_param_get_str(&tcpx_prov, "progress_affinity",
+			 &tcpx_progress_affinity);
+	fi_param_define(&tcpx_prov, "progress_idle", FI_PARAM_INT,
+			"Only let the progress thread run after the "
+			"application has not progressed the domain for this "
+			"many microseconds (default: 0, always run)");
+	fi_param_get_int(&tcpx_prov, "progress_idle", &tcpx_progress_idle);
+	if (tcpx_progress_idle < 0)
+		tcpx_progress_idle = 0;
+	if (tcpx_io_uring) {
+		ret = tcpx_uring_probe();
+		if (ret) {
+			FI_WARN(&tcpx_prov, FI_LOG_CORE,
+				"io_uring not supported, using sockets: %s\n",
+				fi_strerror(-ret));
+			tcpx_io_uring = 0;
+		}
+	}
 
 	return &tcpx_prov;
 }
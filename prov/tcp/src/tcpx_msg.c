@@ -60,6 +60,10 @@ tcpx_alloc_recv_entry(struct tcpx_ep *tcpx_ep)
 	recv_entry = tcpx_xfer_entry_alloc(tcpx_cq, TCPX_OP_MSG_RECV);
 	if (recv_entry) {
 		recv_entry->ep = tcpx_ep;
+	} else {
+		fastlock_acquire(&tcpx_ep->lock);
+		ofi_ep_stats_eagain(&tcpx_ep->util_ep);
+		fastlock_release(&tcpx_ep->lock);
 	}
 	return recv_entry;
 }
@@ -76,6 +80,10 @@ tcpx_alloc_send_entry(struct tcpx_ep *tcpx_ep)
 	send_entry = tcpx_xfer_entry_alloc(tcpx_cq, TCPX_OP_MSG_SEND);
 	if (send_entry) {
 		send_entry->ep = tcpx_ep;
+	} else {
+		fastlock_acquire(&tcpx_ep->lock);
+		ofi_ep_stats_eagain(&tcpx_ep->util_ep);
+		fastlock_release(&tcpx_ep->lock);
 	}
 	return send_entry;
 }
@@ -85,6 +93,7 @@ static inline void tcpx_queue_recv(struct tcpx_ep *tcpx_ep,
 {
 	fastlock_acquire(&tcpx_ep->lock);
 	slist_insert_tail(&recv_entry->entry, &tcpx_ep->rx_queue);
+	tcpx_ep_rx_posted(tcpx_ep);
 	fastlock_release(&tcpx_ep->lock);
 }
 
@@ -97,6 +106,8 @@ static ssize_t tcpx_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 	tcpx_ep = container_of(ep, struct tcpx_ep, util_ep.ep_fid);
 
 	assert(msg->iov_count <= TCPX_IOV_LIMIT);
+	if ((flags & FI_MULTI_RECV) && msg->iov_count != 1)
+		return -FI_EINVAL;
 
 	recv_entry = tcpx_alloc_recv_entry(tcpx_ep);
 	if (!recv_entry)
@@ -130,7 +141,8 @@ static ssize_t tcpx_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	recv_entry->iov[0].iov_base = buf;
 	recv_entry->iov[0].iov_len = len;
 
-	recv_entry->flags = ((tcpx_ep->util_ep.rx_op_flags & FI_COMPLETION) |
+	recv_entry->flags = ((tcpx_ep->util_ep.rx_op_flags &
+			      (FI_COMPLETION | FI_MULTI_RECV)) |
 			     FI_MSG | FI_RECV);
 	recv_entry->context = context;
 
@@ -147,6 +159,8 @@ static ssize_t tcpx_recvv(struct fid_ep *ep, const struct iovec *iov, void **des
 	tcpx_ep = container_of(ep, struct tcpx_ep, util_ep.ep_fid);
 
 	assert(count <= TCPX_IOV_LIMIT);
+	if ((tcpx_ep->util_ep.rx_op_flags & FI_MULTI_RECV) && count != 1)
+		return -FI_EINVAL;
 
 	recv_entry = tcpx_alloc_recv_entry(tcpx_ep);
 	if (!recv_entry)
@@ -155,7 +169,8 @@ static ssize_t tcpx_recvv(struct fid_ep *ep, const struct iovec *iov, void **des
 	recv_entry->iov_cnt = count;
 	memcpy(recv_entry->iov, iov, count * sizeof(*iov));
 
-	recv_entry->flags = ((tcpx_ep->util_ep.rx_op_flags & FI_COMPLETION) |
+	recv_entry->flags = ((tcpx_ep->util_ep.rx_op_flags &
+			      (FI_COMPLETION | FI_MULTI_RECV)) |
 			     FI_MSG | FI_RECV);
 	recv_entry->context = context;
 
@@ -35,6 +35,7 @@
 #include <ofi_prov.h>
 #include "tcpx.h"
 #include <poll.h>
+#include <sched.h>
 
 #include <sys/types.h>
 #include <ifaddrs.h>
@@ -91,21 +92,10 @@ int tcpx_ep_shutdown_report(struct tcpx_ep *ep, fid_t fid)
 	return FI_SUCCESS;
 }
 
-static void process_tx_entry(struct tcpx_xfer_entry *tx_entry)
+/* Completes the entry at the head of the tx queue */
+static void tcpx_tx_entry_done(struct tcpx_xfer_entry *tx_entry, int ret)
 {
 	struct tcpx_cq *tcpx_cq;
-	int ret;
-
-	ret = tcpx_send_msg(tx_entry);
-	if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
-		return;
-
-	if (ret) {
-		FI_WARN(&tcpx_prov, FI_LOG_DOMAIN, "msg send failed\n");
-
-		tcpx_ep_shutdown_report(tx_entry->ep,
-					&tx_entry->ep->util_ep.ep_fid.fid);
-	}
 
 	/* Keep this path below as a single pass path.*/
 	tx_entry->ep->hdr_bswap(&tx_entry->hdr.base_hdr);
@@ -125,6 +115,26 @@ static void process_tx_entry(struct tcpx_xfer_entry *tx_entry)
 	}
 }
 
+static void process_tx_entry(struct tcpx_xfer_entry *tx_entry)
+{
+	int ret;
+
+	ret = tcpx_send_msg(tx_entry);
+	if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret)) {
+		ofi_ep_stats_retry(&tx_entry->ep->util_ep);
+		return;
+	}
+
+	if (ret) {
+		FI_WARN(&tcpx_prov, FI_LOG_DOMAIN, "msg send failed\n");
+
+		tcpx_ep_shutdown_report(tx_entry->ep,
+					&tx_entry->ep->util_ep.ep_fid.fid);
+	}
+
+	tcpx_tx_entry_done(tx_entry, ret);
+}
+
 static int tcpx_prepare_rx_entry_resp(struct tcpx_xfer_entry *rx_entry)
 {
 	struct tcpx_cq *tcpx_tx_cq;
@@ -409,6 +419,118 @@ tcpx_rx_detect_init(struct tcpx_rx_detect *rx_detect)
 {
 	rx_detect->hdr_len = sizeof(rx_detect->hdr.base_hdr);
 	rx_detect->done_len = 0;
+	rx_detect->unexp = false;
+}
+
+/*
+ * Claims the next len bytes of a multi-recv buffer for rx_entry, which
+ * completes with the buffer's context.  A message larger than the buffer
+ * claims all of it, and its receive then fails with a truncation error.
+ * Returns true once less than min_len bytes are left: the caller then
+ * removes the buffer from its queue.
+ */
+bool tcpx_mrecv_claim(struct tcpx_xfer_entry *mrecv,
+		      struct tcpx_xfer_entry *rx_entry,
+		      size_t len, size_t min_len)
+{
+	len = MIN(len, mrecv->iov[0].iov_len);
+
+	rx_entry->flags = (mrecv->flags & FI_COMPLETION) | FI_MSG | FI_RECV;
+	rx_entry->context = mrecv->context;
+	rx_entry->iov_cnt = 1;
+	rx_entry->iov[0].iov_base = mrecv->iov[0].iov_base;
+	rx_entry->iov[0].iov_len = len;
+	rx_entry->mrecv_msg_start = mrecv->iov[0].iov_base;
+	rx_entry->mrecv = mrecv;
+
+	mrecv->iov[0].iov_base = (uint8_t *) mrecv->iov[0].iov_base + len;
+	mrecv->iov[0].iov_len -= len;
+	mrecv->mrecv_claims++;
+	mrecv->mrecv_carved = true;
+	if (mrecv->iov[0].iov_len >= min_len)
+		return false;
+
+	mrecv->mrecv_retired = true;
+	return true;
+}
+
+/*
+ * Called as a receive claimed from a multi-recv buffer completes.  The
+ * last receive to complete once the buffer has left its queue reports
+ * FI_MULTI_RECV, releasing the buffer to the application.  Receives on
+ * other endpoints sharing the buffer may complete concurrently, so the
+ * claim count is updated under the shared receive context's lock.
+ */
+void tcpx_mrecv_put(struct tcpx_xfer_entry *rx_entry)
+{
+	struct tcpx_xfer_entry *mrecv = rx_entry->mrecv;
+	struct tcpx_rx_ctx *srx_ctx = rx_entry->ep->srx_ctx;
+	struct tcpx_cq *tcpx_cq;
+	bool release;
+
+	rx_entry->mrecv = NULL;
+	if (srx_ctx)
+		fastlock_acquire(&srx_ctx->lock);
+
+	assert(mrecv->mrecv_claims);
+	release = !--mrecv->mrecv_claims && mrecv->mrecv_retired;
+	if (release) {
+		rx_entry->flags |= FI_MULTI_RECV;
+		if (srx_ctx)
+			util_buf_release(srx_ctx->buf_pool, mrecv);
+	}
+
+	if (srx_ctx) {
+		fastlock_release(&srx_ctx->lock);
+	} else if (release) {
+		tcpx_cq = container_of(rx_entry->ep->util_ep.rx_cq,
+				       struct tcpx_cq, util_cq);
+		tcpx_xfer_entry_release(tcpx_cq, mrecv);
+	}
+}
+
+/*
+ * Takes the receive for a len byte message from the head of the
+ * endpoint's rx queue.  Messages are carved out of multi-recv buffers in
+ * arrival order.  A buffer without room for the message leaves the queue,
+ * and is released once the receives already placed in it complete.
+ */
+static struct tcpx_xfer_entry *
+tcpx_ep_get_rx_entry(struct tcpx_ep *ep, size_t len)
+{
+	struct tcpx_xfer_entry *rx_entry, *mrecv;
+	struct tcpx_cq *tcpx_cq;
+
+	tcpx_cq = container_of(ep->util_ep.rx_cq, struct tcpx_cq, util_cq);
+	while (!slist_empty(&ep->rx_queue)) {
+		mrecv = container_of(ep->rx_queue.head,
+				     struct tcpx_xfer_entry, entry);
+		if (!(mrecv->flags & FI_MULTI_RECV)) {
+			slist_remove_head(&ep->rx_queue);
+			return mrecv;
+		}
+
+		if (len > mrecv->iov[0].iov_len && mrecv->mrecv_carved) {
+			slist_remove_head(&ep->rx_queue);
+			mrecv->mrecv_retired = true;
+			if (!mrecv->mrecv_claims) {
+				tcpx_cq_report_completion(ep->util_ep.rx_cq,
+							  mrecv, 0);
+				tcpx_xfer_entry_release(tcpx_cq, mrecv);
+			}
+			continue;
+		}
+
+		rx_entry = tcpx_xfer_entry_alloc(tcpx_cq, TCPX_OP_MSG_RECV);
+		if (!rx_entry)
+			return NULL;
+
+		if (tcpx_mrecv_claim(mrecv, rx_entry, len,
+				     ep->min_multi_recv))
+			slist_remove_head(&ep->rx_queue);
+		return rx_entry;
+	}
+	return NULL;
 }
 
 int tcpx_get_rx_entry_op_msg(struct tcpx_ep *tcpx_ep)
@@ -417,6 +539,7 @@ int tcpx_get_rx_entry_op_msg(struct tcpx_ep *tcpx_ep)
 	struct tcpx_xfer_entry *tx_entry;
 	struct tcpx_cq *tcpx_cq;
 	struct tcpx_rx_detect *rx_detect = &tcpx_ep->rx_detect;
+	size_t msg_len;
 	int ret;
 
 	tcpx_cq = container_of(tcpx_ep->util_ep.rx_cq,
@@ -438,25 +561,27 @@ int tcpx_get_rx_entry_op_msg(struct tcpx_ep *tcpx_ep)
 		return -FI_EAGAIN;
 	}
 
-	if (tcpx_ep->srx_ctx){
-		rx_entry = tcpx_srx_dequeue(tcpx_ep->srx_ctx);
-		if (!rx_entry)
-			return -FI_EAGAIN;
-
-	} else {
-		if (slist_empty(&tcpx_ep->rx_queue))
-			return -FI_EAGAIN;
-
-		rx_entry = container_of(slist_remove_head(&tcpx_ep->rx_queue),
-					struct tcpx_xfer_entry, entry);
+	msg_len = rx_detect->hdr.base_hdr.size - rx_detect->done_len;
+	if (tcpx_ep->srx_ctx)
+		rx_entry = tcpx_srx_dequeue(tcpx_ep->srx_ctx, tcpx_ep, msg_len);
+	else
+		rx_entry = tcpx_ep_get_rx_entry(tcpx_ep, msg_len);
+	if (!rx_entry) {
+		if (!rx_detect->unexp) {
+			rx_detect->unexp = true;
+			ofi_ep_stats_unexp(&tcpx_ep->util_ep);
+		}
+		return -FI_EAGAIN;
 	}
+
+	ofi_ep_stats_rx(&tcpx_ep->util_ep, msg_len);
 	tcpx_ep->cur_rx_proc_fn = process_rx_entry;
 
 	memcpy(&rx_entry->hdr, &tcpx_ep->rx_detect.hdr,
 	       (size_t) tcpx_ep->rx_detect.hdr.base_hdr.payload_off);
 	rx_entry->ep = tcpx_ep;
 	rx_entry->hdr.base_hdr.op_data = TCPX_OP_MSG_RECV;
-	rx_entry->rem_len = rx_entry->hdr.base_hdr.size - rx_detect->done_len;
+	rx_entry->rem_len = msg_len;
 	if (tcpx_ep->srx_ctx)
 		rx_entry->flags |= tcpx_ep->util_ep.rx_op_flags & FI_COMPLETION;
 
@@ -589,7 +714,7 @@ static void tcpx_process_stage_buffer(struct tcpx_ep *ep)
 
 	while (ep->stage_buf.len != ep->stage_buf.off) {
 		if (!ep->cur_rx_entry) {
-			ret = tcpx_recv_hdr(ep->conn_fd, &ep->stage_buf,
+			ret = tcpx_recv_hdr(ep, &ep->stage_buf,
 					    &ep->rx_detect);
 			if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
 				return;
@@ -624,7 +749,7 @@ static void tcpx_process_rx_msg(struct tcpx_ep *ep)
 
 	if (!ep->cur_rx_entry) {
 		if (ep->stage_buf.len == ep->stage_buf.off) {
-			ret = tcpx_read_to_buffer(ep->conn_fd, &ep->stage_buf);
+			ret = tcpx_read_to_buffer(ep, &ep->stage_buf);
 			if (ret && !OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
 				goto err1;
 
@@ -632,7 +757,7 @@ static void tcpx_process_rx_msg(struct tcpx_ep *ep)
 			return;
 		}
 
-		ret = tcpx_recv_hdr(ep->conn_fd, &ep->stage_buf,
+		ret = tcpx_recv_hdr(ep, &ep->stage_buf,
 				    &ep->rx_detect);
 		if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
 			return;
@@ -661,34 +786,365 @@ err1:
 		tcpx_ep_shutdown_report(ep, &ep->util_ep.ep_fid.fid);
 }
 
-static void process_tx_queue(struct tcpx_ep *ep)
+/*
+ * Accounts for sent bytes of the iovecs gathered by tcpx_tx_batch: every
+ * entry whose bytes were all sent is completed.  A negative value is a
+ * send error, which is reported against the entry at the queue head.
+ */
+void tcpx_tx_queue_sent(struct tcpx_ep *ep, ssize_t sent)
+{
+	struct tcpx_xfer_entry *tx_entry;
+
+	if (sent < 0) {
+		if (OFI_SOCK_TRY_SND_RCV_AGAIN(-sent))
+			return;
+
+		FI_WARN(&tcpx_prov, FI_LOG_DOMAIN, "msg send failed\n");
+		tcpx_ep_shutdown_report(ep, &ep->util_ep.ep_fid.fid);
+		tcpx_tx_entry_done(container_of(ep->tx_queue.head,
+						struct tcpx_xfer_entry, entry),
+				   (int) sent);
+		return;
+	}
+
+	while (sent) {
+		tx_entry = container_of(ep->tx_queue.head,
+					struct tcpx_xfer_entry, entry);
+		if ((size_t) sent < tx_entry->rem_len) {
+			tx_entry->rem_len -= sent;
+			ofi_consume_iov(tx_entry->iov, &tx_entry->iov_cnt, sent);
+			break;
+		}
+
+		sent -= tx_entry->rem_len;
+		tx_entry->rem_len = 0;
+		tcpx_tx_entry_done(tx_entry, 0);
+	}
+}
+
+/*
+ * Gathers the iovecs of as many queued entries as fit in TCPX_TX_BATCH_IOV
+ * iovecs and about TCPX_TX_BATCH_SIZE bytes.
+ */
+static size_t tcpx_tx_batch(struct tcpx_ep *ep, struct iovec *iov)
 {
 	struct tcpx_xfer_entry *tx_entry;
 	struct slist_entry *entry;
+	size_t iov_cnt = 0, len = 0;
+
+	for (entry = ep->tx_queue.head; entry && len < TCPX_TX_BATCH_SIZE;
+	     entry = entry->next) {
+		tx_entry = container_of(entry, struct tcpx_xfer_entry, entry);
+		if (iov_cnt + tx_entry->iov_cnt > TCPX_TX_BATCH_IOV)
+			break;
+
+		memcpy(&iov[iov_cnt], tx_entry->iov,
+		       tx_entry->iov_cnt * sizeof(*iov));
+		iov_cnt += tx_entry->iov_cnt;
+		len += tx_entry->rem_len;
+	}
+	return iov_cnt;
+}
+
+/*
+ * Sends a batch of queued entries with a single sendmsg.  With the io_uring
+ * engine the batch is submitted and tcpx_uring_progress accounts for it
+ * when the send completes.
+ */
+static void process_tx_queue(struct tcpx_ep *ep)
+{
+	struct iovec iov[TCPX_TX_BATCH_IOV];
+	size_t iov_cnt;
+	ssize_t sent;
+	int ret;
 
 	if (slist_empty(&ep->tx_queue))
 		return;
 
-	entry = ep->tx_queue.head;
-	tx_entry = container_of(entry, struct tcpx_xfer_entry, entry);
-	process_tx_entry(tx_entry);
+	if (ep->uring) {
+		if (tcpx_uring_tx_busy(ep))
+			return;
+
+		iov_cnt = tcpx_tx_batch(ep, iov);
+		ret = tcpx_uring_send(ep, iov, iov_cnt);
+		if (ret)
+			tcpx_tx_queue_sent(ep, ret);
+		return;
+	}
+
+	if (!ep->tx_queue.head->next) {
+		process_tx_entry(container_of(ep->tx_queue.head,
+					      struct tcpx_xfer_entry, entry));
+		return;
+	}
+
+	iov_cnt = tcpx_tx_batch(ep, iov);
+	sent = tcpx_send_iov(ep->conn_fd, iov, iov_cnt);
+	if (OFI_SOCK_TRY_SND_RCV_AGAIN(-sent))
+		ofi_ep_stats_retry(&ep->util_ep);
+	tcpx_tx_queue_sent(ep, sent);
 }
 
 void tcpx_ep_progress(struct tcpx_ep *ep)
 {
+	if (ep->uring)
+		tcpx_uring_progress(ep);
 	tcpx_process_rx_msg(ep);
 	process_tx_queue(ep);
 }
 
+static void tcpx_progress_ep(struct tcpx_ep *ep)
+{
+	fastlock_acquire(&ep->lock);
+	ep->progress_func(ep);
+	tcpx_ep_ready_update(ep);
+	fastlock_release(&ep->lock);
+}
+
 void tcpx_progress(struct util_ep *util_ep)
 {
+	struct tcpx_domain *domain;
 	struct tcpx_ep *ep;
 
 	ep = container_of(util_ep, struct tcpx_ep, util_ep);
-	fastlock_acquire(&ep->lock);
-	ep->progress_func(ep);
-	fastlock_release(&ep->lock);
-	return;
+	if (tcpx_progress_idle) {
+		domain = container_of(util_ep->domain, struct tcpx_domain,
+				      util_domain);
+		domain->app_progress_time = fi_gettime_us();
+	}
+	tcpx_progress_ep(ep);
+}
+
+/* Endpoints progressed per pass of the auto progress thread */
+#define TCPX_PROGRESS_BATCH 64
+
+static void tcpx_progress_thread_set_affinity(void)
+{
+	int ret;
+
+	if (!tcpx_progress_affinity)
+		return;
+
+	ret = ofi_set_thread_affinity(tcpx_progress_affinity);
+	if (ret)
+		FI_WARN(&tcpx_prov, FI_LOG_DOMAIN,
+			"unable to set progress thread affinity to %s: %s\n",
+			tcpx_progress_affinity, fi_strerror(-ret));
+}
+
+/*
+ * Progresses the endpoints of a domain whose wait fds are ready, so that
+ * transfers advance while the application is not reading its CQs.  With
+ * progress_idle set, the thread stands by while the application itself
+ * has driven progress within that many microseconds.
+ */
+static void *tcpx_progress_thread_func(void *arg)
+{
+	struct tcpx_domain *domain = arg;
+	void *ready[TCPX_PROGRESS_BATCH];
+	uint64_t idle;
+	int i, n;
+
+	tcpx_progress_thread_set_affinity();
+
+	while (domain->progress_run) {
+		if (tcpx_progress_idle) {
+			idle = fi_gettime_us() - domain->app_progress_time;
+			if (idle < (uint64_t) tcpx_progress_idle) {
+				usleep(tcpx_progress_idle - idle);
+				continue;
+			}
+		}
+
+		/* endpoints reported by the set are only used under the lock
+		 * that tcpx_cq_wait_ep_del takes to remove them */
+		fastlock_acquire(&domain->progress_lock);
+		n = fi_epoll_wait(domain->progress_set, ready,
+				  TCPX_PROGRESS_BATCH, 0);
+		for (i = 0; i < n; i++) {
+			if (ready[i])
+				tcpx_progress_ep(container_of(ready[i],
+						 struct tcpx_ep, util_ep));
+		}
+		fastlock_release(&domain->progress_lock);
+
+		/* leave the CPU to the application between passes */
+		if (n > 0)
+			sched_yield();
+		else if (!n)
+			fi_epoll_wait(domain->progress_set, ready, 1, -1);
+	}
+	return NULL;
+}
+
+int tcpx_progress_thread_start(struct tcpx_domain *domain)
+{
+	int ret;
+
+	ret = fi_epoll_create(&domain->progress_set);
+	if (ret)
+		return ret;
+
+	ret = fd_signal_init(&domain->progress_signal);
+	if (ret)
+		goto err1;
+
+	ret = fi_epoll_add(domain->progress_set,
+			   fd_signal_get(&domain->progress_signal),
+			   FI_EPOLL_IN, NULL);
+	if (ret)
+		goto err2;
+
+	fastlock_init(&domain->progress_lock);
+	domain->app_progress_time = fi_gettime_us();
+	domain->progress_run = 1;
+	ret = pthread_create(&domain->progress_thread, NULL,
+			     tcpx_progress_thread_func, domain);
+	if (ret) {
+		FI_WARN(&tcpx_prov, FI_LOG_DOMAIN,
+			"unable to start progress thread\n");
+		ret = -ret;
+		goto err3;
+	}
+	return FI_SUCCESS;
+err3:
+	domain->progress_run = 0;
+	fastlock_destroy(&domain->progress_lock);
+err2:
+	fd_signal_free(&domain->progress_signal);
+err1:
+	fi_epoll_close(domain->progress_set);
+	return ret;
+}
+
+void tcpx_progress_thread_stop(struct tcpx_domain *domain)
+{
+	if (!domain->progress_run)
+		return;
+
+	domain->progress_run = 0;
+	fd_signal_set(&domain->progress_signal);
+	pthread_join(domain->progress_thread, NULL);
+
+	fastlock_destroy(&domain->progress_lock);
+	fd_signal_free(&domain->progress_signal);
+	fi_epoll_close(domain->progress_set);
+}
+
+/*
+ * Updates and returns ep->rx_blocked: whether the message being received
+ * waits for a receive to be posted.  With a shared receive context, the
+ * flag is set before its queue is checked, and tcpx_srx_rx_posted checks
+ * the flag after queueing, so that one of them sees the other.  Caller
+ * holds ep->lock.
+ */
+static bool tcpx_ep_check_rx_blocked(struct tcpx_ep *ep)
+{
+	ep->rx_blocked = ep->rx_detect.unexp;
+	if (!ep->rx_blocked)
+		return false;
+
+	if (ep->srx_ctx) {
+		ofi_mb();
+		ep->rx_blocked = slist_empty(&ep->srx_ctx->rx_queue);
+	} else {
+		ep->rx_blocked = slist_empty(&ep->rx_queue);
+	}
+	return ep->rx_blocked;
+}
+
+/*
+ * Whether the endpoint has work that its wait fd will not signal: queued
+ * sends, or received data that a posted receive can take.  A send
+ * submitted to the io_uring engine signals the ring fd when it completes.
+ */
+static bool tcpx_ep_pending(struct tcpx_ep *ep)
+{
+	bool rx_blocked = tcpx_ep_check_rx_blocked(ep);
+
+	if (!rx_blocked && ep->stage_buf.off != ep->stage_buf.len)
+		return true;
+
+	if (ep->uring)
+		return (!rx_blocked && tcpx_uring_rx_pending(ep)) ||
+		       (!slist_empty(&ep->tx_queue) && !tcpx_uring_tx_busy(ep));
+
+	return !slist_empty(&ep->tx_queue);
+}
+
+/*
+ * Keeps FI_EPOLL_OUT registered with the CQ ready sets while the endpoint
+ * has queued sends or staged data for a posted receive, so that it is
+ * still progressed when no more data arrives.  While received data waits
+ * for a receive to be posted, nothing more can be read, so FI_EPOLL_IN is
+ * dropped as well, except for the ring fd of a busy io_uring send.
+ * Posting a receive re-arms the endpoint.  Caller holds ep->lock.
+ */
+void tcpx_ep_ready_update(struct tcpx_ep *ep)
+{
+	struct util_cq *tx_cq = ep->util_ep.tx_cq, *rx_cq = ep->util_ep.rx_cq;
+	uint32_t events = FI_EPOLL_IN;
+
+	if (ep->cm_state != TCPX_EP_CONNECTED) {
+		/* a disconnected socket stays readable, which would keep the
+		 * progress thread spinning until the endpoint is closed */
+		if (tcpx_progress_thread && ep->cm_state == TCPX_EP_SHUTDOWN &&
+		    ep->ready_events) {
+			fi_epoll_del(tcpx_ep_domain(ep)->progress_set,
+				     tcpx_ep_wait_fd(ep));
+			ep->ready_events = 0;
+		}
+		return;
+	}
+
+	if (tcpx_ep_pending(ep))
+		events |= FI_EPOLL_OUT;
+	if (ep->rx_blocked && !(ep->uring && tcpx_uring_tx_busy(ep)))
+		events &= ~FI_EPOLL_IN;
+	if (events == ep->ready_events)
+		return;
+
+	ep->ready_events = events;
+	if (ofi_cq_ready_mod(rx_cq, tcpx_ep_wait_fd(ep), events,
+			     &ep->util_ep))
+		FI_WARN(&tcpx_prov, FI_LOG_EP_DATA,
+			"failed to update CQ ready set\n");
+	if (tx_cq != rx_cq &&
+	    ofi_cq_ready_mod(tx_cq, tcpx_ep_wait_fd(ep), events,
+			     &ep->util_ep))
+		FI_WARN(&tcpx_prov, FI_LOG_EP_DATA,
+			"failed to update CQ ready set\n");
+	if (tcpx_progress_thread &&
+	    fi_epoll_mod(tcpx_ep_domain(ep)->progress_set, tcpx_ep_wait_fd(ep),
+			 events, &ep->util_ep))
+		FI_WARN(&tcpx_prov, FI_LOG_EP_DATA,
+			"failed to update progress thread set\n");
+}
+
+/* Caller holds ep->lock */
+void tcpx_ep_rx_posted(struct tcpx_ep *ep)
+{
+	if (ep->rx_blocked)
+		tcpx_ep_ready_update(ep);
+}
+
+/* Re-arms the endpoints whose data waited for a receive on the context */
+void tcpx_srx_rx_posted(struct tcpx_rx_ctx *srx_ctx)
+{
+	struct tcpx_ep *ep;
+
+	ofi_mb();
+	fastlock_acquire(&srx_ctx->ep_lock);
+	dlist_foreach_container(&srx_ctx->ep_list, struct tcpx_ep, ep,
+				srx_entry) {
+		if (!ep->rx_blocked)
+			continue;
+
+		fastlock_acquire(&ep->lock);
+		tcpx_ep_rx_posted(ep);
+		fastlock_release(&ep->lock);
+	}
+	fastlock_release(&srx_ctx->ep_lock);
 }
 
 static int tcpx_try_func(void *util_ep)
@@ -703,6 +1159,12 @@ static int tcpx_try_func(void *util_ep)
 			       struct util_wait_fd, util_wait);
 
 	fastlock_acquire(&ep->lock);
+	if (ep->uring) {
+		ret = tcpx_ep_pending(ep) ? -FI_EAGAIN : FI_SUCCESS;
+		fastlock_release(&ep->lock);
+		return ret;
+	}
+
 	if (!slist_empty(&ep->tx_queue) && !ep->send_ready_monitor) {
 		ep->send_ready_monitor = true;
 		events = FI_EPOLL_IN | FI_EPOLL_OUT;
@@ -724,29 +1186,102 @@ epoll_mod:
 	return ret;
 }
 
+/*
+ * Registers one of the endpoint's fds with its CQ ready sets, the wait set
+ * of its receive CQ and the progress thread set.
+ */
+static int tcpx_cq_wait_fd_add(struct tcpx_ep *ep, int fd)
+{
+	struct util_cq *tx_cq = ep->util_ep.tx_cq, *rx_cq = ep->util_ep.rx_cq;
+	int ret;
+
+	ret = ofi_cq_ready_add(rx_cq, fd, FI_EPOLL_IN, &ep->util_ep);
+	if (ret)
+		return ret;
+
+	if (tx_cq != rx_cq) {
+		ret = ofi_cq_ready_add(tx_cq, fd, FI_EPOLL_IN,
+				       &ep->util_ep);
+		if (ret)
+			goto err;
+	}
+
+	if (rx_cq->wait) {
+		ret = ofi_wait_fd_add(rx_cq->wait, fd, FI_EPOLL_IN,
+				      tcpx_try_func, (void *)&ep->util_ep,
+				      NULL);
+		if (ret)
+			goto err;
+	}
+
+	if (tcpx_progress_thread) {
+		ret = fi_epoll_add(tcpx_ep_domain(ep)->progress_set, fd,
+				   FI_EPOLL_IN, &ep->util_ep);
+		if (ret)
+			goto err_wait;
+	}
+	return FI_SUCCESS;
+err_wait:
+	if (rx_cq->wait)
+		ofi_wait_fd_del(rx_cq->wait, fd);
+err:
+	ofi_cq_ready_del(rx_cq, fd);
+	if (tx_cq != rx_cq)
+		ofi_cq_ready_del(tx_cq, fd);
+	return ret;
+}
+
+static void tcpx_cq_wait_fd_del(struct tcpx_ep *ep, int fd)
+{
+	ofi_cq_ready_del(ep->util_ep.rx_cq, fd);
+	if (ep->util_ep.tx_cq != ep->util_ep.rx_cq)
+		ofi_cq_ready_del(ep->util_ep.tx_cq, fd);
+
+	if (ep->util_ep.rx_cq->wait) {
+		ofi_wait_fd_del(ep->util_ep.rx_cq->wait, fd);
+	}
+	if (tcpx_progress_thread)
+		fi_epoll_del(tcpx_ep_domain(ep)->progress_set, fd);
+}
+
+/*
+ * An io_uring endpoint also registers the domain ring, which signals
+ * completions of its requests before they are reaped.
+ */
 int tcpx_cq_wait_ep_add(struct tcpx_ep *ep)
 {
-	if (!ep->util_ep.rx_cq->wait)
-		return FI_SUCCESS;
+	int ret;
+
+	ep->ready_events = FI_EPOLL_IN;
+	ret = tcpx_cq_wait_fd_add(ep, tcpx_ep_wait_fd(ep));
+	if (ret || !ep->uring)
+		return ret;
 
-	return ofi_wait_fd_add(ep->util_ep.rx_cq->wait,
-			       ep->conn_fd, FI_EPOLL_IN,
-			       tcpx_try_func, (void *)&ep->util_ep,
-			       NULL);
+	ret = tcpx_cq_wait_fd_add(ep, tcpx_uring_ring_fd(ep));
+	if (ret)
+		tcpx_cq_wait_fd_del(ep, tcpx_ep_wait_fd(ep));
+	return ret;
 }
 
 void tcpx_cq_wait_ep_del(struct tcpx_ep *ep)
 {
+	struct tcpx_domain *domain = tcpx_ep_domain(ep);
+
+	/* taken before ep->lock, in the same order as the progress thread */
+	if (tcpx_progress_thread)
+		fastlock_acquire(&domain->progress_lock);
 	fastlock_acquire(&ep->lock);
 	if (ep->cm_state == TCPX_EP_CONNECTING) {
 		goto out;
 	}
 
-	if (ep->util_ep.rx_cq->wait) {
-		ofi_wait_fd_del(ep->util_ep.rx_cq->wait, ep->conn_fd);
-	}
+	tcpx_cq_wait_fd_del(ep, tcpx_ep_wait_fd(ep));
+	if (ep->uring)
+		tcpx_cq_wait_fd_del(ep, tcpx_uring_ring_fd(ep));
 out:
 	fastlock_release(&ep->lock);
+	if (tcpx_progress_thread)
+		fastlock_release(&domain->progress_lock);
 }
 
 void tcpx_tx_queue_insert(struct tcpx_ep *tcpx_ep,
@@ -755,13 +1290,29 @@ void tcpx_tx_queue_insert(struct tcpx_ep *tcpx_ep,
 	int empty;
 	struct util_wait *wait = tcpx_ep->util_ep.tx_cq->wait;
 
+	if (tx_entry->hdr.base_hdr.op_data != TCPX_OP_MSG_RESP)
+		ofi_ep_stats_tx(&tcpx_ep->util_ep, tx_entry->rem_len -
+				tx_entry->hdr.base_hdr.payload_off);
+
 	empty = slist_empty(&tcpx_ep->tx_queue);
 	slist_insert_tail(&tx_entry->entry, &tcpx_ep->tx_queue);
 
-	if (empty) {
+	/* FI_MORE defers the send so that the next post (or progress)
+	 * coalesces the queued messages into one sendmsg */
+	if (tx_entry->flags & FI_MORE) {
+		tx_entry->flags &= ~FI_MORE;
+		tcpx_ep_ready_update(tcpx_ep);
+		return;
+	}
+
+	if (empty)
 		process_tx_entry(tx_entry);
+	else
+		process_tx_queue(tcpx_ep);
 
-		if (!slist_empty(&tcpx_ep->tx_queue) && wait)
+	if (!slist_empty(&tcpx_ep->tx_queue)) {
+		tcpx_ep_ready_update(tcpx_ep);
+		if (wait)
 			wait->signal(wait);
 	}
 }
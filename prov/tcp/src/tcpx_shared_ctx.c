@@ -54,6 +54,11 @@ static inline void tcpx_srx_recv_init(struct tcpx_xfer_entry *recv_entry,
 {
 	recv_entry->flags = base_flags | FI_MSG | FI_RECV;
 	recv_entry->context = context;
+	recv_entry->mrecv_msg_start = NULL;
+	recv_entry->mrecv = NULL;
+	recv_entry->mrecv_claims = 0;
+	recv_entry->mrecv_carved = false;
+	recv_entry->mrecv_retired = false;
 }
 
 static inline void tcpx_srx_recv_init_iov(struct tcpx_xfer_entry *recv_entry,
@@ -63,17 +68,55 @@ static inline void tcpx_srx_recv_init_iov(struct tcpx_xfer_entry *recv_entry,
 	memcpy(&recv_entry->iov[0], iov, count * sizeof(*iov));
 }
 
+/*
+ * Takes the receive for a len byte message arriving on ep.  Messages are
+ * carved out of multi-recv buffers in arrival order, whichever endpoint
+ * they arrive on.  A buffer without room for the message leaves the queue,
+ * and is released once the receives already placed in it complete; a
+ * message larger than a whole buffer fails with a truncation error.
+ */
 struct tcpx_xfer_entry *
-tcpx_srx_dequeue(struct tcpx_rx_ctx *srx_ctx)
+tcpx_srx_dequeue(struct tcpx_rx_ctx *srx_ctx, struct tcpx_ep *ep, size_t len)
 {
-	struct tcpx_xfer_entry *xfer_entry;
+	struct tcpx_xfer_entry *xfer_entry = NULL, *mrecv;
+
+	/* Checked without the lock: with many connections, most endpoints
+	 * find nothing posted.  A receive posted meanwhile is found when the
+	 * endpoint is next progressed, as its message is still pending. */
+	if (slist_empty(&srx_ctx->rx_queue))
+		return NULL;
 
 	fastlock_acquire(&srx_ctx->lock);
-	if (!slist_empty(&srx_ctx->rx_queue)) {
-		xfer_entry = container_of(slist_remove_head(&srx_ctx->rx_queue),
-					  struct tcpx_xfer_entry, entry);
-	} else {
-		xfer_entry = NULL;
+	while (!slist_empty(&srx_ctx->rx_queue)) {
+		mrecv = container_of(srx_ctx->rx_queue.head,
+				     struct tcpx_xfer_entry, entry);
+		if (!(mrecv->flags & FI_MULTI_RECV)) {
+			slist_remove_head(&srx_ctx->rx_queue);
+			xfer_entry = mrecv;
+			break;
+		}
+
+		if (len > mrecv->iov[0].iov_len && mrecv->mrecv_carved) {
+			slist_remove_head(&srx_ctx->rx_queue);
+			mrecv->mrecv_retired = true;
+			if (!mrecv->mrecv_claims) {
+				mrecv->flags |= ep->util_ep.rx_op_flags &
+						FI_COMPLETION;
+				tcpx_cq_report_completion(ep->util_ep.rx_cq,
+							  mrecv, 0);
+				util_buf_release(srx_ctx->buf_pool, mrecv);
+			}
+			continue;
+		}
+
+		xfer_entry = util_buf_alloc(srx_ctx->buf_pool);
+		if (!xfer_entry)
+			break;
+
+		if (tcpx_mrecv_claim(mrecv, xfer_entry, len,
+				     srx_ctx->min_multi_recv))
+			slist_remove_head(&srx_ctx->rx_queue);
+		break;
 	}
 	fastlock_release(&srx_ctx->lock);
 	return xfer_entry;
@@ -88,6 +131,8 @@ static ssize_t tcpx_srx_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 
 	srx_ctx = container_of(ep, struct tcpx_rx_ctx, rx_fid);
 	assert(msg->iov_count <= TCPX_IOV_LIMIT);
+	if ((flags & FI_MULTI_RECV) && msg->iov_count != 1)
+		return -FI_EINVAL;
 
 	fastlock_acquire(&srx_ctx->lock);
 	recv_entry = util_buf_alloc(srx_ctx->buf_pool);
@@ -102,6 +147,8 @@ static ssize_t tcpx_srx_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 	slist_insert_tail(&recv_entry->entry, &srx_ctx->rx_queue);
 unlock:
 	fastlock_release(&srx_ctx->lock);
+	if (!ret)
+		tcpx_srx_rx_posted(srx_ctx);
 	return ret;
 }
 
@@ -121,7 +168,8 @@ static ssize_t tcpx_srx_recv(struct fid_ep *ep, void *buf, size_t len, void *des
 		goto unlock;
 	}
 
-	tcpx_srx_recv_init(recv_entry, 0, context);
+	tcpx_srx_recv_init(recv_entry, srx_ctx->op_flags & FI_MULTI_RECV,
+			   context);
 	recv_entry->iov_cnt = 1;
 	recv_entry->iov[0].iov_base = buf;
 	recv_entry->iov[0].iov_len = len;
@@ -129,6 +177,8 @@ static ssize_t tcpx_srx_recv(struct fid_ep *ep, void *buf, size_t len, void *des
 	slist_insert_tail(&recv_entry->entry, &srx_ctx->rx_queue);
 unlock:
 	fastlock_release(&srx_ctx->lock);
+	if (!ret)
+		tcpx_srx_rx_posted(srx_ctx);
 	return ret;
 }
 
@@ -141,6 +191,8 @@ static ssize_t tcpx_srx_recvv(struct fid_ep *ep, const struct iovec *iov, void *
 
 	srx_ctx = container_of(ep, struct tcpx_rx_ctx, rx_fid);
 	assert(count <= TCPX_IOV_LIMIT);
+	if ((srx_ctx->op_flags & FI_MULTI_RECV) && count != 1)
+		return -FI_EINVAL;
 
 	fastlock_acquire(&srx_ctx->lock);
 	recv_entry = util_buf_alloc(srx_ctx->buf_pool);
@@ -149,12 +201,15 @@ static ssize_t tcpx_srx_recvv(struct fid_ep *ep, const struct iovec *iov, void *
 		goto unlock;
 	}
 
-	tcpx_srx_recv_init(recv_entry, 0, context);
+	tcpx_srx_recv_init(recv_entry, srx_ctx->op_flags & FI_MULTI_RECV,
+			   context);
 	tcpx_srx_recv_init_iov(recv_entry, count, iov);
 
 	slist_insert_tail(&recv_entry->entry, &srx_ctx->rx_queue);
 unlock:
 	fastlock_release(&srx_ctx->lock);
+	if (!ret)
+		tcpx_srx_rx_posted(srx_ctx);
 	return ret;
 }
 
@@ -170,3 +225,61 @@ struct fi_ops_msg tcpx_srx_msg_ops = {
 	.senddata = fi_no_msg_senddata,
 	.injectdata = fi_no_msg_injectdata,
 };
+
+static int tcpx_srx_getopt(fid_t fid, int level, int optname,
+			   void *optval, size_t *optlen)
+{
+	struct tcpx_rx_ctx *srx_ctx;
+
+	srx_ctx = container_of(fid, struct tcpx_rx_ctx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT)
+		return -FI_ENOPROTOOPT;
+
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		if (*optlen < sizeof(size_t)) {
+			*optlen = sizeof(size_t);
+			return -FI_ETOOSMALL;
+		}
+		*(size_t *) optval = srx_ctx->min_multi_recv;
+		*optlen = sizeof(size_t);
+		break;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
+	return FI_SUCCESS;
+}
+
+static int tcpx_srx_setopt(fid_t fid, int level, int optname,
+			   const void *optval, size_t optlen)
+{
+	struct tcpx_rx_ctx *srx_ctx;
+
+	srx_ctx = container_of(fid, struct tcpx_rx_ctx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT)
+		return -FI_ENOPROTOOPT;
+
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+		fastlock_acquire(&srx_ctx->lock);
+		srx_ctx->min_multi_recv = *(size_t *) optval;
+		fastlock_release(&srx_ctx->lock);
+		break;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
+	return FI_SUCCESS;
+}
+
+struct fi_ops_ep tcpx_srx_ops = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = fi_no_cancel,
+	.getopt = tcpx_srx_getopt,
+	.setopt = tcpx_srx_setopt,
+	.tx_ctx = fi_no_tx_ctx,
+	.rx_ctx = fi_no_rx_ctx,
+	.rx_size_left = fi_no_rx_size_left,
+	.tx_size_left = fi_no_tx_size_left,
+};
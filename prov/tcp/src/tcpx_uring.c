@@ -0,0 +1,897 @@
+/*
+ * Copyright (c) 2019 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *	   Redistribution and use in source and binary forms, with or
+ *	   without modification, are permitted provided that the following
+ *	   conditions are met:
+ *
+ *		- Redistributions of source code must retain the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer.
+ *
+ *		- Redistributions in binary form must reproduce the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer in the documentation and/or other materials
+ *		  provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * io_uring I/O engine.  A domain owns one ring and one pool of receive
+ * buffers, which its connected endpoints share.  Each endpoint keeps a
+ * multishot receive armed on its socket that fills buffers from the pool,
+ * so incoming data is picked up from the completion queue without any
+ * system call.  The receive path then copies from those buffers as if it
+ * were reading the socket.  While the pool has no buffers for an endpoint,
+ * it reads its socket directly instead, so that data held by other
+ * endpoints cannot stall it.  Queued sends are submitted as one sendmsg
+ * request at a time per endpoint, which completes in the background.
+ *
+ * Whichever endpoint progresses first reaps the ring's completions and
+ * hands them to the endpoints they belong to, signaling their fds.  The
+ * ring and the per-endpoint state it touches are protected by uring->lock,
+ * which is taken after ep->lock.
+ */
+
+#include <rdma/fi_errno.h>
+#include <ofi_prov.h>
+#include <sys/types.h>
+#include <ofi_util.h>
+#include <ofi_iov.h>
+#include "tcpx.h"
+
+#if HAVE_TCP_IO_URING
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define TCPX_URING_SQ_SIZE	8
+#define TCPX_URING_CQ_SIZE	(2 * TCPX_URING_BUF_CNT)
+#define TCPX_URING_BUF_CNT	128
+#define TCPX_URING_BUF_SIZE	(8 * 1024)
+#define TCPX_URING_BGID		0
+
+/* Low bits of a request's user_data, which holds its tcpx_uring_ep */
+enum {
+	TCPX_URING_RECV,
+	TCPX_URING_SEND,
+	TCPX_URING_POLL,
+	TCPX_URING_OP_MASK = 3,
+};
+
+/* Pool buffer holding received data, queued on its endpoint by next */
+struct tcpx_uring_buf {
+	uint32_t		len;
+	uint32_t		off;
+	uint16_t		next;
+};
+
+struct tcpx_uring {
+	int			fd;
+	fastlock_t		lock;
+
+	void			*sq_ring;
+	size_t			sq_ring_size;
+	unsigned		*sq_head;
+	unsigned		*sq_tail;
+	unsigned		*sq_flags;
+	unsigned		sq_mask;
+	unsigned		*sq_array;
+	struct io_uring_sqe	*sqes;
+	size_t			sqes_size;
+
+	void			*cq_ring;
+	size_t			cq_ring_size;
+	unsigned		*cq_head;
+	unsigned		*cq_tail;
+	unsigned		cq_mask;
+	struct io_uring_cqe	*cqes;
+
+	struct io_uring_buf_ring *br;
+	uint8_t			*bufs;
+	struct tcpx_uring_buf	buf_info[TCPX_URING_BUF_CNT];
+	uint16_t		br_tail;
+	/* buffers in the buffer ring, as far as reaped completions tell */
+	unsigned		buf_free;
+	/* endpoints whose receive stopped while the stream is open */
+	struct dlist_entry	rearm_list;
+};
+
+/* Endpoint state, protected by uring->lock unless noted */
+struct tcpx_uring_ep {
+	struct tcpx_uring	*uring;
+	int			sock;
+	/* dup of the ring fd, signaled when any request completes */
+	int			ring_fd;
+	/* set when another endpoint reaps a completion for this one */
+	struct fd_signal	signal;
+
+	/* received data, as a queue of pool buffers */
+	uint16_t		rx_head;
+	uint16_t		rx_tail;
+	unsigned		rx_cnt;
+	/* 0 while the stream is open, -FI_ENOTCONN or an error after */
+	int			rx_err;
+	bool			recv_armed;
+	struct dlist_entry	rearm_entry;
+	/* waits for the socket to become readable while the receive is
+	 * stopped for lack of buffers */
+	bool			poll_armed;
+	/* requests are being canceled by tcpx_uring_fini */
+	bool			closing;
+
+	bool			tx_busy;
+	/* completed send that the endpoint has not accounted for yet */
+	bool			tx_done;
+	int			tx_res;
+	struct msghdr		tx_msg;
+	struct iovec		tx_iov[TCPX_TX_BATCH_IOV];
+};
+
+static int tcpx_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int tcpx_io_uring_enter(int fd, unsigned to_submit,
+			       unsigned min_complete, unsigned flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			     flags, NULL, 0);
+}
+
+static int tcpx_io_uring_register(int fd, unsigned opcode, void *arg,
+				  unsigned nr_args)
+{
+	return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void tcpx_uring_unmap(struct tcpx_uring *uring)
+{
+	if (uring->sqes)
+		munmap(uring->sqes, uring->sqes_size);
+	if (uring->cq_ring && uring->cq_ring != uring->sq_ring)
+		munmap(uring->cq_ring, uring->cq_ring_size);
+	if (uring->sq_ring)
+		munmap(uring->sq_ring, uring->sq_ring_size);
+}
+
+static int tcpx_uring_map(struct tcpx_uring *uring, struct io_uring_params *p)
+{
+	uint8_t *sq, *cq;
+
+	uring->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+	uring->cq_ring_size = p->cq_off.cqes +
+			      p->cq_entries * sizeof(struct io_uring_cqe);
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+		uring->sq_ring_size = uring->cq_ring_size =
+			MAX(uring->sq_ring_size, uring->cq_ring_size);
+
+	sq = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		return -errno;
+	uring->sq_ring = sq;
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		cq = sq;
+	} else {
+		cq = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, uring->fd,
+			  IORING_OFF_CQ_RING);
+		if (cq == MAP_FAILED)
+			return -errno;
+	}
+	uring->cq_ring = cq;
+
+	uring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, uring->fd,
+			   IORING_OFF_SQES);
+	if (uring->sqes == MAP_FAILED) {
+		uring->sqes = NULL;
+		return -errno;
+	}
+
+	uring->sq_head = (unsigned *) (sq + p->sq_off.head);
+	uring->sq_tail = (unsigned *) (sq + p->sq_off.tail);
+	uring->sq_flags = (unsigned *) (sq + p->sq_off.flags);
+	uring->sq_mask = *(unsigned *) (sq + p->sq_off.ring_mask);
+	uring->sq_array = (unsigned *) (sq + p->sq_off.array);
+	uring->cq_head = (unsigned *) (cq + p->cq_off.head);
+	uring->cq_tail = (unsigned *) (cq + p->cq_off.tail);
+	uring->cq_mask = *(unsigned *) (cq + p->cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *) (cq + p->cq_off.cqes);
+	return 0;
+}
+
+static void tcpx_uring_buf_add(struct tcpx_uring *uring, uint16_t bid)
+{
+	struct io_uring_buf *buf;
+
+	buf = &uring->br->bufs[uring->br_tail & (TCPX_URING_BUF_CNT - 1)];
+	buf->addr = (uintptr_t) &uring->bufs[bid * TCPX_URING_BUF_SIZE];
+	buf->len = TCPX_URING_BUF_SIZE;
+	buf->bid = bid;
+	__atomic_store_n(&uring->br->tail, ++uring->br_tail, __ATOMIC_RELEASE);
+	uring->buf_free++;
+}
+
+static int tcpx_uring_bufs_init(struct tcpx_uring *uring)
+{
+	struct io_uring_buf_reg reg = {0};
+	size_t size;
+	uint16_t bid;
+	int ret;
+
+	size = TCPX_URING_BUF_CNT * sizeof(struct io_uring_buf);
+	uring->br = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (uring->br == MAP_FAILED) {
+		uring->br = NULL;
+		return -errno;
+	}
+
+	uring->bufs = malloc(TCPX_URING_BUF_CNT * TCPX_URING_BUF_SIZE);
+	if (!uring->bufs)
+		return -FI_ENOMEM;
+
+	reg.ring_addr = (uintptr_t) uring->br;
+	reg.ring_entries = TCPX_URING_BUF_CNT;
+	reg.bgid = TCPX_URING_BGID;
+	ret = tcpx_io_uring_register(uring->fd, IORING_REGISTER_PBUF_RING,
+				     &reg, 1);
+	if (ret)
+		return -errno;
+
+	for (bid = 0; bid < TCPX_URING_BUF_CNT; bid++)
+		tcpx_uring_buf_add(uring, bid);
+	return 0;
+}
+
+static void tcpx_uring_free(struct tcpx_uring *uring)
+{
+	if (uring->fd >= 0)
+		close(uring->fd);
+	tcpx_uring_unmap(uring);
+	if (uring->br)
+		munmap(uring->br,
+		       TCPX_URING_BUF_CNT * sizeof(struct io_uring_buf));
+	free(uring->bufs);
+	fastlock_destroy(&uring->lock);
+	free(uring);
+}
+
+static struct tcpx_uring *tcpx_uring_alloc(int *err)
+{
+	struct io_uring_params p = {0};
+	struct tcpx_uring *uring;
+
+	uring = calloc(1, sizeof(*uring));
+	if (!uring) {
+		*err = -FI_ENOMEM;
+		return NULL;
+	}
+	fastlock_init(&uring->lock);
+	dlist_init(&uring->rearm_list);
+
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = TCPX_URING_CQ_SIZE;
+	uring->fd = tcpx_io_uring_setup(TCPX_URING_SQ_SIZE, &p);
+	if (uring->fd < 0) {
+		*err = -errno;
+		goto err;
+	}
+
+	*err = tcpx_uring_map(uring, &p);
+	if (*err)
+		goto err;
+
+	*err = tcpx_uring_bufs_init(uring);
+	if (*err)
+		goto err;
+	return uring;
+err:
+	tcpx_uring_free(uring);
+	return NULL;
+}
+
+static struct io_uring_sqe *tcpx_uring_get_sqe(struct tcpx_uring *uring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail, idx;
+
+	tail = *uring->sq_tail;
+	if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >
+	    uring->sq_mask)
+		return NULL;
+
+	idx = tail & uring->sq_mask;
+	sqe = &uring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	uring->sq_array[idx] = idx;
+	return sqe;
+}
+
+static int tcpx_uring_submit(struct tcpx_uring *uring)
+{
+	int ret;
+
+	__atomic_store_n(uring->sq_tail, *uring->sq_tail + 1,
+			 __ATOMIC_RELEASE);
+	do {
+		ret = tcpx_io_uring_enter(uring->fd, 1, 0, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : 0;
+}
+
+static int tcpx_uring_arm_recv(struct tcpx_uring *uring, int sock,
+			       uint64_t user_data)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = tcpx_uring_get_sqe(uring);
+	if (!sqe)
+		return -FI_EAGAIN;
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = sock;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = TCPX_URING_BGID;
+	sqe->user_data = user_data;
+	return tcpx_uring_submit(uring);
+}
+
+static int tcpx_uring_ep_arm(struct tcpx_uring_ep *uep)
+{
+	int ret;
+
+	ret = tcpx_uring_arm_recv(uep->uring, uep->sock,
+				  (uintptr_t) uep | TCPX_URING_RECV);
+	if (!ret)
+		uep->recv_armed = true;
+	return ret;
+}
+
+static int tcpx_uring_ep_poll(struct tcpx_uring_ep *uep)
+{
+	struct io_uring_sqe *sqe;
+	int ret;
+
+	sqe = tcpx_uring_get_sqe(uep->uring);
+	if (!sqe)
+		return -FI_EAGAIN;
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = uep->sock;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = (uintptr_t) uep | TCPX_URING_POLL;
+	ret = tcpx_uring_submit(uep->uring);
+	if (!ret)
+		uep->poll_armed = true;
+	return ret;
+}
+
+/* Cancels the endpoint's request identified by op */
+static int tcpx_uring_cancel(struct tcpx_uring_ep *uep, int op)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = tcpx_uring_get_sqe(uep->uring);
+	if (!sqe)
+		return -FI_EAGAIN;
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = (uintptr_t) uep | op;
+	return tcpx_uring_submit(uep->uring);
+}
+
+/*
+ * Re-arms the receives that stopped while their streams are open, in the
+ * order they stopped, while buffers are available.
+ */
+static void tcpx_uring_rearm(struct tcpx_uring *uring)
+{
+	struct tcpx_uring_ep *uep;
+	int ret;
+
+	while (uring->buf_free && !dlist_empty(&uring->rearm_list)) {
+		uep = container_of(uring->rearm_list.next,
+				   struct tcpx_uring_ep, rearm_entry);
+		ret = tcpx_uring_ep_arm(uep);
+		if (ret == -FI_EAGAIN)
+			return;
+
+		dlist_remove_init(&uep->rearm_entry);
+		if (ret) {
+			uep->rx_err = ret;
+			fd_signal_set(&uep->signal);
+		}
+	}
+}
+
+/*
+ * Completion of a multishot receive.  Returns whether the endpoint has
+ * something new to process.
+ */
+static bool tcpx_uring_recv_done(struct tcpx_uring *uring,
+				 struct tcpx_uring_ep *uep,
+				 struct io_uring_cqe *cqe)
+{
+	uint16_t bid;
+
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		uep->recv_armed = false;
+
+	if (cqe->res > 0) {
+		assert(cqe->flags & IORING_CQE_F_BUFFER);
+		bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		uring->buf_info[bid].len = cqe->res;
+		uring->buf_info[bid].off = 0;
+		if (uep->rx_cnt++)
+			uring->buf_info[uep->rx_tail].next = bid;
+		else
+			uep->rx_head = bid;
+		uep->rx_tail = bid;
+		uring->buf_free--;
+		return true;
+	}
+
+	/*
+	 * The receive stops when the pool runs out of buffers, and is
+	 * canceled when the thread that armed it exits.  It is armed again
+	 * once buffers are available, and the endpoint reads its socket
+	 * directly until then.
+	 */
+	if (cqe->res == -ENOBUFS ||
+	    (cqe->res == -ECANCELED && !uep->closing)) {
+		if (!uep->recv_armed && !uep->rx_err &&
+		    dlist_empty(&uep->rearm_entry))
+			dlist_insert_tail(&uep->rearm_entry, &uring->rearm_list);
+		return true;
+	}
+
+	if (!uep->recv_armed && !uep->rx_err)
+		uep->rx_err = cqe->res ? cqe->res : -FI_ENOTCONN;
+	return true;
+}
+
+/*
+ * Reaps the ring's completions.  Received data is queued on its endpoint
+ * and finished sends are recorded for their endpoint to account for.
+ * Endpoints other than self are signaled.  Caller holds uring->lock.
+ */
+static void tcpx_uring_reap(struct tcpx_uring *uring,
+			    struct tcpx_uring_ep *self)
+{
+	struct tcpx_uring_ep *uep;
+	struct io_uring_cqe *cqe;
+	unsigned head, tail;
+	bool work;
+
+	head = *uring->cq_head;
+	tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		cqe = &uring->cqes[head & uring->cq_mask];
+		uep = (struct tcpx_uring_ep *) (uintptr_t)
+		      (cqe->user_data & ~(uint64_t) TCPX_URING_OP_MASK);
+		/* cancel requests carry no endpoint */
+		if (!uep)
+			continue;
+
+		switch (cqe->user_data & TCPX_URING_OP_MASK) {
+		case TCPX_URING_RECV:
+			work = tcpx_uring_recv_done(uring, uep, cqe);
+			break;
+		case TCPX_URING_SEND:
+			uep->tx_busy = false;
+			uep->tx_done = true;
+			/* canceled by the exit of the submitting thread, the
+			 * endpoint sends the data again */
+			uep->tx_res = (cqe->res == -ECANCELED && !uep->closing) ?
+				      0 : cqe->res;
+			work = true;
+			break;
+		default:
+			uep->poll_armed = false;
+			work = true;
+			break;
+		}
+
+		if (work && uep != self)
+			fd_signal_set(&uep->signal);
+	}
+	__atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+
+	/* completions that did not fit the CQ are flushed by the kernel */
+	if (__atomic_load_n(uring->sq_flags, __ATOMIC_RELAXED) &
+	    IORING_SQ_CQ_OVERFLOW)
+		tcpx_io_uring_enter(uring->fd, 0, 0, IORING_ENTER_GETEVENTS);
+
+	tcpx_uring_rearm(uring);
+}
+
+/*
+ * Reaps the domain ring and accounts for the endpoint's finished send.
+ * Caller holds ep->lock.
+ */
+void tcpx_uring_progress(struct tcpx_ep *ep)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	struct tcpx_uring *uring = uep->uring;
+	bool tx_done;
+	int tx_res;
+
+	fastlock_acquire(&uring->lock);
+	fd_signal_reset(&uep->signal);
+	tcpx_uring_reap(uring, uep);
+	tx_done = uep->tx_done;
+	tx_res = uep->tx_res;
+	uep->tx_done = false;
+	fastlock_release(&uring->lock);
+
+	if (tx_done)
+		tcpx_tx_queue_sent(ep, tx_res == -EPIPE ? -FI_ENOTCONN : tx_res);
+}
+
+static size_t tcpx_uring_copy(struct tcpx_uring_ep *uep, uint8_t *buf,
+			      size_t len)
+{
+	struct tcpx_uring *uring = uep->uring;
+	struct tcpx_uring_buf *info;
+	size_t copied = 0, n;
+
+	while (uep->rx_cnt && copied < len) {
+		info = &uring->buf_info[uep->rx_head];
+		n = MIN(len - copied, info->len - info->off);
+		memcpy(buf + copied,
+		       &uring->bufs[uep->rx_head * TCPX_URING_BUF_SIZE +
+				    info->off], n);
+		copied += n;
+		info->off += n;
+		if (info->off == info->len) {
+			tcpx_uring_buf_add(uring, uep->rx_head);
+			uep->rx_head = info->next;
+			uep->rx_cnt--;
+		}
+	}
+	return copied;
+}
+
+/*
+ * Reads the socket while the receive is stopped for lack of buffers.  No
+ * request is armed on the socket and no data is queued then, so the stream
+ * stays in order.  A poll request signals when more data arrives.
+ */
+static ssize_t tcpx_uring_recv_direct(struct tcpx_uring_ep *uep,
+				      struct iovec *iov, size_t iov_cnt)
+{
+	ssize_t ret;
+
+	ret = ofi_readv_socket(uep->sock, iov, iov_cnt);
+	if (ret > 0)
+		return ret;
+
+	ret = ret ? -ofi_sockerr() : -FI_ENOTCONN;
+	if (!OFI_SOCK_TRY_SND_RCV_AGAIN(-ret)) {
+		uep->rx_err = (int) ret;
+		return ret;
+	}
+
+	if (!uep->poll_armed) {
+		ret = tcpx_uring_ep_poll(uep);
+		if (ret && ret != -FI_EAGAIN) {
+			uep->rx_err = (int) ret;
+			return ret;
+		}
+	}
+	return -FI_EAGAIN;
+}
+
+/* Result of a receive from an endpoint without queued data */
+static ssize_t tcpx_uring_recv_empty(struct tcpx_uring_ep *uep,
+				     struct iovec *iov, size_t iov_cnt)
+{
+	if (uep->rx_err)
+		return uep->rx_err;
+
+	return uep->recv_armed ? -FI_EAGAIN :
+	       tcpx_uring_recv_direct(uep, iov, iov_cnt);
+}
+
+/* Same as a nonblocking recv on the socket, with errors as -FI_* codes */
+ssize_t tcpx_uring_recv(struct tcpx_ep *ep, void *buf, size_t len)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = len,
+	};
+	ssize_t ret;
+
+	fastlock_acquire(&uep->uring->lock);
+	if (uep->rx_cnt) {
+		ret = tcpx_uring_copy(uep, buf, len);
+		tcpx_uring_rearm(uep->uring);
+	} else {
+		ret = tcpx_uring_recv_empty(uep, &iov, 1);
+	}
+	fastlock_release(&uep->uring->lock);
+	return ret;
+}
+
+ssize_t tcpx_uring_recvv(struct tcpx_ep *ep, struct iovec *iov, size_t iov_cnt)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	size_t i, copied;
+	ssize_t ret = 0;
+
+	fastlock_acquire(&uep->uring->lock);
+	if (!uep->rx_cnt) {
+		ret = tcpx_uring_recv_empty(uep, iov, iov_cnt);
+		goto out;
+	}
+
+	for (i = 0; i < iov_cnt && uep->rx_cnt; i++) {
+		copied = tcpx_uring_copy(uep, iov[i].iov_base,
+					 iov[i].iov_len);
+		ret += copied;
+		if (copied < iov[i].iov_len)
+			break;
+	}
+	tcpx_uring_rearm(uep->uring);
+out:
+	fastlock_release(&uep->uring->lock);
+	return ret;
+}
+
+bool tcpx_uring_rx_pending(struct tcpx_ep *ep)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	bool pending;
+
+	fastlock_acquire(&uep->uring->lock);
+	pending = uep->rx_cnt != 0;
+	fastlock_release(&uep->uring->lock);
+	return pending;
+}
+
+/* Whether a submitted send has not been accounted for yet */
+bool tcpx_uring_tx_busy(struct tcpx_ep *ep)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	bool busy;
+
+	fastlock_acquire(&uep->uring->lock);
+	busy = uep->tx_busy || uep->tx_done;
+	fastlock_release(&uep->uring->lock);
+	return busy;
+}
+
+/*
+ * Starts sending the given iovecs.  The caller keeps the data in place
+ * until tcpx_tx_queue_sent reports how much of it was sent.
+ */
+int tcpx_uring_send(struct tcpx_ep *ep, struct iovec *iov, size_t iov_cnt)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	struct tcpx_uring *uring = uep->uring;
+	struct io_uring_sqe *sqe;
+	int ret;
+
+	assert(iov_cnt <= TCPX_TX_BATCH_IOV);
+	fastlock_acquire(&uring->lock);
+	assert(!uep->tx_busy && !uep->tx_done);
+	sqe = tcpx_uring_get_sqe(uring);
+	if (!sqe) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	memcpy(uep->tx_iov, iov, iov_cnt * sizeof(*iov));
+	memset(&uep->tx_msg, 0, sizeof(uep->tx_msg));
+	uep->tx_msg.msg_iov = uep->tx_iov;
+	uep->tx_msg.msg_iovlen = iov_cnt;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = uep->sock;
+	sqe->addr = (uintptr_t) &uep->tx_msg;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = (uintptr_t) uep | TCPX_URING_SEND;
+
+	ret = tcpx_uring_submit(uring);
+	if (!ret)
+		uep->tx_busy = true;
+out:
+	fastlock_release(&uring->lock);
+	return ret;
+}
+
+int tcpx_uring_wait_fd(struct tcpx_ep *ep)
+{
+	return fd_signal_get(&ep->uring->signal);
+}
+
+int tcpx_uring_ring_fd(struct tcpx_ep *ep)
+{
+	return ep->uring->ring_fd;
+}
+
+int tcpx_uring_init(struct tcpx_ep *ep)
+{
+	struct tcpx_uring *uring = tcpx_ep_domain(ep)->uring;
+	struct tcpx_uring_ep *uep;
+	int ret;
+
+	uep = calloc(1, sizeof(*uep));
+	if (!uep)
+		return -FI_ENOMEM;
+
+	uep->uring = uring;
+	uep->sock = ep->conn_fd;
+	dlist_init(&uep->rearm_entry);
+	uep->ring_fd = dup(uring->fd);
+	if (uep->ring_fd < 0) {
+		ret = -errno;
+		goto free;
+	}
+
+	ret = fd_signal_init(&uep->signal);
+	if (ret)
+		goto close;
+
+	fastlock_acquire(&uring->lock);
+	ret = tcpx_uring_ep_arm(uep);
+	fastlock_release(&uring->lock);
+	if (ret)
+		goto signal;
+
+	ep->uring = uep;
+	return 0;
+signal:
+	fd_signal_free(&uep->signal);
+close:
+	close(uep->ring_fd);
+free:
+	free(uep);
+	return ret;
+}
+
+/*
+ * Cancels the endpoint's requests and waits for their last completions,
+ * so that nothing in the ring refers to the endpoint or its data anymore.
+ */
+void tcpx_uring_fini(struct tcpx_ep *ep)
+{
+	struct tcpx_uring_ep *uep = ep->uring;
+	struct tcpx_uring *uring;
+	int ret;
+
+	if (!uep)
+		return;
+
+	uring = uep->uring;
+	fastlock_acquire(&uring->lock);
+	uep->closing = true;
+	dlist_remove_init(&uep->rearm_entry);
+	if (uep->recv_armed)
+		tcpx_uring_cancel(uep, TCPX_URING_RECV);
+	if (uep->tx_busy)
+		tcpx_uring_cancel(uep, TCPX_URING_SEND);
+	if (uep->poll_armed)
+		tcpx_uring_cancel(uep, TCPX_URING_POLL);
+
+	while (uep->recv_armed || uep->tx_busy || uep->poll_armed) {
+		ret = tcpx_io_uring_enter(uring->fd, 0, 1,
+					  IORING_ENTER_GETEVENTS);
+		if (ret < 0 && errno != EINTR) {
+			FI_WARN(&tcpx_prov, FI_LOG_EP_CTRL,
+				"io_uring wait failed: %s\n", strerror(errno));
+			break;
+		}
+		tcpx_uring_reap(uring, uep);
+	}
+
+	while (uep->rx_cnt) {
+		tcpx_uring_buf_add(uring, uep->rx_head);
+		uep->rx_head = uring->buf_info[uep->rx_head].next;
+		uep->rx_cnt--;
+	}
+	tcpx_uring_rearm(uring);
+	fastlock_release(&uring->lock);
+
+	fd_signal_free(&uep->signal);
+	close(uep->ring_fd);
+	free(uep);
+	ep->uring = NULL;
+}
+
+int tcpx_uring_open(struct tcpx_domain *domain)
+{
+	int ret;
+
+	domain->uring = tcpx_uring_alloc(&ret);
+	return ret;
+}
+
+void tcpx_uring_close(struct tcpx_domain *domain)
+{
+	if (!domain->uring)
+		return;
+
+	assert(dlist_empty(&domain->uring->rearm_list));
+	tcpx_uring_free(domain->uring);
+	domain->uring = NULL;
+}
+
+/*
+ * Checks once that the kernel supports everything the engine needs,
+ * including multishot receives, by receiving a byte over a socket pair.
+ */
+int tcpx_uring_probe(void)
+{
+	struct tcpx_uring *uring;
+	struct io_uring_cqe *cqe;
+	int ret, sv[2];
+	char byte = 0;
+
+	uring = tcpx_uring_alloc(&ret);
+	if (!uring)
+		return ret;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+		ret = -errno;
+		goto free;
+	}
+
+	ret = tcpx_uring_arm_recv(uring, sv[0], 0);
+	if (ret)
+		goto close;
+
+	if (write(sv[1], &byte, sizeof(byte)) != sizeof(byte)) {
+		ret = -FI_EIO;
+		goto close;
+	}
+
+	ret = tcpx_io_uring_enter(uring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+	if (ret < 0) {
+		ret = -errno;
+		goto close;
+	}
+
+	cqe = &uring->cqes[*uring->cq_head & uring->cq_mask];
+	if (cqe->res == sizeof(byte) && (cqe->flags & IORING_CQE_F_MORE))
+		ret = 0;
+	else
+		ret = cqe->res < 0 ? cqe->res : -FI_ENOSYS;
+close:
+	close(sv[0]);
+	close(sv[1]);
+free:
+	tcpx_uring_free(uring);
+	return ret;
+}
+
+#endif /* HAVE_TCP_IO_URING */
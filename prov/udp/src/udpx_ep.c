@@ -194,6 +194,12 @@ static struct fi_ops_cm udpx_cm_ops = {
 static int udpx_getopt(fid_t fid, int level, int optname,
 		       void *optval, size_t *optlen)
 {
+	struct udpx_ep *ep;
+
+	ep = container_of(fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (level == FI_OPT_ENDPOINT && optname == FI_OPT_EP_STATS)
+		return ofi_ep_getopt_stats(&ep->util_ep, optval, optlen);
+
 	return -FI_ENOPROTOOPT;
 }
 
@@ -297,6 +303,7 @@ static void udpx_ep_progress(struct util_ep *util_ep)
 	if (ret >= 0) {
 		ep->rx_comp(ep, entry->context, 0, ret, NULL, &addr);
 		ofi_cirque_discard(ep->rxq);
+		ofi_ep_stats_rx(&ep->util_ep, ret);
 	}
 out:
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
@@ -402,11 +409,14 @@ static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 				addr, (socklen_t)addrlen);
 	if (ret == (ssize_t)len) {
 		ep->tx_comp(ep, context);
+		ofi_ep_stats_tx(&ep->util_ep, len);
 		ret = 0;
 	} else {
 		ret = -errno;
 	}
 out:
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&ep->util_ep);
 	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
 	return ret;
 }
@@ -457,11 +467,14 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
 	if (ret >= 0) {
 		ep->tx_comp(ep, msg->context);
+		ofi_ep_stats_tx(&ep->util_ep, ret);
 		ret = 0;
 	} else {
 		ret = -errno;
 	}
 out:
+	if (ret == -FI_EAGAIN)
+		ofi_ep_stats_eagain(&ep->util_ep);
 	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
 	return ret;
 }
@@ -494,6 +507,16 @@ static ssize_t udpx_sendv_mc(struct fid_ep *ep_fid, const struct iovec *iov,
 	return udpx_sendmsg(ep_fid, &msg, FI_MULTICAST);
 }
 
+/* Injects do not take the CQ lock, so their counts may be approximate */
+static ssize_t udpx_inject_done(struct udpx_ep *ep, ssize_t ret, size_t len)
+{
+	if (ret != (ssize_t)len)
+		return -errno;
+
+	ofi_ep_stats_tx(&ep->util_ep, len);
+	return 0;
+}
+
 static ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 			   fi_addr_t dest_addr)
 {
@@ -504,7 +527,7 @@ static ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				ofi_ip_av_get_addr(ep->util_ep.av, (int)dest_addr),
 				(socklen_t)ep->util_ep.av->addrlen);
-	return ret == (ssize_t)len ? 0 : -errno;
+	return udpx_inject_done(ep, ret, len);
 }
 
 static ssize_t udpx_inject_mc(struct fid_ep *ep_fid, const void *buf,
@@ -517,7 +540,7 @@ static ssize_t udpx_inject_mc(struct fid_ep *ep_fid, const void *buf,
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				(const void *)(uintptr_t)dest_addr,
 				(socklen_t)ofi_sizeofaddr((const void *)(uintptr_t)dest_addr));
-	return ret == (ssize_t)len ? 0 : -errno;
+	return udpx_inject_done(ep, ret, len);
 }
 
 static struct fi_ops_msg udpx_msg_ops = {
@@ -990,6 +990,270 @@ void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_LAST][FI_DATATYPE_LAST])
 
 #endif /* HAVE_BUILTIN_MM_ATOMICS */
 
+/*********************************************************************
+ * Local (non-atomic) handlers
+ *********************************************************************/
+
+/*
+ * When a target buffer is only ever updated by one thread at a time, the
+ * per element compare-exchange loops above are pure overhead.  The local
+ * handlers are plain loops the compiler vectorizes.  On x86 they are built
+ * for the baseline ISA (SSE2 on x86-64), AVX2 and AVX-512, and
+ * ofi_atomic_init() selects the widest variant the CPU and OS support.
+ * Datatypes and ops without a local handler fall back to the handlers above.
+ */
+#define OFI_LOP_MIN(dst,src)	((dst) > (src) ? (src) : (dst))
+#define OFI_LOP_MAX(dst,src)	((dst) < (src) ? (src) : (dst))
+#define OFI_LOP_SUM(dst,src)	((dst) + (src))
+#define OFI_LOP_PROD(dst,src)	((dst) * (src))
+#define OFI_LOP_LOR(dst,src)	(((dst) != 0) | ((src) != 0))
+#define OFI_LOP_LAND(dst,src)	(((dst) != 0) & ((src) != 0))
+#define OFI_LOP_BOR(dst,src)	((dst) | (src))
+#define OFI_LOP_BAND(dst,src)	((dst) & (src))
+#define OFI_LOP_LXOR(dst,src)	(((dst) != 0) ^ ((src) != 0))
+#define OFI_LOP_BXOR(dst,src)	((dst) ^ (src))
+#define OFI_LOP_WRITE(dst,src)	(src)
+#define OFI_LOP_READ(dst,src)	(dst)
+
+/* GCC won't vectorize these loops at -O2 without a cost model override */
+#if defined(__GNUC__) && !defined(__clang__)
+#define OFI_VECTORIZE	__attribute__((optimize("tree-vectorize",	\
+					       "vect-cost-model=dynamic")))
+#else
+#define OFI_VECTORIZE
+#endif
+
+#define OFI_LOCAL_ATTR_generic	OFI_VECTORIZE
+#define OFI_LOCAL_ATTR_avx2	OFI_VECTORIZE __attribute__((target("avx2")))
+/* configure checks for this exact target string */
+#define OFI_LOCAL_ATTR_avx512	OFI_VECTORIZE				\
+	__attribute__((target("avx512f,avx512bw,prefer-vector-width=512")))
+
+#define OFI_DEF_LWRITE_NAME(op, type, isa) ofi_lwrite_## op ##_## type ##_## isa,
+#define OFI_DEF_LWRITE_FUNC(op, type, isa)				\
+	static OFI_LOCAL_ATTR_##isa void				\
+	ofi_lwrite_## op ##_## type ##_## isa				\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		size_t i;						\
+		type *d = (dst);					\
+		const type *s = (src);					\
+		for (i = 0; i < cnt; i++)				\
+			d[i] = op(d[i], s[i]);				\
+	}
+
+#define OFI_DEF_LREADWRITE_NAME(op, type, isa) ofi_lreadwrite_## op ##_## type ##_## isa,
+#define OFI_DEF_LREADWRITE_FUNC(op, type, isa)				\
+	static OFI_LOCAL_ATTR_##isa void				\
+	ofi_lreadwrite_## op ##_## type ##_## isa			\
+		(void *dst, const void *src, void *res, size_t cnt)	\
+	{								\
+		size_t i;						\
+		type *d = (dst);					\
+		const type *s = (src);					\
+		type *r = (res);					\
+		for (i = 0; i < cnt; i++) {				\
+			r[i] = d[i];					\
+			d[i] = op(d[i], s[i]);				\
+		}							\
+	}
+
+#define OFI_DEF_LREAD_NAME(op, type, isa) ofi_lread_## type ##_## isa,
+#define OFI_DEF_LREAD_FUNC(op, type, isa)				\
+	static OFI_LOCAL_ATTR_##isa void ofi_lread_## type ##_## isa	\
+		(void *dst, const void *src, void *res, size_t cnt)	\
+	{								\
+		OFI_UNUSED(src);					\
+		memcpy(res, dst, cnt * sizeof(type));			\
+	}
+
+#define OFI_DEFINE_LOCAL_INT_HANDLERS(ATOMICTYPE, FUNCNAME, op, isa)	\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint8_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int16_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint16_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int32_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint32_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int64_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint64_t, isa)		\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME
+
+#define OFI_DEFINE_LOCAL_REAL_HANDLERS(ATOMICTYPE, FUNCNAME, op, isa)	\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint8_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int16_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint16_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int32_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint32_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int64_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint64_t, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, float, isa)		\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, double, isa)		\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME
+
+/*
+ * Defines the local write and read-write handlers for one ISA, along with
+ * their dispatch tables, ofi_atomic_{write,readwrite}_local_<isa>.
+ */
+#define OFI_DEFINE_LOCAL_TABLES(isa)					\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_MIN, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_MAX, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_SUM, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_PROD, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_LOR, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_LAND, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, FUNC, OFI_LOP_BOR, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, FUNC, OFI_LOP_BAND, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_LXOR, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, FUNC, OFI_LOP_BXOR, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, FUNC, OFI_LOP_WRITE, isa)	\
+									\
+	static void (*ofi_atomic_write_local_##isa			\
+		[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])			\
+		(void *dst, const void *src, size_t cnt) =		\
+	{								\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_MIN, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_MAX, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_SUM, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_PROD, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_LOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_LAND, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, NAME, OFI_LOP_BOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, NAME, OFI_LOP_BAND, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_LXOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LWRITE, NAME, OFI_LOP_BXOR, isa) },	\
+	{ OFI_OP_NOT_SUPPORTED(FI_ATOMIC_READ) },			\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LWRITE, NAME, OFI_LOP_WRITE, isa) },	\
+	};								\
+									\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_MIN, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_MAX, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_SUM, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_PROD, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_LOR, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_LAND, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, FUNC, OFI_LOP_BOR, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, FUNC, OFI_LOP_BAND, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_LXOR, isa)	\
+	OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, FUNC, OFI_LOP_BXOR, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREAD, FUNC, OFI_LOP_READ, isa)	\
+	OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, FUNC, OFI_LOP_WRITE, isa)	\
+									\
+	static void (*ofi_atomic_readwrite_local_##isa			\
+		[OFI_READWRITE_OP_LAST][FI_DATATYPE_LAST])		\
+		(void *dst, const void *src, void *res, size_t cnt) =	\
+	{								\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_MIN, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_MAX, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_SUM, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_PROD, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_LOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_LAND, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, NAME, OFI_LOP_BOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, NAME, OFI_LOP_BAND, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_LXOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_INT_HANDLERS(LREADWRITE, NAME, OFI_LOP_BXOR, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREAD, NAME, OFI_LOP_READ, isa) },	\
+	{ OFI_DEFINE_LOCAL_REAL_HANDLERS(LREADWRITE, NAME, OFI_LOP_WRITE, isa) },	\
+	};
+
+OFI_DEFINE_LOCAL_TABLES(generic)
+
+#if defined(HAVE_TARGET_ATTR_AVX512) && defined(HAVE_CPUID)
+
+OFI_DEFINE_LOCAL_TABLES(avx2)
+OFI_DEFINE_LOCAL_TABLES(avx512)
+
+/* XCR0 bits: SSE and AVX state, plus opmask and upper ZMM state */
+#define OFI_XSTATE_AVX		0x06
+#define OFI_XSTATE_AVX512	0xe6
+
+static int ofi_atomic_os_supports(uint64_t xstate)
+{
+	if (!ofi_cpu_supports(0x1, OFI_OSXSAVE_REG, OFI_OSXSAVE_BIT))
+		return 0;
+
+	return (ofi_xgetbv(0) & xstate) == xstate;
+}
+
+#endif /* HAVE_TARGET_ATTR_AVX512 && HAVE_CPUID */
+
+void (*ofi_atomic_write_local_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, size_t cnt);
+void (*ofi_atomic_readwrite_local_handlers[OFI_READWRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, void *res, size_t cnt);
+
+int ofi_atomic_local_enabled;
+
+static void ofi_atomic_init_once(void)
+{
+	void (*(*write)[FI_DATATYPE_LAST])(void *, const void *, size_t);
+	void (*(*readwrite)[FI_DATATYPE_LAST])(void *, const void *,
+					       void *, size_t);
+	const char *isa = "generic";
+	int op, type;
+
+	fi_param_get_bool(NULL, "atomic_local", &ofi_atomic_local_enabled);
+
+	write = ofi_atomic_write_local_generic;
+	readwrite = ofi_atomic_readwrite_local_generic;
+
+#if defined(HAVE_TARGET_ATTR_AVX512) && defined(HAVE_CPUID)
+	if (ofi_cpu_supports(0x7, OFI_AVX512F_REG, OFI_AVX512F_BIT) &&
+	    ofi_cpu_supports(0x7, OFI_AVX512BW_REG, OFI_AVX512BW_BIT) &&
+	    ofi_atomic_os_supports(OFI_XSTATE_AVX512)) {
+		write = ofi_atomic_write_local_avx512;
+		readwrite = ofi_atomic_readwrite_local_avx512;
+		isa = "avx512";
+	} else if (ofi_cpu_supports(0x7, OFI_AVX2_REG, OFI_AVX2_BIT) &&
+		   ofi_atomic_os_supports(OFI_XSTATE_AVX)) {
+		write = ofi_atomic_write_local_avx2;
+		readwrite = ofi_atomic_readwrite_local_avx2;
+		isa = "avx2";
+	}
+#endif
+
+	for (op = 0; op < OFI_WRITE_OP_LAST; op++) {
+		for (type = 0; type < FI_DATATYPE_LAST; type++) {
+			ofi_atomic_write_local_handlers[op][type] =
+				write[op][type] ? write[op][type] :
+				ofi_atomic_write_handlers[op][type];
+		}
+	}
+
+	for (op = 0; op < OFI_READWRITE_OP_LAST; op++) {
+		for (type = 0; type < FI_DATATYPE_LAST; type++) {
+			ofi_atomic_readwrite_local_handlers[op][type] =
+				readwrite[op][type] ? readwrite[op][type] :
+				ofi_atomic_readwrite_handlers[op][type];
+		}
+	}
+
+	FI_INFO(&core_prov, FI_LOG_CORE, "Local atomic handlers (%s) %s\n",
+		isa, ofi_atomic_local_enabled ? "enabled" : "disabled");
+}
+
+/*
+ * Providers built as DSOs carry their own copy of the tables, so this runs
+ * from every util domain.  The tables are filled in once, and callers
+ * return only after that, so domains opened concurrently never see them
+ * partially written.
+ */
+void ofi_atomic_init(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, ofi_atomic_init_once);
+}
+
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags)
 {
@@ -460,6 +460,9 @@ int ofi_cq_cleanup(struct util_cq *cq)
 			fi_close(&cq->wait->wait_fid.fid);
 	}
 
+	if (cq->progress == ofi_cq_progress_ready)
+		fi_epoll_close(cq->ready_set);
+
 	ofi_atomic_dec32(&cq->domain->ref);
 	util_comp_cirq_free(cq->cirq);
 	fastlock_destroy(&cq->cq_lock);
@@ -600,6 +603,61 @@ void ofi_cq_progress(struct util_cq *cq)
 	cq->cq_fastlock_release(&cq->ep_list_lock);
 }
 
+/* Endpoints progressed per ofi_cq_progress_ready call */
+#define OFI_CQ_READY_BATCH 64
+
+void ofi_cq_progress_ready(struct util_cq *cq)
+{
+	void *ready[OFI_CQ_READY_BATCH];
+	struct util_ep *ep;
+	int i, n;
+
+	/* ep_list_lock keeps endpoints from being closed while reported */
+	cq->cq_fastlock_acquire(&cq->ep_list_lock);
+	n = fi_epoll_wait(cq->ready_set, ready, OFI_CQ_READY_BATCH, 0);
+	for (i = 0; i < n; i++) {
+		ep = ready[i];
+		ep->progress(ep);
+	}
+	cq->cq_fastlock_release(&cq->ep_list_lock);
+}
+
+int ofi_cq_ready_init(struct util_cq *cq)
+{
+	int ret;
+
+	ret = fi_epoll_create(&cq->ready_set);
+	if (ret)
+		return ret;
+
+	cq->progress = ofi_cq_progress_ready;
+	return 0;
+}
+
+int ofi_cq_ready_add(struct util_cq *cq, int fd, uint32_t events,
+		     struct util_ep *ep)
+{
+	if (cq->progress != ofi_cq_progress_ready)
+		return 0;
+
+	return fi_epoll_add(cq->ready_set, fd, events, ep);
+}
+
+int ofi_cq_ready_mod(struct util_cq *cq, int fd, uint32_t events,
+		     struct util_ep *ep)
+{
+	if (cq->progress != ofi_cq_progress_ready)
+		return 0;
+
+	return fi_epoll_mod(cq->ready_set, fd, events, ep);
+}
+
+void ofi_cq_ready_del(struct util_cq *cq, int fd)
+{
+	if (cq->progress == ofi_cq_progress_ready)
+		fi_epoll_del(cq->ready_set, fd);
+}
+
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 		 struct fi_cq_attr *attr, struct util_cq *cq,
 		 ofi_cq_progress_func progress, void *context)
@@ -35,6 +35,7 @@
 
 #include <ofi_enosys.h>
 #include <ofi_util.h>
+#include <ofi_atomic.h>
 
 
 int ofi_domain_bind_eq(struct util_domain *domain, struct util_eq *eq)
@@ -100,6 +101,7 @@ int ofi_domain_init(struct fid_fabric *fabric_fid, const struct fi_info *info,
 	fabric = container_of(fabric_fid, struct util_fabric, fabric_fid);
 	domain->fabric = fabric;
 	domain->prov = fabric->prov;
+	ofi_atomic_init();
 	ret = util_domain_init(domain, info);
 	if (ret)
 		return ret;
@@ -33,9 +33,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <inttypes.h>
 #include <ofi_enosys.h>
 #include <ofi_util.h>
 
+int ofi_ep_stats_enabled;
+
 int ofi_ep_bind_cq(struct util_ep *ep, struct util_cq *cq, uint64_t flags)
 {
 	int ret;
@@ -229,6 +232,13 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 	ep->rem_rd_cntr_inc 	= ofi_cntr_inc_noop;
 	ep->rem_wr_cntr_inc 	= ofi_cntr_inc_noop;
 	ep->type = info->ep_attr->type;
+	ofi_atomic_initialize64(&ep->stats.tx_msgs, 0);
+	ofi_atomic_initialize64(&ep->stats.tx_bytes, 0);
+	ofi_atomic_initialize64(&ep->stats.rx_msgs, 0);
+	ofi_atomic_initialize64(&ep->stats.rx_bytes, 0);
+	ofi_atomic_initialize64(&ep->stats.unexp_msgs, 0);
+	ofi_atomic_initialize64(&ep->stats.retries, 0);
+	ofi_atomic_initialize64(&ep->stats.eagain, 0);
 	ofi_atomic_inc32(&util_domain->ref);
 	if (util_domain->eq)
 		ofi_ep_bind_eq(ep, util_domain->eq);
@@ -243,8 +253,65 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 	return 0;
 }
 
+static void util_ep_stats_read(struct util_ep *ep, struct fi_ep_stats *stats)
+{
+	stats->size = sizeof(*stats);
+	stats->tx_msgs = ofi_atomic_get64(&ep->stats.tx_msgs);
+	stats->tx_bytes = ofi_atomic_get64(&ep->stats.tx_bytes);
+	stats->rx_msgs = ofi_atomic_get64(&ep->stats.rx_msgs);
+	stats->rx_bytes = ofi_atomic_get64(&ep->stats.rx_bytes);
+	stats->unexp_msgs = ofi_atomic_get64(&ep->stats.unexp_msgs);
+	stats->retries = ofi_atomic_get64(&ep->stats.retries);
+	stats->eagain = ofi_atomic_get64(&ep->stats.eagain);
+}
+
+/* Size of struct fi_ep_stats as first defined, which callers must supply */
+#define UTIL_EP_STATS_SIZE_V1	(offsetof(struct fi_ep_stats, eagain) + \
+				 sizeof(uint64_t))
+
+/* Callers built against another version of the header may pass a smaller
+ * or larger structure; the fields both know are written, and size and
+ * optlen report how many bytes that is. */
+int ofi_ep_getopt_stats(struct util_ep *ep, void *optval, size_t *optlen)
+{
+	struct fi_ep_stats stats;
+	size_t len;
+
+	if (!ofi_ep_stats_enabled)
+		return -FI_ENODATA;
+
+	if (*optlen < UTIL_EP_STATS_SIZE_V1) {
+		*optlen = sizeof(stats);
+		return -FI_ETOOSMALL;
+	}
+
+	util_ep_stats_read(ep, &stats);
+	len = MIN(*optlen, sizeof(stats));
+	stats.size = len;
+	memcpy(optval, &stats, len);
+	*optlen = len;
+	return FI_SUCCESS;
+}
+
+/* Requested explicitly through FI_EP_STATS, so bypass the log level */
+static void util_ep_stats_log(struct util_ep *ep)
+{
+	struct fi_ep_stats stats;
+
+	util_ep_stats_read(ep, &stats);
+	fi_log(ep->domain->prov, FI_LOG_INFO, FI_LOG_EP_CTRL, __func__,
+	       __LINE__, "ep %p stats: tx_msgs %" PRIu64 " tx_bytes %" PRIu64
+	       " rx_msgs %" PRIu64 " rx_bytes %" PRIu64 " unexp_msgs %" PRIu64
+	       " retries %" PRIu64 " eagain %" PRIu64 "\n", (void *) ep,
+	       stats.tx_msgs, stats.tx_bytes, stats.rx_msgs, stats.rx_bytes,
+	       stats.unexp_msgs, stats.retries, stats.eagain);
+}
+
 int ofi_endpoint_close(struct util_ep *util_ep)
 {
+	if (ofi_ep_stats_enabled)
+		util_ep_stats_log(util_ep);
+
 	if (util_ep->tx_cq) {
 		fid_list_remove(&util_ep->tx_cq->ep_list,
 				&util_ep->tx_cq->ep_list_lock,
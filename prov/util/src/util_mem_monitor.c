@@ -32,7 +32,17 @@
  */
 
 #include <ofi_mr.h>
+#include <ofi_iov.h>
 
+#if HAVE_UFFD_UNMAP
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#endif
+
+struct ofi_mem_monitor *uffd_monitor;
+struct ofi_mem_monitor *default_monitor;
 
 void ofi_monitor_init(struct ofi_mem_monitor *monitor)
 {
@@ -49,6 +59,7 @@ void ofi_monitor_add_queue(struct ofi_mem_monitor *monitor,
 {
 	fastlock_init(&nq->lock);
 	dlist_init(&nq->list);
+	ofi_atomic_initialize32(&nq->pending, 0);
 	fastlock_acquire(&nq->lock);
 	nq->refcnt = 0;
 	fastlock_release(&nq->lock);
@@ -104,8 +115,10 @@ void ofi_monitor_unsubscribe(struct ofi_subscription *subscription)
 	subscription->nq->monitor->unsubscribe(subscription->nq->monitor,
 					       subscription);
 	fastlock_acquire(&subscription->nq->lock);
-	if (!dlist_empty(&subscription->entry))
+	if (!dlist_empty(&subscription->entry)) {
 		dlist_remove_init(&subscription->entry);
+		ofi_atomic_dec32(&subscription->nq->pending);
+	}
 	subscription->nq->refcnt--;
 	fastlock_release(&subscription->nq->lock);
 }
@@ -120,6 +133,7 @@ struct ofi_subscription *ofi_monitor_get_event(struct ofi_notification_queue *nq
 				subscription, entry);
 		/* needed to protect against double insertions */
 		dlist_init(&subscription->entry);
+		ofi_atomic_dec32(&nq->pending);
 	} else {
 		subscription = NULL;
 	}
@@ -127,3 +141,473 @@ struct ofi_subscription *ofi_monitor_get_event(struct ofi_notification_queue *nq
 
 	return subscription;
 }
+
+/*
+ * Subscription tracking shared by the generic monitors.  Subscriptions are
+ * kept in an rbtree ordered by start address (ties are broken by the
+ * subscription address, so identical ranges may be subscribed more than
+ * once).  Every subscription overlapping a range starts at most max_len
+ * bytes before it, which bounds the walk done by ofi_monitor_notify().
+ */
+struct util_monitor {
+	struct ofi_mem_monitor	monitor;
+	pthread_mutex_t		lock;
+	RbtHandle		subscr_tree;
+	size_t			max_len;
+};
+
+static int util_monitor_compare(void *a, void *b)
+{
+	struct ofi_subscription *subscr1 = a, *subscr2 = b;
+
+	if (subscr1->iov.iov_base != subscr2->iov.iov_base)
+		return (subscr1->iov.iov_base < subscr2->iov.iov_base) ? -1 : 1;
+	if (subscr1 != subscr2)
+		return (subscr1 < subscr2) ? -1 : 1;
+	return 0;
+}
+
+static int util_monitor_lower_bound(void *a, void *b)
+{
+	struct ofi_subscription *subscription = b;
+
+	return ((uintptr_t) subscription->iov.iov_base >= *(uintptr_t *) a) ?
+		0 : 1;
+}
+
+static int util_monitor_init(struct util_monitor *monitor)
+{
+	monitor->subscr_tree = rbtNew(util_monitor_compare);
+	if (!monitor->subscr_tree)
+		return -FI_ENOMEM;
+
+	pthread_mutex_init(&monitor->lock, NULL);
+	monitor->max_len = 0;
+	ofi_monitor_init(&monitor->monitor);
+	return 0;
+}
+
+static void util_monitor_cleanup(struct util_monitor *monitor)
+{
+	ofi_monitor_cleanup(&monitor->monitor);
+	pthread_mutex_destroy(&monitor->lock);
+	rbtDelete(monitor->subscr_tree);
+}
+
+/* Caller must hold monitor->lock */
+static int util_monitor_insert(struct util_monitor *monitor,
+			       struct ofi_subscription *subscription)
+{
+	if (rbtInsert(monitor->subscr_tree, subscription, subscription) !=
+	    RBT_STATUS_OK)
+		return -FI_ENOMEM;
+
+	monitor->max_len = MAX(monitor->max_len, subscription->iov.iov_len);
+	return 0;
+}
+
+/* Caller must hold monitor->lock */
+static void util_monitor_erase(struct util_monitor *monitor,
+			       struct ofi_subscription *subscription)
+{
+	RbtIterator iter;
+
+	iter = rbtFind(monitor->subscr_tree, subscription);
+	assert(iter);
+	rbtErase(monitor->subscr_tree, iter);
+}
+
+/* Caller must hold monitor->lock */
+static RbtIterator util_monitor_first(struct util_monitor *monitor,
+				      uintptr_t start)
+{
+	start = (start > monitor->max_len) ? start - monitor->max_len : 0;
+	return rbtFindLeftmost(monitor->subscr_tree, &start,
+			       util_monitor_lower_bound);
+}
+
+void ofi_monitor_notify(struct ofi_mem_monitor *monitor,
+			const void *addr, size_t len)
+{
+	struct util_monitor *util_monitor;
+	struct ofi_subscription *subscription;
+	uintptr_t start, end;
+	RbtIterator iter;
+	void *key;
+
+	util_monitor = container_of(monitor, struct util_monitor, monitor);
+	start = (uintptr_t) addr;
+	end = start + len;
+
+	pthread_mutex_lock(&util_monitor->lock);
+	for (iter = util_monitor_first(util_monitor, start); iter;
+	     iter = rbtNext(util_monitor->subscr_tree, iter)) {
+		rbtKeyValue(util_monitor->subscr_tree, iter, &key,
+			    (void **) &subscription);
+		if ((uintptr_t) subscription->iov.iov_base >= end)
+			break;
+		if ((uintptr_t) ofi_iov_end(&subscription->iov) > start)
+			ofi_monitor_add_event_to_nq(subscription);
+	}
+	pthread_mutex_unlock(&util_monitor->lock);
+}
+
+
+#if HAVE_UFFD_UNMAP
+
+/*
+ * userfaultfd monitor
+ *
+ * Subscribed ranges are registered with a userfaultfd which reports
+ * munmap, madvise(MADV_DONTNEED/MADV_REMOVE) and mremap of any part of
+ * them.  The event thread is started on the first subscription.  Ranges
+ * are registered in write-protect mode, only to receive those events:
+ * pages are never write-protected, so accesses to them never fault.
+ * Registration is done at page granularity, and a page is unregistered
+ * once no remaining subscription covers it.
+ */
+struct ofi_uffd {
+	struct util_monitor	util_monitor;
+	pthread_t		thread;
+	pid_t			pid;
+	int			fd;
+	int			running;
+	size_t			page_size;
+	size_t			hugepage_size;
+};
+
+static struct ofi_uffd uffd;
+
+static uintptr_t ofi_uffd_page_start(uintptr_t addr, size_t page_size)
+{
+	return addr & ~((uintptr_t) page_size - 1);
+}
+
+static uintptr_t ofi_uffd_page_end(uintptr_t addr, size_t page_size)
+{
+	return ofi_uffd_page_start(addr + page_size - 1, page_size);
+}
+
+static int ofi_uffd_ioctl_range(unsigned long request, uintptr_t start,
+				uintptr_t end)
+{
+	struct uffdio_register reg;
+
+	reg.range.start = start;
+	reg.range.len = end - start;
+	reg.mode = UFFDIO_REGISTER_MODE_WP;
+	return ioctl(uffd.fd, request, (request == UFFDIO_REGISTER) ?
+		     (void *) &reg : (void *) &reg.range) ? -errno : 0;
+}
+
+/* hugetlbfs mappings must be registered at huge page granularity */
+static int ofi_uffd_register(uintptr_t start, size_t len)
+{
+	int ret;
+
+	ret = ofi_uffd_ioctl_range(UFFDIO_REGISTER,
+				   ofi_uffd_page_start(start, uffd.page_size),
+				   ofi_uffd_page_end(start + len, uffd.page_size));
+	if (ret == -FI_EINVAL && uffd.hugepage_size)
+		ret = ofi_uffd_ioctl_range(UFFDIO_REGISTER,
+			ofi_uffd_page_start(start, uffd.hugepage_size),
+			ofi_uffd_page_end(start + len, uffd.hugepage_size));
+	return ret;
+}
+
+/*
+ * Unregisters the pages of [start, end) which are not covered by any
+ * remaining subscription.  Subscriptions are walked in start order, so the
+ * uncovered pages are the gaps between their page rounded ranges.
+ * Caller must hold the monitor lock.
+ */
+static int ofi_uffd_unregister_gaps(uintptr_t start, uintptr_t end,
+				    size_t page_size)
+{
+	struct ofi_subscription *subscription;
+	uintptr_t sub_start, sub_end;
+	RbtIterator iter;
+	void *key;
+	int ret;
+
+	start = ofi_uffd_page_start(start, page_size);
+	end = ofi_uffd_page_end(end, page_size);
+
+	for (iter = util_monitor_first(&uffd.util_monitor, start);
+	     iter && start < end;
+	     iter = rbtNext(uffd.util_monitor.subscr_tree, iter)) {
+		rbtKeyValue(uffd.util_monitor.subscr_tree, iter, &key,
+			    (void **) &subscription);
+		sub_start = ofi_uffd_page_start((uintptr_t)
+				subscription->iov.iov_base, page_size);
+		sub_end = ofi_uffd_page_end((uintptr_t)
+				ofi_iov_end(&subscription->iov), page_size);
+		if (sub_start >= end)
+			break;
+		if (sub_end <= start)
+			continue;
+
+		if (sub_start > start) {
+			ret = ofi_uffd_ioctl_range(UFFDIO_UNREGISTER, start,
+						   sub_start);
+			if (ret)
+				return ret;
+		}
+		start = sub_end;
+	}
+
+	return (start < end) ?
+	       ofi_uffd_ioctl_range(UFFDIO_UNREGISTER, start, end) : 0;
+}
+
+/* Caller must hold the monitor lock */
+static void ofi_uffd_unregister(uintptr_t start, size_t len)
+{
+	int ret;
+
+	ret = ofi_uffd_unregister_gaps(start, start + len, uffd.page_size);
+	if (ret == -FI_EINVAL && uffd.hugepage_size)
+		ret = ofi_uffd_unregister_gaps(start, start + len,
+					       uffd.hugepage_size);
+	/* Unmapped ranges were already unregistered by the kernel */
+	if (ret && ret != -FI_EINVAL && ret != -FI_ENOMEM)
+		FI_DBG(&core_prov, FI_LOG_MR,
+		       "unable to unregister %p (len: %zu) with uffd: %s\n",
+		       (void *) start, len, fi_strerror(-ret));
+}
+
+static void *ofi_uffd_handler(void *arg)
+{
+	struct uffd_msg msg;
+	struct pollfd fds;
+	ssize_t ret;
+
+	fds.fd = uffd.fd;
+	fds.events = POLLIN;
+	for (;;) {
+		ret = poll(&fds, 1, -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			FI_WARN(&core_prov, FI_LOG_MR,
+				"uffd poll failed: %s\n", strerror(errno));
+			break;
+		}
+
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		/* Unmap events block the unmapping thread until read */
+		ret = read(uffd.fd, &msg, sizeof(msg));
+		if (ret != sizeof(msg)) {
+			pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+			if (errno == EAGAIN)
+				continue;
+			FI_WARN(&core_prov, FI_LOG_MR,
+				"uffd read failed: %s\n", strerror(errno));
+			break;
+		}
+
+		switch (msg.event) {
+		case UFFD_EVENT_REMOVE:
+		case UFFD_EVENT_UNMAP:
+			ofi_monitor_notify(&uffd.util_monitor.monitor,
+				(void *) (uintptr_t) msg.arg.remove.start,
+				(size_t) (msg.arg.remove.end -
+					  msg.arg.remove.start));
+			break;
+		case UFFD_EVENT_REMAP:
+			ofi_monitor_notify(&uffd.util_monitor.monitor,
+				(void *) (uintptr_t) msg.arg.remap.from,
+				(size_t) msg.arg.remap.len);
+			break;
+		default:
+			FI_WARN(&core_prov, FI_LOG_MR,
+				"Unhandled uffd event %d\n", msg.event);
+			break;
+		}
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	}
+	return NULL;
+}
+
+/* Caller must hold the monitor lock */
+static int ofi_uffd_start(void)
+{
+	struct uffdio_api api;
+	ssize_t hugepage_size;
+	int ret;
+
+	uffd.fd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#ifdef UFFD_USER_MODE_ONLY
+	if (uffd.fd < 0 && errno == EPERM)
+		uffd.fd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK |
+				  UFFD_USER_MODE_ONLY);
+#endif
+	if (uffd.fd < 0) {
+		FI_WARN(&core_prov, FI_LOG_MR,
+			"syscall/userfaultfd %s\n", strerror(errno));
+		return -errno;
+	}
+
+	api.api = UFFD_API;
+	api.features = UFFD_FEATURE_EVENT_UNMAP | UFFD_FEATURE_EVENT_REMOVE |
+		       UFFD_FEATURE_EVENT_REMAP;
+	ret = ioctl(uffd.fd, UFFDIO_API, &api);
+	if (ret < 0) {
+		FI_WARN(&core_prov, FI_LOG_MR,
+			"ioctl/uffdio: %s\n", strerror(errno));
+		ret = -errno;
+		goto closefd;
+	}
+
+	/* Ranges are registered in write-protect mode, which is only
+	 * reported as supported by kernels that implement it */
+	if (api.api != UFFD_API ||
+	    !(api.features & UFFD_FEATURE_PAGEFAULT_FLAG_WP)) {
+		FI_WARN(&core_prov, FI_LOG_MR, "uffd features not supported\n");
+		ret = -FI_ENOSYS;
+		goto closefd;
+	}
+
+	uffd.page_size = sysconf(_SC_PAGESIZE);
+	hugepage_size = ofi_get_hugepage_size();
+	uffd.hugepage_size = (hugepage_size > 0) ? hugepage_size : 0;
+
+	ret = pthread_create(&uffd.thread, NULL, ofi_uffd_handler, &uffd);
+	if (ret) {
+		FI_WARN(&core_prov, FI_LOG_MR,
+			"failed to create handler thread %s\n", strerror(ret));
+		ret = -ret;
+		goto closefd;
+	}
+
+	uffd.pid = getpid();
+	uffd.running = 1;
+	return 0;
+
+closefd:
+	close(uffd.fd);
+	return ret;
+}
+
+static int ofi_uffd_subscribe(struct ofi_mem_monitor *monitor,
+			      struct ofi_subscription *subscription)
+{
+	int ret;
+
+	assert(monitor == &uffd.util_monitor.monitor);
+	pthread_mutex_lock(&uffd.util_monitor.lock);
+	if (!uffd.running) {
+		ret = ofi_uffd_start();
+		if (ret)
+			goto unlock;
+	} else if (uffd.pid != getpid()) {
+		/* The userfaultfd belongs to the parent's address space */
+		ret = -FI_ENOSYS;
+		goto unlock;
+	}
+
+	ret = ofi_uffd_register((uintptr_t) subscription->iov.iov_base,
+				subscription->iov.iov_len);
+	if (ret) {
+		FI_DBG(&core_prov, FI_LOG_MR,
+		       "unable to register %p (len: %zu) with uffd: %s\n",
+		       subscription->iov.iov_base, subscription->iov.iov_len,
+		       fi_strerror(-ret));
+		goto unlock;
+	}
+
+	ret = util_monitor_insert(&uffd.util_monitor, subscription);
+unlock:
+	pthread_mutex_unlock(&uffd.util_monitor.lock);
+	return ret;
+}
+
+static void ofi_uffd_unsubscribe(struct ofi_mem_monitor *monitor,
+				 struct ofi_subscription *subscription)
+{
+	assert(monitor == &uffd.util_monitor.monitor);
+	pthread_mutex_lock(&uffd.util_monitor.lock);
+	util_monitor_erase(&uffd.util_monitor, subscription);
+	if (uffd.pid == getpid())
+		ofi_uffd_unregister((uintptr_t) subscription->iov.iov_base,
+				    subscription->iov.iov_len);
+	pthread_mutex_unlock(&uffd.util_monitor.lock);
+}
+
+static int ofi_uffd_init(void)
+{
+	int ret;
+
+	ret = util_monitor_init(&uffd.util_monitor);
+	if (ret)
+		return ret;
+
+	uffd.util_monitor.monitor.subscribe = ofi_uffd_subscribe;
+	uffd.util_monitor.monitor.unsubscribe = ofi_uffd_unsubscribe;
+	uffd.fd = -1;
+	uffd.running = 0;
+	uffd_monitor = &uffd.util_monitor.monitor;
+	return 0;
+}
+
+static void ofi_uffd_cleanup(void)
+{
+	if (!uffd_monitor)
+		return;
+
+	/* Leave the monitor running if a cache was never cleaned up */
+	if (ofi_atomic_get32(&uffd.util_monitor.monitor.refcnt))
+		return;
+
+	if (uffd.running && uffd.pid == getpid()) {
+		pthread_cancel(uffd.thread);
+		pthread_join(uffd.thread, NULL);
+	}
+	if (uffd.running)
+		close(uffd.fd);
+	util_monitor_cleanup(&uffd.util_monitor);
+	uffd_monitor = NULL;
+}
+
+#else /* HAVE_UFFD_UNMAP */
+
+static int ofi_uffd_init(void)
+{
+	return -FI_ENOSYS;
+}
+
+static void ofi_uffd_cleanup(void)
+{
+}
+
+#endif /* HAVE_UFFD_UNMAP */
+
+void ofi_monitors_init(void)
+{
+	char *monitor_name = NULL;
+
+	fi_param_define(NULL, "mr_cache_monitor", FI_PARAM_STRING,
+			"Define a default memory registration monitor, used "
+			"by providers to detect when cached registrations "
+			"become invalid.  Options are: userfaultfd and "
+			"disabled (default: userfaultfd, if available)");
+	fi_param_get_str(NULL, "mr_cache_monitor", &monitor_name);
+
+	(void) ofi_uffd_init();
+
+	if (monitor_name && !strcmp(monitor_name, "disabled")) {
+		default_monitor = NULL;
+	} else {
+		if (monitor_name && strcmp(monitor_name, "userfaultfd"))
+			FI_WARN(&core_prov, FI_LOG_MR,
+				"unknown monitor %s, using userfaultfd\n",
+				monitor_name);
+		default_monitor = uffd_monitor;
+	}
+}
+
+void ofi_monitors_cleanup(void)
+{
+	ofi_uffd_cleanup();
+	default_monitor = NULL;
+}
@@ -87,9 +87,19 @@ static void util_mr_uncache_entry(struct ofi_mr_cache *cache,
 {
 	assert(entry->cached);
 	cache->mr_storage.erase(&cache->mr_storage, entry);
+	dlist_remove_init(&entry->lru_entry);
 	entry->cached = 0;
 }
 
+/* Used to route lookups to the exclusive path.  The monitor queues events
+ * without holding the cache lock, so the queue's event count is read
+ * instead of taking its lock on every hit. */
+static inline bool util_mr_cache_events_pending(struct ofi_mr_cache *cache)
+{
+	return ofi_atomic_get_acquire32(&cache->nq.pending) != 0;
+}
+
+/* Caller must hold the cache lock exclusively */
 static void
 util_mr_cache_process_events(struct ofi_mr_cache *cache)
 {
@@ -99,51 +109,81 @@ util_mr_cache_process_events(struct ofi_mr_cache *cache)
 	while ((subscription = ofi_monitor_get_event(&cache->nq))) {
 		entry = container_of(subscription, struct ofi_mr_entry,
 				     subscription);
+		cache->notify_cnt++;
 		if (entry->cached)
 			util_mr_uncache_entry(cache, entry);
 
-		if (entry->use_cnt == 0) {
-			dlist_remove_init(&entry->lru_entry);
+		if (ofi_atomic_get32(&entry->use_cnt) == 0)
 			util_mr_free_entry(cache, entry);
-		}
 	}
 }
 
-bool ofi_mr_cache_flush(struct ofi_mr_cache *cache)
+/* Caller must hold the cache lock exclusively.  Entries that are in use
+ * or were referenced since the last scan are rotated to the tail. */
+static bool util_mr_cache_flush(struct ofi_mr_cache *cache)
 {
 	struct ofi_mr_entry *entry;
+	size_t scan_cnt;
+
+	for (scan_cnt = 2 * cache->cached_cnt; scan_cnt &&
+	     !dlist_empty(&cache->lru_list); scan_cnt--) {
+		dlist_pop_front(&cache->lru_list, struct ofi_mr_entry,
+				entry, lru_entry);
+		if (ofi_atomic_get32(&entry->use_cnt) ||
+		    ofi_atomic_get32(&entry->referenced)) {
+			ofi_atomic_set32(&entry->referenced, 0);
+			dlist_insert_tail(&entry->lru_entry, &cache->lru_list);
+			continue;
+		}
 
-	if (dlist_empty(&cache->lru_list))
-		return false;
+		dlist_init(&entry->lru_entry);
+		FI_DBG(cache->domain->prov, FI_LOG_MR,
+		       "flush %p (len: %" PRIu64 ")\n",
+		       entry->iov.iov_base, entry->iov.iov_len);
+		cache->flush_cnt++;
 
-	dlist_pop_front(&cache->lru_list, struct ofi_mr_entry,
-			entry, lru_entry);
-	dlist_init(&entry->lru_entry);
-	FI_DBG(cache->domain->prov, FI_LOG_MR, "flush %p (len: %" PRIu64 ")\n",
-	       entry->iov.iov_base, entry->iov.iov_len);
+		util_mr_uncache_entry(cache, entry);
+		util_mr_free_entry(cache, entry);
+		return true;
+	}
+	return false;
+}
 
-	util_mr_uncache_entry(cache, entry);
-	util_mr_free_entry(cache, entry);
-	return true;
+bool ofi_mr_cache_flush(struct ofi_mr_cache *cache)
+{
+	bool flushed;
+
+	pthread_rwlock_wrlock(&cache->lock);
+	flushed = util_mr_cache_flush(cache);
+	pthread_rwlock_unlock(&cache->lock);
+	return flushed;
 }
 
 void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 {
+	bool free_entry;
+
 	FI_DBG(cache->domain->prov, FI_LOG_MR, "delete %p (len: %" PRIu64 ")\n",
 	       entry->iov.iov_base, entry->iov.iov_len);
-	cache->delete_cnt++;
+	ofi_atomic_inc64(&cache->delete_cnt);
 
-	util_mr_cache_process_events(cache);
+	/* Cached entries stay on the LRU list when released.  An uncached
+	 * entry can no longer be found, so the last user frees it. */
+	pthread_rwlock_rdlock(&cache->lock);
+	free_entry = !ofi_atomic_dec32(&entry->use_cnt) && !entry->cached;
+	pthread_rwlock_unlock(&cache->lock);
 
-	if (--entry->use_cnt == 0) {
-		if (entry->cached) {
-			dlist_insert_tail(&entry->lru_entry, &cache->lru_list);
-		} else {
-			util_mr_free_entry(cache, entry);
-		}
-	}
+	if (!free_entry && !util_mr_cache_events_pending(cache))
+		return;
+
+	pthread_rwlock_wrlock(&cache->lock);
+	if (free_entry)
+		util_mr_free_entry(cache, entry);
+	util_mr_cache_process_events(cache);
+	pthread_rwlock_unlock(&cache->lock);
 }
 
+/* Caller must hold the cache lock exclusively */
 static int
 util_mr_cache_create(struct ofi_mr_cache *cache, const struct iovec *iov,
 		     uint64_t access, struct ofi_mr_entry **entry)
@@ -153,22 +193,22 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct iovec *iov,
 	FI_DBG(cache->domain->prov, FI_LOG_MR, "create %p (len: %" PRIu64 ")\n",
 	       iov->iov_base, iov->iov_len);
 
-	util_mr_cache_process_events(cache);
-
 	*entry = util_buf_alloc(cache->entry_pool);
 	if (OFI_UNLIKELY(!*entry))
 		return -FI_ENOMEM;
 
 	(*entry)->iov = *iov;
-	(*entry)->use_cnt = 1;
+	ofi_atomic_initialize32(&(*entry)->referenced, 0);
+	ofi_atomic_initialize32(&(*entry)->use_cnt, 1);
+	dlist_init(&(*entry)->lru_entry);
 
 	ret = cache->add_region(cache, *entry);
 	if (ret) {
-		while (ret && ofi_mr_cache_flush(cache)) {
+		while (ret && util_mr_cache_flush(cache)) {
 			ret = cache->add_region(cache, *entry);
 		}
 		if (ret) {
-			assert(!ofi_mr_cache_flush(cache));
+			assert(!util_mr_cache_flush(cache));
 			util_buf_release(cache->entry_pool, *entry);
 			return ret;
 		}
@@ -185,11 +225,14 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct iovec *iov,
 			goto err;
 		}
 		(*entry)->cached = 1;
+		dlist_insert_tail(&(*entry)->lru_entry, &cache->lru_list);
 
 		ret = ofi_monitor_subscribe(&cache->nq, iov->iov_base, iov->iov_len,
 					    &(*entry)->subscription);
-		if (ret)
+		if (ret) {
+			util_mr_uncache_entry(cache, *entry);
 			goto err;
+		}
 		(*entry)->subscribed = 1;
 	}
 
@@ -200,6 +243,7 @@ err:
 	return ret;
 }
 
+/* Caller must hold the cache lock exclusively */
 static int
 util_mr_cache_merge(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
 		    struct ofi_mr_entry *old_entry, struct ofi_mr_entry **entry)
@@ -227,73 +271,124 @@ util_mr_cache_merge(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
 			ofi_monitor_unsubscribe(&old_entry->subscription);
 			old_entry->subscribed = 0;
 		}
-		cache->mr_storage.erase(&cache->mr_storage, old_entry);
-		old_entry->cached = 0;
+		util_mr_uncache_entry(cache, old_entry);
 
-		if (old_entry->use_cnt == 0) {
-			dlist_remove_init(&old_entry->lru_entry);
-			util_mr_free_entry(cache, old_entry); 
-		}
+		if (ofi_atomic_get32(&old_entry->use_cnt) == 0)
+			util_mr_free_entry(cache, old_entry);
 
 	} while ((old_entry = cache->mr_storage.find(&cache->mr_storage, &iov)));
 
 	return util_mr_cache_create(cache, &iov, attr->access, entry);
 }
 
-int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
-			struct ofi_mr_entry **entry)
+/* Caller must hold the cache lock exclusively */
+static int
+util_mr_cache_search(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
+		     struct ofi_mr_entry **entry)
 {
 	util_mr_cache_process_events(cache);
 
-	assert(attr->iov_count == 1);
-	FI_DBG(cache->domain->prov, FI_LOG_MR, "search %p (len: %" PRIu64 ")\n",
-	       attr->mr_iov->iov_base, attr->mr_iov->iov_len);
-	cache->search_cnt++;
+	*entry = cache->mr_storage.find(&cache->mr_storage, attr->mr_iov);
+	if (*entry) {
+		/* This branch is always false if the merging entries wasn't
+		 * requested */
+		if (!ofi_iov_within(attr->mr_iov, &(*entry)->iov))
+			return util_mr_cache_merge(cache, attr, *entry, entry);
+
+		ofi_atomic_inc64(&cache->hit_cnt);
+		ofi_atomic_inc32(&(*entry)->use_cnt);
+		ofi_atomic_set32(&(*entry)->referenced, 1);
+		return 0;
+	}
 
+	/* Eviction is only needed when adding a region */
 	while (((cache->cached_cnt >= cache->max_cached_cnt) ||
 		(cache->cached_size >= cache->max_cached_size)) &&
-	       ofi_mr_cache_flush(cache))
+	       util_mr_cache_flush(cache))
 		;
 
-	*entry = cache->mr_storage.find(&cache->mr_storage, attr->mr_iov);
-	if (!*entry) {
-		return util_mr_cache_create(cache, attr->mr_iov,
-					    attr->access, entry);
-	}
+	return util_mr_cache_create(cache, attr->mr_iov, attr->access, entry);
+}
+
+int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
+			struct ofi_mr_entry **entry)
+{
+	int ret;
 
-	/* This branch is always false if the merging entries wasn't requested */
-	if (!ofi_iov_within(attr->mr_iov, &(*entry)->iov))
-		return util_mr_cache_merge(cache, attr, *entry, entry);
+	assert(attr->iov_count == 1);
+	FI_DBG(cache->domain->prov, FI_LOG_MR, "search %p (len: %" PRIu64 ")\n",
+	       attr->mr_iov->iov_base, attr->mr_iov->iov_len);
+	ofi_atomic_inc64(&cache->search_cnt);
+
+	pthread_rwlock_rdlock(&cache->lock);
+	if (OFI_LIKELY(!util_mr_cache_events_pending(cache))) {
+		*entry = cache->mr_storage.find(&cache->mr_storage,
+						attr->mr_iov);
+		if (*entry && ofi_iov_within(attr->mr_iov, &(*entry)->iov)) {
+			ofi_atomic_inc32(&(*entry)->use_cnt);
+			if (!ofi_atomic_get32(&(*entry)->referenced))
+				ofi_atomic_set32(&(*entry)->referenced, 1);
+			pthread_rwlock_unlock(&cache->lock);
+			ofi_atomic_inc64(&cache->hit_cnt);
+			return 0;
+		}
+	}
+	pthread_rwlock_unlock(&cache->lock);
 
-	cache->hit_cnt++;
-	if ((*entry)->use_cnt++ == 0)
-		dlist_remove_init(&(*entry)->lru_entry);
+	pthread_rwlock_wrlock(&cache->lock);
+	ret = util_mr_cache_search(cache, attr, entry);
+	pthread_rwlock_unlock(&cache->lock);
+	return ret;
+}
 
-	return 0;
+void ofi_mr_cache_add_stats(struct ofi_mr_cache *cache,
+			    struct fi_mr_cache_stats *stats)
+{
+	uint64_t search_cnt, hit_cnt;
+
+	/* Searches are counted before their hit */
+	hit_cnt = ofi_atomic_get64(&cache->hit_cnt);
+	search_cnt = ofi_atomic_get64(&cache->search_cnt);
+
+	pthread_rwlock_rdlock(&cache->lock);
+	stats->searches += search_cnt;
+	stats->hits += hit_cnt;
+	stats->misses += search_cnt - hit_cnt;
+	stats->evictions += cache->flush_cnt;
+	stats->invalidations += cache->notify_cnt;
+	stats->cached_cnt += cache->cached_cnt;
+	stats->cached_size += cache->cached_size;
+	pthread_rwlock_unlock(&cache->lock);
 }
 
 void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 {
 	struct ofi_mr_entry *entry;
 	struct dlist_entry *tmp;
+	size_t search_cnt, hit_cnt;
 
+	search_cnt = ofi_atomic_get64(&cache->search_cnt);
+	hit_cnt = ofi_atomic_get64(&cache->hit_cnt);
 	FI_INFO(cache->domain->prov, FI_LOG_MR, "MR cache stats: "
-		"searches %zu, deletes %zu, hits %zu\n",
-		cache->search_cnt, cache->delete_cnt, cache->hit_cnt);
+		"searches %zu, deletes %zu, hits %zu, misses %zu, "
+		"notifications %zu, flushes %zu\n",
+		search_cnt, (size_t) ofi_atomic_get64(&cache->delete_cnt),
+		hit_cnt, search_cnt - hit_cnt, cache->notify_cnt,
+		cache->flush_cnt);
 
 	util_mr_cache_process_events(cache);
 
 	dlist_foreach_container_safe(&cache->lru_list, struct ofi_mr_entry,
 				     entry, lru_entry, tmp) {
-		assert(entry->use_cnt == 0);
+		assert(ofi_atomic_get32(&entry->use_cnt) == 0);
 		util_mr_uncache_entry(cache, entry);
-		dlist_remove_init(&entry->lru_entry);
 		util_mr_free_entry(cache, entry);
 	}
 	cache->mr_storage.destroy(&cache->mr_storage);
 	ofi_monitor_del_queue(&cache->nq);
 	ofi_atomic_dec32(&cache->domain->ref);
 	util_buf_pool_destroy(cache->entry_pool);
+	pthread_rwlock_destroy(&cache->lock);
 	assert(cache->cached_cnt == 0);
 	assert(cache->cached_size == 0);
 }
@@ -380,21 +475,29 @@ int ofi_mr_cache_init(struct util_domain *domain,
 	int ret;
 	assert(cache->add_region && cache->delete_region);
 
+	if (!monitor)
+		monitor = default_monitor;
+	if (!monitor)
+		return -FI_ENOSYS;
+
 	ret = ofi_mr_cache_init_storage(cache);
 	if (ret)
 		return ret;
 
 	cache->domain = domain;
 	ofi_atomic_inc32(&domain->ref);
+	pthread_rwlock_init(&cache->lock, NULL);
 
 	dlist_init(&cache->lru_list);
 	cache->cached_cnt = 0;
 	cache->cached_size = 0;
 	if (!cache->max_cached_size)
 		cache->max_cached_size = SIZE_MAX;
-	cache->search_cnt = 0;
-	cache->delete_cnt = 0;
-	cache->hit_cnt = 0;
+	ofi_atomic_initialize64(&cache->search_cnt, 0);
+	ofi_atomic_initialize64(&cache->delete_cnt, 0);
+	ofi_atomic_initialize64(&cache->hit_cnt, 0);
+	cache->notify_cnt = 0;
+	cache->flush_cnt = 0;
 	ofi_monitor_add_queue(monitor, &cache->nq);
 
 	ret = util_buf_pool_create(&cache->entry_pool,
@@ -406,6 +509,7 @@ int ofi_mr_cache_init(struct util_domain *domain,
 
 	return 0;
 err:
+	pthread_rwlock_destroy(&cache->lock);
 	ofi_atomic_dec32(&cache->domain->ref);
 	ofi_monitor_del_queue(&cache->nq);
 	cache->mr_storage.destroy(&cache->mr_storage);
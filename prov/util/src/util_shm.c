@@ -38,10 +38,26 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
 
 #include <ofi_shm.h>
 
+/* Peers duplicate a region's signal fd with pidfd_getfd() */
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+#include <sys/eventfd.h>
+#define SMR_HAVE_SIGNAL 1
+#else
+#define SMR_HAVE_SIGNAL 0
+#endif
+
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+#include <linux/mempolicy.h>
+#define SMR_HAVE_NUMA 1
+#else
+#define SMR_HAVE_NUMA 0
+#endif
+
 
 static void smr_peer_addr_init(struct smr_addr *peer)
 {
@@ -49,6 +65,48 @@ static void smr_peer_addr_init(struct smr_addr *peer)
 	peer->addr = FI_ADDR_UNSPEC;
 }
 
+/*
+ * Prefer the caller's NUMA node for the region's pages.  The policy is
+ * kept by the shared memory object, so it also applies to pages first
+ * touched by peers.  Optionally leave the inject buffers to first touch,
+ * placing them near the sender that fills them.
+ */
+static void smr_numa_bind(const struct fi_provider *prov, void *addr,
+			  size_t size, size_t inject_start, size_t inject_end,
+			  int inject_first_touch)
+{
+#if SMR_HAVE_NUMA
+	unsigned long nodemask;
+	unsigned cpu, node;
+	size_t page_size;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) ||
+	    node >= sizeof(nodemask) * 8)
+		return;
+
+	nodemask = 1UL << node;
+	if (syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &nodemask,
+		    sizeof(nodemask) * 8, 0)) {
+		FI_INFO(prov, FI_LOG_EP_CTRL, "mbind error: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	if (!inject_first_touch)
+		return;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	inject_start = ofi_div_ceil(inject_start, page_size) * page_size;
+	inject_end = inject_end / page_size * page_size;
+	if (inject_end > inject_start &&
+	    syscall(SYS_mbind, (char *) addr + inject_start,
+		    inject_end - inject_start, MPOL_DEFAULT, NULL, 0, 0)) {
+		FI_INFO(prov, FI_LOG_EP_CTRL, "mbind error: %s\n",
+			strerror(errno));
+	}
+#endif
+}
+
 /* TODO: Determine if aligning SMR data helps performance */
 int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	       const struct smr_attr *attr, struct smr_region **smr)
@@ -61,10 +119,12 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	cmd_queue_offset = sizeof(**smr);
 	resp_queue_offset = cmd_queue_offset + sizeof(struct smr_cmd_queue) +
 			sizeof(struct smr_cmd) * attr->rx_count;
-	inject_pool_offset = resp_queue_offset + sizeof(struct smr_resp_queue) +
-			sizeof(struct smr_resp) * attr->tx_count;
-	peer_addr_offset = inject_pool_offset + sizeof(struct smr_inject_pool) +
-			sizeof(struct smr_inject_pool_entry) * attr->rx_count;
+	inject_pool_offset = smr_inject_align(resp_queue_offset +
+			sizeof(struct smr_resp_queue) +
+			sizeof(struct smr_resp) * attr->tx_count);
+	peer_addr_offset = inject_pool_offset +
+			smr_inject_pool_total_size(attr->rx_count,
+						   attr->inject_size);
 	name_offset = peer_addr_offset + sizeof(struct smr_addr) * SMR_MAX_PEERS;
 	total_size = name_offset + strlen(attr->name) + 1;
 	total_size = roundup_power_of_two(total_size);
@@ -90,6 +150,12 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 
 	close(fd);
 
+	if (attr->numa_bind) {
+		smr_numa_bind(prov, mapped_addr, total_size, inject_pool_offset +
+			      smr_inject_pool_hdr_size(attr->rx_count),
+			      peer_addr_offset, attr->inject_first_touch);
+	}
+
 	*smr = mapped_addr;
 	fastlock_init(&(*smr)->lock);
 	fastlock_acquire(&(*smr)->lock);
@@ -106,10 +172,15 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	(*smr)->peer_addr_offset = peer_addr_offset;
 	(*smr)->name_offset = name_offset;
 	(*smr)->cmd_cnt = attr->rx_count;
+	(*smr)->inject_size = attr->inject_size;
+	ofi_atomic_initialize32(&(*smr)->signal, 0);
+	(*smr)->signal_fd = -1;
+	ofi_atomic_initialize32(&(*smr)->posted.state, SMR_POSTED_IDLE);
 
 	smr_cmd_queue_init(smr_cmd_queue(*smr), attr->rx_count);
 	smr_resp_queue_init(smr_resp_queue(*smr), attr->tx_count);
-	smr_inject_pool_init(smr_inject_pool(*smr), attr->rx_count);
+	smr_inject_pool_init(smr_inject_pool(*smr), attr->rx_count,
+			     attr->inject_size);
 	for (i = 0; i < SMR_MAX_PEERS; i++)
 		smr_peer_addr_init(&smr_peer_addr(*smr)[i]);
 
@@ -127,6 +198,8 @@ err1:
 
 void smr_free(struct smr_region *smr)
 {
+	if (smr->signal_fd >= 0)
+		close(smr->signal_fd);
 	shm_unlink(smr_name(smr));
 	munmap(smr, smr->total_size);
 }
@@ -142,14 +215,128 @@ int smr_map_create(const struct fi_provider *prov, int peer_count,
 		return -FI_ENOMEM;
 	}
 
-	for (i = 0; i < peer_count; i++)
+	for (i = 0; i < peer_count; i++) {
 		smr_peer_addr_init(&(*map)->peers[i].peer);
+		(*map)->peers[i].signal_fd = -1;
+		(*map)->peers[i].signal_err = 0;
+	}
 
 	fastlock_init(&(*map)->lock);
 
 	return 0;
 }
 
+#if SMR_HAVE_SIGNAL
+/* Duplicates fd of process pid, as peers do with a region's signal fd */
+static int smr_getfd(pid_t pid, int fd)
+{
+	int pidfd, ret;
+
+	pidfd = syscall(SYS_pidfd_open, pid, 0);
+	if (pidfd < 0)
+		return -errno;
+
+	ret = syscall(SYS_pidfd_getfd, pidfd, fd, 0);
+	if (ret < 0)
+		ret = -errno;
+	close(pidfd);
+	return ret;
+}
+#endif
+
+int smr_signal_open(const struct fi_provider *prov, struct smr_region *smr)
+{
+#if SMR_HAVE_SIGNAL
+	int fd;
+
+	if (smr->signal_fd >= 0)
+		return 0;
+
+	smr->signal_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (smr->signal_fd < 0) {
+		FI_WARN(prov, FI_LOG_EP_CTRL, "eventfd error\n");
+		return -errno;
+	}
+
+	/* Fail now if the kernel or a seccomp filter doesn't let peers
+	 * duplicate the fd, rather than sleeping without being woken */
+	fd = smr_getfd(getpid(), smr->signal_fd);
+	if (fd < 0) {
+		FI_WARN(prov, FI_LOG_EP_CTRL, "blocking waits not supported, "
+			"pidfd_getfd: %s\n", strerror(-fd));
+		close(smr->signal_fd);
+		smr->signal_fd = -1;
+		return fd;
+	}
+	close(fd);
+	return 0;
+#else
+	FI_WARN(prov, FI_LOG_EP_CTRL, "blocking waits not supported\n");
+	return -FI_ENOSYS;
+#endif
+}
+
+int smr_signal_reset(struct smr_region *smr)
+{
+	uint64_t val;
+
+	return read(smr->signal_fd, &val, sizeof val) == sizeof val ?
+	       0 : -errno;
+}
+
+/* Called with the map lock held.  Returns 0 if the peer doesn't wait or
+ * its signal fd was duplicated. */
+static int smr_map_signal_fd(struct smr_peer *peer)
+{
+#if SMR_HAVE_SIGNAL
+	int fd;
+
+	if (peer->signal_fd >= 0 || peer->region->signal_fd < 0)
+		return 0;
+
+	fd = smr_getfd(peer->region->pid, peer->region->signal_fd);
+	if (fd < 0)
+		return fd;
+
+	peer->signal_fd = fd;
+#endif
+	return 0;
+}
+
+void smr_signal_peer(const struct fi_provider *prov, struct smr_map *map,
+		     int id)
+{
+	struct smr_peer *peer = &map->peers[id];
+	uint64_t val = 1;
+	int ret;
+
+	/* The peer may have started waiting after we mapped its region */
+	if (peer->signal_fd < 0) {
+		if (peer->signal_err)
+			return;
+
+		fastlock_acquire(&map->lock);
+		ret = smr_map_signal_fd(peer);
+		fastlock_release(&map->lock);
+		if (ret) {
+			FI_WARN(prov, FI_LOG_EP_DATA, "unable to get signal fd "
+				"of %s: %s\n", peer->peer.name,
+				strerror(-ret));
+			peer->signal_err = ret;
+			return;
+		}
+	}
+
+	/* Cleared before writing, so that a peer going back to sleep after
+	 * this wakeup sets it again.  If the write fails, leave it set for
+	 * the next post to retry. */
+	ofi_atomic_set32(&peer->region->signal, 0);
+	if (write(peer->signal_fd, &val, sizeof val) != sizeof val) {
+		ofi_atomic_set32(&peer->region->signal, 1);
+		FI_WARN(prov, FI_LOG_EP_DATA, "signal write error\n");
+	}
+}
+
 int smr_map_to_region(const struct fi_provider *prov, struct smr_peer *peer_buf)
 {
 	struct smr_region *peer;
@@ -181,7 +368,22 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_peer *peer_buf)
 	munmap(peer, sizeof(*peer));
 
 	peer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (peer == MAP_FAILED) {
+		FI_WARN(prov, FI_LOG_AV, "mmap error\n");
+		ret = -errno;
+		goto out;
+	}
 	peer_buf->region = peer;
+	peer_buf->signal_err = 0;
+
+	/* A peer that blocks must be woken up by us */
+	ret = smr_map_signal_fd(peer_buf);
+	if (ret) {
+		FI_WARN(prov, FI_LOG_AV, "unable to get signal fd of %s: %s\n",
+			peer_buf->peer.name, strerror(-ret));
+		munmap(peer, size);
+		peer_buf->region = NULL;
+	}
 
 out:
 	close(fd);
@@ -263,6 +465,10 @@ void smr_map_del(struct smr_map *map, int id)
 	    map->peers[id].peer.addr == FI_ADDR_UNSPEC)
 		return;
 
+	if (map->peers[id].signal_fd >= 0) {
+		close(map->peers[id].signal_fd);
+		map->peers[id].signal_fd = -1;
+	}
 	munmap(map->peers[id].region, map->peers[id].region->total_size);
 	map->peers[id].peer.addr = FI_ADDR_UNSPEC;
 }
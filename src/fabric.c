@@ -54,8 +54,12 @@
 struct ofi_prov {
 	struct ofi_prov		*next;
 	char			*prov_name;
+	enum ofi_prov_type	type;
 	struct fi_provider	*provider;
 	void			*dlhandle;
+	/* Built-in providers are only initialized when first needed.  This
+	 * is cleared once the provider was initialized or skipped. */
+	struct fi_provider	*(*ini)(void);
 };
 
 static struct ofi_prov *prov_head, *prov_tail;
@@ -64,6 +68,32 @@ extern struct ofi_common_locks common_locks;
 
 static struct fi_filter prov_filter;
 
+/*
+ * fi_getinfo result cache
+ */
+
+#define OFI_GETINFO_CACHE_SIZE 64
+
+struct ofi_getinfo_entry {
+	struct dlist_entry	entry;
+	uint32_t		version;
+	char			*node;
+	char			*service;
+	uint64_t		flags;
+	struct fi_info		*hints;
+	struct fi_info		*info;
+};
+
+static struct {
+	fastlock_t		lock;
+	struct dlist_entry	list;
+	size_t			cnt;
+	int			pid;
+	int			enabled;
+} getinfo_cache;
+
+static void ofi_getinfo_cache_flush(void);
+
 static int ofi_find_name(char **names, const char *name)
 {
 	int i;
@@ -82,16 +112,6 @@ static enum ofi_prov_type ofi_prov_type(const struct fi_provider *provider)
 	return ctx->type;
 }
 
-static int ofi_is_util_prov(const struct fi_provider *provider)
-{
-	return ofi_prov_type(provider) == OFI_PROV_UTIL;
-}
-
-static int ofi_is_core_prov(const struct fi_provider *provider)
-{
-	return ofi_prov_type(provider) == OFI_PROV_CORE;
-}
-
 static int ofi_is_hook_prov(const struct fi_provider *provider)
 {
 	return ofi_prov_type(provider) == OFI_PROV_HOOK;
@@ -108,7 +128,7 @@ int ofi_apply_filter(struct fi_filter *filter, const char *name)
 	return 0;
 }
 
-static int ofi_getinfo_filter(const struct fi_provider *provider)
+static int ofi_getinfo_filter(const char *name, enum ofi_prov_type type)
 {
 	/* Positive filters only apply to core providers.  They must be
 	 * explicitly enabled by the filter.  Other providers (i.e. utility)
@@ -116,10 +136,10 @@ static int ofi_getinfo_filter(const struct fi_provider *provider)
 	 * over any enabled core filter.  Negative filters may be used
 	 * to disable any provider.
 	 */
-	if (!prov_filter.negated && !ofi_is_core_prov(provider))
+	if (!prov_filter.negated && type != OFI_PROV_CORE)
 		return 0;
 
-	return ofi_apply_filter(&prov_filter, provider->name);
+	return ofi_apply_filter(&prov_filter, name);
 }
 
 static struct ofi_prov *ofi_getprov(const char *prov_name, size_t len)
@@ -135,6 +155,8 @@ static struct ofi_prov *ofi_getprov(const char *prov_name, size_t len)
 	return NULL;
 }
 
+static void ofi_load_prov(struct ofi_prov *prov);
+
 struct fi_provider *ofi_get_hook(const char *name)
 {
 	struct ofi_prov *prov;
@@ -152,6 +174,7 @@ struct fi_provider *ofi_get_hook(const char *name)
 	}
 
 	if (prov) {
+		ofi_load_prov(prov);
 		if (prov->provider && ofi_is_hook_prov(prov->provider)) {
 			provider = prov->provider;
 		} else {
@@ -210,33 +233,89 @@ static struct ofi_prov *ofi_create_prov_entry(const char *prov_name)
 	return prov;
 }
 
-/* This is the default order that providers will be reported when a provider
- * is available.  Initialize the socket(s) provider last.  This will result in
- * it being the least preferred provider.
- */
-static void ofi_ordered_provs_init(void)
-{
-	char *ordered_prov_names[] = {
-		"psm2", "psm", "usnic", "mlx", "gni",
-		"bgq", "netdir", "ofi_rxm", "ofi_rxd", "verbs",
-		/* Initialize the socket based providers last of the
-		 * standard providers.  This will result in them being
-		 * the least preferred providers.
-		 */
+#define OFI_BUILTIN_INI(name, init)				\
+	static struct fi_provider *ofi_ ## name ## _ini(void)	\
+	{							\
+		return init;					\
+	}
 
-		/* Before you add ANYTHING here, read the comment above!!! */
-		"UDP", "sockets", "tcp", /* NOTHING GOES HERE! */
-		/* Seriously, read it! */
+OFI_BUILTIN_INI(psm2, PSM2_INIT)
+OFI_BUILTIN_INI(psm, PSM_INIT)
+OFI_BUILTIN_INI(usnic, USNIC_INIT)
+OFI_BUILTIN_INI(mlx, MLX_INIT)
+OFI_BUILTIN_INI(gni, GNI_INIT)
+OFI_BUILTIN_INI(bgq, BGQ_INIT)
+OFI_BUILTIN_INI(netdir, NETDIR_INIT)
+OFI_BUILTIN_INI(rxm, RXM_INIT)
+OFI_BUILTIN_INI(rxd, RXD_INIT)
+OFI_BUILTIN_INI(verbs, VERBS_INIT)
+OFI_BUILTIN_INI(udp, UDP_INIT)
+OFI_BUILTIN_INI(sockets, SOCKETS_INIT)
+OFI_BUILTIN_INI(tcp, TCP_INIT)
+OFI_BUILTIN_INI(perf_hook, PERF_HOOK_INIT)
+OFI_BUILTIN_INI(noop_hook, NOOP_HOOK_INIT)
+OFI_BUILTIN_INI(shm, SHM_INIT)
+/* OFI_BUILTIN_INI(rstream, RSTREAM_INIT) - no support */
+OFI_BUILTIN_INI(mrail, MRAIL_INIT)
+
+/* Names and types let fi_getinfo() decide whether a built-in provider is
+ * needed before initializing it.  The init function returns NULL if the
+ * provider is not built in. */
+static const struct {
+	const char		*name;
+	enum ofi_prov_type	type;
+	struct fi_provider	*(*ini)(void);
+} ofi_builtin_provs[] = {
+	/* This is the default order that providers will be reported when a
+	 * provider is available.  Initialize the socket(s) provider last.
+	 * This will result in it being the least preferred provider.
+	 */
+	{ "psm2",		OFI_PROV_CORE,	ofi_psm2_ini },
+	{ "psm",		OFI_PROV_CORE,	ofi_psm_ini },
+	{ "usnic",		OFI_PROV_CORE,	ofi_usnic_ini },
+	{ "mlx",		OFI_PROV_CORE,	ofi_mlx_ini },
+	{ "gni",		OFI_PROV_CORE,	ofi_gni_ini },
+	{ "bgq",		OFI_PROV_CORE,	ofi_bgq_ini },
+	{ "netdir",		OFI_PROV_CORE,	ofi_netdir_ini },
+	{ "ofi_rxm",		OFI_PROV_UTIL,	ofi_rxm_ini },
+	{ "ofi_rxd",		OFI_PROV_UTIL,	ofi_rxd_ini },
+	{ "verbs",		OFI_PROV_CORE,	ofi_verbs_ini },
+	/* Initialize the socket based providers last of the
+	 * standard providers.  This will result in them being
+	 * the least preferred providers.
+	 */
 
-		/* These are hooking providers only.  Their order
-		 * doesn't matter
-		 */
-		"ofi_perf_hook", "ofi_noop_hook",
-	};
-	int num_provs = sizeof(ordered_prov_names)/sizeof(ordered_prov_names[0]), i;
+	/* Before you add ANYTHING here, read the comment above!!! */
+	{ "UDP",		OFI_PROV_CORE,	ofi_udp_ini },
+	{ "sockets",		OFI_PROV_CORE,	ofi_sockets_ini },
+	{ "tcp",		OFI_PROV_CORE,	ofi_tcp_ini },
+	/* NOTHING GOES HERE! */
+	/* Seriously, read it! */
 
-	for (i = 0; i < num_provs; i++)
-		ofi_create_prov_entry(ordered_prov_names[i]);
+	/* These are hooking providers only.  Their order
+	 * doesn't matter
+	 */
+	{ "ofi_perf_hook",	OFI_PROV_HOOK,	ofi_perf_hook_ini },
+	{ "ofi_noop_hook",	OFI_PROV_HOOK,	ofi_noop_hook_ini },
+
+	/* Not part of the preferred order, reported after all others */
+	{ "shm",		OFI_PROV_CORE,	ofi_shm_ini },
+	{ "ofi_mrail",		OFI_PROV_UTIL,	ofi_mrail_ini },
+};
+
+static void ofi_ordered_provs_init(void)
+{
+	struct ofi_prov *prov;
+	size_t i;
+
+	for (i = 0; i < sizeof(ofi_builtin_provs) / sizeof(ofi_builtin_provs[0]);
+	     i++) {
+		prov = ofi_create_prov_entry(ofi_builtin_provs[i].name);
+		if (!prov)
+			continue;
+		prov->type = ofi_builtin_provs[i].type;
+		prov->ini = ofi_builtin_provs[i].ini;
+	}
 }
 
 static void ofi_set_prov_type(struct fi_prov_context *ctx,
@@ -293,7 +372,7 @@ static int ofi_register_provider(struct fi_provider *provider, void *dlhandle)
 	ctx = (struct fi_prov_context *) &provider->context;
 	ofi_set_prov_type(ctx, provider);
 
-	if (ofi_getinfo_filter(provider)) {
+	if (ofi_getinfo_filter(provider->name, ctx->type)) {
 		FI_INFO(&core_prov, FI_LOG_CORE,
 			"\"%s\" filtered by provider include/exclude "
 			"list, skipping\n", provider->name);
@@ -343,6 +422,7 @@ static int ofi_register_provider(struct fi_provider *provider, void *dlhandle)
 update_prov_registry:
 	prov->dlhandle = dlhandle;
 	prov->provider = provider;
+	prov->type = ctx->type;
 	return 0;
 
 cleanup:
@@ -350,6 +430,45 @@ cleanup:
 	return ret;
 }
 
+/* Caller must hold the ini_lock */
+static void ofi_load_prov_locked(struct ofi_prov *prov)
+{
+	struct fi_provider *(*ini)(void) = prov->ini;
+	struct fi_provider *provider;
+
+	if (!ini)
+		return;
+
+	prov->ini = NULL;
+	if (ofi_getinfo_filter(prov->prov_name, prov->type)) {
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"\"%s\" filtered by provider include/exclude "
+			"list, skipping\n", prov->prov_name);
+		return;
+	}
+
+	provider = ini();
+	if (provider)
+		ofi_register_provider(provider, NULL);
+}
+
+/* Initialize a built-in provider on first use.  The lock is always taken,
+ * so a concurrent caller can't see the provider half registered. */
+static void ofi_load_prov(struct ofi_prov *prov)
+{
+	pthread_mutex_lock(&common_locks.ini_lock);
+	ofi_load_prov_locked(prov);
+	pthread_mutex_unlock(&common_locks.ini_lock);
+}
+
+void ofi_load_provs(void)
+{
+	struct ofi_prov *prov;
+
+	for (prov = prov_head; prov; prov = prov->next)
+		ofi_load_prov(prov);
+}
+
 #ifdef HAVE_LIBDL
 static int lib_filter(const struct dirent *entry)
 {
@@ -434,6 +553,7 @@ libdl_done:
 
 void fi_ini(void)
 {
+	struct ofi_prov *prov;
 	char *param_val = NULL;
 
 	pthread_mutex_lock(&common_locks.ini_lock);
@@ -448,6 +568,7 @@ void fi_ini(void)
 	ofi_pmem_init();
 	ofi_perf_init();
 	ofi_hook_init();
+	ofi_monitors_init();
 
 	fi_param_define(NULL, "provider", FI_PARAM_STRING,
 			"Only use specified provider (default: all available)");
@@ -461,9 +582,28 @@ void fi_ini(void)
 			" used by distribute OFI application. The provider uses"
 			" this to optimize resource allocations"
 			" (default: OFI service specific)");
+	fi_param_define(NULL, "getinfo_cache", FI_PARAM_BOOL,
+			"Cache fi_getinfo results within the process and"
+			" return copies of them to later calls with the same"
+			" arguments (default: yes)");
+	fi_param_define(NULL, "ep_stats", FI_PARAM_BOOL,
+			"Collect transfer statistics for each endpoint, and log"
+			" them when it is closed (default: no)");
+	fi_param_define(NULL, "atomic_local", FI_PARAM_BOOL,
+			"Apply atomic operations targeting FI_THREAD_DOMAIN"
+			" domains without atomic instructions. Only safe if"
+			" the target memory is not updated through other"
+			" domains or by the application (default: no)");
 	fi_param_get_str(NULL, "provider", &param_val);
 	ofi_create_filter(&prov_filter, param_val);
 
+	getinfo_cache.enabled = 1;
+	fi_param_get_bool(NULL, "getinfo_cache", &getinfo_cache.enabled);
+	fi_param_get_bool(NULL, "ep_stats", &ofi_ep_stats_enabled);
+	fastlock_init(&getinfo_cache.lock);
+	dlist_init(&getinfo_cache.list);
+	getinfo_cache.pid = getpid();
+
 #ifdef HAVE_LIBDL
 	int n = 0;
 	char **dirs;
@@ -495,26 +635,14 @@ void fi_ini(void)
 libdl_done:
 #endif
 
-	ofi_register_provider(PSM2_INIT, NULL);
-	ofi_register_provider(PSM_INIT, NULL);
-	ofi_register_provider(USNIC_INIT, NULL);
-	ofi_register_provider(MLX_INIT, NULL);
-	ofi_register_provider(GNI_INIT, NULL);
-	ofi_register_provider(BGQ_INIT, NULL);
-	ofi_register_provider(NETDIR_INIT, NULL);
-	ofi_register_provider(SHM_INIT, NULL);
-	ofi_register_provider(RXM_INIT, NULL);
-	ofi_register_provider(VERBS_INIT, NULL);
-	/* ofi_register_provider(RSTREAM_INIT, NULL); - no support */
-	ofi_register_provider(MRAIL_INIT, NULL);
-	ofi_register_provider(RXD_INIT, NULL);
-
-	ofi_register_provider(UDP_INIT, NULL);
-	ofi_register_provider(SOCKETS_INIT, NULL);
-	ofi_register_provider(TCP_INIT, NULL);
-
-	ofi_register_provider(PERF_HOOK_INIT, NULL);
-	ofi_register_provider(NOOP_HOOK_INIT, NULL);
+	/* Built-in providers are initialized when first needed.  Those also
+	 * loaded as a library are resolved now, so that the newer one is
+	 * kept before either is in use.
+	 */
+	for (prov = prov_head; prov; prov = prov->next) {
+		if (prov->provider)
+			ofi_load_prov_locked(prov);
+	}
 
 	ofi_init = 1;
 
@@ -529,6 +657,9 @@ FI_DESTRUCTOR(fi_fini(void))
 	if (!ofi_init)
 		return;
 
+	/* Cached infos may reference provider NIC objects */
+	ofi_getinfo_cache_flush();
+
 	while (prov_head) {
 		prov = prov_head;
 		prov_head = prov->next;
@@ -537,7 +668,9 @@ FI_DESTRUCTOR(fi_fini(void))
 		free(prov);
 	}
 
+	fastlock_destroy(&getinfo_cache.lock);
 	ofi_free_filter(&prov_filter);
+	ofi_monitors_cleanup();
 	fi_log_fini();
 	fi_param_fini();
 	ofi_osd_fini();
@@ -591,6 +724,7 @@ static int ofi_getprovinfo(struct fi_info **info)
 
 	*info = tail = NULL;
 	for (prov = prov_head; prov; prov = prov->next) {
+		ofi_load_prov(prov);
 		if (!prov->provider)
 			continue;
 
@@ -631,11 +765,11 @@ static void ofi_set_prov_attr(struct fi_fabric_attr *attr,
 
 	core_name = attr->prov_name;
 	if (core_name) {
-		assert(ofi_is_util_prov(prov));
+		assert(ofi_prov_type(prov) == OFI_PROV_UTIL);
 		attr->prov_name = ofi_strdup_append(core_name, prov->name);
 		free(core_name);
 	} else {
-		assert(ofi_is_core_prov(prov));
+		assert(ofi_prov_type(prov) == OFI_PROV_CORE);
 		attr->prov_name = strdup(prov->name);
 	}
 	attr->prov_version = prov->version;
@@ -659,7 +793,7 @@ static void ofi_set_prov_attr(struct fi_fabric_attr *attr,
  *    name it would be excluded (internal use only). These excluded providers
  *    should be listed only at the end.
  */
-static int ofi_layering_ok(const struct fi_provider *provider,
+static int ofi_layering_ok(const char *name, enum ofi_prov_type type,
 			   char **prov_vec, size_t count,
 			   uint64_t flags)
 {
@@ -671,21 +805,20 @@ static int ofi_layering_ok(const struct fi_provider *provider,
 		if (prov_vec[i][0] != '^')
 		    break;
 
-		if (!strcasecmp(&prov_vec[i][1], provider->name))
+		if (!strcasecmp(&prov_vec[i][1], name))
 			return 0;
 	}
 	count = i + 1;
 
 	if (flags & OFI_CORE_PROV_ONLY) {
 		assert((count == 1) || (count == 0));
-		if (!ofi_is_core_prov(provider)) {
+		if (type != OFI_PROV_CORE) {
 			FI_INFO(&core_prov, FI_LOG_CORE,
-				"Need core provider, skipping %s\n",
-				provider->name);
+				"Need core provider, skipping %s\n", name);
 			return 0;
 		}
 
-		if ((count == 0) && !strcasecmp(provider->name, "sockets")) {
+		if ((count == 0) && !strcasecmp(name, "sockets")) {
 			FI_INFO(&core_prov, FI_LOG_CORE,
 				"Skipping util;sockets layering\n");
 			return 0;
@@ -700,7 +833,7 @@ static int ofi_layering_ok(const struct fi_provider *provider,
 	 * fewer. In such a case, we have to be agnostic to the ordering of
 	 * core and utility providers */
 
-	if ((count == 1) && ofi_is_util_prov(provider) &&
+	if ((count == 1) && type == OFI_PROV_UTIL &&
 	    !ofi_has_util_prefix(prov_vec[0])) {
 		if (!strcasecmp(prov_vec[0], "sockets")) {
 			FI_INFO(&core_prov, FI_LOG_CORE,
@@ -717,32 +850,282 @@ static int ofi_layering_ok(const struct fi_provider *provider,
 	else
 		prov_name = prov_vec[count - 1];
 
-	return !strcasecmp(provider->name, prov_name);
+	return !strcasecmp(name, prov_name);
 }
 
-__attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
-int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
-		const char *service, uint64_t flags,
-		const struct fi_info *hints, struct fi_info **info)
+static int ofi_str_equal(const char *a, const char *b)
 {
-	struct ofi_prov *prov;
-	struct fi_info *tail, *cur;
-	char **prov_vec = NULL;
-	size_t count = 0;
-	int ret;
+	if (!a || !b)
+		return a == b;
+	return !strcmp(a, b);
+}
 
-	if (!ofi_init)
-		fi_ini();
+static int ofi_mem_equal(const void *a, size_t a_len,
+			 const void *b, size_t b_len)
+{
+	if (!a || !b)
+		return a == b;
+	return a_len == b_len && !memcmp(a, b, a_len);
+}
 
-	if (FI_VERSION_LT(fi_version(), version)) {
-		FI_WARN(&core_prov, FI_LOG_CORE,
-			"Requested version is newer than library\n");
-		return -FI_ENOSYS;
+static int ofi_tx_attr_equal(const struct fi_tx_attr *a,
+			     const struct fi_tx_attr *b)
+{
+	if (!a || !b)
+		return a == b;
+	return a->caps == b->caps && a->mode == b->mode &&
+	       a->op_flags == b->op_flags && a->msg_order == b->msg_order &&
+	       a->comp_order == b->comp_order &&
+	       a->inject_size == b->inject_size && a->size == b->size &&
+	       a->iov_limit == b->iov_limit &&
+	       a->rma_iov_limit == b->rma_iov_limit;
+}
+
+static int ofi_rx_attr_equal(const struct fi_rx_attr *a,
+			     const struct fi_rx_attr *b)
+{
+	if (!a || !b)
+		return a == b;
+	return a->caps == b->caps && a->mode == b->mode &&
+	       a->op_flags == b->op_flags && a->msg_order == b->msg_order &&
+	       a->comp_order == b->comp_order &&
+	       a->total_buffered_recv == b->total_buffered_recv &&
+	       a->size == b->size && a->iov_limit == b->iov_limit;
+}
+
+static int ofi_ep_attr_equal(const struct fi_ep_attr *a,
+			     const struct fi_ep_attr *b)
+{
+	if (!a || !b)
+		return a == b;
+	return a->type == b->type && a->protocol == b->protocol &&
+	       a->protocol_version == b->protocol_version &&
+	       a->max_msg_size == b->max_msg_size &&
+	       a->msg_prefix_size == b->msg_prefix_size &&
+	       a->max_order_raw_size == b->max_order_raw_size &&
+	       a->max_order_war_size == b->max_order_war_size &&
+	       a->max_order_waw_size == b->max_order_waw_size &&
+	       a->mem_tag_format == b->mem_tag_format &&
+	       a->tx_ctx_cnt == b->tx_ctx_cnt &&
+	       a->rx_ctx_cnt == b->rx_ctx_cnt &&
+	       ofi_mem_equal(a->auth_key, a->auth_key_size,
+			     b->auth_key, b->auth_key_size);
+}
+
+/* The domain fid is not compared: hints that set it are not cached. */
+static int ofi_domain_attr_equal(const struct fi_domain_attr *a,
+				 const struct fi_domain_attr *b)
+{
+	if (!a || !b)
+		return a == b;
+	return ofi_str_equal(a->name, b->name) &&
+	       a->threading == b->threading &&
+	       a->control_progress == b->control_progress &&
+	       a->data_progress == b->data_progress &&
+	       a->resource_mgmt == b->resource_mgmt &&
+	       a->av_type == b->av_type && a->mr_mode == b->mr_mode &&
+	       a->mr_key_size == b->mr_key_size &&
+	       a->cq_data_size == b->cq_data_size &&
+	       a->cq_cnt == b->cq_cnt && a->ep_cnt == b->ep_cnt &&
+	       a->tx_ctx_cnt == b->tx_ctx_cnt &&
+	       a->rx_ctx_cnt == b->rx_ctx_cnt &&
+	       a->max_ep_tx_ctx == b->max_ep_tx_ctx &&
+	       a->max_ep_rx_ctx == b->max_ep_rx_ctx &&
+	       a->max_ep_stx_ctx == b->max_ep_stx_ctx &&
+	       a->max_ep_srx_ctx == b->max_ep_srx_ctx &&
+	       a->cntr_cnt == b->cntr_cnt &&
+	       a->mr_iov_limit == b->mr_iov_limit &&
+	       a->caps == b->caps && a->mode == b->mode &&
+	       a->max_err_data == b->max_err_data &&
+	       a->mr_cnt == b->mr_cnt &&
+	       ofi_mem_equal(a->auth_key, a->auth_key_size,
+			     b->auth_key, b->auth_key_size);
+}
+
+/* The fabric fid is not compared: hints that set it are not cached. */
+static int ofi_fabric_attr_equal(const struct fi_fabric_attr *a,
+				 const struct fi_fabric_attr *b)
+{
+	if (!a || !b)
+		return a == b;
+	return ofi_str_equal(a->name, b->name) &&
+	       ofi_str_equal(a->prov_name, b->prov_name) &&
+	       a->prov_version == b->prov_version &&
+	       a->api_version == b->api_version;
+}
+
+/* Compare the hints field by field, and the strings and keys they point to
+ * by content.
+ */
+static int ofi_hints_equal(const struct fi_info *a, const struct fi_info *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	return a->caps == b->caps && a->mode == b->mode &&
+	       a->addr_format == b->addr_format &&
+	       ofi_mem_equal(a->src_addr, a->src_addrlen,
+			     b->src_addr, b->src_addrlen) &&
+	       ofi_mem_equal(a->dest_addr, a->dest_addrlen,
+			     b->dest_addr, b->dest_addrlen) &&
+	       ofi_tx_attr_equal(a->tx_attr, b->tx_attr) &&
+	       ofi_rx_attr_equal(a->rx_attr, b->rx_attr) &&
+	       ofi_ep_attr_equal(a->ep_attr, b->ep_attr) &&
+	       ofi_domain_attr_equal(a->domain_attr, b->domain_attr) &&
+	       ofi_fabric_attr_equal(a->fabric_attr, b->fabric_attr);
+}
+
+static struct fi_info *ofi_dupinfo_list(const struct fi_info *info)
+{
+	struct fi_info *head = NULL, *tail = NULL, *cur;
+
+	for (; info; info = info->next) {
+		cur = fi_dupinfo(info);
+		if (!cur) {
+			fi_freeinfo(head);
+			return NULL;
+		}
+
+		if (!head)
+			head = cur;
+		else
+			tail->next = cur;
+		tail = cur;
 	}
+	return head;
+}
 
-	if (flags == FI_PROV_ATTR_ONLY) {
-		return ofi_getprovinfo(info);
+static void ofi_getinfo_entry_free(struct ofi_getinfo_entry *entry)
+{
+	free(entry->node);
+	free(entry->service);
+	fi_freeinfo(entry->hints);
+	fi_freeinfo(entry->info);
+	free(entry);
+}
+
+static void ofi_getinfo_cache_flush(void)
+{
+	struct ofi_getinfo_entry *entry;
+
+	while (!dlist_empty(&getinfo_cache.list)) {
+		dlist_pop_front(&getinfo_cache.list, struct ofi_getinfo_entry,
+				entry, entry);
+		ofi_getinfo_entry_free(entry);
+	}
+	getinfo_cache.cnt = 0;
+}
+
+/* Results depend on the hints by value.  Hints referencing objects (a
+ * connection request, a NIC, an open domain or fabric) are not cached.
+ */
+static int ofi_getinfo_cacheable(const struct fi_info *hints)
+{
+	if (!getinfo_cache.enabled)
+		return 0;
+	if (!hints)
+		return 1;
+	return !hints->handle && !hints->nic &&
+	       (!hints->domain_attr || !hints->domain_attr->domain) &&
+	       (!hints->fabric_attr || !hints->fabric_attr->fabric);
+}
+
+/* The cache is dropped in a forked child: some providers derive their
+ * addresses from the process ID. */
+static struct ofi_getinfo_entry *
+ofi_getinfo_cache_find(uint32_t version, const char *node, const char *service,
+		       uint64_t flags, const struct fi_info *hints)
+{
+	struct ofi_getinfo_entry *entry;
+	struct dlist_entry *item;
+
+	if (getinfo_cache.pid != getpid()) {
+		ofi_getinfo_cache_flush();
+		getinfo_cache.pid = getpid();
+		return NULL;
+	}
+
+	dlist_foreach(&getinfo_cache.list, item) {
+		entry = container_of(item, struct ofi_getinfo_entry, entry);
+		if (entry->version == version && entry->flags == flags &&
+		    ofi_str_equal(entry->node, node) &&
+		    ofi_str_equal(entry->service, service) &&
+		    ofi_hints_equal(entry->hints, hints))
+			return entry;
 	}
+	return NULL;
+}
+
+static int ofi_getinfo_cache_get(uint32_t version, const char *node,
+				 const char *service, uint64_t flags,
+				 const struct fi_info *hints,
+				 struct fi_info **info)
+{
+	struct ofi_getinfo_entry *entry;
+	int ret = -FI_ENOENT;
+
+	fastlock_acquire(&getinfo_cache.lock);
+	entry = ofi_getinfo_cache_find(version, node, service, flags, hints);
+	if (entry) {
+		*info = ofi_dupinfo_list(entry->info);
+		if (*info)
+			ret = 0;
+	}
+	fastlock_release(&getinfo_cache.lock);
+	return ret;
+}
+
+static void ofi_getinfo_cache_put(uint32_t version, const char *node,
+				  const char *service, uint64_t flags,
+				  const struct fi_info *hints,
+				  const struct fi_info *info)
+{
+	struct ofi_getinfo_entry *entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return;
+
+	entry->version = version;
+	entry->flags = flags;
+	if ((node && !(entry->node = strdup(node))) ||
+	    (service && !(entry->service = strdup(service))) ||
+	    (hints && !(entry->hints = fi_dupinfo(hints))) ||
+	    !(entry->info = ofi_dupinfo_list(info))) {
+		ofi_getinfo_entry_free(entry);
+		return;
+	}
+
+	fastlock_acquire(&getinfo_cache.lock);
+	if (ofi_getinfo_cache_find(version, node, service, flags, hints)) {
+		/* Added by a concurrent call */
+		fastlock_release(&getinfo_cache.lock);
+		ofi_getinfo_entry_free(entry);
+		return;
+	}
+
+	if (getinfo_cache.cnt == OFI_GETINFO_CACHE_SIZE) {
+		struct ofi_getinfo_entry *oldest;
+
+		dlist_pop_front(&getinfo_cache.list, struct ofi_getinfo_entry,
+				oldest, entry);
+		ofi_getinfo_entry_free(oldest);
+		getinfo_cache.cnt--;
+	}
+	dlist_insert_tail(&entry->entry, &getinfo_cache.list);
+	getinfo_cache.cnt++;
+	fastlock_release(&getinfo_cache.lock);
+}
+
+static int ofi_getinfo_provs(uint32_t version, const char *node,
+			     const char *service, uint64_t flags,
+			     const struct fi_info *hints, struct fi_info **info)
+{
+	struct ofi_prov *prov;
+	struct fi_info *tail, *cur;
+	char **prov_vec = NULL;
+	size_t count = 0;
+	int ret;
 
 	if (hints && hints->fabric_attr && hints->fabric_attr->prov_name) {
 		prov_vec = ofi_split_and_alloc(hints->fabric_attr->prov_name,
@@ -755,10 +1138,14 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 
 	*info = tail = NULL;
 	for (prov = prov_head; prov; prov = prov->next) {
-		if (!prov->provider || !prov->provider->getinfo)
+		/* Check the layering first to only initialize the
+		 * providers that may be used */
+		if (!ofi_layering_ok(prov->prov_name, prov->type, prov_vec,
+				     count, flags))
 			continue;
 
-		if (!ofi_layering_ok(prov->provider, prov_vec, count, flags))
+		ofi_load_prov(prov);
+		if (!prov->provider || !prov->provider->getinfo)
 			continue;
 
 		if (FI_VERSION_LT(prov->provider->fi_version, version)) {
@@ -803,6 +1190,46 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 
 	return *info ? 0 : -FI_ENODATA;
 }
+
+__attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
+int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
+		const char *service, uint64_t flags,
+		const struct fi_info *hints, struct fi_info **info)
+{
+	int ret;
+
+	if (!ofi_init)
+		fi_ini();
+
+	if (FI_VERSION_LT(fi_version(), version)) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"Requested version is newer than library\n");
+		return -FI_ENOSYS;
+	}
+
+	if (flags == FI_PROV_ATTR_ONLY) {
+		return ofi_getprovinfo(info);
+	}
+
+	if (!ofi_getinfo_cacheable(hints))
+		return ofi_getinfo_provs(version, node, service, flags,
+					 hints, info);
+
+	ret = ofi_getinfo_cache_get(version, node, service, flags, hints,
+				    info);
+	if (ret != -FI_ENOENT) {
+		FI_DBG(&core_prov, FI_LOG_CORE, "fi_getinfo result cached\n");
+		return ret;
+	}
+
+	/* Failures are not cached: a provider may find a device or peer
+	 * that was not available yet. */
+	ret = ofi_getinfo_provs(version, node, service, flags, hints, info);
+	if (!ret)
+		ofi_getinfo_cache_put(version, node, service, flags, hints,
+				      *info);
+	return ret;
+}
 CURRENT_SYMVER(fi_getinfo_, fi_getinfo);
 
 struct fi_info *ofi_allocinfo_internal(void)
@@ -960,6 +1387,8 @@ int DEFAULT_SYMVER_PRE(fi_fabric)(struct fi_fabric_attr *attr,
 		return -FI_EINVAL;
 
 	prov = ofi_getprov(top_name, strlen(top_name));
+	if (prov)
+		ofi_load_prov(prov);
 	if (!prov || !prov->provider || !prov->provider->fabric)
 		return -FI_ENODEV;
 
@@ -41,6 +41,7 @@
 #include <netdb.h>
 #include <poll.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -52,6 +53,10 @@
 #include <sys/wait.h>
 #include <sys/time.h>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #include <ofi_osd.h>
 #include <rdma/fabric.h>
 #include <rdma/fi_cm.h>
@@ -78,6 +83,9 @@ enum {
 	PP_OPT_ITER = 1 << 1,
 	PP_OPT_SIZE = 1 << 2,
 	PP_OPT_VERIFY_DATA = 1 << 3,
+	PP_OPT_STREAM = 1 << 4,
+	PP_OPT_JSON = 1 << 5,
+	PP_OPT_SEP = 1 << 6,
 };
 
 struct pp_opts {
@@ -88,6 +96,7 @@ struct pp_opts {
 	int transfer_size;
 	int sizes_enabled;
 	int options;
+	int threads;
 };
 
 #define PP_SIZE_MAX_POWER_TWO 22
@@ -163,7 +172,7 @@ struct ct_pingpong {
 	struct fid_fabric *fabric;
 	struct fid_domain *domain;
 	struct fid_pep *pep;
-	struct fid_ep *ep;
+	struct fid_ep *ep, *rx_ep, *sep;
 	struct fid_cq *txcq, *rxcq;
 	struct fid_mr *mr;
 	struct fid_av *av;
@@ -195,6 +204,23 @@ struct ct_pingpong {
 	char ctrl_buf[PP_CTRL_BUF_LEN + 1];
 
 	void *local_name, *rem_name;
+
+	/* Each test thread runs on its own copy of this structure, which
+	 * shares the fabric, domain and EQ of the first one (thread 0).
+	 */
+	struct ct_pingpong **threads;
+	int thread_idx;
+	pthread_t thread;
+	int thread_ret;
+	int *cpus, cpu_cnt;
+	int rx_ctx_bits;
+
+	/* Round trip time of each iteration, for the JSON output */
+	uint64_t *lat_ns;
+
+	/* Contexts of the operations in flight in streaming mode */
+	struct fi_context2 *tx_ctx_ring, *rx_ctx_ring;
+	size_t tx_window, rx_window;
 };
 
 static const char integ_alphabet[] =
@@ -215,6 +241,18 @@ static uint64_t pp_gettime_us(void)
 	return now.tv_sec * 1000000 + now.tv_usec;
 }
 
+static uint64_t pp_gettime_ns(void)
+{
+#ifndef _WIN32
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+#else
+	return pp_gettime_us() * 1000;
+#endif
+}
+
 static long parse_ulong(char *str, long max)
 {
 	long ret;
@@ -609,6 +647,10 @@ static int pp_recv_name(struct ct_pingpong *ct)
 		return ret;
 	PP_DEBUG("Received name\n");
 
+	/* Only the first endpoint's name is used to select the fi_info */
+	if (ct->hints->dest_addr)
+		return 0;
+
 	ct->hints->dest_addr = calloc(1, len);
 	if (!ct->hints->dest_addr) {
 		PP_DEBUG("Failed to allocate memory for destination address\n");
@@ -1253,7 +1295,7 @@ static ssize_t pp_rx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 	 * before message size is updated. The recvs posted are always for the
 	 * next incoming message.
 	 */
-	ret = pp_post_rx(ct, ct->ep, MAX(ct->rx_size , PP_MAX_CTRL_MSG) +
+	ret = pp_post_rx(ct, ct->rx_ep, MAX(ct->rx_size , PP_MAX_CTRL_MSG) +
 			 ct->rx_prefix_size, ct->rx_ctx_ptr);
 	if (!ret)
 		ct->cnt_ack_msg++;
@@ -1261,6 +1303,89 @@ static ssize_t pp_rx(struct ct_pingpong *ct, struct fid_ep *ep, size_t size)
 	return ret;
 }
 
+static ssize_t pp_send(struct ct_pingpong *ct, size_t size)
+{
+	if (size < ct->fi->tx_attr->inject_size)
+		return pp_inject(ct, ct->ep, size);
+	else
+		return pp_tx(ct, ct->ep, size);
+}
+
+static void *pp_ring_ctx(struct fi_context2 *ring, void *ctx_ptr,
+			 uint64_t seq, size_t window)
+{
+	return ctx_ptr ? &ring[seq % window] : NULL;
+}
+
+/* Keeps up to tx_window sends in flight and waits for the receiver to
+ * acknowledge the whole stream.
+ */
+static int pp_stream_tx(struct ct_pingpong *ct)
+{
+	size_t size = ct->opts.transfer_size + ct->tx_prefix_size;
+	int ret, i;
+
+	for (i = 0; i < ct->opts.iterations; i++) {
+		if (ct->tx_seq - ct->tx_cq_cntr >= ct->tx_window) {
+			ret = pp_get_tx_comp(ct, ct->tx_seq - ct->tx_window + 1);
+			if (ret)
+				return ret;
+		}
+
+		if (ct->opts.transfer_size < ct->fi->tx_attr->inject_size)
+			ret = pp_post_inject(ct, ct->ep, size);
+		else
+			ret = pp_post_tx(ct, ct->ep, size,
+					 pp_ring_ctx(ct->tx_ctx_ring,
+						     ct->tx_ctx_ptr, ct->tx_seq,
+						     ct->tx_window));
+		if (ret)
+			return ret;
+	}
+
+	ret = pp_get_tx_comp(ct, ct->tx_seq);
+	if (ret)
+		return ret;
+
+	ret = pp_rx(ct, ct->rx_ep, 0);
+	if (ret)
+		return ret;
+
+	/* The acknowledgement covers every message of the stream */
+	ct->cnt_ack_msg += ct->opts.iterations - 1;
+	return 0;
+}
+
+/* Keeps up to rx_window receives posted, leaving one posted for the next
+ * message once the stream is received, as pp_rx() does.
+ */
+static int pp_stream_rx(struct ct_pingpong *ct)
+{
+	uint64_t last = ct->rx_cq_cntr + ct->opts.iterations;
+	size_t size = MAX(ct->rx_size, PP_MAX_CTRL_MSG) + ct->rx_prefix_size;
+	int ret;
+
+	while (ct->rx_cq_cntr < last) {
+		while (ct->rx_seq <= last &&
+		       ct->rx_seq - ct->rx_cq_cntr < ct->rx_window) {
+			ret = pp_post_rx(ct, ct->rx_ep, size,
+					 pp_ring_ctx(ct->rx_ctx_ring,
+						     ct->rx_ctx_ptr, ct->rx_seq,
+						     ct->rx_window));
+			if (ret)
+				return ret;
+		}
+
+		ret = pp_get_rx_comp(ct, ct->rx_cq_cntr + 1);
+		if (ret)
+			return ret;
+	}
+	ct->cnt_ack_msg += ct->opts.iterations;
+
+	/* Not all providers handle zero-length messages, ack with a byte */
+	return (int) pp_send(ct, 1);
+}
+
 /*******************************************************************************
  *                                Initialization and allocations
  ******************************************************************************/
@@ -1324,8 +1449,8 @@ static int pp_alloc_msgs(struct ct_pingpong *ct)
 
 	if (ct->fi->domain_attr->mr_mode & FI_MR_LOCAL) {
 		ret = fi_mr_reg(ct->domain, ct->buf, ct->buf_size,
-				FI_SEND | FI_RECV, 0, PP_MR_KEY, 0, &(ct->mr),
-				NULL);
+				FI_SEND | FI_RECV, 0, PP_MR_KEY + ct->thread_idx,
+				0, &(ct->mr), NULL);
 		if (ret) {
 			PP_PRINTERR("fi_mr_reg", ret);
 			return ret;
@@ -1366,6 +1491,45 @@ static int pp_open_fabric_res(struct ct_pingpong *ct)
 	return 0;
 }
 
+/* Opens the transmit and receive contexts of this thread, and the scalable
+ * endpoint itself on thread 0.
+ */
+static int pp_alloc_sep_ctx(struct ct_pingpong *ct, struct fi_info *fi)
+{
+	int ret;
+
+	if (!ct->sep) {
+		fi->ep_attr->tx_ctx_cnt = ct->opts.threads;
+		fi->ep_attr->rx_ctx_cnt = ct->opts.threads;
+
+		ret = fi_scalable_ep(ct->domain, fi, &(ct->sep), NULL);
+		if (ret) {
+			PP_PRINTERR("fi_scalable_ep", ret);
+			return ret;
+		}
+
+		ret = fi_scalable_ep_bind(ct->sep, &(ct->av->fid), 0);
+		if (ret) {
+			PP_PRINTERR("fi_scalable_ep_bind", ret);
+			return ret;
+		}
+	}
+
+	ret = fi_tx_context(ct->sep, ct->thread_idx, NULL, &(ct->ep), NULL);
+	if (ret) {
+		PP_PRINTERR("fi_tx_context", ret);
+		return ret;
+	}
+
+	ret = fi_rx_context(ct->sep, ct->thread_idx, NULL, &(ct->rx_ep), NULL);
+	if (ret) {
+		PP_PRINTERR("fi_rx_context", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
 static int pp_alloc_active_res(struct ct_pingpong *ct, struct fi_info *fi)
 {
 	int ret;
@@ -1393,8 +1557,8 @@ static int pp_alloc_active_res(struct ct_pingpong *ct, struct fi_info *fi)
 		return ret;
 	}
 
-	if (fi->ep_attr->type == FI_EP_RDM ||
-	    fi->ep_attr->type == FI_EP_DGRAM) {
+	if (!ct->av && (fi->ep_attr->type == FI_EP_RDM ||
+			fi->ep_attr->type == FI_EP_DGRAM)) {
 		if (fi->domain_attr->av_type != FI_AV_UNSPEC)
 			ct->av_attr.type = fi->domain_attr->av_type;
 
@@ -1410,11 +1574,15 @@ static int pp_alloc_active_res(struct ct_pingpong *ct, struct fi_info *fi)
 	if (fi->rx_attr->mode & FI_MSG_PREFIX)
 		ct->rx_prefix_size = fi->ep_attr->msg_prefix_size;
 
+	if (pp_check_opts(ct, PP_OPT_SEP))
+		return pp_alloc_sep_ctx(ct, fi);
+
 	ret = fi_endpoint(ct->domain, fi, &(ct->ep), NULL);
 	if (ret) {
 		PP_PRINTERR("fi_endpoint", ret);
 		return ret;
 	}
+	ct->rx_ep = ct->ep;
 
 	return 0;
 }
@@ -1487,9 +1655,10 @@ static int pp_init_ep(struct ct_pingpong *ct)
 
 	if (ct->fi->ep_attr->type == FI_EP_MSG)
 		PP_EP_BIND(ct->ep, ct->eq, 0);
-	PP_EP_BIND(ct->ep, ct->av, 0);
+	if (!ct->sep)
+		PP_EP_BIND(ct->ep, ct->av, 0);
 	PP_EP_BIND(ct->ep, ct->txcq, FI_TRANSMIT);
-	PP_EP_BIND(ct->ep, ct->rxcq, FI_RECV);
+	PP_EP_BIND(ct->rx_ep, ct->rxcq, FI_RECV);
 
 	ret = fi_enable(ct->ep);
 	if (ret) {
@@ -1497,7 +1666,15 @@ static int pp_init_ep(struct ct_pingpong *ct)
 		return ret;
 	}
 
-	ret = pp_post_rx(ct, ct->ep, MAX(ct->rx_size, PP_MAX_CTRL_MSG) +
+	if (ct->rx_ep != ct->ep) {
+		ret = fi_enable(ct->rx_ep);
+		if (ret) {
+			PP_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+	}
+
+	ret = pp_post_rx(ct, ct->rx_ep, MAX(ct->rx_size, PP_MAX_CTRL_MSG) +
 			 ct->rx_prefix_size, ct->rx_ctx_ptr);
 	if (ret)
 		return ret;
@@ -1598,19 +1775,13 @@ static int pp_start_server(struct ct_pingpong *ct)
 	return 0;
 }
 
-static int pp_server_connect(struct ct_pingpong *ct)
+static int pp_server_accept(struct ct_pingpong *ct)
 {
 	struct fi_eq_cm_entry entry;
 	uint32_t event;
 	ssize_t rd;
 	int ret;
 
-	PP_DEBUG("Connected endpoint: connecting server\n");
-
-	ret = pp_exchange_names_connected(ct);
-	if (ret)
-		return ret;
-
 	/* Listen */
 	rd = fi_eq_sread(ct->eq, &event, &entry, sizeof(entry), -1, 0);
 	if (rd != sizeof(entry)) {
@@ -1624,10 +1795,12 @@ static int pp_server_connect(struct ct_pingpong *ct)
 	}
 
 	ct->fi = entry.info;
-	ret = fi_domain(ct->fabric, ct->fi, &(ct->domain), NULL);
-	if (ret) {
-		PP_PRINTERR("fi_domain", ret);
-		goto err;
+	if (!ct->domain) {
+		ret = fi_domain(ct->fabric, ct->fi, &(ct->domain), NULL);
+		if (ret) {
+			PP_PRINTERR("fi_domain", ret);
+			goto err;
+		}
 	}
 
 	ret = pp_alloc_active_res(ct, ct->fi);
@@ -1669,20 +1842,25 @@ err:
 	return ret;
 }
 
-static int pp_client_connect(struct ct_pingpong *ct)
+static int pp_server_connect(struct ct_pingpong *ct)
 {
-	struct fi_eq_cm_entry entry;
-	uint32_t event;
-	ssize_t rd;
 	int ret;
 
+	PP_DEBUG("Connected endpoint: connecting server\n");
+
 	ret = pp_exchange_names_connected(ct);
 	if (ret)
 		return ret;
 
-	ret = pp_open_fabric_res(ct);
-	if (ret)
-		return ret;
+	return pp_server_accept(ct);
+}
+
+static int pp_connect_ep(struct ct_pingpong *ct, void *name)
+{
+	struct fi_eq_cm_entry entry;
+	uint32_t event;
+	ssize_t rd;
+	int ret;
 
 	ret = pp_alloc_active_res(ct, ct->fi);
 	if (ret)
@@ -1692,7 +1870,7 @@ static int pp_client_connect(struct ct_pingpong *ct)
 	if (ret)
 		return ret;
 
-	ret = fi_connect(ct->ep, ct->rem_name, NULL, 0);
+	ret = fi_connect(ct->ep, name, NULL, 0);
 	if (ret) {
 		PP_PRINTERR("fi_connect", ret);
 		return ret;
@@ -1716,6 +1894,229 @@ static int pp_client_connect(struct ct_pingpong *ct)
 	return 0;
 }
 
+static int pp_client_connect(struct ct_pingpong *ct)
+{
+	int ret;
+
+	ret = pp_exchange_names_connected(ct);
+	if (ret)
+		return ret;
+
+	ret = pp_open_fabric_res(ct);
+	if (ret)
+		return ret;
+
+	return pp_connect_ep(ct, ct->rem_name);
+}
+
+/*******************************************************************************
+ *                                         Threads
+ ******************************************************************************/
+
+static void pp_pin_thread(struct ct_pingpong *ct)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	int ret;
+
+	CPU_ZERO(&set);
+	CPU_SET(ct->cpus[ct->thread_idx % ct->cpu_cnt], &set);
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (ret)
+		PP_PRINTERR("pthread_setaffinity_np", -ret);
+#else
+	PP_ERR("CPU pinning is not supported on this platform");
+#endif
+}
+
+static int pp_alloc_test_res(struct ct_pingpong *ct)
+{
+	if (pp_check_opts(ct, PP_OPT_STREAM)) {
+		ct->tx_window = MAX(ct->fi->tx_attr->size, (size_t) 1);
+		ct->rx_window = MAX(ct->fi->rx_attr->size, (size_t) 1);
+		ct->tx_ctx_ring = calloc(ct->tx_window,
+					 sizeof(*ct->tx_ctx_ring));
+		ct->rx_ctx_ring = calloc(ct->rx_window,
+					 sizeof(*ct->rx_ctx_ring));
+		if (!ct->tx_ctx_ring || !ct->rx_ctx_ring)
+			return -FI_ENOMEM;
+	} else if (pp_check_opts(ct, PP_OPT_JSON) && ct->opts.iterations) {
+		ct->lat_ns = calloc(ct->opts.iterations, sizeof(*ct->lat_ns));
+		if (!ct->lat_ns)
+			return -FI_ENOMEM;
+	}
+	return 0;
+}
+
+/* Copies the objects shared by all threads, everything else is per thread */
+static void pp_thread_init(struct ct_pingpong *ct, struct ct_pingpong *t,
+			   int idx)
+{
+	memset(t, 0, sizeof(*t));
+	t->fi = ct->fi;
+	t->hints = ct->hints;
+	t->fabric = ct->fabric;
+	t->domain = ct->domain;
+	t->pep = ct->pep;
+	t->eq = ct->eq;
+	t->sep = ct->sep;
+	if (ct->sep)
+		t->av = ct->av;
+	t->av_attr = ct->av_attr;
+	t->cq_attr = ct->cq_attr;
+	t->opts = ct->opts;
+	t->timeout_sec = ct->timeout_sec;
+	t->ctrl_connfd = ct->ctrl_connfd;
+	t->cpus = ct->cpus;
+	t->cpu_cnt = ct->cpu_cnt;
+	t->rx_ctx_bits = ct->rx_ctx_bits;
+	t->thread_idx = idx;
+
+	if (ct->tx_ctx_ptr)
+		t->tx_ctx_ptr = ct->tx_ctx_ptr == &ct->tx_ctx[0] ?
+				&t->tx_ctx[0] : &t->tx_ctx[1];
+	if (ct->rx_ctx_ptr)
+		t->rx_ctx_ptr = ct->rx_ctx_ptr == &ct->rx_ctx[0] ?
+				&t->rx_ctx[0] : &t->rx_ctx[1];
+}
+
+static int pp_alloc_threads(struct ct_pingpong *ct)
+{
+	int i, ret;
+
+	ct->threads = calloc(ct->opts.threads, sizeof(*ct->threads));
+	if (!ct->threads)
+		return -FI_ENOMEM;
+
+	ct->threads[0] = ct;
+	for (i = 1; i < ct->opts.threads; i++) {
+		ct->threads[i] = malloc(sizeof(*ct->threads[i]));
+		if (!ct->threads[i])
+			return -FI_ENOMEM;
+		pp_thread_init(ct, ct->threads[i], i);
+	}
+
+	for (i = 0; i < ct->opts.threads; i++) {
+		ret = pp_alloc_test_res(ct->threads[i]);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/* Opens the endpoint of thread 0, or every context of a scalable endpoint */
+static int pp_init_eps(struct ct_pingpong *ct)
+{
+	int i, ret;
+
+	ret = pp_alloc_active_res(ct, ct->fi);
+	if (ret)
+		return ret;
+
+	ret = pp_init_ep(ct);
+	if (ret)
+		return ret;
+
+	ret = pp_alloc_threads(ct);
+	if (ret || !ct->sep)
+		return ret;
+
+	for (i = 1; i < ct->opts.threads; i++) {
+		ret = pp_alloc_active_res(ct->threads[i], ct->fi);
+		if (ret)
+			return ret;
+
+		ret = pp_init_ep(ct->threads[i]);
+		if (ret)
+			return ret;
+	}
+
+	ret = fi_enable(ct->sep);
+	if (ret)
+		PP_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+/* Connection-less endpoints of threads other than 0 exchange their names
+ * in the same order as the first one.
+ */
+static int pp_init_thread_ep(struct ct_pingpong *ct)
+{
+	int ret;
+
+	ret = pp_alloc_active_res(ct, ct->fi);
+	if (ret)
+		return ret;
+
+	ret = pp_init_ep(ct);
+	if (ret)
+		return ret;
+
+	if (ct->opts.dst_addr) {
+		ret = pp_recv_name(ct);
+		if (ret < 0)
+			return ret;
+		ret = pp_send_name(ct, &ct->ep->fid);
+	} else {
+		ret = pp_send_name(ct, &ct->ep->fid);
+		if (ret < 0)
+			return ret;
+		ret = pp_recv_name(ct);
+	}
+	if (ret < 0)
+		return ret;
+
+	return pp_av_insert(ct->av, ct->rem_name, 1, &(ct->remote_fi_addr), 0,
+			    NULL);
+}
+
+static int pp_init_threads_connless(struct ct_pingpong *ct)
+{
+	int i, ret;
+
+	for (i = 1; i < ct->opts.threads; i++) {
+		if (ct->sep) {
+			ct->threads[i]->remote_fi_addr =
+				fi_rx_addr(ct->remote_fi_addr, i,
+					   ct->rx_ctx_bits);
+			continue;
+		}
+
+		ret = pp_init_thread_ep(ct->threads[i]);
+		if (ret)
+			return ret;
+	}
+
+	if (ct->sep)
+		ct->remote_fi_addr = fi_rx_addr(ct->remote_fi_addr, 0,
+						ct->rx_ctx_bits);
+	return 0;
+}
+
+static int pp_connect_threads(struct ct_pingpong *ct)
+{
+	int i, ret;
+
+	ret = pp_alloc_threads(ct);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < ct->opts.threads; i++) {
+		/* Keeps the CM events of each connection apart */
+		ret = pp_ctrl_sync(ct);
+		if (ret)
+			return ret;
+
+		if (ct->opts.dst_addr)
+			ret = pp_connect_ep(ct->threads[i], ct->rem_name);
+		else
+			ret = pp_server_accept(ct->threads[i]);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
 static int pp_init_fabric(struct ct_pingpong *ct)
 {
 	int ret;
@@ -1741,15 +2142,11 @@ static int pp_init_fabric(struct ct_pingpong *ct)
 		if (ret)
 			return ret;
 
-		ret = pp_alloc_active_res(ct, ct->fi);
-		if (ret)
-			return ret;
-
-		ret = pp_init_ep(ct);
+		ret = pp_init_eps(ct);
 		if (ret)
 			return ret;
 
-		ret = pp_send_name(ct, &ct->ep->fid);
+		ret = pp_send_name(ct, ct->sep ? &ct->sep->fid : &ct->ep->fid);
 	} else {
 		PP_DEBUG("SERVER: getinfo\n");
 		ret = pp_getinfo(ct, ct->hints, &(ct->fi));
@@ -1761,17 +2158,12 @@ static int pp_init_fabric(struct ct_pingpong *ct)
 		if (ret)
 			return ret;
 
-		PP_DEBUG("SERVER: allocate active resource\n");
-		ret = pp_alloc_active_res(ct, ct->fi);
-		if (ret)
-			return ret;
-
-		PP_DEBUG("SERVER: initialize endpoint\n");
-		ret = pp_init_ep(ct);
+		PP_DEBUG("SERVER: allocate active resource and endpoints\n");
+		ret = pp_init_eps(ct);
 		if (ret)
 			return ret;
 
-		ret = pp_send_name(ct, &ct->ep->fid);
+		ret = pp_send_name(ct, ct->sep ? &ct->sep->fid : &ct->ep->fid);
 		if (ret < 0)
 			return ret;
 
@@ -1797,6 +2189,10 @@ static int pp_init_fabric(struct ct_pingpong *ct)
 		ret = pp_av_insert(ct->av, ct->rem_name, 1, &(ct->remote_fi_addr), 0,
 				   NULL);
 	}
+	if (ret)
+		return ret;
+
+	ret = pp_init_threads_connless(ct);
 	if (ret)
 		return ret;
 	PP_DEBUG("Connection-less endpoint: address vector initialized\n");
@@ -1810,13 +2206,20 @@ static int pp_init_fabric(struct ct_pingpong *ct)
  *                                Deallocations and Final
  ******************************************************************************/
 
+static void pp_free_threads(struct ct_pingpong *ct);
+
 static void pp_free_res(struct ct_pingpong *ct)
 {
 	PP_DEBUG("Freeing resources of test suite\n");
 
+	pp_free_threads(ct);
+
 	if (ct->mr != &(ct->no_mr))
 		PP_CLOSE_FID(ct->mr);
+	if (ct->rx_ep != ct->ep)
+		PP_CLOSE_FID(ct->rx_ep);
 	PP_CLOSE_FID(ct->ep);
+	PP_CLOSE_FID(ct->sep);
 	PP_CLOSE_FID(ct->pep);
 	PP_CLOSE_FID(ct->rxcq);
 	PP_CLOSE_FID(ct->txcq);
@@ -1827,7 +2230,11 @@ static void pp_free_res(struct ct_pingpong *ct)
 
 	free(ct->rem_name);
 	free(ct->local_name);
-	
+	free(ct->lat_ns);
+	free(ct->tx_ctx_ring);
+	free(ct->rx_ctx_ring);
+	free(ct->cpus);
+
 	if (ct->buf) {
 		ofi_freealign(ct->buf);
 		ct->buf = ct->rx_buf = ct->tx_buf = NULL;
@@ -1849,6 +2256,37 @@ static void pp_free_res(struct ct_pingpong *ct)
 	PP_DEBUG("Resources of test suite freed\n");
 }
 
+static void pp_free_threads(struct ct_pingpong *ct)
+{
+	struct ct_pingpong *t;
+	int i;
+
+	if (!ct->threads)
+		return;
+
+	for (i = 1; i < ct->opts.threads && ct->threads[i]; i++) {
+		t = ct->threads[i];
+
+		/* Leave the shared objects to thread 0 */
+		t->pep = NULL;
+		t->sep = NULL;
+		t->eq = NULL;
+		t->domain = NULL;
+		t->fabric = NULL;
+		t->hints = NULL;
+		t->cpus = NULL;
+		if (t->av == ct->av)
+			t->av = NULL;
+		if (t->fi == ct->fi)
+			t->fi = NULL;
+
+		pp_free_res(t);
+		free(t);
+	}
+	free(ct->threads);
+	ct->threads = NULL;
+}
+
 static int pp_finalize(struct ct_pingpong *ct)
 {
 	struct iovec iov;
@@ -1956,10 +2394,54 @@ static void pp_pingpong_usage(struct ct_pingpong *ct, char *name, char *desc)
 	fprintf(stderr, " %-20s %s\n", "-m <transmit mode>",
 		"transmit mode type: msg|tagged (msg)");
 
+	fprintf(stderr, " %-20s %s (%d)\n", "-T <threads>",
+		"number of threads, each with its own endpoint",
+		ct->opts.threads);
+	fprintf(stderr, " %-20s %s\n", "-x",
+		"use one context of a scalable endpoint per thread (rdm)");
+	fprintf(stderr, " %-20s %s\n", "-a <cpus>",
+		"pin threads to a list of CPUs eg 0,2,4-7");
+	fprintf(stderr, " %-20s %s\n", "-W",
+		"stream messages without waiting for each reply");
+	fprintf(stderr, " %-20s %s\n", "-j",
+		"print results as JSON lines with latency percentiles");
+
 	fprintf(stderr, " %-20s %s\n", "-h", "display this help output");
 	fprintf(stderr, " %-20s %s\n", "-v", "enable debugging output");
 }
 
+/* Parses a list of CPUs and CPU ranges, such as 0,2,4-7 */
+static int pp_parse_cpus(struct ct_pingpong *ct, char *str)
+{
+	long first, last;
+	char *end;
+	int *cpus;
+
+	while (*str) {
+		first = strtol(str, &end, 10);
+		last = first;
+		if (end != str && *end == '-')
+			last = strtol(end + 1, &end, 10);
+
+		if (end == str || first < 0 || last < first ||
+		    last >= INT_MAX || (*end && *end != ',')) {
+			fprintf(stderr, "Invalid CPU list: %s\n", str);
+			return -FI_EINVAL;
+		}
+
+		for (; first <= last; first++) {
+			cpus = realloc(ct->cpus,
+				       (ct->cpu_cnt + 1) * sizeof(*cpus));
+			if (!cpus)
+				return -FI_ENOMEM;
+			ct->cpus = cpus;
+			ct->cpus[ct->cpu_cnt++] = (int) first;
+		}
+		str = *end ? end + 1 : end;
+	}
+	return 0;
+}
+
 static void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 {
 	switch (op) {
@@ -2034,6 +2516,34 @@ static void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 		}
 		break;
 
+	/* Threads */
+	case 'T':
+		ct->opts.threads = (int)parse_ulong(optarg, INT_MAX);
+		if (ct->opts.threads < 1)
+			ct->opts.threads = 1;
+		break;
+
+	/* Scalable endpoint */
+	case 'x':
+		ct->opts.options |= PP_OPT_SEP;
+		break;
+
+	/* CPU affinity */
+	case 'a':
+		if (pp_parse_cpus(ct, optarg))
+			exit(EXIT_FAILURE);
+		break;
+
+	/* Streaming */
+	case 'W':
+		ct->opts.options |= PP_OPT_STREAM;
+		break;
+
+	/* JSON output */
+	case 'j':
+		ct->opts.options |= PP_OPT_JSON;
+		break;
+
 	/* Debug */
 	case 'v':
 		pp_debug = 1;
@@ -2044,61 +2554,243 @@ static void pp_parse_opts(struct ct_pingpong *ct, int op, char *optarg)
 	}
 }
 
+/* Checks the options that only work together, and sets the hints they need */
+static int pp_check_test_opts(struct ct_pingpong *ct)
+{
+	if (pp_check_opts(ct, PP_OPT_VERIFY_DATA) &&
+	    (ct->opts.threads > 1 || pp_check_opts(ct, PP_OPT_STREAM))) {
+		fprintf(stderr, "Data checks require one thread and no "
+			"streaming\n");
+		return -FI_EINVAL;
+	}
+
+	if (pp_check_opts(ct, PP_OPT_STREAM) &&
+	    ct->hints->ep_attr->type == FI_EP_DGRAM) {
+		fprintf(stderr, "Streaming requires a reliable endpoint: "
+			"msg|rdm\n");
+		return -FI_EINVAL;
+	}
+
+	if (pp_check_opts(ct, PP_OPT_SEP)) {
+		if (ct->hints->ep_attr->type != FI_EP_RDM) {
+			fprintf(stderr, "Scalable endpoints require rdm\n");
+			return -FI_EINVAL;
+		}
+
+		ct->hints->caps |= FI_NAMED_RX_CTX;
+		ct->hints->ep_attr->tx_ctx_cnt = ct->opts.threads;
+		ct->hints->ep_attr->rx_ctx_cnt = ct->opts.threads;
+		while (ct->opts.threads >> ++ct->rx_ctx_bits)
+			;
+		ct->av_attr.rx_ctx_bits = ct->rx_ctx_bits;
+	}
+
+	if (ct->opts.threads > 1)
+		ct->hints->domain_attr->threading = FI_THREAD_SAFE;
+
+	if (ct->cpus)
+		pp_pin_thread(ct);
+	return 0;
+}
+
 /*******************************************************************************
  *      PingPong core and implemenations for endpoints
  ******************************************************************************/
 
-static int pingpong(struct ct_pingpong *ct)
+static int pp_test(struct ct_pingpong *ct)
 {
+	uint64_t start_ns = 0;
 	int ret, i;
 
-	ret = pp_ctrl_sync(ct);
-	if (ret)
-		return ret;
-
 	pp_start(ct);
-	if (ct->opts.dst_addr) {
+	if (pp_check_opts(ct, PP_OPT_STREAM)) {
+		ret = ct->opts.dst_addr ? pp_stream_tx(ct) : pp_stream_rx(ct);
+		if (ret)
+			return ret;
+	} else if (ct->opts.dst_addr) {
 		for (i = 0; i < ct->opts.iterations; i++) {
+			if (ct->lat_ns)
+				start_ns = pp_gettime_ns();
 
-			if (ct->opts.transfer_size <
-			    ct->fi->tx_attr->inject_size)
-				ret = pp_inject(ct, ct->ep,
-						ct->opts.transfer_size);
-			else
-				ret = pp_tx(ct, ct->ep, ct->opts.transfer_size);
+			ret = pp_send(ct, ct->opts.transfer_size);
 			if (ret)
 				return ret;
 
 			ret = pp_rx(ct, ct->ep, ct->opts.transfer_size);
 			if (ret)
 				return ret;
+
+			if (ct->lat_ns)
+				ct->lat_ns[i] = pp_gettime_ns() - start_ns;
 		}
 	} else {
 		for (i = 0; i < ct->opts.iterations; i++) {
+			if (ct->lat_ns)
+				start_ns = pp_gettime_ns();
 
 			ret = pp_rx(ct, ct->ep, ct->opts.transfer_size);
 			if (ret)
 				return ret;
 
-			if (ct->opts.transfer_size <
-			    ct->fi->tx_attr->inject_size)
-				ret = pp_inject(ct, ct->ep,
-						ct->opts.transfer_size);
-			else
-				ret = pp_tx(ct, ct->ep, ct->opts.transfer_size);
+			ret = pp_send(ct, ct->opts.transfer_size);
 			if (ret)
 				return ret;
+
+			if (ct->lat_ns)
+				ct->lat_ns[i] = pp_gettime_ns() - start_ns;
 		}
 	}
 	pp_stop(ct);
 
+	return 0;
+}
+
+static void *pp_thread_run(void *arg)
+{
+	struct ct_pingpong *ct = arg;
+
+	if (ct->cpus)
+		pp_pin_thread(ct);
+
+	ct->thread_ret = pp_test(ct);
+	return NULL;
+}
+
+/* Thread 0 runs its part of the test in the calling thread */
+static int pp_run_threads(struct ct_pingpong *ct)
+{
+	struct ct_pingpong *t;
+	int i, ret = 0;
+
+	for (i = 1; i < ct->opts.threads; i++) {
+		t = ct->threads[i];
+		t->opts.transfer_size = ct->opts.transfer_size;
+		t->cnt_ack_msg = 0;
+
+		ret = pthread_create(&t->thread, NULL, pp_thread_run, t);
+		if (ret) {
+			PP_PRINTERR("pthread_create", -ret);
+			ret = -ret;
+			break;
+		}
+	}
+
+	ct->thread_ret = ret ? ret : pp_test(ct);
+
+	while (--i > 0)
+		pthread_join(ct->threads[i]->thread, NULL);
+
+	for (i = 0; i < ct->opts.threads; i++) {
+		if (ct->threads[i]->thread_ret)
+			return ct->threads[i]->thread_ret;
+	}
+
+	for (i = 1; i < ct->opts.threads; i++)
+		ct->cnt_ack_msg += ct->threads[i]->cnt_ack_msg;
+	return 0;
+}
+
+static int pp_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted round trip times, as one-way usec */
+static double pp_percentile(uint64_t *lat, size_t cnt, double pct)
+{
+	double pos = pct / 100.0 * cnt;
+	size_t rank = (size_t) pos;
+
+	if (rank < pos)
+		rank++;
+	return lat[rank ? rank - 1 : 0] / 2000.0;
+}
+
+static void pp_show_json(struct ct_pingpong *ct, uint64_t start, uint64_t end,
+			 int xfers_per_iter)
+{
+	int sent = ct->opts.iterations * ct->opts.threads;
+	int64_t elapsed = MAX((int64_t) (end - start), (int64_t) 1);
+	uint64_t bytes = (uint64_t) sent * ct->opts.transfer_size *
+			 xfers_per_iter;
+	uint64_t *lat;
+	size_t cnt = 0;
+	int i;
+
+	if (sent == 0)
+		return;
+
+	printf("{\"provider\": \"%s\", \"ep_type\": \"%s\", \"mode\": \"%s\", "
+	       "\"threads\": %d, \"scalable_ep\": %s, \"size\": %d, "
+	       "\"iterations\": %d, \"sent\": %d, \"acked\": %ld, "
+	       "\"bytes\": %" PRIu64 ", \"time_usec\": %" PRId64 ", "
+	       "\"mb_per_sec\": %.2f, \"usec_per_xfer\": %.3f, "
+	       "\"mxfers_per_sec\": %.3f",
+	       ct->fi->fabric_attr->prov_name,
+	       fi_tostr(&ct->fi->ep_attr->type, FI_TYPE_EP_TYPE),
+	       pp_check_opts(ct, PP_OPT_STREAM) ? "stream" : "pingpong",
+	       ct->opts.threads, ct->sep ? "true" : "false",
+	       ct->opts.transfer_size, ct->opts.iterations, sent,
+	       ct->cnt_ack_msg, bytes, elapsed, bytes / (double) elapsed,
+	       elapsed / (double) sent / xfers_per_iter,
+	       sent * xfers_per_iter / (double) elapsed);
+
+	lat = ct->lat_ns ? malloc(sent * sizeof(*lat)) : NULL;
+	if (lat) {
+		for (i = 0; i < ct->opts.threads; i++) {
+			memcpy(&lat[cnt], ct->threads[i]->lat_ns,
+			       ct->opts.iterations * sizeof(*lat));
+			cnt += ct->opts.iterations;
+		}
+		qsort(lat, cnt, sizeof(*lat), pp_cmp_u64);
+
+		printf(", \"latency_usec\": {\"min\": %.3f, \"p50\": %.3f, "
+		       "\"p90\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, "
+		       "\"max\": %.3f}", lat[0] / 2000.0,
+		       pp_percentile(lat, cnt, 50),
+		       pp_percentile(lat, cnt, 90),
+		       pp_percentile(lat, cnt, 99),
+		       pp_percentile(lat, cnt, 99.9), lat[cnt - 1] / 2000.0);
+		free(lat);
+	}
+	printf("}\n");
+}
+
+static int pingpong(struct ct_pingpong *ct)
+{
+	uint64_t start, end;
+	int ret, i, xfers_per_iter;
+
+	ret = pp_ctrl_sync(ct);
+	if (ret)
+		return ret;
+
+	ret = ct->opts.threads > 1 ? pp_run_threads(ct) : pp_test(ct);
+	if (ret)
+		return ret;
+
 	ret = pp_ctrl_txrx_msg_count(ct);
 	if (ret)
 		return ret;
 
+	/* The run lasts from the first thread start to the last thread end */
+	start = ct->start;
+	end = ct->end;
+	for (i = 1; i < ct->opts.threads; i++) {
+		start = MIN(start, ct->threads[i]->start);
+		end = MAX(end, ct->threads[i]->end);
+	}
+	xfers_per_iter = pp_check_opts(ct, PP_OPT_STREAM) ? 1 : 2;
+
 	PP_DEBUG("Results:\n");
-	show_perf(NULL, ct->opts.transfer_size, ct->opts.iterations,
-		  ct->cnt_ack_msg, ct->start, ct->end, 2);
+	if (pp_check_opts(ct, PP_OPT_JSON))
+		pp_show_json(ct, start, end, xfers_per_iter);
+	else
+		show_perf(NULL, ct->opts.transfer_size,
+			  ct->opts.iterations * ct->opts.threads,
+			  ct->cnt_ack_msg, start, end, xfers_per_iter);
 
 	return 0;
 }
@@ -2130,7 +2822,8 @@ out:
 
 static int run_pingpong_dgram(struct ct_pingpong *ct)
 {
-	int ret;
+	struct ct_pingpong *t;
+	int i, ret;
 
 	PP_DEBUG("Selected endpoint: DGRAM\n");
 
@@ -2141,8 +2834,11 @@ static int run_pingpong_dgram(struct ct_pingpong *ct)
 	/* Post an extra receive to avoid lacking a posted receive in the
 	 * finalize.
 	 */
-	ret = fi_recv(ct->ep, ct->rx_buf, ct->rx_size, fi_mr_desc(ct->mr), 0,
-		      ct->rx_ctx_ptr);
+	for (i = 0; i < ct->opts.threads; i++) {
+		t = ct->threads[i];
+		ret = fi_recv(t->ep, t->rx_buf, t->rx_size, fi_mr_desc(t->mr),
+			      0, t->rx_ctx_ptr);
+	}
 
 	ret = run_suite_pingpong(ct);
 	if (ret)
@@ -2195,6 +2891,10 @@ static int run_pingpong_msg(struct ct_pingpong *ct)
 	if (ret)
 		return ret;
 
+	ret = pp_connect_threads(ct);
+	if (ret)
+		goto out;
+
 	ret = run_suite_pingpong(ct);
 	if (ret)
 		goto out;
@@ -2214,7 +2914,8 @@ int main(int argc, char **argv)
 		.opts = {
 			.iterations = 10,
 			.transfer_size = 64,
-			.sizes_enabled = PP_DEFAULT_SIZE
+			.sizes_enabled = PP_DEFAULT_SIZE,
+			.threads = 1,
 		},
 		.eq_attr.wait_obj = FI_WAIT_UNSPEC,
 	};
@@ -2229,7 +2930,7 @@ int main(int argc, char **argv)
 
 	ofi_osd_init();
 
-	while ((op = getopt(argc, argv, "hvd:p:e:I:S:B:P:cm:")) != -1) {
+	while ((op = getopt(argc, argv, "hvd:p:e:I:S:B:P:cm:T:xa:Wj")) != -1) {
 		switch (op) {
 		default:
 			pp_parse_opts(&ct, op, optarg);
@@ -2245,6 +2946,10 @@ int main(int argc, char **argv)
 	if (optind < argc)
 		ct.opts.dst_addr = argv[optind];
 
+	ret = pp_check_test_opts(&ct);
+	if (ret)
+		goto out;
+
 	pp_banner_options(&ct);
 
 	switch (ct.hints->ep_attr->type) {
@@ -2265,6 +2970,7 @@ int main(int argc, char **argv)
 		ret = EXIT_FAILURE;
 	}
 
+out:
 	pp_free_res(&ct);
 	return -ret;
 }
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2019 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/param.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_errno.h>
+
+/*
+ * Measures the cost of library startup as seen by a job launching many
+ * processes on a node.  Each child process is forked before libfabric is
+ * initialized, so it pays for loading providers in its first fi_getinfo
+ * call.  Later calls show the steady state cost.
+ */
+
+struct startup_result {
+	int		ret;
+	int		count;
+	uint64_t	first_us;
+	uint64_t	next_us;
+};
+
+static int num_procs = 1;
+static int iterations = 10;
+static char *prov_name;
+static char *node;
+static char *service;
+static enum fi_ep_type ep_type = FI_EP_UNSPEC;
+
+static uint64_t startup_gettime_us(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static int startup_getinfo(struct fi_info *hints, int *count)
+{
+	struct fi_info *info, *cur;
+	int ret;
+
+	ret = fi_getinfo(FI_VERSION(FI_MAJOR_VERSION, FI_MINOR_VERSION),
+			 node, service, 0, hints, &info);
+	if (ret)
+		return ret;
+
+	for (*count = 0, cur = info; cur; cur = cur->next)
+		(*count)++;
+	fi_freeinfo(info);
+	return 0;
+}
+
+static void startup_child(int fd)
+{
+	struct startup_result result = {0};
+	struct fi_info *hints;
+	uint64_t start;
+	int i;
+
+	start = startup_gettime_us();
+	hints = fi_allocinfo();
+	if (!hints) {
+		result.ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	hints->ep_attr->type = ep_type;
+	if (prov_name) {
+		hints->fabric_attr->prov_name = strdup(prov_name);
+		if (!hints->fabric_attr->prov_name) {
+			result.ret = -FI_ENOMEM;
+			goto free;
+		}
+	}
+
+	result.ret = startup_getinfo(hints, &result.count);
+	result.first_us = startup_gettime_us() - start;
+	if (result.ret)
+		goto free;
+
+	start = startup_gettime_us();
+	for (i = 0; i < iterations; i++) {
+		result.ret = startup_getinfo(hints, &result.count);
+		if (result.ret)
+			break;
+	}
+	if (iterations)
+		result.next_us = (startup_gettime_us() - start) / iterations;
+free:
+	fi_freeinfo(hints);
+out:
+	if (write(fd, &result, sizeof(result)) != sizeof(result))
+		exit(EXIT_FAILURE);
+	exit(result.ret ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void startup_show(const char *name, uint64_t min, uint64_t sum,
+			 uint64_t max, int cnt)
+{
+	printf("%-18s %-10" PRIu64 " %-10" PRIu64 " %" PRIu64 "\n",
+	       name, min, sum / cnt, max);
+}
+
+static int run(void)
+{
+	struct startup_result *results;
+	uint64_t first_min = UINT64_MAX, first_max = 0, first_sum = 0;
+	uint64_t next_min = UINT64_MAX, next_max = 0, next_sum = 0;
+	int fds[2], i, ret = 0;
+	ssize_t len;
+	pid_t pid;
+
+	results = calloc(num_procs, sizeof(*results));
+	if (!results)
+		return -FI_ENOMEM;
+
+	if (pipe(fds)) {
+		perror("pipe");
+		free(results);
+		return -errno;
+	}
+
+	for (i = 0; i < num_procs; i++) {
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			num_procs = i;
+			ret = -errno;
+			break;
+		} else if (!pid) {
+			close(fds[0]);
+			startup_child(fds[1]);
+		}
+	}
+	close(fds[1]);
+
+	/* Results are smaller than PIPE_BUF, so writes are never mixed */
+	for (i = 0; i < num_procs; i++) {
+		len = read(fds[0], &results[i], sizeof(results[i]));
+		if (len != sizeof(results[i])) {
+			fprintf(stderr, "missing result from child process\n");
+			ret = -FI_EOTHER;
+			num_procs = i;
+			break;
+		}
+	}
+	close(fds[0]);
+	while (wait(NULL) > 0)
+		;
+
+	for (i = 0; i < num_procs; i++) {
+		if (results[i].ret) {
+			fprintf(stderr, "fi_getinfo: %s\n",
+				fi_strerror(-results[i].ret));
+			if (!ret)
+				ret = results[i].ret;
+			continue;
+		}
+
+		first_min = MIN(first_min, results[i].first_us);
+		first_max = MAX(first_max, results[i].first_us);
+		first_sum += results[i].first_us;
+		next_min = MIN(next_min, results[i].next_us);
+		next_max = MAX(next_max, results[i].next_us);
+		next_sum += results[i].next_us;
+	}
+
+	if (!ret && num_procs) {
+		printf("processes: %d, fi_info entries: %d\n", num_procs,
+		       results[0].count);
+		printf("%-18s %-10s %-10s %s\n", "usec", "min", "avg", "max");
+		startup_show("first fi_getinfo", first_min, first_sum,
+			     first_max, num_procs);
+		if (iterations)
+			startup_show("next fi_getinfo", next_min, next_sum,
+				     next_max, num_procs);
+	}
+
+	free(results);
+	return ret;
+}
+
+static void usage(char *name)
+{
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  %s [OPTIONS]\n", name);
+	fprintf(stderr, "\nTime library startup in concurrently started "
+		"processes.\n");
+	fprintf(stderr, "\nOptions:\n");
+	fprintf(stderr, " -n <procs>\tnumber of processes (default 1)\n");
+	fprintf(stderr, " -I <iter>\tfi_getinfo calls after the first "
+		"(default 10)\n");
+	fprintf(stderr, " -p <prov>\tprovider name hint\n");
+	fprintf(stderr, " -e <ep_type>\tendpoint type hint: msg|rdm|dgram\n");
+	fprintf(stderr, " -s <node>\tnode to pass to fi_getinfo\n");
+	fprintf(stderr, " -P <service>\tservice to pass to fi_getinfo\n");
+	fprintf(stderr, " -h\t\tdisplay this help output\n");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	while ((op = getopt(argc, argv, "n:I:p:e:s:P:h")) != -1) {
+		switch (op) {
+		case 'n':
+			num_procs = atoi(optarg);
+			break;
+		case 'I':
+			iterations = atoi(optarg);
+			break;
+		case 'p':
+			prov_name = optarg;
+			break;
+		case 'e':
+			if (!strcasecmp(optarg, "msg")) {
+				ep_type = FI_EP_MSG;
+			} else if (!strcasecmp(optarg, "rdm")) {
+				ep_type = FI_EP_RDM;
+			} else if (!strcasecmp(optarg, "dgram")) {
+				ep_type = FI_EP_DGRAM;
+			} else {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 's':
+			node = optarg;
+			break;
+		case 'P':
+			service = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_procs < 1 || iterations < 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ret = run();
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}